@@ -17,7 +17,7 @@
  * @param fmt The printf-style format string.
  * @param ... Format arguments.
  */
-void alick_error(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirInst *inst, const char *fmt, ...);
+void alick_error(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirPackedInst *inst, const char *fmt, ...);
 
 /**
  * @brief Logs a warning in the ALIR checker.
@@ -28,27 +28,27 @@ void alick_error(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirInst *
  * @param fmt The printf-style format string.
  * @param ... Format arguments.
  */
-void alick_warning(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirInst *inst, const char *fmt, ...);
+void alick_warning(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirPackedInst *inst, const char *fmt, ...);
 
 /**
  * @brief Pass 1: Control Flow Graph validation.
  * @param ctx The checker context.
- * @param func The ALIR function.
+ * @param pf The packed ALIR function.
  */
-void alick_check_cfg(AlickCtx *ctx, AlirFunction *func);
+void alick_check_cfg(AlickCtx *ctx, AlirPackedFunction *pf);
 
 /**
  * @brief Pass 2: Type, operand, and structural validation.
  * @param ctx The checker context.
- * @param func The ALIR function.
+ * @param pf The packed ALIR function.
  */
-void alick_check_types(AlickCtx *ctx, AlirFunction *func);
+void alick_check_types(AlickCtx *ctx, AlirPackedFunction *pf);
 
 /**
  * @brief Pass 3: Localized memory validity (dangling pointers, UAF, double-free).
  * @param ctx The checker context.
- * @param func The ALIR function.
+ * @param pf The packed ALIR function.
  */
-void alick_check_memory(AlickCtx *ctx, AlirFunction *func);
+void alick_check_memory(AlickCtx *ctx, AlirPackedFunction *pf);
 
 #endif // ALICK_INTERNAL_H
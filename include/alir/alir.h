@@ -26,13 +26,24 @@ typedef enum {
 
 /**
  * @brief A value in ALIR.
+ *
+ * Constants and global references made by the constructors in const.h are
+ * shared from a pool of the module, and a block has one label value that
+ * every branch to it reads. Such values must never be changed in place;
+ * an operand is changed by storing another value into its slot.
  */
 typedef struct AlirValue {
     AlirValueKind kind;
     VarType type;       // Reuse Parser's VarType for type info
     int temp_id;
+    int pooled;         // Shared from the module pool: no use list, never copied per function
 
     Value val;
+    struct AlirBlock *block; // Branch target of a label value (val.str_val keeps its name)
+
+    // Def-use chains, valid after alir_build_uses (see use.h)
+    struct AlirInst *def;   // Instruction writing this value as dest
+    struct AlirUse *uses;   // Operand slots reading this value
 } AlirValue;
 
 /**
@@ -69,6 +80,12 @@ typedef enum {
     ALIR_OP_CAST,
     ALIR_OP_SIZEOF,
     ALIR_OP_ALIGNOF,
+
+    // SSA
+    ALIR_OP_PHI,        // dest = value of the incoming edge; args hold (label, value) pairs
+
+    // Control Flow (cont.)
+    ALIR_OP_SWITCH,     // Multi-way branch on op1; op2 is the default label; args hold (case, label) pairs
 } AlirOpcode;
 
 /**
@@ -83,21 +100,34 @@ typedef struct AlirInst {
     // For Calls or Switches
     AlirValue **args;
     int arg_count;
-    int custom_flag;
+    int custom_flag;        // PHI, SWITCH: capacity of args, in pairs
 
     struct AlirInst *next;
 
     // Source mapping context
     int line;
     int col;
+
+    struct AlirUse *operand_uses; // Uses held by this instruction's operands
 } AlirInst;
 
+/**
+ * @brief One operand slot of an instruction reading a value.
+ */
+typedef struct AlirUse {
+    AlirInst *user;             // Instruction holding the operand
+    AlirValue **slot;           // Operand slot inside the user (op1, op2 or args[i])
+    struct AlirUse *next;       // Next use of the same value
+    struct AlirUse **pprev;     // Link pointing at this use, for O(1) unlinking
+    struct AlirUse *next_operand; // Next use held by the same user
+} AlirUse;
+
 /**
  * @brief A switch case in ALIR.
  */
 typedef struct AlirSwitchCase {
     long value;
-    char *label;
+    struct AlirBlock *block;
     struct AlirSwitchCase *next;
 } AlirSwitchCase;
 
@@ -120,6 +150,9 @@ typedef struct AlirBlock {
     struct AlirBlock *next;
     BlockEdge *pred;
     BlockEdge *succ;
+    long trip_count;        // Header of a counted loop: times its test passes, 0 if unknown
+    int loop_latch;         // Non-zero on the block whose branch closes a counted loop
+    struct AlirValue *ref;  // Label value of this block, made once by alir_val_block
 } AlirBlock;
 
 /**
@@ -148,8 +181,12 @@ typedef struct AlirFunction {
     int is_varargs;
     int is_extern;
     int is_pure;
+    int is_total;           // Terminates on every input (inferred summary)
+    int is_pristine;        // Never returns a tainted value (inferred summary)
+    int inline_hint;        // 1 always inline, -1 never inline, 0 cost model
     char *reason;
     char *cconv;
+    struct OptlirAnalyses *analyses; // Cached by the optlir pass manager while it runs, or NULL
     struct AlirFunction *next;
 } AlirFunction;
 
@@ -227,12 +264,19 @@ typedef struct AlirModule {
     AlirConstFoldEntry *const_folds; // Persistent const fold entries
 
     HashMap const_fold_map;        // name -> AlirValue*
+    HashMap value_pool;            // constant or global key -> shared AlirValue* (see const.h)
 
     // Fast lookup maps
     HashMap struct_map;
     HashMap enum_map;
     HashMap func_map;
 
+    // Canonical type table, filled on demand (see pack.h)
+    VarType *types;
+    uint32_t type_count;
+    uint32_t type_capacity;
+    HashMap type_map;              // type key -> handle + 1
+
     // Diagnostics tracing
     const char *src;
     const char *filename;
@@ -254,7 +298,7 @@ typedef struct AlirSymbol {
 typedef struct FluxVar {
     char *name;
     VarType type;
-    int index; // Index in the context struct
+    int index; // Declaration order in the flux body
     struct FluxVar *next;
 } FluxVar;
 
@@ -284,7 +328,10 @@ typedef struct AlirCtx {
     AlirValue *flux_ctx_ptr;       // The %ctx pointer in Resume
     char *flux_struct_name;        // Name of the struct
     int flux_yield_count;
-    AlirSwitchCase *flux_resume_cases;  // Pending if/else chain for flux dispatch
+    AlirSwitchCase *flux_resume_cases;  // Pending cases of the flux dispatch switch
+    struct FluxYield *flux_yields; // Suspension points of the flux resume being generated
+    HashMap flux_defs;             // Flux function name -> FuncDefNode*, for fused for-in loops
+    struct FluxFusion *flux_fusion; // Innermost generator fused into a for-in, or NULL
 
     int current_line;
     int current_col;
@@ -298,6 +345,7 @@ typedef struct AlirCtx {
     int defer_capacity;
 
     HashMap class_map;      // class name -> ClassNode*
+    HashMap macro_cache;    // macro + argument shape -> cached expansion
 } AlirCtx;
 
 // Struct & Enum Registry
@@ -340,7 +388,7 @@ void alir_register_enum(AlirModule *mod, const char *name, AlirEnumEntry *entrie
  * @brief Creates a constant integer ALIR value.
  * @param mod The ALIR module.
  * @param val The integer value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it (see const.h).
  */
 AlirValue* alir_const_int(AlirModule *mod, long val);
 
@@ -348,7 +396,7 @@ AlirValue* alir_const_int(AlirModule *mod, long val);
  * @brief Creates a constant boolean ALIR value.
  * @param mod The ALIR module.
  * @param val The boolean value (0 or 1).
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it (see const.h).
  */
 AlirValue* alir_const_bool(AlirModule *mod, int val);
 
@@ -514,6 +562,23 @@ const char* alir_op_str(AlirOpcode op);
  */
 void* alir_alloc(AlirModule *mod, size_t size);
 
+/**
+ * @brief Routes the ALIR allocations of the calling thread to an arena of its own.
+ *
+ * Lets several threads transform different functions of one module; the
+ * caller hands the arena's blocks to the module arena afterwards.
+ *
+ * @param arena The arena, or NULL to go back to the module arena.
+ */
+void alir_set_thread_arena(Arena *arena);
+
+/**
+ * @brief Returns the arena ALIR allocations of the calling thread go to.
+ * @param mod The ALIR module.
+ * @return The thread arena if one is set, else the module arena, or NULL.
+ */
+Arena* alir_arena(AlirModule *mod);
+
 /**
  * @brief Duplicates a string into the ALIR module's arena.
  * @param mod The ALIR module.
@@ -544,8 +609,13 @@ AlirModule* alir_read_binary(CompilerContext *ctx, const char *filename);
 #include "generator.h"
 #include "core.h"
 #include "flux.h"
+#include "use.h"
+#include "phi.h"
+#include "switch.h"
+#include "pack.h"
 
 #include "fragment/generate.h"
 #include "fragment/addr.h"
+#include "fragment/macro.h"
 
 #endif // ALIR_H
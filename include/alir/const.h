@@ -1,6 +1,14 @@
 /**
  * @file const.h
  * @brief ALIR constant value constructors.
+ *
+ * Constants and global references are uniqued per module: asking twice for
+ * the same type and bits, or the same global name and type, returns the same
+ * value. Two constants from these constructors are therefore equal exactly
+ * when their pointers are. The values are immutable; a pass that needs a
+ * different constant asks for one. A thread optimizing functions alongside
+ * others gets private values instead, and constants folded in place from
+ * temps are never pooled, so optlir still compares constants by content.
  */
 #ifndef ALIR_CONST_H
 #define ALIR_CONST_H
@@ -11,15 +19,24 @@
  * @brief Creates a constant integer ALIR value.
  * @param mod The ALIR module.
  * @param val The integer value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_int(AlirModule *mod, long val);
 
+/**
+ * @brief Creates a constant ALIR value of any scalar type.
+ * @param mod The ALIR module.
+ * @param type The type of the constant.
+ * @param val The bits, with the bytes the type does not use zeroed.
+ * @return The constant, shared with other uses of it.
+ */
+AlirValue* alir_const_value(AlirModule *mod, VarType type, Value val);
+
 /**
  * @brief Creates a constant char ALIR value.
  * @param mod The ALIR module.
  * @param val The char value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_char(AlirModule *mod, char val);
 
@@ -27,7 +44,7 @@ AlirValue* alir_const_char(AlirModule *mod, char val);
  * @brief Creates a constant unsigned char ALIR value.
  * @param mod The ALIR module.
  * @param val The unsigned char value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_unsigned_char(AlirModule *mod, unsigned char val);
 
@@ -35,7 +52,7 @@ AlirValue* alir_const_unsigned_char(AlirModule *mod, unsigned char val);
  * @brief Creates a constant unsigned int ALIR value.
  * @param mod The ALIR module.
  * @param val The unsigned int value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_unsigned_int(AlirModule *mod, unsigned int val);
 
@@ -43,7 +60,7 @@ AlirValue* alir_const_unsigned_int(AlirModule *mod, unsigned int val);
  * @brief Creates a constant float ALIR value.
  * @param mod The ALIR module.
  * @param val The float value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_float(AlirModule *mod, float val);
 
@@ -51,7 +68,7 @@ AlirValue* alir_const_float(AlirModule *mod, float val);
  * @brief Creates a constant double ALIR value.
  * @param mod The ALIR module.
  * @param val The double value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_double(AlirModule *mod, double val);
 
@@ -59,7 +76,7 @@ AlirValue* alir_const_double(AlirModule *mod, double val);
  * @brief Creates a constant long ALIR value.
  * @param mod The ALIR module.
  * @param val The long value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_long(AlirModule *mod, long val);
 
@@ -67,7 +84,7 @@ AlirValue* alir_const_long(AlirModule *mod, long val);
  * @brief Creates a constant long long ALIR value.
  * @param mod The ALIR module.
  * @param val The long long value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_long_long(AlirModule *mod, long long val);
 
@@ -75,7 +92,7 @@ AlirValue* alir_const_long_long(AlirModule *mod, long long val);
  * @brief Creates a constant unsigned long ALIR value.
  * @param mod The ALIR module.
  * @param val The unsigned long value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_unsigned_long(AlirModule *mod, unsigned long val);
 
@@ -83,7 +100,7 @@ AlirValue* alir_const_unsigned_long(AlirModule *mod, unsigned long val);
  * @brief Creates a constant unsigned long long ALIR value.
  * @param mod The ALIR module.
  * @param val The unsigned long long value.
- * @return The created ALIR value.
+ * @return The constant, shared with other uses of it.
  */
 AlirValue* alir_const_unsigned_long_long(AlirModule *mod, unsigned long long val);
 
@@ -109,18 +126,35 @@ AlirValue* alir_val_var(AlirModule *mod, const char *name);
  * @param mod The ALIR module.
  * @param name The global name.
  * @param type The type of the global.
- * @return The created ALIR value.
+ * @return The reference, shared with other uses of it.
  */
 AlirValue* alir_val_global(AlirModule *mod, const char *name, VarType type);
 
 /**
  * @brief Creates a label ALIR value.
+ *
+ * Label names are only unique within a function and alir_resolve_labels
+ * binds the value to a block of one, so these are not pooled; prefer
+ * alir_val_block.
+ *
  * @param mod The ALIR module.
  * @param label The label name.
  * @return The created ALIR value.
  */
 AlirValue* alir_val_label(AlirModule *mod, const char *label);
 
+/**
+ * @brief Returns the label ALIR value that refers to a block directly.
+ *
+ * The value is made on first use and kept on the block, so every branch
+ * to the block reads the same one.
+ *
+ * @param mod The ALIR module.
+ * @param block The target block.
+ * @return The label value of the block.
+ */
+AlirValue* alir_val_block(AlirModule *mod, AlirBlock *block);
+
 /**
  * @brief Creates a type ALIR value.
  * @param mod The ALIR module.
@@ -57,4 +57,30 @@ AlirBlock* alir_add_block(AlirModule *mod, AlirFunction *func, const char *label
  */
 void alir_append_inst(AlirBlock *block, AlirInst *inst);
 
+/**
+ * @brief Returns the number of branch target slots of an instruction.
+ * @param inst The instruction.
+ * @return 1 for JUMP, 2 for CONDI, 1 + cases for SWITCH, 0 otherwise.
+ */
+int alir_branch_count(AlirInst *inst);
+
+/**
+ * @brief Returns one branch target slot of an instruction.
+ * @param inst The instruction.
+ * @param k The slot index below alir_branch_count().
+ * @return The slot, or NULL if it does not hold a label.
+ */
+AlirValue** alir_branch_slot(AlirInst *inst, int k);
+
+/**
+ * @brief Binds label values that only carry a name to the block of that name.
+ *
+ * Generation creates labels bound to their blocks; this is for code that
+ * arrives by name, such as the binary format.
+ *
+ * @param mod The ALIR module.
+ * @param func The function whose branch targets and phi predecessors are resolved.
+ */
+void alir_resolve_labels(AlirModule *mod, AlirFunction *func);
+
 #endif // ALIR_CORE_H
@@ -5,4 +5,47 @@
 #ifndef ALIR_FLUX_H
 #define ALIR_FLUX_H
 
+#define FLUX_FUSE_MAX_EMITS 4   // Emits a generator may have to be fused; each copies the loop body
+
+/**
+ * @brief Marks where a flux local is declared, so its old value counts as dead there.
+ * @param ctx The ALIR context.
+ * @param slot Slot of the declared variable.
+ */
+void alir_flux_mark_decl(AlirCtx *ctx, AlirValue *slot);
+
+/**
+ * @brief Registers the flux functions of an AST so for-in loops can find their bodies.
+ * @param ctx The ALIR context.
+ * @param root Root AST node.
+ */
+void alir_scan_flux_defs(AlirCtx *ctx, ASTNode *root);
+
+/**
+ * @brief Generates a for-in over a generator call as one plain loop, if it can.
+ *
+ * The generator body is generated in place, with its own names, and every
+ * emit runs a copy of the loop body. Returning from the generator ends the
+ * loop. No context struct or resume call is left behind.
+ *
+ * @param ctx The ALIR context.
+ * @param fn The for-in AST node.
+ * @return Non-zero if the loop was generated, 0 to lower it through the resume function.
+ */
+int alir_flux_fuse_for_in(AlirCtx *ctx, ForInNode *fn);
+
+/**
+ * @brief Generates an emit of a fused generator: the loop body, once.
+ * @param ctx The ALIR context.
+ * @param en The emit AST node.
+ */
+void alir_flux_fuse_emit(AlirCtx *ctx, EmitNode *en);
+
+/**
+ * @brief Generates a return of a fused generator, which ends the loop.
+ * @param ctx The ALIR context.
+ * @param rn The return AST node.
+ */
+void alir_flux_fuse_return(AlirCtx *ctx, ReturnNode *rn);
+
 #endif // ALIR_FLUX_H
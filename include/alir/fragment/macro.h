@@ -0,0 +1,23 @@
+/**
+ * @file macro.h
+ * @brief ALIR macro expansion with a per-shape expansion cache.
+ */
+#ifndef ALIR_FRAGMENT_MACRO_H
+#define ALIR_FRAGMENT_MACRO_H
+
+/**
+ * @brief Expands a macro call inline into the current block.
+ *
+ * The cloned, rewritten and semantically checked body is cached per macro and
+ * argument shape (node kinds and types); later calls with the same shape only
+ * re-target the argument placeholders before lowering.
+ *
+ * @param ctx The ALIR context.
+ * @param fd The macro definition.
+ * @param this_arg The receiver bound to "this", or NULL for plain/static calls.
+ * @param args The call-site argument list.
+ * @param scoped Non-zero to check and lower the body in the macro's namespace and scope.
+ */
+void alir_gen_macro_expansion(AlirCtx *ctx, FuncDefNode *fd, ASTNode *this_arg, ASTNode *args, int scoped);
+
+#endif // ALIR_FRAGMENT_MACRO_H
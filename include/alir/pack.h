@@ -0,0 +1,120 @@
+/**
+ * @file pack.h
+ * @brief Dense, index-based storage for ALIR functions.
+ *
+ * The linked form (AlirBlock -> AlirInst -> AlirValue) is what generation and
+ * optlir produce. A packed function stores the same code in three flat arrays:
+ * instructions (each block is a contiguous range), values (operands are 32-bit
+ * indices into it, with equal temps, names and labels sharing one entry) and
+ * the module's canonical type table. Readers that only walk the code, such as
+ * alick, use the packed form; alir_unpack_function turns it back into the
+ * linked form for everything else.
+ */
+#ifndef ALIR_PACK_H
+#define ALIR_PACK_H
+
+#include <stdint.h>
+
+typedef uint32_t AlirValueRef;  // Index into AlirPackedFunction.values, 0 = none
+typedef uint32_t AlirTypeRef;   // Index into AlirModule.types
+
+#define ALIR_VALUE_NONE 0
+#define ALIR_PACKED_INLINE_ARGS 2
+
+/**
+ * @brief A value of a packed function.
+ */
+typedef struct AlirPackedValue {
+    uint8_t kind;           // AlirValueKind
+    uint8_t pooled;         // Copied from AlirValue.pooled
+    AlirTypeRef type;
+    int32_t temp_id;
+    int32_t block;          // Target block index of a label, -1 otherwise
+    Value val;
+} AlirPackedValue;
+
+/**
+ * @brief An instruction of a packed function.
+ */
+typedef struct AlirPackedInst {
+    uint16_t op;            // AlirOpcode
+    uint32_t arg_count;
+    int32_t custom_flag;
+    AlirValueRef dest;
+    AlirValueRef op1;
+    AlirValueRef op2;
+    union {
+        AlirValueRef inline_args[ALIR_PACKED_INLINE_ARGS];
+        AlirValueRef *args; // When arg_count > ALIR_PACKED_INLINE_ARGS
+    };
+    int32_t line;
+    int32_t col;
+} AlirPackedInst;
+
+/**
+ * @brief A block of a packed function: a range of its instruction array.
+ */
+typedef struct AlirPackedBlock {
+    AlirBlock *block;       // Block of the linked form (label, CFG edges)
+    uint32_t first;
+    uint32_t count;
+} AlirPackedBlock;
+
+/**
+ * @brief A function stored densely.
+ */
+typedef struct AlirPackedFunction {
+    AlirFunction *func;
+    AlirPackedBlock *blocks;
+    uint32_t block_count;
+    AlirPackedInst *insts;
+    uint32_t inst_count;
+    AlirPackedValue *values; // values[0] is the "none" sentinel
+    uint32_t value_count;
+} AlirPackedFunction;
+
+/**
+ * @brief Returns the canonical handle of a type, adding it to the module table.
+ * @param mod The ALIR module.
+ * @param t The type.
+ * @return The type handle.
+ */
+AlirTypeRef alir_type_ref(AlirModule *mod, VarType t);
+
+/**
+ * @brief Returns the type behind a canonical handle.
+ * @param mod The ALIR module.
+ * @param ref The type handle.
+ * @return The type.
+ */
+VarType* alir_type_get(AlirModule *mod, AlirTypeRef ref);
+
+/**
+ * @brief Packs the linked form of a function into dense arrays.
+ * @param mod The ALIR module (arrays come from its arena).
+ * @param func The function.
+ * @return The packed function.
+ */
+AlirPackedFunction* alir_pack_function(AlirModule *mod, AlirFunction *func);
+
+/**
+ * @brief Rebuilds the linked form of a function from its packed form.
+ *
+ * Blocks keep their identity; instructions and values are recreated, with
+ * one AlirValue per packed value so equal operands share a pointer. PHI and
+ * SWITCH argument lists are sized exactly, and def-use chains must be
+ * rebuilt with alir_build_uses.
+ *
+ * @param mod The ALIR module.
+ * @param pf The packed function.
+ */
+void alir_unpack_function(AlirModule *mod, AlirPackedFunction *pf);
+
+/**
+ * @brief Returns the argument references of a packed instruction.
+ * @param inst The instruction.
+ * @return Its arg_count argument references.
+ */
+AlirValueRef* alir_packed_args(AlirPackedInst *inst);
+
+#endif // ALIR_PACK_H
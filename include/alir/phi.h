@@ -0,0 +1,76 @@
+/**
+ * @file phi.h
+ * @brief Phi instructions of ALIR in SSA form.
+ *
+ * A phi sits at the head of its block and picks the value of the edge the
+ * block was entered through. Its args hold one (label, value) pair per
+ * predecessor: args[2k] is the predecessor block, args[2k + 1] the value.
+ */
+#ifndef ALIR_PHI_H
+#define ALIR_PHI_H
+
+/**
+ * @brief Creates an empty phi.
+ * @param mod The ALIR module.
+ * @param dest The value the phi defines.
+ * @param capacity Number of incoming pairs to reserve.
+ * @return The new phi instruction.
+ */
+AlirInst* alir_phi_create(AlirModule *mod, AlirValue *dest, int capacity);
+
+/**
+ * @brief Inserts a phi at the head of a block.
+ * @param block The block.
+ * @param phi The phi instruction.
+ */
+void alir_phi_insert(AlirBlock *block, AlirInst *phi);
+
+/**
+ * @brief Returns the value a phi takes when entered from a block.
+ * @param phi The phi instruction.
+ * @param pred The predecessor block.
+ * @return The incoming value, or NULL if the phi has no entry for pred.
+ */
+AlirValue* alir_phi_incoming(AlirInst *phi, AlirBlock *pred);
+
+/**
+ * @brief Appends an incoming pair to a phi, keeping the def-use chains valid.
+ * @param mod The ALIR module.
+ * @param phi The phi instruction.
+ * @param pred The predecessor block.
+ * @param val The value flowing in from pred.
+ */
+void alir_phi_add_incoming(AlirModule *mod, AlirInst *phi, AlirBlock *pred, AlirValue *val);
+
+/**
+ * @brief Removes the entry of one predecessor from every phi of a block.
+ *
+ * Called when the last edge from pred to block disappears.
+ *
+ * @param mod The ALIR module.
+ * @param block The block holding the phis.
+ * @param pred The predecessor block.
+ */
+void alir_phi_remove_pred(AlirModule *mod, AlirBlock *block, AlirBlock *pred);
+
+/**
+ * @brief Drops the phi entries of a block whose predecessor is not in a set.
+ *
+ * One pass over the entries, for when many predecessors go away at once.
+ *
+ * @param mod The ALIR module.
+ * @param block The block holding the phis.
+ * @param preds Blocks to keep, keyed by "%p" of the block.
+ */
+void alir_phi_keep_preds(AlirModule *mod, AlirBlock *block, HashMap *preds);
+
+/**
+ * @brief Renames a predecessor in every phi of a block.
+ * @param mod The ALIR module.
+ * @param block The block holding the phis.
+ * @param from The old predecessor block.
+ * @param to The new predecessor block.
+ */
+void alir_phi_rename_pred(AlirModule *mod, AlirBlock *block, AlirBlock *from, AlirBlock *to);
+
+#endif // ALIR_PHI_H
@@ -0,0 +1,58 @@
+/**
+ * @file switch.h
+ * @brief Multi-way branch instructions of ALIR.
+ *
+ * A switch compares op1 against a table of integer cases and branches to
+ * the matching label, or to the default label in op2. Its args hold one
+ * (case, label) pair per case: args[2k] is the constant, args[2k + 1] the
+ * target. Several cases may share a target; case values are unique.
+ */
+#ifndef ALIR_SWITCH_H
+#define ALIR_SWITCH_H
+
+/**
+ * @brief Creates a switch without cases.
+ * @param mod The ALIR module.
+ * @param cond The value being dispatched on.
+ * @param default_bb The block taken when no case matches.
+ * @param capacity Number of cases to reserve.
+ * @return The new switch instruction.
+ */
+AlirInst* alir_switch_create(AlirModule *mod, AlirValue *cond, AlirBlock *default_bb, int capacity);
+
+/**
+ * @brief Appends a case to a switch.
+ *
+ * The caller keeps case values unique.
+ *
+ * @param mod The ALIR module.
+ * @param sw The switch instruction.
+ * @param value The case value.
+ * @param target The block taken for that value.
+ */
+void alir_switch_add_case(AlirModule *mod, AlirInst *sw, long value, AlirBlock *target);
+
+/**
+ * @brief Returns the number of cases of a switch.
+ * @param sw The switch instruction.
+ * @return Its case count.
+ */
+int alir_switch_case_count(AlirInst *sw);
+
+/**
+ * @brief Returns the value of one case of a switch.
+ * @param sw The switch instruction.
+ * @param k The case index.
+ * @return The case value.
+ */
+long alir_switch_case_value(AlirInst *sw, int k);
+
+/**
+ * @brief Returns the block a switch branches to for a value.
+ * @param sw The switch instruction.
+ * @param value The dispatched value.
+ * @return The matching case target, or the default block.
+ */
+AlirBlock* alir_switch_target(AlirInst *sw, long value);
+
+#endif // ALIR_SWITCH_H
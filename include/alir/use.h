@@ -0,0 +1,43 @@
+/**
+ * @file use.h
+ * @brief Def-use chains over ALIR instructions.
+ */
+#ifndef ALIR_USE_H
+#define ALIR_USE_H
+
+/**
+ * @brief Rebuilds the def pointers and use lists of a function.
+ *
+ * Every value read by an operand of the function gets its use list rebuilt
+ * and every destination gets its def pointer. Labels and type operands are
+ * not tracked. Passes that edit operands afterwards keep the chains valid
+ * through alir_set_operand, alir_replace_all_uses and alir_drop_uses.
+ *
+ * @param mod The ALIR module (use records come from its arena).
+ * @param func The function.
+ */
+void alir_build_uses(AlirModule *mod, AlirFunction *func);
+
+/**
+ * @brief Sets one operand slot of an instruction, keeping the chains valid.
+ * @param mod The ALIR module.
+ * @param inst The instruction owning the slot.
+ * @param slot The operand slot (&inst->op1, &inst->op2 or &inst->args[i]).
+ * @param val The new operand, or NULL.
+ */
+void alir_set_operand(AlirModule *mod, AlirInst *inst, AlirValue **slot, AlirValue *val);
+
+/**
+ * @brief Rewrites every use of a value to read another value instead.
+ * @param from The value being replaced.
+ * @param to The replacement.
+ */
+void alir_replace_all_uses(AlirValue *from, AlirValue *to);
+
+/**
+ * @brief Unlinks the operand uses of an instruction that is being removed.
+ * @param inst The instruction.
+ */
+void alir_drop_uses(AlirInst *inst);
+
+#endif // ALIR_USE_H
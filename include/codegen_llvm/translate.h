@@ -14,4 +14,12 @@
  */
 void translate_inst(CodegenCtx *ctx, AlirInst *inst);
 
+/**
+ * @brief Adds the incoming values of every phi of a translated function.
+ * @param ctx The code generation context.
+ * @param func The ALIR function.
+ * @param exits Map from ALIR block label to the LLVM block it ended in.
+ */
+void translate_phi_incoming(CodegenCtx *ctx, AlirFunction *func, HashMap *exits);
+
 #endif // LLVM_CODEGEN_TRANSLATE_H
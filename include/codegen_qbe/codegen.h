@@ -37,6 +37,19 @@ void print_val(FILE *out, AlirValue *v);
  */
 void emit_inst(FILE *out, AlirModule *module, AlirInst *inst, AlirBlock *next_block);
 
+/**
+ * @brief Counts the points where a block is split into several QBE blocks.
+ *
+ * Each FALLBACK ends in a QBE block of its own. The code after the last one
+ * gets the label `@<label>.exit`, which phis name as the predecessor. A
+ * block ending in a switch reaches each target through its own landing
+ * block `@<label>.to.<target>` instead.
+ *
+ * @param b The ALIR block.
+ * @return The number of FALLBACK instructions in the block.
+ */
+int qbe_block_splits(AlirBlock *b);
+
 /**
  * @brief Finds the maximum temporary ID in a module.
  * @param module The ALIR module.
@@ -52,5 +65,6 @@ int alloc_qbe_temp(void);
 
 extern int s_next_qbe_temp;
 extern AlirFunction *s_current_qbe_function;
+extern AlirBlock *s_current_qbe_block;
 
 #endif // QBE_CODEGEN_H
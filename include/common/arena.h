@@ -79,6 +79,16 @@ void arena_reset(Arena *a);
  */
 void arena_free(Arena *a);
 
+/**
+ * @brief Moves the blocks of one arena into another, so they live as long as it does.
+ *
+ * The source arena is left empty and its interner is released.
+ *
+ * @param a The arena taking the blocks.
+ * @param from The arena giving them up.
+ */
+void arena_adopt(Arena *a, Arena *from);
+
 /**
  * @brief Duplicates a string into the arena allocator (also interns it).
  * @param a The arena allocator.
@@ -81,6 +81,42 @@ const char* token_type_to_string(TokenType type);
  * @return A short string describing the token.
  */
 const char* get_token_description(TokenType type);
+/**
+ * @brief A node of a BK-tree, children are keyed by their distance to it.
+ */
+typedef struct BKNode {
+    const char *word;
+    int dist;               // Distance to the parent word
+    int max_child;          // Largest distance among the children
+    int order;              // Insertion order, breaks ties between suggestions
+    struct BKNode *children;
+    struct BKNode *sibling;
+} BKNode;
+
+/**
+ * @brief A BK-tree over words under Levenshtein distance, for "did you mean" lookups.
+ */
+typedef struct BKTree {
+    BKNode *root;
+    int count;
+} BKTree;
+
+/**
+ * @brief Inserts a word into a BK-tree (duplicates are ignored).
+ * @param tree The tree.
+ * @param arena Arena for the node; the word is not copied.
+ * @param word The word.
+ */
+void bk_tree_insert(BKTree *tree, Arena *arena, const char *word);
+/**
+ * @brief Finds the closest word in a BK-tree.
+ * @param tree The tree.
+ * @param word The word to match.
+ * @param max_dist The largest accepted distance.
+ * @param out_dist Optional output for the distance of the match.
+ * @return The closest word (earliest inserted on ties), or NULL if none is within max_dist.
+ */
+const char* bk_tree_closest(BKTree *tree, const char *word, int max_dist, int *out_dist);
 /**
  * @brief Finds the closest keyword to an identifier using Levenshtein distance.
  * @param ident The identifier to match.
@@ -94,5 +130,13 @@ const char* find_closest_keyword(const char *ident);
  * @return The edit distance, or 100 on null input.
  */
 int levenshtein_dist(const char *s1, const char *s2);
+/**
+ * @brief Computes the Levenshtein distance between two strings, giving up early.
+ * @param s1 First string.
+ * @param s2 Second string.
+ * @param max_dist The largest distance of interest.
+ * @return The edit distance, or max_dist + 1 if it exceeds max_dist.
+ */
+int levenshtein_bounded(const char *s1, const char *s2, int max_dist);
 
 #endif // DIAGNOSTIC_H
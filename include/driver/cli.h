@@ -9,9 +9,10 @@
 
 /**
  * @brief Runs the REPL.
+ * @param trace_incremental Print which declarations each line reuses, checks or drops.
  * @return 0 on success, non-zero on failure.
  */
-int run_repl(void);
+int run_repl(int trace_incremental);
 
 /**
  * @brief Runs a source file.
@@ -25,6 +25,7 @@ typedef struct MetalirVM {
     void *registers;
     VMGlobal *globals;
     int status;
+    HashMap switch_tables;  // "%p" of a SWITCH -> its case table ("%lld" -> block)
 } MetalirVM;
 
 /**
@@ -85,12 +85,4 @@ void vm_eval_flow(VMContext *ctx, AlirInst *inst);
  */
 void vm_eval_misc(VMContext *ctx, AlirInst *inst);
 
-/**
- * @brief Finds a basic block by label.
- * @param func The ALIR function.
- * @param label The block label.
- * @return The block, or NULL if not found.
- */
-AlirBlock* find_block(AlirFunction *func, const char *label);
-
 #endif // VM_INTERNAL_H
@@ -0,0 +1,57 @@
+/**
+ * @file alias.h
+ * @brief Alias classes of the memory an ALIR function touches.
+ */
+#ifndef OPTLIR_ALIAS_H
+#define OPTLIR_ALIAS_H
+
+#include "../alir/alir.h"
+
+/**
+ * @brief Memory of one function split into classes that never overlap.
+ *
+ * Every stack slot whose address is only loaded from, stored to or used as
+ * the base of a field address (with the same restriction on that address)
+ * gets a class of its own. All other memory shares class 0: globals, the
+ * heap, and any slot whose address is passed on.
+ */
+typedef struct OptlirAlias {
+    HashMap classes;            // "%p" of a stack address -> alias class
+    int count;                  // Number of classes, including class 0
+} OptlirAlias;
+
+/**
+ * @brief Computes the alias classes of a function.
+ * @param module The ALIR module.
+ * @param func The function (def-use chains valid).
+ * @param alias Receives the classes.
+ */
+void optlir_alias_build(AlirModule *module, AlirFunction *func, OptlirAlias *alias);
+
+/**
+ * @brief Returns the alias class of an address.
+ * @param alias The alias classes.
+ * @param addr The address.
+ * @return The class of its stack slot, or 0 for memory reachable from elsewhere.
+ */
+int optlir_alias_class(OptlirAlias *alias, AlirValue *addr);
+
+/**
+ * @brief Returns the function a call reaches directly, if it is pure on values.
+ *
+ * A pure function may still write through an address it is given, so a call
+ * passing one is treated as writing class 0.
+ *
+ * @param module The ALIR module.
+ * @param call The call instruction.
+ * @return The callee, or NULL for impure, indirect and address-taking calls.
+ */
+AlirFunction* optlir_alias_pure_callee(AlirModule *module, AlirInst *call);
+
+/**
+ * @brief Releases the classes when they were not allocated from an arena.
+ * @param alias The alias classes.
+ */
+void optlir_alias_free(OptlirAlias *alias);
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * @file callgraph.h
+ * @brief Call and reference graph of an ALIR module, for interprocedural passes.
+ */
+#ifndef OPTLIR_CALLGRAPH_H
+#define OPTLIR_CALLGRAPH_H
+
+#include "../alir/alir.h"
+
+/**
+ * @brief What a call graph node stands for.
+ */
+typedef enum OptlirCgKind {
+    OPTLIR_CG_FUNCTION,
+    OPTLIR_CG_GLOBAL,
+    OPTLIR_CG_STRUCT
+} OptlirCgKind;
+
+/**
+ * @brief A symbol of the module: a function, a global or a struct type.
+ */
+typedef struct OptlirCgNode {
+    OptlirCgKind kind;
+    const char *name;           // Interned symbol name
+    AlirFunction *func;         // OPTLIR_CG_FUNCTION
+    AlirGlobal *global;         // OPTLIR_CG_GLOBAL
+    AlirStruct *type;           // OPTLIR_CG_STRUCT
+    int *calls;                 // Callee node of each direct call site
+    int call_count;
+    int *refs;                  // Other symbols it needs, each once
+    int ref_count;
+    int callers;                // Direct call sites reaching it
+    int live;                   // Set by optlir_callgraph_mark_live
+    int call_cap;
+    int ref_cap;
+    int next_suffix;            // Next struct with the same name after its last '.', or -1
+} OptlirCgNode;
+
+/**
+ * @brief The symbols of a module and what each one uses.
+ *
+ * Functions come first, in module order, so node k is the k-th function.
+ * A call edge is a direct call. A reference edge is any other use: a
+ * function whose address is taken, a global, or a class type named in a
+ * signature, an instruction or a field.
+ */
+typedef struct OptlirCallGraph {
+    AlirModule *module;
+    OptlirCgNode *nodes;
+    int count;
+    int func_count;             // Nodes [0, func_count) are functions
+    HashMap index;              // function or global name -> node + 1
+    HashMap structs;            // struct name -> node + 1
+    HashMap suffixes;           // struct name after its last '.' -> first such node + 1
+} OptlirCallGraph;
+
+/**
+ * @brief Builds the call and reference graph of a module.
+ * @param module The ALIR module.
+ * @param cg Receives the graph.
+ */
+void optlir_callgraph_build(AlirModule *module, OptlirCallGraph *cg);
+
+/**
+ * @brief Returns the node of a function or global.
+ * @param cg The call graph.
+ * @param name The symbol name.
+ * @return The node index, or -1 when the module does not define the name.
+ */
+int optlir_callgraph_find(OptlirCallGraph *cg, const char *name);
+
+/**
+ * @brief Returns the node of a struct type.
+ *
+ * Structs have names of their own: a class and its constructor share one.
+ *
+ * @param cg The call graph.
+ * @param name The struct name.
+ * @return The node index, or -1 when the module has no such struct.
+ */
+int optlir_callgraph_find_struct(OptlirCallGraph *cg, const char *name);
+
+/**
+ * @brief Returns the function a call reaches directly.
+ * @param cg The call graph.
+ * @param call The call instruction.
+ * @return The callee node index, or -1 for indirect and unknown callees.
+ */
+int optlir_callgraph_callee(OptlirCallGraph *cg, AlirInst *call);
+
+/**
+ * @brief Marks every symbol reachable from the program roots as live.
+ *
+ * The root is main; a live generator also keeps its resume function.
+ *
+ * @param cg The call graph.
+ * @return Number of live nodes.
+ */
+int optlir_callgraph_mark_live(OptlirCallGraph *cg);
+
+/**
+ * @brief Releases the lookup tables when they were not allocated from an arena.
+ * @param cg The call graph.
+ */
+void optlir_callgraph_free(OptlirCallGraph *cg);
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file dom.h
+ * @brief Dominator tree and dominance frontiers of ALIR functions.
+ */
+#ifndef OPTLIR_DOM_H
+#define OPTLIR_DOM_H
+
+#include "../alir/alir.h"
+
+/**
+ * @brief A list of block indices.
+ */
+typedef struct OptlirIndexList {
+    int index;
+    struct OptlirIndexList *next;
+} OptlirIndexList;
+
+/**
+ * @brief Dominator information of one function.
+ *
+ * Only blocks reachable from the entry are numbered, in depth-first
+ * preorder, so the entry is index 0 and every other block comes after its
+ * immediate dominator.
+ */
+typedef struct OptlirDomTree {
+    AlirBlock **blocks;         // index -> block
+    int count;
+    int *idom;                  // index -> immediate dominator (entry: itself)
+    int *child;                 // index -> first dominator-tree child, or -1
+    int *sibling;               // index -> next child of the same parent, or -1
+    int *pre;                   // index -> dominator-tree preorder number
+    int *post;                  // index -> dominator-tree postorder number
+    OptlirIndexList **frontier; // index -> dominance frontier
+    int *preds;                 // Reachable predecessor indices, grouped by block
+    int *pred_first;            // index -> first entry of preds
+    int *pred_end;              // index -> one past the last entry of preds
+    HashMap index;              // "%p" of a block -> index + 1
+} OptlirDomTree;
+
+/**
+ * @brief Computes the dominator tree and dominance frontiers of a function.
+ * @param module The ALIR module (tables come from its arena).
+ * @param func The function (pred/succ edges must be valid).
+ * @return The dominator information, or NULL for a function without blocks.
+ */
+OptlirDomTree* optlir_dom_build(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Returns the index of a block.
+ * @param dom The dominator information.
+ * @param b The block.
+ * @return Its index, or -1 if the block is unreachable.
+ */
+int optlir_dom_index(OptlirDomTree *dom, AlirBlock *b);
+
+/**
+ * @brief Whether one block dominates another.
+ * @param dom The dominator information.
+ * @param a Index of the dominating block.
+ * @param b Index of the dominated block.
+ * @return Non-zero if every path from the entry to b passes through a.
+ */
+int optlir_dominates(OptlirDomTree *dom, int a, int b);
+
+#endif
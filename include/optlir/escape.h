@@ -0,0 +1,35 @@
+/**
+ * @file escape.h
+ * @brief Interprocedural escape analysis turning heap allocations into stack slots.
+ */
+#ifndef OPTLIR_ESCAPE_H
+#define OPTLIR_ESCAPE_H
+
+#include "../alir/alir.h"
+#include "callgraph.h"
+
+#define OPTLIR_ESCAPE_MAX_BYTES     4096    // Largest malloc moved to the stack
+#define OPTLIR_ESCAPE_FRAME_BYTES   16384   // Stack one function may gain this way
+
+/**
+ * @brief Moves malloc calls whose memory never outlives the function onto its stack.
+ *
+ * Every parameter of every function gets a summary: whether the callee may
+ * keep the pointer it is given (store it, free it, hand it to unknown code)
+ * and whether it may return it. The summaries start out optimistic and are
+ * recomputed over the call graph, callers after their callees, until none
+ * changes, so recursion needs no special case.
+ *
+ * A malloc of a constant size then becomes an alloca in the entry block when
+ * no pointer derived from it is stored, returned or passed to a parameter
+ * that keeps it, and none is carried into the next iteration of a loop
+ * around the call. The free calls releasing it are removed. Recursive
+ * functions are left alone, since their frames pile up.
+ *
+ * @param module The ALIR module (SSA form).
+ * @param cg The call graph of the module.
+ * @return Number of allocations moved.
+ */
+int optlir_escape_heap(AlirModule *module, OptlirCallGraph *cg);
+
+#endif
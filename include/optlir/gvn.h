@@ -0,0 +1,25 @@
+/**
+ * @file gvn.h
+ * @brief Dominator-based global value numbering over ALIR functions.
+ */
+#ifndef OPTLIR_GVN_H
+#define OPTLIR_GVN_H
+
+#include "../alir/alir.h"
+
+/**
+ * @brief Removes instructions recomputing a value a dominating one computed.
+ *
+ * Instructions are numbered by opcode, result type and the numbers of their
+ * operands. Pure calls on plain values are numbered like arithmetic. Loads
+ * are numbered together with the memory they read, so a store or call in
+ * between keeps them apart, and a store hands its value to the loads it
+ * dominates.
+ *
+ * @param module The ALIR module.
+ * @param func The function (SSA form).
+ * @return Number of instructions removed.
+ */
+int optlir_gvn_function(AlirModule *module, AlirFunction *func);
+
+#endif
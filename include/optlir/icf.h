@@ -0,0 +1,37 @@
+/**
+ * @file icf.h
+ * @brief Identical function folding over optimized ALIR.
+ */
+#ifndef OPTLIR_ICF_H
+#define OPTLIR_ICF_H
+
+#include "../alir/alir.h"
+#include "callgraph.h"
+
+#define OPTLIR_ICF_INST_BYTES   4   // Machine code bytes counted per ALIR instruction folded away
+#define OPTLIR_ICF_MAX_ROUNDS   4   // Folding rounds; each can make the callers of folded functions equal
+
+/**
+ * @brief Folds functions whose optimized bodies are the same into one.
+ *
+ * Template instantiations often compile to the same code: a compound over
+ * int and unsigned int, say, differs only in the signedness of values the
+ * backends treat alike. Every function body gets a structural hash, and
+ * functions in one bucket are compared instruction by instruction, with
+ * temps matched by first occurrence, labels by block position and calls
+ * of the function itself matched with each other. Signedness counts only
+ * where an instruction reads it: casts, switches, shifts right, ordered
+ * compares, divisions and call arguments.
+ *
+ * The first function of a group stays. Direct calls of the others are sent
+ * to it and "unused" then drops them; one whose address is taken keeps its
+ * name and becomes a thunk calling the one that stays. Folding changes the
+ * callers, so the pass repeats while the last round folded anything.
+ *
+ * @param module The ALIR module.
+ * @param cg The call graph of the module.
+ * @return Number of functions folded.
+ */
+int optlir_fold_identical(AlirModule *module, OptlirCallGraph *cg);
+
+#endif
@@ -0,0 +1,27 @@
+/**
+ * @file indvar.h
+ * @brief Induction variables, strength reduction and trip counts of ALIR loops.
+ */
+#ifndef OPTLIR_INDVAR_H
+#define OPTLIR_INDVAR_H
+
+#include "../alir/alir.h"
+
+/**
+ * @brief Rewrites values derived from a loop counter into running values and
+ * records the trip counts of counted loops.
+ *
+ * A basic induction variable is a header phi that the latch advances by a
+ * constant. An element address indexed by one becomes a pointer that steps
+ * by the same amount, and a multiple of one becomes a sum. When the header
+ * test compares the counter with a constant and is the only way out, the
+ * header gets the trip count and the latch is marked, for backends that
+ * annotate loops.
+ *
+ * @param module The ALIR module.
+ * @param func The function (SSA form).
+ * @return Number of changes: instructions strength-reduced and preheaders created.
+ */
+int optlir_indvar_function(AlirModule *module, AlirFunction *func);
+
+#endif
@@ -0,0 +1,25 @@
+/**
+ * @file licm.h
+ * @brief Loop-invariant code motion over ALIR functions.
+ */
+#ifndef OPTLIR_LICM_H
+#define OPTLIR_LICM_H
+
+#include "../alir/alir.h"
+
+/**
+ * @brief Moves computations that give the same result on every iteration of
+ * a loop into its preheader.
+ *
+ * Pure instructions whose operands are all defined outside the loop move out,
+ * innermost loops first, so a value can climb out of a whole nest. A load
+ * moves out too when nothing in the loop writes its alias class and reading
+ * the address early cannot fault. Loops that need a preheader get one.
+ *
+ * @param module The ALIR module.
+ * @param func The function (SSA form).
+ * @return Number of changes: instructions hoisted and preheaders created.
+ */
+int optlir_licm_function(AlirModule *module, AlirFunction *func);
+
+#endif
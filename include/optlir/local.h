@@ -5,7 +5,8 @@
 #ifndef OPTLIR_LOCAL_H
 #define OPTLIR_LOCAL_H
 
-#include "../alir/alir.h"
+#include "optlir.h"
+#include "pure.h"
 
 /**
  * @brief Runs local optimizations on the module.
@@ -13,4 +14,128 @@
  */
 void optlir_local_optimize(AlirModule *module);
 
+/**
+ * @brief Builds the predecessor and successor edges of every block of a function.
+ *
+ * Each branch target slot contributes one edge, so a block branching twice
+ * to the same target has two edges to it.
+ *
+ * @param func The ALIR function.
+ * @param arena Arena allocator for the edges.
+ */
+void optlir_build_edges(AlirFunction *func, Arena *arena);
+
+/**
+ * @brief Removes the blocks the entry cannot reach.
+ * @param module The ALIR module.
+ * @param func The function (edges must be valid).
+ * @return Number of blocks removed.
+ */
+int optlir_remove_unreachable_function(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Sends the branches into blocks that only jump on to their target.
+ * @param module The ALIR module.
+ * @param func The function (edges must be valid).
+ * @return Number of blocks forwarded.
+ */
+int optlir_forward_blocks_function(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Folds instructions whose operands are constants and drops identities.
+ * @param module The ALIR module.
+ * @param func The function (def-use chains valid).
+ * @return Number of instructions folded away.
+ */
+int optlir_constprop_function(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Turns branches and switches on constants into jumps.
+ * @param module The ALIR module.
+ * @param func The function (edges must be valid).
+ * @return Number of branches folded.
+ */
+int optlir_fold_branches_function(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Merges blocks into a predecessor that is their only way in.
+ * @param module The ALIR module.
+ * @param func The function (edges must be valid).
+ * @return Number of blocks merged.
+ */
+int optlir_merge_blocks_function(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Removes stores into stack slots that are never read.
+ * @param module The ALIR module.
+ * @param func The function (def-use chains valid).
+ * @return Number of stores removed.
+ */
+int optlir_dead_stores_function(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Replaces stack copies of parameters by the parameters.
+ * @param module The ALIR module.
+ * @param func The function (def-use chains valid).
+ * @return Number of copies replaced.
+ */
+int optlir_param_copies_function(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Evaluates calls of pure functions with constant arguments.
+ * @param module The ALIR module.
+ * @param func The function.
+ * @param ev The evaluator, which remembers results across call sites.
+ * @return Number of calls replaced by their result.
+ */
+int optlir_pure_calls_function(AlirModule *module, AlirFunction *func, OptlirPureEval *ev);
+
+/**
+ * @brief Removes the stack release markers mem2reg leaves behind.
+ * @param module The ALIR module.
+ * @return Number of markers removed.
+ */
+int optlir_strip_free_stack(AlirModule *module);
+
+/**
+ * @brief Extracts a constant value from an ALIR value if possible.
+ * @param val The ALIR value.
+ * @return The constant value wrapper (is_const is 0 for non-constants).
+ */
+ConstVal optlir_const_of(AlirValue *val);
+
+/**
+ * @brief Evaluates a binary operation on two constant values.
+ * @param op The ALIR operation code.
+ * @param l Left-hand constant value.
+ * @param r Right-hand constant value.
+ * @param type The result type.
+ * @return The computed constant value (is_const is 0 if op does not fold).
+ */
+ConstVal optlir_eval_binary(int op, ConstVal l, ConstVal r, VarType type);
+
+/**
+ * @brief Evaluates a unary operation on a constant value.
+ * @param op The ALIR operation code.
+ * @param v The constant value.
+ * @param type The result type.
+ * @return The computed constant value (is_const is 0 if op does not fold).
+ */
+ConstVal optlir_eval_unary(int op, ConstVal v, VarType type);
+
+/**
+ * @brief Converts a constant value to another scalar type.
+ * @param v The constant value.
+ * @param type The target type.
+ * @return The converted constant value.
+ */
+ConstVal optlir_eval_cast(ConstVal v, VarType type);
+
+/**
+ * @brief Turns a value into a constant in place, so every use reads the constant.
+ * @param dest The value.
+ * @param res The constant it takes.
+ */
+void optlir_make_const(AlirValue *dest, ConstVal res);
+
 #endif
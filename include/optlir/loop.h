@@ -0,0 +1,75 @@
+/**
+ * @file loop.h
+ * @brief Natural loops of ALIR functions and their nesting forest.
+ */
+#ifndef OPTLIR_LOOP_H
+#define OPTLIR_LOOP_H
+
+#include "../alir/alir.h"
+#include "dom.h"
+
+/**
+ * @brief A natural loop: a header and every block that reaches a back edge
+ * into it without passing it.
+ *
+ * Blocks are named by their dominator index. Back edges sharing a header
+ * make up one loop.
+ */
+typedef struct OptlirLoop {
+    int header;
+    int *blocks;                // Member blocks, header first, in dominator preorder
+    int block_count;
+    int *latches;               // Members with a back edge to the header
+    int latch_count;
+    AlirBlock *preheader;       // Sole way in from outside, or NULL
+    int depth;                  // 1 for outermost loops
+    struct OptlirLoop *parent;
+    struct OptlirLoop *child;   // First directly nested loop
+    struct OptlirLoop *sibling; // Next loop with the same parent
+} OptlirLoop;
+
+/**
+ * @brief The loops of one function.
+ */
+typedef struct OptlirLoopForest {
+    OptlirDomTree *dom;
+    OptlirLoop **loops;         // Innermost loops come before the loops around them
+    int count;
+    OptlirLoop *roots;          // Outermost loops, linked through sibling
+    OptlirLoop **innermost;     // Dominator index -> innermost loop holding it, or NULL
+} OptlirLoopForest;
+
+/**
+ * @brief Finds the natural loops of a function and how they nest.
+ * @param module The ALIR module (tables come from its arena).
+ * @param dom The dominator information of the function.
+ * @return The loops; a function without loops gets an empty forest.
+ */
+OptlirLoopForest* optlir_loops_build(AlirModule *module, OptlirDomTree *dom);
+
+/**
+ * @brief Whether a loop holds a block, directly or through a nested loop.
+ * @param forest The loops.
+ * @param loop The loop.
+ * @param bi Dominator index of the block.
+ * @return Non-zero if the block belongs to the loop.
+ */
+int optlir_loop_contains(OptlirLoopForest *forest, OptlirLoop *loop, int bi);
+
+/**
+ * @brief Gives a loop a preheader: a block that only jumps to the header and
+ * is the header's only predecessor outside the loop.
+ *
+ * The entries of outside predecessors in the header's phis move to the
+ * preheader, merged by new phis there when there were several. The CFG
+ * edges, the dominator tree and the forest are stale afterwards.
+ *
+ * @param module The ALIR module.
+ * @param func The function.
+ * @param forest The loops.
+ * @param loop The loop.
+ * @return The preheader, or NULL for a loop headed by the entry block.
+ */
+AlirBlock* optlir_loop_make_preheader(AlirModule *module, AlirFunction *func, OptlirLoopForest *forest, OptlirLoop *loop);
+
+#endif
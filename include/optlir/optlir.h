@@ -6,12 +6,7 @@
 #define OPTLIR_H
 
 #include "../alir/alir.h"
-
-typedef struct UsedSet {
-    char **names;
-    int count;
-    int capacity;
-} UsedSet;
+#include "callgraph.h"
 
 typedef struct ConstVal {
     long long int_val;
@@ -20,12 +15,49 @@ typedef struct ConstVal {
     int is_float;
 } ConstVal;
 
+/**
+ * @brief What the optimization passes changed, reported by --opt-stats.
+ */
+typedef struct OptlirStats {
+    int sccp_folded;            // Instructions SCCP replaced by a constant
+    int sccp_blocks_removed;    // Blocks SCCP proved unreachable
+    int inlined_calls;          // Call sites replaced by the callee's body
+    int gvn_eliminated;         // Instructions GVN found computed already
+    int licm_hoisted;           // Instructions LICM moved out of loops
+    int indvar_reduced;         // Loop-derived values turned into running values
+    int indvar_trip_counts;     // Loops given a known trip count
+    int pure_folded;            // Pure calls replaced by their result
+    int pure_memo_hits;         // Calls answered from the memo instead of evaluated
+    int pure_over_budget;       // Call sites left to run time for lack of steps or memory
+    long long pure_nanos;       // Time spent evaluating pure calls
+    int escape_moved;           // Heap allocations moved to the stack
+    int escape_frees_removed;   // Calls of free dropped with them
+    int icf_folded;             // Functions folded into an identical one
+    int icf_bytes_saved;        // Estimated machine code bytes the folded bodies took
+} OptlirStats;
+
+extern _Thread_local OptlirStats optlir_stats;   // Per thread; the pass manager adds up its workers' counts
+
+/**
+ * @brief Prints the optimization statistics.
+ * @param out The stream to print to.
+ */
+void optlir_print_stats(FILE *out);
+
 /**
  * @brief Removes unused functions and globals from the module.
  * @param module The ALIR module.
  */
 void optlir_remove_unused(AlirModule *module);
 
+/**
+ * @brief Removes the functions, structs and globals a call graph does not reach from main.
+ * @param module The ALIR module.
+ * @param cg The call graph of the module.
+ * @return Number of symbols removed.
+ */
+int optlir_remove_unused_graph(AlirModule *module, OptlirCallGraph *cg);
+
 /**
  * @brief Runs all optimization passes on the module.
  * @param module The ALIR module.
@@ -39,6 +71,28 @@ void optlir_optimize(AlirModule *module, int opt_level);
  */
 void optlir_mem2reg_local(AlirModule *module);
 
+/**
+ * @brief Promotes scalar stack slots to SSA values with phis (global mem2reg).
+ * @param module The ALIR module.
+ */
+void optlir_mem2reg_ssa(AlirModule *module);
+
+/**
+ * @brief Inlines small and annotated direct calls, callees first.
+ * @param module The ALIR module (SSA form).
+ * @param opt_level The optimization level, which scales the size threshold.
+ */
+void optlir_inline(AlirModule *module, int opt_level);
+
+/**
+ * @brief Inlines small and annotated direct calls along a given call graph.
+ * @param module The ALIR module (SSA form).
+ * @param cg The call graph of the module.
+ * @param opt_level The optimization level, which scales the size threshold.
+ * @return Number of calls inlined.
+ */
+int optlir_inline_calls(AlirModule *module, OptlirCallGraph *cg, int opt_level);
+
 /**
  * @brief Removes dead alloc instructions.
  * @param module The ALIR module.
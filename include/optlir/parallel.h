@@ -0,0 +1,41 @@
+/**
+ * @file parallel.h
+ * @brief Work-stealing thread pool for running optlir work on many functions at once.
+ */
+#ifndef OPTLIR_PARALLEL_H
+#define OPTLIR_PARALLEL_H
+
+/**
+ * @brief A loop whose iterations are independent and may run on any thread.
+ *
+ * Worker 0 is the calling thread. Each worker runs begin before its first
+ * task and end after its last one, on its own thread, so thread-local setup
+ * belongs there.
+ */
+typedef struct OptlirParallelLoop {
+    int count;                                  // Tasks are 0 .. count - 1
+    void *ctx;
+    void (*begin)(void *ctx, int worker);       // Or NULL
+    void (*run)(void *ctx, int worker, int task);
+    void (*end)(void *ctx, int worker);         // Or NULL
+} OptlirParallelLoop;
+
+/**
+ * @brief Returns how many worker threads a job count asks for.
+ * @param requested The requested count; 0 or less means one per online CPU.
+ * @return At least 1.
+ */
+int optlir_parallel_jobs(int requested);
+
+/**
+ * @brief Runs every task of a loop on up to jobs threads and waits for all of them.
+ *
+ * The tasks start out split into one contiguous range per worker; a worker
+ * whose range runs dry steals half of what another one has left.
+ *
+ * @param loop The loop.
+ * @param jobs Number of workers, including the calling thread.
+ */
+void optlir_parallel_for(const OptlirParallelLoop *loop, int jobs);
+
+#endif
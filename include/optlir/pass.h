@@ -0,0 +1,140 @@
+/**
+ * @file pass.h
+ * @brief Pass manager of the ALIR optimizer: registered passes, pipelines and cached analyses.
+ */
+#ifndef OPTLIR_PASS_H
+#define OPTLIR_PASS_H
+
+#include "../alir/alir.h"
+#include "dom.h"
+#include "callgraph.h"
+#include "pure.h"
+#include <stdio.h>
+
+#define OPTLIR_AN_CFG       (1u << 0)   // Block pred/succ edges
+#define OPTLIR_AN_USES      (1u << 1)   // Def pointers and use lists
+#define OPTLIR_AN_DOM       (1u << 2)   // Dominator tree
+#define OPTLIR_AN_CALLGRAPH (1u << 3)   // Module call graph
+#define OPTLIR_AN_ALL       (OPTLIR_AN_CFG | OPTLIR_AN_USES | OPTLIR_AN_DOM | OPTLIR_AN_CALLGRAPH)
+
+/**
+ * @brief Analyses of one function kept between passes.
+ *
+ * A function carries one only while the pass manager optimizes it; with none,
+ * every request recomputes the analysis.
+ */
+typedef struct OptlirAnalyses {
+    unsigned valid;             // OPTLIR_AN_* bits that are up to date
+    OptlirDomTree *dom;         // Valid with OPTLIR_AN_DOM
+} OptlirAnalyses;
+
+typedef struct OptlirPassManager OptlirPassManager;
+
+/**
+ * @brief A registered optimization pass.
+ *
+ * Exactly one of the run hooks is set. Both return how many changes the pass
+ * made; zero means the IR is untouched and every analysis stays valid.
+ * Function passes run on several functions at once unless marked sequential.
+ */
+typedef struct OptlirPass {
+    const char *name;
+    int (*run_function)(OptlirPassManager *pm, AlirFunction *func);
+    int (*run_module)(OptlirPassManager *pm);
+    unsigned requires;          // Analyses made valid before it runs (function passes)
+    unsigned preserves;         // Analyses still valid after it changes something
+    const char *summary;
+    int sequential;             // Reads other functions, so it runs alone on the calling thread
+} OptlirPass;
+
+/**
+ * @brief State of one pipeline run.
+ */
+struct OptlirPassManager {
+    AlirModule *module;
+    int opt_level;
+    int max_rounds;             // Rounds of a function pass group before giving up on a fixed point
+    int jobs;                   // Threads a function pass group may use
+    unsigned module_valid;      // OPTLIR_AN_CALLGRAPH when callgraph is up to date
+    OptlirCallGraph callgraph;
+    OptlirPureEval pure;        // Memo of evaluated pure calls, shared by all call sites
+};
+
+/**
+ * @brief Returns the pipeline an optimization level runs.
+ * @param opt_level The optimization level.
+ * @return Comma-separated pass names.
+ */
+const char* optlir_default_pipeline(int opt_level);
+
+/**
+ * @brief Runs a pipeline of passes on the module.
+ *
+ * Passes run in the order given. A run of consecutive function passes is
+ * applied to one function at a time and repeated while it changes anything,
+ * up to a number of rounds set by the optimization level.
+ *
+ * @param module The ALIR module.
+ * @param opt_level The optimization level, for thresholds and rounds.
+ * @param pipeline Comma-separated pass names.
+ * @return 0 on success, -1 if the pipeline names an unknown pass.
+ */
+int optlir_run_pipeline(AlirModule *module, int opt_level, const char *pipeline);
+
+/**
+ * @brief Sets how many threads function pass groups may use.
+ * @param jobs The thread count; 0 means one per online CPU, 1 runs everything on the calling thread.
+ */
+void optlir_set_jobs(int jobs);
+
+/**
+ * @brief Checks that every name of a pipeline is a registered pass.
+ * @param pipeline Comma-separated pass names.
+ * @param err Stream for the diagnostic, or NULL.
+ * @return Non-zero if the pipeline is valid.
+ */
+int optlir_pipeline_valid(const char *pipeline, FILE *err);
+
+/**
+ * @brief Makes the pred/succ edges of a function valid.
+ * @param module The ALIR module.
+ * @param func The function.
+ */
+void optlir_require_cfg(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Makes the def pointers and use lists of a function valid.
+ * @param module The ALIR module.
+ * @param func The function.
+ */
+void optlir_require_uses(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Returns the dominator tree of a function, building the edges first if needed.
+ * @param module The ALIR module.
+ * @param func The function.
+ * @return The dominator information, or NULL for a function without blocks.
+ */
+OptlirDomTree* optlir_require_dom(AlirModule *module, AlirFunction *func);
+
+/**
+ * @brief Drops cached analyses of a function that a change made stale.
+ * @param func The function.
+ * @param lost OPTLIR_AN_* bits no longer valid.
+ */
+void optlir_invalidate(AlirFunction *func, unsigned lost);
+
+/**
+ * @brief Returns the module call graph, rebuilding it if a pass changed the module.
+ * @param pm The pass manager.
+ * @return The call graph.
+ */
+OptlirCallGraph* optlir_require_callgraph(OptlirPassManager *pm);
+
+/**
+ * @brief Prints how often each pass ran, what it changed and how long it took.
+ * @param out The stream to print to.
+ */
+void optlir_print_pass_stats(FILE *out);
+
+#endif
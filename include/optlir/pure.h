@@ -0,0 +1,69 @@
+/**
+ * @file pure.h
+ * @brief Compile-time evaluation of pure ALIR functions with constant arguments.
+ */
+#ifndef OPTLIR_PURE_H
+#define OPTLIR_PURE_H
+
+#include "../alir/alir.h"
+#include "optlir.h"
+
+#define OPTLIR_PURE_STEPS   1000000     // Default instructions one call site may execute
+#define OPTLIR_PURE_MEMORY  (1L << 20)  // Default bytes of frames and stack slots it may hold
+
+/**
+ * @brief Evaluates calls of pure functions and remembers the results.
+ *
+ * Every call site gets the same step and memory budget. A call that runs
+ * out of either, or reaches something the evaluator does not model (memory
+ * other than its own scalar stack slots, impure or external callees, traps
+ * such as division by zero), is left to run at run time. Evaluation needs
+ * the module arena, since the results outlive the call sites.
+ */
+typedef struct OptlirPureEval {
+    AlirModule *module;
+    long max_steps;
+    long max_memory;
+    long steps_left;            // Of the call site being evaluated
+    long memory_left;
+    int depth;
+    HashMap funcs;              // "%p" of a function -> its PureFunc
+    HashMap memo;               // Callee and argument bits -> PureMemo
+} OptlirPureEval;
+
+/**
+ * @brief Prepares an evaluator with the budgets set by optlir_pure_set_budget.
+ * @param ev The evaluator.
+ * @param module The ALIR module.
+ */
+void optlir_pure_init(OptlirPureEval *ev, AlirModule *module);
+
+/**
+ * @brief Releases an evaluator.
+ * @param ev The evaluator.
+ */
+void optlir_pure_free(OptlirPureEval *ev);
+
+/**
+ * @brief Evaluates one call of a pure function with constant arguments.
+ *
+ * The time spent and the outcome are added to optlir_stats.
+ *
+ * @param ev The evaluator.
+ * @param callee The called function.
+ * @param args The constant arguments.
+ * @param arg_count Number of arguments.
+ * @param out Receives the returned value.
+ * @return Non-zero if the call was evaluated within the budgets.
+ */
+int optlir_pure_eval_call(OptlirPureEval *ev, AlirFunction *callee, AlirValue **args, int arg_count,
+                          ConstVal *out);
+
+/**
+ * @brief Sets the budgets of every evaluator created afterwards.
+ * @param steps Instructions one call site may execute; 0 or less keeps the current value.
+ * @param memory Bytes one call site may hold; 0 or less keeps the current value.
+ */
+void optlir_pure_set_budget(long steps, long memory);
+
+#endif
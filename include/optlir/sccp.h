@@ -0,0 +1,24 @@
+/**
+ * @file sccp.h
+ * @brief Sparse conditional constant propagation over ALIR functions.
+ */
+#ifndef OPTLIR_SCCP_H
+#define OPTLIR_SCCP_H
+
+#include "../alir/alir.h"
+
+/**
+ * @brief Propagates constants along the executable edges of a function.
+ *
+ * Every value proven constant becomes that constant in place and loses its
+ * defining instruction, so the branches reading it fold afterwards and the
+ * blocks never reached become unreachable. The caller folds the branches
+ * and removes the dead blocks.
+ *
+ * @param module The ALIR module.
+ * @param func The function (SSA form, valid edges and def-use chains).
+ * @return Number of values folded to constants.
+ */
+int optlir_sccp_function(AlirModule *module, AlirFunction *func);
+
+#endif
@@ -63,6 +63,7 @@ typedef struct Parser {
     HashMap types_map;
     char *current_namespace;
     char *pending_cconv;
+    int pending_inline;
     struct ASTNode *synthetic_classes;
     int in_space_separated_call;
     int disable_space_call;
@@ -105,6 +106,17 @@ void report_error(Lexer *l, Token t, const char *msg);
  */
 ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarType *replace_with, int num_params, char **rename_from, char **rename_to, int num_renames);
 
+/**
+ * @brief Records which call-site argument each macro placeholder was cloned from.
+ */
+typedef struct MacroArgTrace {
+    ASTNode **slots;        // Placeholder nodes inserted into the expanded body
+    ASTNode **origins;      // Argument node each placeholder was cloned from
+    int count;
+    int capacity;
+    int value_dependent;    // Expansion inspected literal argument values (metas.*)
+} MacroArgTrace;
+
 /**
  * @brief Rewrites a macro invocation AST by substituting macro arguments.
  * @param ctx The compiler context.
@@ -113,9 +125,17 @@ ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarT
  * @param param_names Macro parameter names.
  * @param param_args Macro argument AST nodes.
  * @param num_params Number of parameters.
+ * @param trace Optional trace of inserted placeholders, or NULL.
  * @return The rewritten AST node.
  */
-ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs_head, char **param_names, ASTNode **param_args, int num_params);
+ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs_head, char **param_names, ASTNode **param_args, int num_params, MacroArgTrace *trace);
+
+/**
+ * @brief Re-targets a macro placeholder to another argument of the same node type.
+ * @param slot The placeholder node produced by ast_rewrite_macro.
+ * @param arg The new argument node.
+ */
+void ast_refresh_macro_arg(ASTNode *slot, ASTNode *arg);
 
 /**
  * @brief Clones a VarType, optionally substituting type parameters and renaming.
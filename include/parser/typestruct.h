@@ -175,6 +175,7 @@ typedef struct {
   bool is_override : 1;
   bool is_mutable : 1;
   char *cconv;
+  int inline_hint;        // meta [inline = always] -> 1, [inline = never] -> -1
   char *extern_name;
   char **err_names;       // error set attached via `errnum [...]`
   int num_err;
@@ -0,0 +1,80 @@
+/**
+ * @file incremental.h
+ * @brief Declaration dependency tracking for in-process recompilation.
+ */
+#ifndef SEMANTIC_FRAGMENT_INCREMENTAL_H
+#define SEMANTIC_FRAGMENT_INCREMENTAL_H
+
+#include "../semantic.h"
+
+/**
+ * @brief Splices previously checked declarations back into a new program.
+ *
+ * Every top-level declaration is fingerprinted. A declaration whose
+ * fingerprint matches the last recompilation, and none of whose dependencies
+ * changed, is replaced by the node checked last time and skipped by
+ * sem_check_program. Declarations missing from a resubmitted program are
+ * dropped and their dependents checked again. Does nothing unless
+ * ctx->incremental is set.
+ *
+ * @param ctx The semantic context, reused across recompilations.
+ * @param root The program; its head may be replaced.
+ */
+void sem_incremental_prepare(SemanticCtx *ctx, ASTNode **root);
+
+/**
+ * @brief Records the errors of the finished recompilation.
+ * @param ctx The semantic context.
+ * @param error_count Errors reported by this recompilation.
+ */
+void sem_incremental_finish(SemanticCtx *ctx, int error_count);
+
+/**
+ * @brief Returns the declaration record created for a top-level node.
+ * @param ctx The semantic context.
+ * @param node The top-level node.
+ * @return The record, or NULL if the node is not tracked this round.
+ */
+SemDecl* sem_decl_for(SemanticCtx *ctx, ASTNode *node);
+
+/**
+ * @brief Whether a top-level node was reused from the last recompilation.
+ * @param ctx The semantic context.
+ * @param node The top-level node.
+ * @return Non-zero if the node must not be scanned or checked again.
+ */
+int sem_decl_is_reused(SemanticCtx *ctx, ASTNode *node);
+
+/**
+ * @brief Records that the current declaration looked up a name.
+ * @param ctx The semantic context.
+ * @param name The (possibly dotted) name.
+ */
+void sem_decl_note_use(SemanticCtx *ctx, const char *name);
+
+/**
+ * @brief Records that the current declaration declared a name.
+ * @param ctx The semantic context.
+ * @param name The declared name.
+ */
+void sem_decl_note_provide(SemanticCtx *ctx, const char *name);
+
+/**
+ * @brief Records a global symbol the current declaration added.
+ *
+ * The symbol is removed again if the declaration is deleted.
+ *
+ * @param ctx The semantic context.
+ * @param sym The symbol.
+ */
+void sem_decl_note_symbol(SemanticCtx *ctx, SemSymbol *sym);
+
+/**
+ * @brief Records the nodes appended to the program while checking a declaration.
+ * @param ctx The semantic context.
+ * @param decl The declaration being checked.
+ * @param first The first appended node, or NULL.
+ */
+void sem_decl_note_extras(SemanticCtx *ctx, SemDecl *decl, ASTNode *first);
+
+#endif // SEMANTIC_FRAGMENT_INCREMENTAL_H
@@ -0,0 +1,44 @@
+/**
+ * @file effect.h
+ * @brief Call-graph based effect summaries (pure/total/pristine).
+ */
+#ifndef SEMANTIC_MODIFIER_EFFECT_H
+#define SEMANTIC_MODIFIER_EFFECT_H
+
+#include "semantic.h"
+
+/**
+ * @brief Records a call from the function being checked to a callee.
+ * @param ctx The semantic context.
+ * @param callee The called symbol (ignored unless it is a function).
+ * @param site The call node, used for diagnostics.
+ */
+void sem_record_call(SemanticCtx *ctx, SemSymbol *callee, ASTNode *site);
+
+/**
+ * @brief Associates a checked function definition with its symbol.
+ * @param ctx The semantic context.
+ * @param fd The function definition.
+ * @param sym The function symbol.
+ */
+void sem_effect_register(SemanticCtx *ctx, FuncDefNode *fd, SemSymbol *sym);
+
+/**
+ * @brief Finalizes pure/total/pristine summaries over the recorded call graph.
+ *
+ * Strongly connected components are collapsed and solved callee-first, so
+ * every summary is computed exactly once regardless of call-chain depth.
+ *
+ * @param ctx The semantic context.
+ */
+void sem_infer_effects(SemanticCtx *ctx);
+
+/**
+ * @brief Returns the symbol holding the effect summary of a function definition.
+ * @param ctx The semantic context.
+ * @param fd The function definition.
+ * @return The symbol, or NULL if the function was never checked.
+ */
+SemSymbol* sem_effect_lookup(SemanticCtx *ctx, FuncDefNode *fd);
+
+#endif // SEMANTIC_MODIFIER_EFFECT_H
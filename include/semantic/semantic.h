@@ -76,6 +76,14 @@ SemSymbol* sem_symbol_lookup_type(SemanticCtx *ctx, const char *name);
  */
 SemSymbol* sem_symbol_lookup(SemanticCtx *ctx, const char *name, SemScope **out_scope);
 
+/**
+ * @brief Suggests a visible symbol whose name is close to an unknown one.
+ * @param ctx The semantic context.
+ * @param name The unknown name.
+ * @return The suggested name, or NULL if nothing is close enough.
+ */
+const char* sem_suggest_symbol(SemanticCtx *ctx, const char *name);
+
 /**
  * @brief Looks up a symbol directly in a scope.
  * @param scope The scope to search.
@@ -298,7 +306,7 @@ void sem_check_var_decl(SemanticCtx *ctx, VarDeclNode *node, int register_sym);
  * @param node_ptr Pointer to the AST node pointer.
  * @param target_type The target type.
  */
-void sem_insert_implicit_cast(SemanticCtx *ctx, ASTNode **node_ptr, VarType target_type);
+void sem_insert_implicit_cast(SemanticCtx *ctx, ASTNode **node_ptr, VarType target_type);
 
 #include "emitter.h"
 #include "type.h"
@@ -308,8 +316,10 @@ void sem_insert_implicit_cast(SemanticCtx *ctx, ASTNode **node_ptr, VarType targ
 #include "fragment/symbolic.h"
 #include "fragment/field.h"
 #include "fragment/block.h"
+#include "fragment/incremental.h"
 #include "modifier/class.h"
 #include "modifier/func.h"
 #include "modifier/taint.h"
+#include "modifier/effect.h"
 
 #endif // SEMANTIC_H
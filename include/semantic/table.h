@@ -8,7 +8,7 @@
 /**
  * @brief Hashes an AST node pointer.
  * @param node The AST node.
- * @return The hash value.
+ * @return The hash value, not reduced to any table size.
  */
 unsigned int hash_ptr(ASTNode *node);
 
@@ -69,6 +69,7 @@ typedef struct SemSymbol {
     bool is_partial : 1;
     bool must_partial : 1;
     bool is_union : 1;
+    bool returns_tainted : 1;  // Some return statement yields a tainted value
     
     // Attached error set (`errnum [...]`) for tainted functions.
     bool has_errnum : 1;
@@ -89,8 +90,7 @@ typedef struct SemScope {
     bool is_class_scope : 1;    // Identifies if this scope belongs to a class
 } SemScope;
 
-// TODO use hashmap for this
-
+// Initial bucket count of the node type table; it doubles as it fills (power of two)
 #define TYPE_TABLE_SIZE 1024
 
 typedef struct TypeEntry {
@@ -107,8 +107,46 @@ typedef struct {
     bool namespace_auto_search;
     bool namespace_ausearch_warning;
     bool function_auto_call;
+    bool incremental_trace;     // Print which declarations are reused, checked or dropped
 } SemanticSettings;
 
+/**
+ * @brief A call from one function to another, recorded for effect inference.
+ */
+typedef struct SemCallEdge {
+    SemSymbol *caller;
+    SemSymbol *callee;
+    ASTNode *site;
+    struct SemCallEdge *next;
+} SemCallEdge;
+
+/**
+ * @brief A top-level declaration remembered across in-process recompilations.
+ */
+typedef struct SemDecl {
+    char *key;               // Kind, name, file and ordinal
+    unsigned long long hash; // Fingerprint of the declaration's source and shape
+    ASTNode *node;           // The node that was checked
+    char **provides;         // Names declared while scanning it
+    int provide_count;
+    int provide_cap;
+    char **uses;             // Names looked up while scanning or checking it
+    int use_count;
+    int use_cap;
+    void *use_set;           // Actually HashMap: dedups uses
+    ASTNode **extras;        // Template instantiations appended while checking it
+    int extra_count;
+    int extra_cap;
+    SemSymbol **symbols;     // Global symbols added while scanning it
+    int symbol_count;
+    int symbol_cap;
+    int generation;          // Recompilation that checked it
+    int seen;                // Last recompilation whose program contained it
+    int had_errors;
+    struct SemDecl *round_next; // Records created by the same recompilation
+    struct SemDecl *all_next;   // Every record still in decl_map
+} SemDecl;
+
 typedef struct {
     CompilerContext *compiler_ctx;
     SemanticSettings settings;
@@ -120,7 +158,9 @@ typedef struct {
     
     int in_wash_block;
     
-    TypeEntry *type_buckets[TYPE_TABLE_SIZE];
+    TypeEntry **type_buckets;          // Node -> type table, NULL until the first entry
+    unsigned int type_bucket_count;
+    unsigned int type_entry_count;
 
     const char *current_source; 
     const char *current_filename; 
@@ -130,6 +170,24 @@ typedef struct {
     
     ASTNode **ast_tail; // For appending instantiated templates
     ASTNode *current_node;
+
+    SemCallEdge *call_edges; // Calls seen while checking, consumed by sem_infer_effects
+    void *effect_map; // Actually HashMap: FuncDefNode* -> SemSymbol*
+
+    void *symbol_index;           // Actually BKTree over global symbol names, for suggestions
+    SemSymbol *symbol_index_head; // Newest global symbol already in symbol_index
+
+    // Incremental re-checking, see fragment/incremental.c
+    int incremental;        // Keep declaration records across sem_check_program calls
+    int decl_scanning;      // Symbols added now are provided by current_decl
+    SemDecl *current_decl;
+    SemDecl *decl_round;    // Records created by the current recompilation
+    SemDecl *decl_all;      // Every record still in decl_map
+    int decl_generation;    // Number of recompilations so far
+    void *decl_stamps;      // Actually HashMap: name -> generation that last re-declared it
+    void *decl_map;         // Actually HashMap: decl key -> SemDecl*
+    void *decl_nodes;       // Actually HashMap: node ptr -> SemDecl* (current round)
+    void *decl_reused;      // Actually HashMap: node ptr -> reused ASTNode*
 } SemanticCtx;
 
 #endif // SEMANTIC_TYPESTRUCT_H
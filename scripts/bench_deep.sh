@@ -0,0 +1,112 @@
+#!/bin/bash
+
+# Deep-nesting stress benchmark
+# Usage: ./scripts/bench_deep.sh [sizes...] [--compiler path] [--stack KB]
+#   sizes      : link counts to generate (default: 10000 100000 1000000)
+#   --compiler : compiler to run (default: build/alkyl)
+#   --stack    : stack limit for the compiler in KB (default: 1024)
+#
+# For every size N two programs are generated and compiled unoptimized:
+#   else_if_N : one `if ... else if ...` chain with N links
+#   binop_N   : one left-deep `x + x + ... + x` expression with N operators
+# The compiler runs under a small stack limit, so any per-link recursion left
+# in the front end shows up as a crash. Compile time should grow linearly.
+
+COMPILER="build/alkyl"
+STACK_KB=1024
+SIZES=()
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --compiler) COMPILER="$2"; shift ;;
+        --stack) STACK_KB="$2"; shift ;;
+        *) SIZES+=("$1") ;;
+    esac
+    shift
+done
+
+if [ ${#SIZES[@]} -eq 0 ]; then
+    SIZES=(10000 100000 1000000)
+fi
+
+COLOR_RESET="\033[0m"
+COLOR_RED="\033[1;31m"
+COLOR_GREEN="\033[1;32m"
+COLOR_BLUE="\033[1;34m"
+
+OUT_DIR="build/tmp/bench_deep"
+mkdir -p "$OUT_DIR"
+
+gen_else_if() {
+    awk -v n="$1" 'BEGIN {
+        print "import \"std/print\";"
+        print ""
+        print "int main() {"
+        printf "    int a = %d;\n", n - 1
+        print "    int r = 0;"
+        print "    if a == 0 {"
+        print "        r = 0;"
+        for (i = 1; i < n; i++) {
+            printf "    } else if a == %d {\n", i
+            printf "        r = %d;\n", i % 1000
+        }
+        print "    }"
+        print "    std.print r;"
+        print "    return 0;"
+        print "}"
+    }'
+}
+
+gen_binop() {
+    awk -v n="$1" 'BEGIN {
+        print "import \"std/print\";"
+        print ""
+        print "int main() {"
+        print "    int x = 1;"
+        printf "    int r = x"
+        for (i = 0; i < n; i++) {
+            printf " + x"
+            if (i % 16 == 15) printf "\n       "
+        }
+        print ";"
+        print "    std.print r;"
+        print "    return 0;"
+        print "}"
+    }'
+}
+
+run_case() {
+    local NAME="$1"
+    local EXPECTED="$2"
+    local SRC="$OUT_DIR/$NAME.kyl"
+    local BIN="$OUT_DIR/$NAME"
+
+    local START END
+    START=$(date +%s.%N)
+    ( ulimit -s "$STACK_KB"; "$COMPILER" -o "$BIN" --unopt "$SRC" > "$OUT_DIR/$NAME.log" 2>&1 )
+    local RET=$?
+    END=$(date +%s.%N)
+    local SECS
+    SECS=$(awk -v a="$START" -v b="$END" 'BEGIN { printf "%.2f", b - a }')
+
+    if [ $RET -ne 0 ]; then
+        echo -e "$NAME: ${COLOR_RED}FAIL (exit $RET)${COLOR_RESET} after ${SECS}s, see $OUT_DIR/$NAME.log"
+        return
+    fi
+    local GOT
+    GOT=$("./$BIN")
+    if [ "$GOT" != "$EXPECTED" ]; then
+        echo -e "$NAME: ${COLOR_RED}FAIL (printed '$GOT', expected '$EXPECTED')${COLOR_RESET}"
+        return
+    fi
+    echo -e "$NAME: ${COLOR_GREEN}OK${COLOR_RESET} ${SECS}s"
+    rm -f "$BIN"
+}
+
+echo -e "${COLOR_BLUE}Deep nesting benchmark (stack limit ${STACK_KB} KB)${COLOR_RESET}"
+for N in "${SIZES[@]}"; do
+    gen_else_if "$N" > "$OUT_DIR/else_if_$N.kyl"
+    run_case "else_if_$N" "$(( (N - 1) % 1000 ))"
+    gen_binop "$N" > "$OUT_DIR/binop_$N.kyl"
+    run_case "binop_$N" "$(( N + 1 ))"
+done
@@ -0,0 +1,89 @@
+#!/bin/bash
+
+# Optimizer benchmark over the checked-in .balir corpus
+# Usage: ./scripts/bench_optlir.sh [pattern] [--capture] [--runs N] [-O1|-O2|-O3] [--passes=list]
+#                                  [--compiler path] [--alir-opt path]
+#   pattern    : only modules whose name contains it
+#   --capture  : regenerate test/balir/ from test/code/ first (uses --compiler)
+#   --runs     : pipeline runs per module, each on a freshly loaded copy (default: 5)
+#   -O<n>      : optimization level passed to alir-opt (default: -O2)
+#   --passes=  : custom pipeline passed to alir-opt
+#
+# Every module is loaded, optimized and checked with alick by build/alir-opt,
+# so only the optimizer is timed; the front end never runs.
+
+COMPILER="build/alkyl"
+ALIR_OPT="build/alir-opt"
+CORPUS="test/balir"
+RUNS=5
+LEVEL="-O2"
+PASSES=""
+CAPTURE=0
+PATTERN=""
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --capture) CAPTURE=1 ;;
+        --runs) RUNS="$2"; shift ;;
+        --compiler) COMPILER="$2"; shift ;;
+        --alir-opt) ALIR_OPT="$2"; shift ;;
+        -O1|-O2|-O3) LEVEL="$1" ;;
+        --passes=*) PASSES="$1" ;;
+        *) PATTERN="$1" ;;
+    esac
+    shift
+done
+
+COLOR_RESET="\033[0m"
+COLOR_RED="\033[1;31m"
+COLOR_GREEN="\033[1;32m"
+COLOR_BLUE="\033[1;34m"
+
+if [ $CAPTURE -eq 1 ]; then
+    echo -e "${COLOR_BLUE}Capturing .balir corpus with $COMPILER${COLOR_RESET}"
+    mkdir -p "$CORPUS" build/tmp
+    for SRC in test/code/*/*.kyl; do
+        FEATURE=$(basename "$(dirname "$SRC")")
+        NAME=$(basename "$SRC" .kyl)
+        rm -f build/out.balir
+        # --emit-balir writes the module before optimization, so capture unoptimized
+        "$COMPILER" "$SRC" --unopt --emit-balir -c -o "build/tmp/balir_capture.o" > /dev/null 2>&1
+        if [ -f build/out.balir ]; then
+            mv build/out.balir "$CORPUS/${FEATURE}_${NAME}.balir"
+        fi
+    done
+    rm -f build/tmp/balir_capture.o
+fi
+
+if [ ! -x "$ALIR_OPT" ]; then
+    echo -e "${COLOR_RED}$ALIR_OPT not found, build the alir-opt target first${COLOR_RESET}"
+    exit 1
+fi
+
+echo -e "${COLOR_BLUE}optlir benchmark: $LEVEL $PASSES, $RUNS runs per module${COLOR_RESET}"
+TOTAL=0
+COUNT=0
+FAILED=0
+for MOD in "$CORPUS"/*.balir; do
+    NAME=$(basename "$MOD" .balir)
+    if [ -n "$PATTERN" ] && [[ "$NAME" != *"$PATTERN"* ]]; then
+        continue
+    fi
+    OUT=$("$ALIR_OPT" "$MOD" $LEVEL $PASSES --runs "$RUNS" 2> "build/tmp/alir_opt_$NAME.log")
+    if [ $? -ne 0 ]; then
+        echo -e "$NAME: ${COLOR_RED}FAIL${COLOR_RESET}, see build/tmp/alir_opt_$NAME.log"
+        FAILED=$((FAILED + 1))
+        continue
+    fi
+    # "... min X ms mean Y ms max Z ms": sum the best time of every module
+    MIN=$(echo "$OUT" | awk '{ for (i = 1; i < NF; i++) if ($i == "min") print $(i + 1) }')
+    printf "%-48s %10s ms\n" "$NAME" "$MIN"
+    TOTAL=$(awk -v a="$TOTAL" -v b="$MIN" 'BEGIN { printf "%.3f", a + b }')
+    COUNT=$((COUNT + 1))
+done
+
+if [ $FAILED -ne 0 ]; then
+    echo -e "${COLOR_RED}$FAILED modules failed${COLOR_RESET}, $COUNT modules took ${TOTAL} ms"
+    exit 1
+fi
+echo -e "${COLOR_GREEN}$COUNT modules${COLOR_RESET} took ${TOTAL} ms (sum of best runs)"
@@ -0,0 +1,117 @@
+#!/bin/bash
+
+# Optimizer driver checks that the output-based tests cannot make
+# Usage: ./scripts/check_optlir.sh [--compiler path] [--alir-opt path] [--jobs N]
+#   --jobs : threads compared against a single-threaded run (default: 4)
+#
+# - test/code/optlir/pipeline.kyl: the custom pipeline runs exactly the
+#   passes of its committed log, with the same counts (times are ignored)
+# - test/code/optlir/bad_pass.kyl: an unknown pass name stops compilation
+#   with the diagnostic of its committed log
+# - test/code/optlir/jobs.kyl: optimizing on N threads emits byte-identical
+#   ALIR to one thread, and the single-threaded compile log matches the
+#   committed one apart from the addresses in debug lines
+# - test/balir/: every optimized module emits the same text ALIR after
+#   being packed into the dense form and unpacked again (alir-opt --pack-check)
+
+COMPILER="build/alkyl"
+ALIR_OPT="build/alir-opt"
+JOBS=4
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --compiler) COMPILER="$2"; shift ;;
+        --alir-opt) ALIR_OPT="$2"; shift ;;
+        --jobs) JOBS="$2"; shift ;;
+    esac
+    shift
+done
+
+COLOR_RESET="\033[0m"
+COLOR_RED="\033[1;31m"
+COLOR_GREEN="\033[1;32m"
+
+mkdir -p build/tmp
+FAILED=0
+
+# Flags from the "// FLAGS:" line of a test, as run_single.sh reads them
+test_flags() {
+    local FIRST_LINE
+    FIRST_LINE=$(head -n 1 "$1" | tr -d '\r')
+    [[ "$FIRST_LINE" == "// FLAGS: "* ]] && echo "${FIRST_LINE#// FLAGS: }"
+}
+
+# Optimizer lines of a log, without colors and timings
+optlir_lines() {
+    sed -r "s/\x1B\[([0-9]{1,2}(;[0-9]{1,2})?)?[mGK]//g" "$1" | grep "^optlir: " \
+        | sed -r "s/ +[0-9]+\.[0-9]+ ms//g"
+}
+
+# A log without colors and with every address zeroed
+masked_log() {
+    sed -r "s/\x1B\[([0-9]{1,2}(;[0-9]{1,2})?)?[mGK]//g; s/0x[0-9a-f]+/0x0/g" "$1"
+}
+
+report() {
+    if [ "$2" -eq 0 ]; then
+        echo -e "$1: ${COLOR_GREEN}PASS${COLOR_RESET}"
+    else
+        echo -e "$1: ${COLOR_RED}FAIL${COLOR_RESET} $3"
+        FAILED=$((FAILED + 1))
+    fi
+}
+
+SRC="test/code/optlir/pipeline.kyl"
+LOG="build/tmp/check_optlir_pipeline.log"
+"$COMPILER" -o build/tmp/check_optlir_pipeline --opt $(test_flags "$SRC") "$SRC" > "$LOG" 2>&1
+RET=$?
+if [ $RET -eq 0 ]; then
+    diff <(optlir_lines test/log/optlir/pipeline.log) <(optlir_lines "$LOG") > build/tmp/check_optlir_pipeline.diff
+    RET=$?
+fi
+report "custom pipeline and --opt-stats" $RET "see build/tmp/check_optlir_pipeline.diff"
+
+SRC="test/code/optlir/bad_pass.kyl"
+LOG="build/tmp/check_optlir_bad_pass.log"
+"$COMPILER" -o build/tmp/check_optlir_bad_pass --opt $(test_flags "$SRC") "$SRC" > "$LOG" 2>&1
+RET=$?
+if [ $RET -ne 0 ]; then
+    diff <(optlir_lines test/log/optlir/bad_pass.log) <(optlir_lines "$LOG") > build/tmp/check_optlir_bad_pass.diff
+    RET=$?
+else
+    RET=1
+fi
+report "unknown pass name rejected" $RET "see build/tmp/check_optlir_bad_pass.diff"
+
+# The test's own --optlir-jobs= is overridden by the one added after it
+SRC="test/code/optlir/jobs.kyl"
+for N in 1 "$JOBS"; do
+    rm -f build/out.alir
+    "$COMPILER" -o build/tmp/check_optlir_jobs --opt $(test_flags "$SRC") --optlir-jobs="$N" --emit-alir "$SRC" \
+        > "build/tmp/check_optlir_jobs$N.log" 2>&1
+    mv build/out.alir "build/tmp/check_optlir_jobs$N.alir" 2> /dev/null
+done
+cmp -s build/tmp/check_optlir_jobs1.alir "build/tmp/check_optlir_jobs$JOBS.alir" \
+    && [ -s build/tmp/check_optlir_jobs1.alir ]
+report "ALIR of --optlir-jobs=1 and --optlir-jobs=$JOBS identical" $? \
+    "diff build/tmp/check_optlir_jobs1.alir build/tmp/check_optlir_jobs$JOBS.alir"
+
+"$COMPILER" -o build/tmp/check_optlir_jobs --opt $(test_flags "$SRC") --optlir-jobs=1 "$SRC" \
+    > build/tmp/check_optlir_jobs1.log 2>&1
+diff <(masked_log test/log/optlir/jobs.log) <(masked_log build/tmp/check_optlir_jobs1.log) > build/tmp/check_optlir_jobs.diff
+report "committed log matches --optlir-jobs=1" $? "see build/tmp/check_optlir_jobs.diff"
+
+RET=0
+> build/tmp/check_optlir_pack.log
+for BALIR in test/balir/*.balir; do
+    "$ALIR_OPT" "$BALIR" -O3 --pack-check 2>&1 > /dev/null | grep "^alir-opt: " >> build/tmp/check_optlir_pack.log
+    [ "${PIPESTATUS[0]}" -eq 0 ] || RET=1
+done
+report "packed form round-trips over test/balir" $RET "see build/tmp/check_optlir_pack.log"
+
+rm -f build/tmp/check_optlir_pipeline build/tmp/check_optlir_bad_pass build/tmp/check_optlir_jobs
+if [ $FAILED -ne 0 ]; then
+    echo -e "${COLOR_RED}$FAILED checks failed${COLOR_RESET}"
+    exit 1
+fi
+echo -e "${COLOR_GREEN}all optimizer checks passed${COLOR_RESET}"
@@ -0,0 +1,73 @@
+#!/bin/bash
+
+# Incremental re-checking checks for the ethyl REPL
+# Usage: ./scripts/check_repl.sh [--repl path]
+#
+# The REPL runs with --trace-incremental, which prints what happens to each
+# declaration in debug and release builds alike.
+#
+# - test/code/interactive/incremental.ethyl: after base() is redefined,
+#   base() and its dependents twice() and quad() are checked again while
+#   the unrelated other() is reused, as in its committed log
+# - the results after the redefinition match a fresh session that only
+#   declares the final definitions (a full re-check)
+# - test/code/interactive/incremental_delete.ethyl: when base() is left out
+#   of a line that re-enters its neighbours, it is dropped and twice(), which
+#   calls it, is checked again and fails, as in its committed log
+
+REPL="build/ethyl"
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --repl) REPL="$2"; shift ;;
+    esac
+    shift
+done
+
+COLOR_RESET="\033[0m"
+COLOR_RED="\033[1;31m"
+COLOR_GREEN="\033[1;32m"
+
+mkdir -p build/tmp
+FAILED=0
+
+# Declaration records of the REPL input, errors and printed results, without colors or prompts
+repl_lines() {
+    sed -r "s/\x1B\[([0-9]{1,2}(;[0-9]{1,2})?)?[mGK]//g; s/^(In \[[0-9]+\]: )+//" "$1" \
+        | grep -E "^incremental: (checking|reusing|dropping) '[^']*\|ethyl_repl\||^[0-9]+:[0-9]+: error: |^-> "
+}
+
+report() {
+    if [ "$2" -eq 0 ]; then
+        echo -e "$1: ${COLOR_GREEN}PASS${COLOR_RESET}"
+    else
+        echo -e "$1: ${COLOR_RED}FAIL${COLOR_RESET} $3"
+        FAILED=$((FAILED + 1))
+    fi
+}
+
+SRC="test/code/interactive/incremental.ethyl"
+LOG="build/tmp/check_repl_incremental.log"
+"$REPL" --trace-incremental < "$SRC" > "$LOG" 2>&1
+diff test/log/interactive/incremental.log <(repl_lines "$LOG") > build/tmp/check_repl_incremental.diff
+report "redefinition re-checks dependents and reuses the rest" $? "see build/tmp/check_repl_incremental.diff"
+
+# The session from the redefinition on, checked from scratch
+FULL="build/tmp/check_repl_full.log"
+sed -n '3,$p' "$SRC" | "$REPL" --trace-incremental > "$FULL" 2>&1
+diff <(repl_lines "$LOG" | grep "^-> " | tail -n 2) <(repl_lines "$FULL" | grep "^-> ") \
+    > build/tmp/check_repl_full.diff \
+    && [ "$(repl_lines "$FULL" | grep -c "^-> ")" -eq 2 ]
+report "results match a full re-check" $? "see build/tmp/check_repl_full.diff"
+
+SRC="test/code/interactive/incremental_delete.ethyl"
+LOG="build/tmp/check_repl_incremental_delete.log"
+"$REPL" --trace-incremental < "$SRC" > "$LOG" 2>&1
+diff test/log/interactive/incremental_delete.log <(repl_lines "$LOG") > build/tmp/check_repl_incremental_delete.diff
+report "deletion re-checks and fails dependents" $? "see build/tmp/check_repl_incremental_delete.diff"
+
+if [ $FAILED -ne 0 ]; then
+    echo -e "${COLOR_RED}$FAILED checks failed${COLOR_RESET}"
+    exit 1
+fi
+echo -e "${COLOR_GREEN}all REPL checks passed${COLOR_RESET}"
@@ -5,74 +5,116 @@
 #include "../../include/alick/alick_internal.h"
 #include <string.h>
 
-/**
- * @brief Find a basic block by its label within a function.
- * @param func Function to search.
- * @param label Block label to find.
- * @return Pointer to the block, or NULL if not found.
- */
-static AlirBlock* find_block(AlirFunction *func, const char *label) {
-    AlirBlock *b = func->blocks;
-    while (b) {
-        if (streq_lit(b->label, label)) return b;
-        b = b->next;
-    }
-    return NULL;
-}
-
 /**
  * @brief Validate the control-flow graph of an ALIR function.
+ *
+ * Packing resolves every label operand to its block index, so a branch
+ * target exists exactly when that index is set.
+ *
  * @param ctx ALIR checker context.
- * @param func Function whose CFG is validated.
+ * @param pf Packed function whose CFG is validated.
  */
-void alick_check_cfg(AlickCtx *ctx, AlirFunction *func) {
-    AlirBlock *b = func->blocks;
-    
-    while (b) {
+void alick_check_cfg(AlickCtx *ctx, AlirPackedFunction *pf) {
+    AlirFunction *func = pf->func;
+    AlirPackedValue *values = pf->values;
+
+    for (uint32_t bi = 0; bi < pf->block_count; bi++) {
+        AlirPackedBlock *pb = &pf->blocks[bi];
+        AlirBlock *b = pb->block;
+
         // 1. Check if block is completely empty
-        if (!b->head || !b->tail) {
+        if (pb->count == 0) {
             alick_error(ctx, func, b, NULL, "Block is empty. Must contain at least a terminator instruction.");
-            b = b->next;
             continue;
         }
 
         // 2. Check if the final instruction is a valid terminator
-        if (!is_terminator(b->tail->op)) {
-            alick_error(ctx, func, b, b->tail, "Block lacks a terminator. Last instruction is '%s', expected branch/return.", alir_op_str(b->tail->op));
+        AlirPackedInst *term = &pf->insts[pb->first + pb->count - 1];
+        if (!is_terminator((AlirOpcode)term->op)) {
+            alick_error(ctx, func, b, term, "Block lacks a terminator. Last instruction is '%s', expected branch/return.", alir_op_str((AlirOpcode)term->op));
         }
 
         // 3. Verify Branch Targets Exist
-        AlirInst *term = b->tail;
         if (term->op == ALIR_OP_JUMP) {
-            if (!term->op1 || term->op1->kind != ALIR_VAL_LABEL) {
+            AlirPackedValue *target = &values[term->op1];
+            if (!term->op1 || target->kind != ALIR_VAL_LABEL) {
                 alick_error(ctx, func, b, term, "Unconditional JUMP target must be a label.");
-            } else if (!find_block(func, term->op1->val.str_val)) {
-                alick_error(ctx, func, b, term, "JUMP target label '%s' does not exist in function.", term->op1->val.str_val);
+            } else if (target->block < 0) {
+                alick_error(ctx, func, b, term, "JUMP target label '%s' does not exist in function.", target->val.str_val);
             }
-        } 
+        }
         else if (term->op == ALIR_OP_CONDI) {
-            if (!term->op2 || term->op2->kind != ALIR_VAL_LABEL) {
+            AlirPackedValue *on_true = &values[term->op2];
+            if (!term->op2 || on_true->kind != ALIR_VAL_LABEL) {
                 alick_error(ctx, func, b, term, "CONDI true-branch target must be a label.");
-            } else if (!find_block(func, term->op2->val.str_val)) {
-                alick_error(ctx, func, b, term, "CONDI true-branch label '%s' does not exist.", term->op2->val.str_val);
+            } else if (on_true->block < 0) {
+                alick_error(ctx, func, b, term, "CONDI true-branch label '%s' does not exist.", on_true->val.str_val);
             }
-            
-            if (term->arg_count < 1 || !term->args || !term->args[0] || term->args[0]->kind != ALIR_VAL_LABEL) {
+
+            AlirValueRef false_ref = term->arg_count >= 1 ? alir_packed_args(term)[0] : ALIR_VALUE_NONE;
+            AlirPackedValue *on_false = &values[false_ref];
+            if (!false_ref || on_false->kind != ALIR_VAL_LABEL) {
                 alick_error(ctx, func, b, term, "CONDI false-branch target must be a label passed in args[0].");
-            } else if (!find_block(func, term->args[0]->val.str_val)) {
-                alick_error(ctx, func, b, term, "CONDI false-branch label '%s' does not exist.", term->args[0]->val.str_val);
+            } else if (on_false->block < 0) {
+                alick_error(ctx, func, b, term, "CONDI false-branch label '%s' does not exist.", on_false->val.str_val);
+            }
+        }
+
+        else if (term->op == ALIR_OP_SWITCH) {
+            AlirPackedValue *fallback = &values[term->op2];
+            if (!term->op2 || fallback->kind != ALIR_VAL_LABEL) {
+                alick_error(ctx, func, b, term, "SWITCH default target must be a label.");
+            } else if (fallback->block < 0) {
+                alick_error(ctx, func, b, term, "SWITCH default label '%s' does not exist.", fallback->val.str_val);
             }
-        } 
+
+            // Case values must be distinct constants
+            AlirModule *mod = ctx->module;
+            Arena *arena = (mod && mod->compiler_ctx) ? mod->compiler_ctx->arena : NULL;
+            HashMap seen;
+            hashmap_init(&seen, arena, term->arg_count > 32 ? term->arg_count : 32);
+            AlirValueRef *args = alir_packed_args(term);
+            for (uint32_t a = 0; a + 1 < term->arg_count; a += 2) {
+                AlirPackedValue *value = &values[args[a]];
+                AlirPackedValue *target = &values[args[a + 1]];
+                if (!args[a] || value->kind != ALIR_VAL_CONST) {
+                    alick_error(ctx, func, b, term, "SWITCH case value must be a constant.");
+                } else {
+                    char key[32];
+                    snprintf(key, sizeof(key), "%ld", value->val.long_val);
+                    if (hashmap_get(&seen, key)) alick_error(ctx, func, b, term, "SWITCH case value %ld appears twice.", value->val.long_val);
+                    else hashmap_put(&seen, key, target);
+                }
+                if (!args[a + 1] || target->kind != ALIR_VAL_LABEL || target->block < 0) {
+                    alick_error(ctx, func, b, term, "SWITCH case target must be a label of this function.");
+                }
+            }
+            if (!arena) hashmap_free(&seen);
+        }
 
         // 4. Ensure no unreachable instructions exist AFTER the terminator
-        AlirInst *i = b->head;
-        while (i) {
-            if (is_terminator(i->op) && i != b->tail) {
-                alick_error(ctx, func, b, i, "Early terminator '%s' found. Instructions following this in the same block are unreachable.", alir_op_str(i->op));
+        for (uint32_t k = pb->first; k + 1 < pb->first + pb->count; k++) {
+            AlirPackedInst *i = &pf->insts[k];
+            if (is_terminator((AlirOpcode)i->op)) {
+                alick_error(ctx, func, b, i, "Early terminator '%s' found. Instructions following this in the same block are unreachable.", alir_op_str((AlirOpcode)i->op));
             }
-            i = i->next;
         }
 
-        b = b->next;
+        // 5. Phis lead their block and name existing predecessors
+        int past_phis = 0;
+        for (uint32_t k = pb->first; k < pb->first + pb->count; k++) {
+            AlirPackedInst *i = &pf->insts[k];
+            if (i->op != ALIR_OP_PHI) {
+                past_phis = 1;
+                continue;
+            }
+            if (past_phis) alick_error(ctx, func, b, i, "PHI must come before every other instruction of its block.");
+            AlirValueRef *args = alir_packed_args(i);
+            for (uint32_t a = 0; a + 1 < i->arg_count; a += 2) {
+                if (!args[a] || values[args[a]].kind != ALIR_VAL_LABEL || values[args[a]].block < 0) {
+                    alick_error(ctx, func, b, i, "PHI incoming block must be a label of this function.");
+                }
+            }
+        }
     }
 }
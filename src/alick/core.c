@@ -14,7 +14,7 @@
  * @param inst Instruction causing the error.
  * @param fmt printf-style format string.
  */
-void alick_error(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirInst *inst, const char *fmt, ...) {
+void alick_error(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirPackedInst *inst, const char *fmt, ...) {
     ctx->error_count++;
     if (ctx->module && ctx->module->compiler_ctx) {
         ctx->module->compiler_ctx->alir_error_count++;
@@ -55,7 +55,7 @@ void alick_error(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirInst *
         fprintf(stderr, "-> %s\n", msg);
         
         if (inst) {
-            fprintf(stderr, "  Instruction Context: %s\n", alir_op_str(inst->op));
+            fprintf(stderr, "  Instruction Context: %s\n", alir_op_str((AlirOpcode)inst->op));
         }
     }
 }
@@ -68,7 +68,7 @@ void alick_error(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirInst *
  * @param inst Instruction causing the warning.
  * @param fmt printf-style format string.
  */
-void alick_warning(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirInst *inst, const char *fmt, ...) {
+void alick_warning(AlickCtx *ctx, AlirFunction *func, AlirBlock *block, AlirPackedInst *inst, const char *fmt, ...) {
     ctx->warning_count++;
     
     char msg[1024];
@@ -123,9 +123,10 @@ int alick_check_module(AlirModule *mod) {
     while (func) {
         // Only run checks on defined functions (ignore declarations)
         if (func->block_count > 0) {
-            alick_check_cfg(&ctx, func);
-            alick_check_types(&ctx, func);
-            alick_check_memory(&ctx, func);
+            AlirPackedFunction *pf = alir_pack_function(mod, func);
+            alick_check_cfg(&ctx, pf);
+            alick_check_types(&ctx, pf);
+            alick_check_memory(&ctx, pf);
         }
         func = func->next;
     }
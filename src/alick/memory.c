@@ -3,25 +3,32 @@
  * @brief Memory validation for the ALIR checker.
  */
 #include "../../include/alick/alick_internal.h"
-#include "../../include/common/hashmap.h"
+
+/**
+ * @brief Whether an operand names a pointer or variable the checker tracks.
+ * @param pf Packed function owning the operand.
+ * @param ref Operand reference.
+ * @return Non-zero for temps and variables.
+ */
+static int is_tracked(AlirPackedFunction *pf, AlirValueRef ref) {
+    if (!ref) return 0;
+    uint8_t kind = pf->values[ref].kind;
+    return kind == ALIR_VAL_TEMP || kind == ALIR_VAL_VAR;
+}
 
 // Helper to extract a string identifier for an AlirValue (Temp IDs or Var names)
 /**
  * @brief Extract a string key identifying an ALIR value.
- * @param val Value to key.
+ * @param pf Packed function owning the value.
+ * @param ref Value to key.
  * @param out_key Buffer to receive the null-terminated key string.
  */
-static void get_val_key(AlirValue *val, char *out_key) {
-    if (!val) {
-        out_key[0] = '\0';
-        return;
-    }
+static void get_val_key(AlirPackedFunction *pf, AlirValueRef ref, char *out_key) {
+    AlirPackedValue *val = &pf->values[ref];
     if (val->kind == ALIR_VAL_TEMP) {
         snprintf(out_key, 64, "%%t%d", val->temp_id);
-    } else if (val->kind == ALIR_VAL_VAR) {
-        snprintf(out_key, 64, "@%s", val->val.str_val);
     } else {
-        out_key[0] = '\0';
+        snprintf(out_key, 64, "@%s", val->val.str_val);
     }
 }
 
@@ -29,65 +36,57 @@ static void get_val_key(AlirValue *val, char *out_key) {
 // Detects basic Use-After-Free and Double-Free vulnerabilities within single blocks.
 /**
  * @brief Perform block-local memory safety checks (use-after-free, double-free).
+ *
+ * Packing gives every temp and variable one value index, so the freed set
+ * is an array stamped with the current block instead of a per-block map.
+ *
  * @param ctx ALIR checker context.
- * @param func Function to check.
+ * @param pf Packed function to check.
  */
-void alick_check_memory(AlickCtx *ctx, AlirFunction *func) {
-    AlirBlock *b = func->blocks;
-    
-    while (b) {
+void alick_check_memory(AlickCtx *ctx, AlirPackedFunction *pf) {
+    AlirFunction *func = pf->func;
+    uint32_t *freed_in = alir_alloc(ctx->module, sizeof(uint32_t) * pf->value_count);
+    if (!freed_in) return;
+    char key[64];
+
+    for (uint32_t bi = 0; bi < pf->block_count; bi++) {
         // Track pointers freed in this block to catch UAF
-        HashMap freed_map;
-        
-        // Use arena if available to avoid memory leaks if checking bails early
-        Arena *arena = NULL;
-        if (ctx->module->compiler_ctx && ctx->module->compiler_ctx->arena) {
-            arena = ctx->module->compiler_ctx->arena;
-        }
-        
-        hashmap_init(&freed_map, arena, 32);
+        AlirBlock *b = pf->blocks[bi].block;
+        uint32_t stamp = bi + 1;
 
-        AlirInst *i = b->head;
-        while (i) {
-            char key1[64] = {0};
-            char key2[64] = {0};
-            
-            get_val_key(i->op1, key1);
-            get_val_key(i->op2, key2);
+        AlirPackedInst *end = pf->insts + pf->blocks[bi].first + pf->blocks[bi].count;
+        for (AlirPackedInst *i = pf->insts + pf->blocks[bi].first; i < end; i++) {
+            int track1 = is_tracked(pf, i->op1);
+            int track2 = is_tracked(pf, i->op2);
 
             // 1. Check Use-After-Free on operands
-            if (key1[0] != '\0' && hashmap_has(&freed_map, key1)) {
-                alick_error(ctx, func, b, i, "Use-After-Free: Pointer/Variable '%s' is used after being freed.", key1);
+            if (track1 && freed_in[i->op1] == stamp) {
+                get_val_key(pf, i->op1, key);
+                alick_error(ctx, func, b, i, "Use-After-Free: Pointer/Variable '%s' is used after being freed.", key);
             }
-            if (key2[0] != '\0' && hashmap_has(&freed_map, key2)) {
-                alick_error(ctx, func, b, i, "Use-After-Free: Pointer/Variable '%s' is used after being freed.", key2);
+            if (track2 && freed_in[i->op2] == stamp) {
+                get_val_key(pf, i->op2, key);
+                alick_error(ctx, func, b, i, "Use-After-Free: Pointer/Variable '%s' is used after being freed.", key);
             }
 
             // Also check call arguments for UAF
-            for (int arg_idx = 0; arg_idx < i->arg_count; arg_idx++) {
-                char arg_key[64] = {0};
-                get_val_key(i->args[arg_idx], arg_key);
-                if (arg_key[0] != '\0' && hashmap_has(&freed_map, arg_key)) {
-                    alick_error(ctx, func, b, i, "Use-After-Free: Pointer '%s' is passed as argument after being freed.", arg_key);
+            AlirValueRef *args = alir_packed_args(i);
+            for (uint32_t arg_idx = 0; arg_idx < i->arg_count; arg_idx++) {
+                if (is_tracked(pf, args[arg_idx]) && freed_in[args[arg_idx]] == stamp) {
+                    get_val_key(pf, args[arg_idx], key);
+                    alick_error(ctx, func, b, i, "Use-After-Free: Pointer '%s' is passed as argument after being freed.", key);
                 }
             }
 
-        // 2. Track FREE instructions
-        if (i->op == ALIR_OP_FREE_STACK && key1[0] != '\0') {
-            if (hashmap_has(&freed_map, key1)) {
-                alick_error(ctx, func, b, i, "Double-Free: Pointer '%s' is freed multiple times.", key1);
-            } else {
-                hashmap_put(&freed_map, key1, (void*)1);
+            // 2. Track FREE instructions
+            if (i->op == ALIR_OP_FREE_STACK && track1) {
+                if (freed_in[i->op1] == stamp) {
+                    get_val_key(pf, i->op1, key);
+                    alick_error(ctx, func, b, i, "Double-Free: Pointer '%s' is freed multiple times.", key);
+                } else {
+                    freed_in[i->op1] = stamp;
+                }
             }
         }
-
-            i = i->next;
-        }
-
-        if (!arena) {
-            hashmap_free(&freed_map);
-        }
-
-        b = b->next;
     }
 }
@@ -4,17 +4,29 @@
  */
 #include "../../include/alick/alick_internal.h"
 
+/**
+ * @brief Whether an operand is present but has no type.
+ * @param ctx ALIR checker context.
+ * @param pf Packed function owning the operand.
+ * @param ref Operand reference.
+ * @return Non-zero if the operand's type is unknown.
+ */
+static int operand_untyped(AlickCtx *ctx, AlirPackedFunction *pf, AlirValueRef ref) {
+    return ref && alir_type_get(ctx->module, pf->values[ref].type)->base == TYPE_UNKNOWN;
+}
+
 /**
  * @brief Validate operand types and counts for instructions in a function.
  * @param ctx ALIR checker context.
- * @param func Function to check.
+ * @param pf Packed function to check.
  */
-void alick_check_types(AlickCtx *ctx, AlirFunction *func) {
-    AlirBlock *b = func->blocks;
-    
-    while (b) {
-        AlirInst *i = b->head;
-        while (i) {
+void alick_check_types(AlickCtx *ctx, AlirPackedFunction *pf) {
+    AlirFunction *func = pf->func;
+
+    for (uint32_t bi = 0; bi < pf->block_count; bi++) {
+        AlirBlock *b = pf->blocks[bi].block;
+        AlirPackedInst *end = pf->insts + pf->blocks[bi].first + pf->blocks[bi].count;
+        for (AlirPackedInst *i = pf->insts + pf->blocks[bi].first; i < end; i++) {
             switch (i->op) {
                 case ALIR_OP_STORE:
                     if (!i->op1) alick_error(ctx, func, b, i, "STORE requires a value operand (op1).");
@@ -29,9 +41,9 @@ void alick_check_types(AlickCtx *ctx, AlirFunction *func) {
                 case ALIR_OP_GET_PTR:
                     if (!i->dest) alick_error(ctx, func, b, i, "GET_PTR requires a destination operand.");
                     if (!i->op1) alick_error(ctx, func, b, i, "GET_PTR requires a base pointer operand (op1).");
-                    if (i->op1->type.base == TYPE_UNKNOWN) alick_error(ctx, func, b, i, "GET_PTR 1st operand must have type.");
+                    if (operand_untyped(ctx, pf, i->op1)) alick_error(ctx, func, b, i, "GET_PTR 1st operand must have type.");
                     if (!i->op2) alick_error(ctx, func, b, i, "GET_PTR requires an index operand (op2).");
-                    if (i->op2->type.base == TYPE_UNKNOWN) alick_error(ctx, func, b, i, "GET_PTR 2nd operand must have type.");
+                    if (operand_untyped(ctx, pf, i->op2)) alick_error(ctx, func, b, i, "GET_PTR 2nd operand must have type.");
                     break;
                     
                 case ALIR_OP_ALLOCA:
@@ -73,14 +85,21 @@ void alick_check_types(AlickCtx *ctx, AlirFunction *func) {
                     if (!i->op1) alick_error(ctx, func, b, i, "CALL requires a function target (op1).");
                     // Note: dest is optional for CALL if return type is void
                     break;
+
+                case ALIR_OP_PHI:
+                    if (!i->dest) alick_error(ctx, func, b, i, "PHI requires a destination.");
+                    if (i->arg_count % 2) alick_error(ctx, func, b, i, "PHI requires (label, value) argument pairs.");
+                    break;
+
+                case ALIR_OP_SWITCH:
+                    if (!i->op1) alick_error(ctx, func, b, i, "SWITCH requires a value to dispatch on.");
+                    if (i->arg_count % 2) alick_error(ctx, func, b, i, "SWITCH requires (case, label) argument pairs.");
+                    break;
                    
                 // TODO if needed, untoggle this
                 default:
                    break;
             }
-            
-            i = i->next;
         }
-        b = b->next;
     }
 }
@@ -5,6 +5,7 @@
 #include "alir.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 /**
@@ -80,22 +81,41 @@ static VarType br_type(AlirModule *m, FILE *f) {
     return t;
 }
 
+/**
+ * @brief Values of one function read so far, in the order they were written.
+ */
+typedef struct BrValues {
+    AlirValue **items;
+    uint32_t count;
+    uint32_t cap;
+} BrValues;
+
 /**
  * @brief Read an AlirValue from a binary file.
  * @param m Module used for allocation.
  * @param f Open file handle.
+ * @param seen Values of the current function read so far.
  * @return Pointer to the decoded value, or NULL on failure.
  */
-static AlirValue* br_value(AlirModule *m, FILE *f) {
+static AlirValue* br_value(AlirModule *m, FILE *f, BrValues *seen) {
     uint8_t kind = br_u8(f);
     if (kind == 0xFF) return NULL;
+    if (kind == 0xFE) {
+        uint32_t index = br_u32(f);
+        return index < seen->count ? seen->items[index] : NULL;
+    }
     AlirValue *v = alir_alloc(m, sizeof(AlirValue));
+    if (seen->count >= seen->cap) {
+        seen->cap = seen->cap ? seen->cap * 2 : 64;
+        seen->items = realloc(seen->items, sizeof(AlirValue*) * seen->cap);
+    }
+    seen->items[seen->count++] = v;
     v->kind = kind;
     v->type = br_type(m, f);
     v->temp_id = br_u32(f);
     
     if (v->kind == ALIR_VAL_INT || v->kind == ALIR_VAL_SINGLE || v->kind == ALIR_VAL_DOUBLE || v->kind == ALIR_VAL_CONST) {
-        v->val.int_val = br_u64(f);
+        v->val.unsigned_long_val = br_u64(f);
     } else if (v->kind == ALIR_VAL_VAR || v->kind == ALIR_VAL_LABEL || v->kind == ALIR_VAL_TYPE || v->kind == ALIR_VAL_GLOBAL) {
         v->val.str_val = br_str(m, f);
     }
@@ -106,21 +126,25 @@ static AlirValue* br_value(AlirModule *m, FILE *f) {
  * @brief Read an AlirInstruction from a binary file.
  * @param m Module used for allocation.
  * @param f Open file handle.
+ * @param seen Values of the current function read so far.
  * @return Pointer to the decoded instruction.
  */
-static AlirInst* br_inst(AlirModule *m, FILE *f) {
+static AlirInst* br_inst(AlirModule *m, FILE *f, BrValues *seen) {
     AlirInst *i = alir_alloc(m, sizeof(AlirInst));
     i->op = br_u32(f);
-    i->dest = br_value(m, f);
-    i->op1 = br_value(m, f);
-    i->op2 = br_value(m, f);
+    i->dest = br_value(m, f, seen);
+    i->op1 = br_value(m, f, seen);
+    i->op2 = br_value(m, f, seen);
     i->arg_count = br_u32(f);
     if (i->arg_count > 0) {
         i->args = alir_alloc(m, sizeof(AlirValue*) * i->arg_count);
         for (int j = 0; j < i->arg_count; j++) {
-            i->args[j] = br_value(m, f);
+            i->args[j] = br_value(m, f, seen);
         }
     }
+    i->custom_flag = br_u32(f);
+    // The args array was allocated exactly, so that is the capacity now
+    if (i->op == ALIR_OP_PHI || i->op == ALIR_OP_SWITCH) i->custom_flag = i->arg_count / 2;
     
     i->line = br_u32(f);
     i->col = br_u32(f);
@@ -131,16 +155,17 @@ static AlirInst* br_inst(AlirModule *m, FILE *f) {
  * @brief Read an AlirBlock (basic block) from a binary file.
  * @param m Module used for allocation.
  * @param f Open file handle.
+ * @param seen Values of the current function read so far.
  * @return Pointer to the decoded block.
  */
-static AlirBlock* br_block(AlirModule *m, FILE *f) {
+static AlirBlock* br_block(AlirModule *m, FILE *f, BrValues *seen) {
     AlirBlock *b = alir_alloc(m, sizeof(AlirBlock));
     b->label = br_str(m, f);
     
     uint32_t inst_c = br_u32(f);
     AlirInst **i_tail = &b->head;
     for (uint32_t j = 0; j < inst_c; j++) {
-        AlirInst *i = br_inst(m, f);
+        AlirInst *i = br_inst(m, f, seen);
         *i_tail = i;
         b->tail = i;
         i_tail = &i->next;
@@ -161,6 +186,12 @@ static AlirFunction* br_func(AlirModule *m, FILE *f) {
     fn->is_flux = br_u8(f);
     fn->is_varargs = br_u8(f);
     fn->cconv = br_str(m, f);
+    fn->is_extern = br_u8(f);
+    fn->is_pure = br_u8(f);
+    fn->is_total = br_u8(f);
+    fn->is_pristine = br_u8(f);
+    fn->inline_hint = (int)br_u8(f) - 1;
+    fn->reason = br_str(m, f);
     
     fn->param_count = br_u32(f);
     AlirParam **p_tail = &fn->params;
@@ -173,13 +204,16 @@ static AlirFunction* br_func(AlirModule *m, FILE *f) {
     }
     
     uint32_t block_c = br_u32(f);
+    BrValues seen = {0};
     AlirBlock **b_tail = &fn->blocks;
     for (uint32_t j = 0; j < block_c; j++) {
-        AlirBlock *b = br_block(m, f);
+        AlirBlock *b = br_block(m, f, &seen);
         *b_tail = b;
         b_tail = &b->next;
     }
+    free(seen.items);
     fn->block_count = block_c;
+    alir_resolve_labels(m, fn);
     return fn;
 }
 
@@ -221,9 +255,30 @@ static AlirGlobal* br_global(AlirModule *m, FILE *f) {
     return g;
 }
 
+/**
+ * @brief Read an AlirEnum definition from a binary file.
+ * @param m Module used for allocation.
+ * @param f Open file handle.
+ * @return Pointer to the decoded enum.
+ */
+static AlirEnum* br_enum(AlirModule *m, FILE *f) {
+    AlirEnum *e = alir_alloc(m, sizeof(AlirEnum));
+    e->name = br_str(m, f);
+    uint32_t ec = br_u32(f);
+    AlirEnumEntry **en_tail = &e->entries;
+    for (uint32_t j = 0; j < ec; j++) {
+        AlirEnumEntry *en = alir_alloc(m, sizeof(AlirEnumEntry));
+        en->name = br_str(m, f);
+        en->value = (long)br_u64(f);
+        *en_tail = en;
+        en_tail = &en->next;
+    }
+    return e;
+}
+
 static const uint8_t MAGIC2[5] = {0xfa, 0x8a, 0x11, 0xa1, 0xc1};
 static const uint8_t MAGIC[9] = {0x2f, 0x58, 0xb0, 0x4f, 0x2e, 0xc2, 0xa8, 0xee, 0x24};
-static const uint8_t VERSION = 1;
+static const uint8_t VERSION = 2;
 
 /**
  * @brief Read a complete ALIR module from a binary file.
@@ -257,6 +312,7 @@ AlirModule* alir_read_binary(CompilerContext *ctx, const char *filename) {
     mod->name = br_str(mod, f);
     mod->src = NULL;
     mod->filename = br_str(mod, f);
+    mod->str_counter = br_u32(f);
     
     uint32_t g_c = br_u32(f);
     AlirGlobal **g_tail = &mod->globals;
@@ -270,14 +326,25 @@ AlirModule* alir_read_binary(CompilerContext *ctx, const char *filename) {
     AlirStruct **s_tail = &mod->structs;
     for (uint32_t i = 0; i < s_c; i++) {
         AlirStruct *st = br_struct(mod, f);
+        hashmap_put(&mod->struct_map, st->name, st);
         *s_tail = st;
         s_tail = &st->next;
     }
     
+    uint32_t e_c = br_u32(f);
+    AlirEnum **e_tail = &mod->enums;
+    for (uint32_t i = 0; i < e_c; i++) {
+        AlirEnum *e = br_enum(mod, f);
+        hashmap_put(&mod->enum_map, e->name, e);
+        *e_tail = e;
+        e_tail = &e->next;
+    }
+
     uint32_t f_c = br_u32(f);
     AlirFunction **f_tail = &mod->functions;
     for (uint32_t i = 0; i < f_c; i++) {
         AlirFunction *fn = br_func(mod, f);
+        hashmap_put(&mod->func_map, fn->name, fn);
         *f_tail = fn;
         f_tail = &fn->next;
     }
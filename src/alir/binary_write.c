@@ -3,6 +3,7 @@
  * @brief ALIR binary module writer implementation.
  */
 #include "alir.h"
+#include "common/arena.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -63,19 +64,41 @@ static void bw_type(FILE *f, VarType t) {
     // The spec usually lowers function types into pointers
 }
 
+/**
+ * @brief Values of one function already written, so a shared value is written once.
+ */
+typedef struct BwValues {
+    HashMap index;          // "%p" of a value -> its index + 1
+    uint32_t count;
+} BwValues;
+
 /**
  * @brief Write an AlirValue to a binary file.
+ *
+ * The first occurrence of a value in a function is written in full; later
+ * ones refer back to it, so the reader rebuilds the same sharing.
+ *
  * @param f Open file handle.
+ * @param seen Values of the current function written so far.
  * @param v Value to serialize.
  */
-static void bw_value(FILE *f, AlirValue *v) {
+static void bw_value(FILE *f, BwValues *seen, AlirValue *v) {
     if (!v) { bw_u8(f, 0xFF); return; }
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)v);
+    uint32_t index = (uint32_t)(uintptr_t)hashmap_get(&seen->index, key);
+    if (index) {
+        bw_u8(f, 0xFE);
+        bw_u32(f, index - 1);
+        return;
+    }
+    hashmap_put(&seen->index, key, (void*)(uintptr_t)++seen->count);
     bw_u8(f, v->kind);
     bw_type(f, v->type);
     bw_u32(f, v->temp_id);
     // Value union
     if (v->kind == ALIR_VAL_INT || v->kind == ALIR_VAL_SINGLE || v->kind == ALIR_VAL_DOUBLE || v->kind == ALIR_VAL_CONST) {
-        bw_u64(f, v->val.int_val); // union overlays float, we just copy 8 bytes
+        bw_u64(f, v->val.unsigned_long_val); // union overlays double, so copy all 8 bytes
     } else if (v->kind == ALIR_VAL_VAR || v->kind == ALIR_VAL_LABEL || v->kind == ALIR_VAL_TYPE || v->kind == ALIR_VAL_GLOBAL) {
         bw_str(f, v->val.str_val);
     }
@@ -84,17 +107,19 @@ static void bw_value(FILE *f, AlirValue *v) {
 /**
  * @brief Write an AlirInstruction to a binary file.
  * @param f Open file handle.
+ * @param seen Values of the current function written so far.
  * @param i Instruction to serialize.
  */
-static void bw_inst(FILE *f, AlirInst *i) {
+static void bw_inst(FILE *f, BwValues *seen, AlirInst *i) {
     bw_u32(f, i->op);
-    bw_value(f, i->dest);
-    bw_value(f, i->op1);
-    bw_value(f, i->op2);
+    bw_value(f, seen, i->dest);
+    bw_value(f, seen, i->op1);
+    bw_value(f, seen, i->op2);
     bw_u32(f, i->arg_count);
     for (int j = 0; j < i->arg_count; j++) {
-        bw_value(f, i->args[j]);
+        bw_value(f, seen, i->args[j]);
     }
+    bw_u32(f, i->custom_flag);
     
     bw_u32(f, i->line);
     bw_u32(f, i->col);
@@ -103,9 +128,10 @@ static void bw_inst(FILE *f, AlirInst *i) {
 /**
  * @brief Write an AlirBlock (basic block) to a binary file.
  * @param f Open file handle.
+ * @param seen Values of the current function written so far.
  * @param b Block to serialize.
  */
-static void bw_block(FILE *f, AlirBlock *b) {
+static void bw_block(FILE *f, BwValues *seen, AlirBlock *b) {
     if (!b) return;
     bw_str(f, b->label);
     
@@ -115,20 +141,27 @@ static void bw_block(FILE *f, AlirBlock *b) {
     bw_u32(f, inst_c);
     
     i = b->head;
-    while(i) { bw_inst(f, i); i = i->next; }
+    while(i) { bw_inst(f, seen, i); i = i->next; }
 }
 
 /**
  * @brief Write an AlirFunction to a binary file.
+ * @param mod Module owning the function.
  * @param f Open file handle.
  * @param fn Function to serialize.
  */
-static void bw_func(FILE *f, AlirFunction *fn) {
+static void bw_func(AlirModule *mod, FILE *f, AlirFunction *fn) {
     bw_str(f, fn->name);
     bw_type(f, fn->ret_type);
     bw_u8(f, fn->is_flux);
     bw_u8(f, fn->is_varargs);
     bw_str(f, fn->cconv);
+    bw_u8(f, fn->is_extern);
+    bw_u8(f, fn->is_pure);
+    bw_u8(f, fn->is_total);
+    bw_u8(f, fn->is_pristine);
+    bw_u8(f, (uint8_t)(fn->inline_hint + 1));
+    bw_str(f, fn->reason);
     
     bw_u32(f, fn->param_count);
     AlirParam *p = fn->params;
@@ -143,8 +176,13 @@ static void bw_func(FILE *f, AlirFunction *fn) {
     while(b) { block_c++; b = b->next; }
     bw_u32(f, block_c);
     
+    Arena *arena = mod->compiler_ctx ? mod->compiler_ctx->arena : NULL;
+    BwValues seen = {0};
+    hashmap_init(&seen.index, arena, 256);
+    seen.index.owns_keys = !arena;
     b = fn->blocks;
-    while(b) { bw_block(f, b); b = b->next; }
+    while(b) { bw_block(f, &seen, b); b = b->next; }
+    if (!arena) hashmap_free(&seen.index);
 }
 
 /**
@@ -179,9 +217,25 @@ static void bw_global(FILE *f, AlirGlobal *g) {
     bw_str(f, g->string_content);
 }
 
+/**
+ * @brief Write an AlirEnum definition to a binary file.
+ * @param f Open file handle.
+ * @param e Enum to serialize.
+ */
+static void bw_enum(FILE *f, AlirEnum *e) {
+    bw_str(f, e->name);
+    uint32_t ec = 0;
+    for (AlirEnumEntry *en = e->entries; en; en = en->next) ec++;
+    bw_u32(f, ec);
+    for (AlirEnumEntry *en = e->entries; en; en = en->next) {
+        bw_str(f, en->name);
+        bw_u64(f, (uint64_t)en->value);
+    }
+}
+
 static const uint8_t MAGIC2[5] = {0xfa, 0x8a, 0x11, 0xa1, 0xc1};
 static const uint8_t MAGIC[9] = {0x2f, 0x58, 0xb0, 0x4f, 0x2e, 0xc2, 0xa8, 0xee, 0x24};
-static const uint8_t VERSION = 1;
+static const uint8_t VERSION = 2;
 
 /**
  * @brief Write a complete ALIR module to a binary file.
@@ -199,15 +253,19 @@ int alir_write_binary(AlirModule *mod, const char *filename) {
     
     bw_str(f, mod->name);
     bw_str(f, mod->filename);
+    bw_u32(f, mod->str_counter);
     
     uint32_t g_c = 0; AlirGlobal *g = mod->globals; while(g) { g_c++; g = g->next; } bw_u32(f, g_c);
     g = mod->globals; while(g) { bw_global(f, g); g = g->next; }
     
     uint32_t s_c = 0; AlirStruct *st = mod->structs; while(st) { s_c++; st = st->next; } bw_u32(f, s_c);
     st = mod->structs; while(st) { bw_struct(f, st); st = st->next; }
+
+    uint32_t e_c = 0; AlirEnum *e = mod->enums; while(e) { e_c++; e = e->next; } bw_u32(f, e_c);
+    e = mod->enums; while(e) { bw_enum(f, e); e = e->next; }
     
     uint32_t f_c = 0; AlirFunction *fn = mod->functions; while(fn) { f_c++; fn = fn->next; } bw_u32(f, f_c);
-    fn = mod->functions; while(fn) { bw_func(f, fn); fn = fn->next; }
+    fn = mod->functions; while(fn) { bw_func(mod, f, fn); fn = fn->next; }
     
     fclose(f);
     return 0;
@@ -5,158 +5,207 @@
 #include "alir.h"
 #include "../common/hashmap.h"
 
+/**
+ * @brief Whether values made now may come from the module pool.
+ *
+ * A thread optimizing functions alongside others allocates from an arena of
+ * its own and must not touch the pool, so it makes private values instead.
+ *
+ * @param mod Module used for allocation.
+ * @return Non-zero if the pool can be used.
+ */
+static int pool_open(AlirModule *mod) {
+    Arena *arena = (mod && mod->compiler_ctx) ? mod->compiler_ctx->arena : NULL;
+    return arena && alir_arena(mod) == arena;
+}
+
+/**
+ * @brief Returns the pooled copy of a constant or global reference.
+ *
+ * The key holds the kind, the whole type and the bits of a constant or the
+ * name of a global. Values whose key does not fit, or with function pointer
+ * types, are allocated on their own.
+ *
+ * @param mod Module used for allocation.
+ * @param proto The value wanted, zeroed apart from kind, type and val; a
+ *        global's name is copied.
+ * @return The shared value, or a new one if it cannot be pooled.
+ */
+static AlirValue* pool_value(AlirModule *mod, const AlirValue *proto) {
+    const VarType *t = &proto->type;
+    char key[320];
+    int n = -1;
+    if (pool_open(mod) && !t->fp_ret_type && !t->fp_param_types) {
+        n = snprintf(key, sizeof(key), "%d:%d:%d:%d:%d:%d%d%d%d:%s:",
+                     proto->kind, t->base, t->ptr_depth, t->array_size, t->array_depth,
+                     t->is_unsigned, t->is_func_ptr, t->is_tainted, t->is_pristine,
+                     t->class_name ? t->class_name : "");
+        if (n > 0 && n < (int)sizeof(key)) {
+            n += proto->kind == ALIR_VAL_GLOBAL
+                ? snprintf(key + n, sizeof(key) - n, "%s", proto->val.str_val ? proto->val.str_val : "")
+                : snprintf(key + n, sizeof(key) - n, "%llx", proto->val.unsigned_long_val);
+        }
+    }
+
+    int pooled = n > 0 && n < (int)sizeof(key);
+    AlirValue *v = pooled ? hashmap_get(&mod->value_pool, key) : NULL;
+    if (v) return v;
+
+    v = alir_alloc(mod, sizeof(AlirValue));
+    *v = *proto;
+    if (v->kind == ALIR_VAL_GLOBAL) v->val.str_val = alir_strdup(mod, proto->val.str_val);
+    if (pooled) {
+        v->pooled = 1;
+        hashmap_put(&mod->value_pool, key, v);
+    }
+    return v;
+}
+
+/**
+ * @brief Create an ALIR constant value of any scalar type.
+ * @param mod Module used for allocation.
+ * @param type Type of the constant.
+ * @param val Bits of the constant, with the bytes the type does not use zeroed.
+ * @return The pooled constant value.
+ */
+AlirValue* alir_const_value(AlirModule *mod, VarType type, Value val) {
+    AlirValue c = {0};
+    c.kind = ALIR_VAL_CONST;
+    c.type = type;
+    c.val = val;
+    return pool_value(mod, &c);
+}
+
 /**
  * @brief Create an ALIR constant integer value.
  * @param mod Module used for allocation.
  * @param val Integer value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_int(AlirModule *mod, long val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_INT, 0};
-    v->val.int_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.int_val = val;
+    return alir_const_value(mod, (VarType){TYPE_INT, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant boolean value.
  * @param mod Module used for allocation.
  * @param val Boolean value (0 or 1).
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_bool(AlirModule *mod, int val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_BOOL, 0};
-    v->val.int_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.int_val = val;
+    return alir_const_value(mod, (VarType){TYPE_BOOL, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant character value.
  * @param mod Module used for allocation.
  * @param val Character value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_char(AlirModule *mod, char val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_CHAR, 0};
-    v->val.char_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.char_val = val;
+    return alir_const_value(mod, (VarType){TYPE_CHAR, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant unsigned character value.
  * @param mod Module used for allocation.
  * @param val Unsigned character value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_unsigned_char(AlirModule *mod, unsigned char val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_CHAR, 0};
-    v->val.unsigned_char_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.unsigned_char_val = val;
+    return alir_const_value(mod, (VarType){TYPE_CHAR, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant unsigned integer value.
  * @param mod Module used for allocation.
  * @param val Unsigned integer value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_unsigned_int(AlirModule *mod, unsigned int val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_UNSIGNED_INT, 0};
-    v->val.unsigned_int_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.unsigned_int_val = val;
+    return alir_const_value(mod, (VarType){TYPE_UNSIGNED_INT, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant long value.
  * @param mod Module used for allocation.
  * @param val Long value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_long(AlirModule *mod, long val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_LONG, 0};
-    v->val.long_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.long_val = val;
+    return alir_const_value(mod, (VarType){TYPE_LONG, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant long long value.
  * @param mod Module used for allocation.
  * @param val Long long value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_long_long(AlirModule *mod, long long val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_LONG_LONG, 0};
-    v->val.long_long_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.long_long_val = val;
+    return alir_const_value(mod, (VarType){TYPE_LONG_LONG, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant unsigned long value.
  * @param mod Module used for allocation.
  * @param val Unsigned long value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_unsigned_long(AlirModule *mod, unsigned long val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_UNSIGNED_LONG, 0};
-    v->val.unsigned_long_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.unsigned_long_val = val;
+    return alir_const_value(mod, (VarType){TYPE_UNSIGNED_LONG, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant unsigned long long value.
  * @param mod Module used for allocation.
  * @param val Unsigned long long value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_unsigned_long_long(AlirModule *mod, unsigned long long val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_UNSIGNED_LONG_LONG, 0};
-    v->val.unsigned_long_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.unsigned_long_val = val;
+    return alir_const_value(mod, (VarType){TYPE_UNSIGNED_LONG_LONG, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant float (single-precision) value.
  * @param mod Module used for allocation.
  * @param val Float value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_float(AlirModule *mod, float val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_SINGLE, 0};
-    v->val.single_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.single_val = val;
+    return alir_const_value(mod, (VarType){TYPE_SINGLE, 0}, v);
 }
 
 /**
  * @brief Create an ALIR constant double value.
  * @param mod Module used for allocation.
  * @param val Double value.
- * @return Newly allocated constant value.
+ * @return The pooled constant value.
  */
 AlirValue* alir_const_double(AlirModule *mod, double val) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_CONST;
-    v->type = (VarType){TYPE_DOUBLE, 0};
-    v->val.double_val = val;
-    return v;
+    Value v = { .unsigned_long_val = 0 };
+    v.double_val = val;
+    return alir_const_value(mod, (VarType){TYPE_DOUBLE, 0}, v);
 }
 
 /**
@@ -192,14 +241,14 @@ AlirValue* alir_val_var(AlirModule *mod, const char *name) {
  * @param mod Module used for allocation.
  * @param name Global variable name.
  * @param type Type of the global.
- * @return Newly allocated global value.
+ * @return The pooled global value.
  */
 AlirValue* alir_val_global(AlirModule *mod, const char *name, VarType type) {
-    AlirValue *v = alir_alloc(mod, sizeof(AlirValue));
-    v->kind = ALIR_VAL_GLOBAL;
-    v->val.str_val = alir_strdup(mod, name);
-    v->type = type;
-    return v;
+    AlirValue g = {0};
+    g.kind = ALIR_VAL_GLOBAL;
+    g.val.str_val = (char*)name;
+    g.type = type;
+    return pool_value(mod, &g);
 }
 
 /**
@@ -215,6 +264,27 @@ AlirValue* alir_val_label(AlirModule *mod, const char *label) {
     return v;
 }
 
+/**
+ * @brief Return the ALIR label value bound to a block, making it on first use.
+ *
+ * A block belongs to one function, which one thread at a time works on, so
+ * the value can be kept on the block without the module pool.
+ *
+ * @param mod Module used for allocation.
+ * @param block Target block.
+ * @return The label value of the block.
+ */
+AlirValue* alir_val_block(AlirModule *mod, AlirBlock *block) {
+    AlirValue *v = block->ref;
+    if (v && v->val.str_val == block->label) return v;
+    v = alir_alloc(mod, sizeof(AlirValue));
+    v->kind = ALIR_VAL_LABEL;
+    v->val.str_val = block->label;
+    v->block = block;
+    block->ref = v;
+    return v;
+}
+
 /**
  * @brief Create an ALIR type-reference value.
  * @param mod Module used for allocation.
@@ -8,6 +8,27 @@
 #include <string.h>
 #include <stdio.h>
 
+// Arena of the calling thread while it optimizes functions alongside others
+static _Thread_local Arena *alir_thread_arena = NULL;
+
+/**
+ * @brief Routes the ALIR allocations of the calling thread to an arena of its own.
+ * @param arena The arena, or NULL to go back to the module arena.
+ */
+void alir_set_thread_arena(Arena *arena) {
+    alir_thread_arena = arena;
+}
+
+/**
+ * @brief Returns the arena ALIR allocations of the calling thread go to.
+ * @param mod ALIR module.
+ * @return The thread arena if one is set, else the module arena, or NULL.
+ */
+Arena* alir_arena(AlirModule *mod) {
+    if (alir_thread_arena) return alir_thread_arena;
+    return (mod && mod->compiler_ctx) ? mod->compiler_ctx->arena : NULL;
+}
+
 /**
  * @brief Allocates memory within an ALIR module's arena.
  * @param mod ALIR module.
@@ -15,8 +36,9 @@
  * @return Pointer to zeroed memory.
  */
 void* alir_alloc(AlirModule *mod, size_t size) {
-    if (mod && mod->compiler_ctx && mod->compiler_ctx->arena) {
-        void *ptr = arena_alloc(mod->compiler_ctx->arena, size);
+    Arena *arena = alir_arena(mod);
+    if (arena) {
+        void *ptr = arena_alloc(arena, size);
         if (ptr) memset(ptr, 0, size);
         return ptr;
     }
@@ -32,6 +54,8 @@ void* alir_alloc(AlirModule *mod, size_t size) {
  */
 char* alir_strdup(AlirModule *mod, const char *str) {
     if (!str) return NULL;
+    // The context interner is shared, so a thread with its own arena copies instead
+    if (alir_thread_arena) return arena_strdup(alir_thread_arena, str);
     if (mod && mod->compiler_ctx) {
         return (char*)context_intern(mod->compiler_ctx, str);
     }
@@ -59,6 +83,7 @@ AlirModule* alir_create_module(CompilerContext *ctx, const char *name) {
     hashmap_init(&m->enum_map, ctx ? ctx->arena : NULL, 64);
     hashmap_init(&m->func_map, ctx ? ctx->arena : NULL, 64);
     hashmap_init(&m->const_fold_map, ctx ? ctx->arena : NULL, 64);
+    hashmap_init(&m->value_pool, ctx ? ctx->arena : NULL, 256);
     return m;
 }
 
@@ -163,6 +188,9 @@ AlirValue* alir_module_add_string_literal(AlirModule *mod, const char *content,
 static HashMap label_map;
 static AlirFunction *current_tracked_func = NULL;
 static Arena *current_tracked_arena = NULL;
+// Last block appended to the tracked function, valid while its block count is unchanged
+static AlirBlock *current_tracked_tail = NULL;
+static int current_tracked_count = 0;
 
 /**
  * @brief Adds a new basic block to an ALIR function with an optional label hint.
@@ -181,6 +209,7 @@ AlirBlock* alir_add_block(AlirModule *mod, AlirFunction *func, const char *label
         hashmap_init(&label_map, arena, 64);
         current_tracked_func = func;
         current_tracked_arena = arena;
+        current_tracked_tail = NULL;
     }
 
     AlirBlock *b = alir_alloc(mod, sizeof(AlirBlock));
@@ -203,12 +232,16 @@ AlirBlock* alir_add_block(AlirModule *mod, AlirFunction *func, const char *label
 
     if (!func->blocks) {
         func->blocks = b;
+    } else if (current_tracked_tail && current_tracked_count == func->block_count && !current_tracked_tail->next) {
+        current_tracked_tail->next = b;
     } else {
         AlirBlock *curr = func->blocks;
         while(curr->next) curr = curr->next;
         curr->next = b;
     }
     func->block_count++;
+    current_tracked_tail = b;
+    current_tracked_count = func->block_count;
     return b;
 }
 
@@ -227,6 +260,72 @@ void alir_append_inst(AlirBlock *block, AlirInst *inst) {
     }
 }
 
+/**
+ * @brief Returns the number of branch target slots of an instruction.
+ * @param inst Instruction to inspect.
+ * @return 1 for JUMP, 2 for CONDI, 1 + cases for SWITCH, 0 otherwise.
+ */
+int alir_branch_count(AlirInst *inst) {
+    switch (inst->op) {
+        case ALIR_OP_JUMP: return 1;
+        case ALIR_OP_CONDI: return 2;
+        case ALIR_OP_SWITCH: return 1 + inst->arg_count / 2;
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Returns one branch target slot of an instruction.
+ *
+ * The slots are the JUMP target; the CONDI true and false targets; the
+ * SWITCH default followed by the case targets.
+ *
+ * @param inst Instruction to inspect.
+ * @param k Slot index below alir_branch_count().
+ * @return The slot, or NULL if it does not hold a label.
+ */
+AlirValue** alir_branch_slot(AlirInst *inst, int k) {
+    AlirValue **slot = NULL;
+    if (inst->op == ALIR_OP_JUMP) slot = &inst->op1;
+    else if (inst->op == ALIR_OP_CONDI) slot = k == 0 ? &inst->op2 : (inst->arg_count > 0 ? &inst->args[0] : NULL);
+    else if (inst->op == ALIR_OP_SWITCH) slot = k == 0 ? &inst->op2 : &inst->args[2 * k - 1];
+    return (slot && *slot && (*slot)->kind == ALIR_VAL_LABEL) ? slot : NULL;
+}
+
+/**
+ * @brief Binds label values that only carry a name to the block of that name.
+ * @param mod ALIR module.
+ * @param func Function whose branch targets are resolved.
+ */
+void alir_resolve_labels(AlirModule *mod, AlirFunction *func) {
+    Arena *arena = alir_arena(mod);
+    HashMap blocks;
+    hashmap_init(&blocks, arena, func->block_count > 16 ? func->block_count * 2 : 32);
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        if (b->label && !hashmap_get(&blocks, b->label)) hashmap_put(&blocks, b->label, b);
+    }
+
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            int n = alir_branch_count(i);
+            for (int k = 0; k < n; k++) {
+                AlirValue **slot = alir_branch_slot(i, k);
+                if (!slot) continue;
+                AlirValue *v = *slot;
+                if (!v->block && v->val.str_val) v->block = hashmap_get(&blocks, v->val.str_val);
+            }
+            if (i->op == ALIR_OP_PHI) {
+                for (int k = 0; k < i->arg_count; k += 2) {
+                    AlirValue *v = i->args[k];
+                    if (v && !v->block && v->val.str_val) v->block = hashmap_get(&blocks, v->val.str_val);
+                }
+            }
+        }
+    }
+
+    if (!arena) hashmap_free(&blocks);
+}
+
 /**
  * @brief Registers a struct type in the ALIR module.
  * @param mod ALIR module.
@@ -332,6 +431,7 @@ const char* alir_op_str(AlirOpcode op) {
         case ALIR_OP_FDIV: return "fdiv";
 
         case ALIR_OP_JUMP: return "jump";
+        case ALIR_OP_SWITCH: return "switch";
         case ALIR_OP_CONDI: return "condition";
         case ALIR_OP_CALL: return "call";
         case ALIR_OP_RET: return "ret";
@@ -355,6 +455,8 @@ const char* alir_op_str(AlirOpcode op) {
         case ALIR_OP_ROTR: return "rotr";
         case ALIR_OP_ROTL: return "rotl";
 
+        case ALIR_OP_PHI: return "phi";
+
         default: return "op";
     }
 }
@@ -173,6 +173,34 @@ void alir_emit_function(AlirModule *mod, FILE *f) {
                       else fprintf(f, "undef");
                       fprintf(f, " ");
                   }
+                  else if (inst->op == ALIR_OP_PHI) {
+                      fprintf(f, "phi[");
+                      if (inst->dest) alir_fprint_type(f, inst->dest->type);
+                      fprintf(f, "]");
+                      for (int k = 0; k + 1 < inst->arg_count; k += 2) {
+                          fprintf(f, "%s [", k > 0 ? "," : "");
+                          alir_fprint_val(f, inst->args[k]);
+                          fprintf(f, ": ");
+                          if (inst->args[k + 1]) alir_fprint_val(f, inst->args[k + 1]);
+                          else fprintf(f, "undef");
+                          fprintf(f, "]");
+                      }
+                  }
+                  else if (inst->op == ALIR_OP_SWITCH) {
+                      fprintf(f, "switch ");
+                      if (inst->op1) alir_fprint_val(f, inst->op1);
+                      else fprintf(f, "undef");
+                      fprintf(f, ", ");
+                      if (inst->op2) alir_fprint_val(f, inst->op2);
+                      else fprintf(f, "undef");
+                      for (int k = 0; k + 1 < inst->arg_count; k += 2) {
+                          fprintf(f, "%s [", k > 0 ? "," : "");
+                          alir_fprint_val(f, inst->args[k]);
+                          fprintf(f, ": ");
+                          alir_fprint_val(f, inst->args[k + 1]);
+                          fprintf(f, "]");
+                      }
+                  }
                   else if (inst->op == ALIR_OP_FREE_STACK) {
                       inst = inst->next;
                       continue;
@@ -10,59 +10,504 @@
  * @return Non-zero if the opcode is a terminator, 0 otherwise.
  */
 static int is_terminator_op(AlirOpcode op) {
-    return op == ALIR_OP_RET || op == ALIR_OP_JUMP || op == ALIR_OP_CONDI || op == ALIR_OP_PANIC;
+    return op == ALIR_OP_RET || op == ALIR_OP_JUMP || op == ALIR_OP_CONDI || op == ALIR_OP_SWITCH || op == ALIR_OP_PANIC;
+}
+
+/**
+ * @brief A suspension point of the flux resume function being generated.
+ */
+typedef struct FluxYield {
+    AlirBlock *block;           // Block ending in the return that suspends
+    AlirBlock *resume;          // Block the dispatch enters on the next resume
+    struct FluxYield *next;
+} FluxYield;
+
+/**
+ * @brief How the resume function uses one of its stack slots.
+ */
+typedef enum {
+    FLUX_SLOT_DIRECT,   // Only loaded and stored whole: spilled to the context at the yields
+    FLUX_SLOT_MEMORY,   // Also accessed through element pointers: lives in the context
+    FLUX_SLOT_ESCAPES   // Its address is kept somewhere: lives in the context
+} FluxSlotKind;
+
+/**
+ * @brief A stack slot of the flux resume function.
+ */
+typedef struct FluxSlot {
+    AlirInst *alloca;
+    FluxSlotKind kind;
+    int captured;
+} FluxSlot;
+
+/**
+ * @brief A context field shared by spilled slots of one type.
+ */
+typedef struct FluxField {
+    VarType type;
+    int index;
+    uint64_t *yields;           // Yields at which some slot is spilled into it
+} FluxField;
+
+/**
+ * @brief State of one capture analysis.
+ */
+typedef struct FluxCapture {
+    AlirCtx *ctx;
+    AlirFunction *func;
+    FluxSlot *slots;
+    int slot_count;
+    HashMap slot_of;            // "%p" of a slot value -> index + 1
+    FluxYield **yields;
+    int yield_count;
+    int words;                  // Words in a set of slots
+    uint64_t *gen;              // Per block id: slots read before being written
+    uint64_t *kill;             // Per block id: slots written
+    uint64_t *live;             // Per block id: slots live on entry
+} FluxCapture;
+
+/**
+ * @brief Emits a declaration marker: the slot's old value is dead from here on.
+ *
+ * The marker is a no-op (ALIR_OP_FREE_STACK, which passes already use as one)
+ * that flux_capture reads and then removes.
+ *
+ * @param ctx The ALIR context.
+ * @param slot Slot of the declared variable.
+ */
+void alir_flux_mark_decl(AlirCtx *ctx, AlirValue *slot) {
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_FREE_STACK, NULL, slot, NULL));
+}
+
+/**
+ * @brief Finds the slot a value names.
+ * @param cap The capture state.
+ * @param v The value.
+ * @return Slot index, or -1 if the value is not a slot.
+ */
+static int flux_slot_index(FluxCapture *cap, AlirValue *v) {
+    if (!v || v->kind != ALIR_VAL_TEMP) return -1;
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)v);
+    return (int)(intptr_t)hashmap_get(&cap->slot_of, key) - 1;
+}
+
+/**
+ * @brief Unlinks an instruction from a block.
+ * @param b The block.
+ * @param inst The instruction.
+ */
+static void flux_unlink(AlirBlock *b, AlirInst *inst) {
+    AlirInst *prev = NULL;
+    for (AlirInst *i = b->head; i && i != inst; i = i->next) prev = i;
+    if (prev) prev->next = inst->next;
+    else b->head = inst->next;
+    if (b->tail == inst) b->tail = prev;
+    inst->next = NULL;
+}
+
+/**
+ * @brief Inserts an instruction in front of another one of the same block.
+ * @param b The block.
+ * @param before The instruction to insert in front of.
+ * @param inst The instruction to insert.
+ */
+static void flux_insert_before(AlirBlock *b, AlirInst *before, AlirInst *inst) {
+    if (b->head == before) {
+        inst->next = b->head;
+        b->head = inst;
+        if (!b->tail) b->tail = inst;
+        return;
+    }
+    for (AlirInst *i = b->head; i; i = i->next) {
+        if (i->next == before) {
+            inst->next = before;
+            i->next = inst;
+            return;
+        }
+    }
+    alir_append_inst(b, inst);
+}
+
+/**
+ * @brief Moves every fixed-size alloca to the entry block and numbers them.
+ *
+ * Resumes enter the body through the dispatch switch, past wherever a slot
+ * was declared, so every slot must be defined on entry.
+ *
+ * @param cap The capture state.
+ */
+static void flux_collect_slots(FluxCapture *cap) {
+    int count = 0;
+    for (AlirBlock *b = cap->func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->op == ALIR_OP_ALLOCA && i->dest && !i->op1) count++;
+        }
+    }
+    cap->slots = alir_alloc(cap->ctx->module, sizeof(FluxSlot) * (count ? count : 1));
+    hashmap_init(&cap->slot_of, alir_arena(cap->ctx->module), 32);
+
+    AlirBlock *entry = cap->func->blocks;
+    for (AlirBlock *b = entry; b; b = b->next) {
+        AlirInst *i = b->head;
+        while (i) {
+            AlirInst *next = i->next;
+            if (i->op == ALIR_OP_ALLOCA && i->dest && !i->op1) {
+                flux_unlink(b, i);
+                char key[32];
+                snprintf(key, sizeof(key), "%p", (void*)i->dest);
+                hashmap_put(&cap->slot_of, key, (void*)(intptr_t)(cap->slot_count + 1));
+                cap->slots[cap->slot_count++].alloca = i;
+            }
+            i = next;
+        }
+    }
+    for (int k = cap->slot_count - 1; k >= 0; k--) {
+        flux_insert_before(entry, entry->head, cap->slots[k].alloca);
+    }
+}
+
+/**
+ * @brief Checks that a pointer is only used to load and store through.
+ * @param v The pointer.
+ * @param derived Set when element pointers are taken from it.
+ * @return Non-zero if its address never goes anywhere else.
+ */
+static int flux_access_only(AlirValue *v, int *derived) {
+    for (AlirUse *u = v->uses; u; u = u->next) {
+        AlirInst *i = u->user;
+        if (i->op == ALIR_OP_LOAD && u->slot == &i->op1) continue;
+        if (i->op == ALIR_OP_STORE && u->slot == &i->op2) continue;
+        if (i->op == ALIR_OP_FREE_STACK) continue;
+        if (i->op == ALIR_OP_GET_PTR && u->slot == &i->op1 && i->dest) {
+            *derived = 1;
+            if (!flux_access_only(i->dest, derived)) return 0;
+            continue;
+        }
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Computes which slots are live on entry to each block.
+ *
+ * Whole stores and declaration markers end a slot's value; loads and element
+ * pointers read it. A yield counts as an edge to its resume block, so a slot
+ * live on entry to a resume block is live across the yield in front of it,
+ * including slots only read after a later yield.
+ *
+ * @param cap The capture state.
+ */
+static void flux_liveness(FluxCapture *cap) {
+    int blocks = cap->func->block_count;
+    int w = cap->words;
+    cap->gen = alir_alloc(cap->ctx->module, sizeof(uint64_t) * blocks * w);
+    cap->kill = alir_alloc(cap->ctx->module, sizeof(uint64_t) * blocks * w);
+    cap->live = alir_alloc(cap->ctx->module, sizeof(uint64_t) * blocks * w);
+
+    for (AlirBlock *b = cap->func->blocks; b; b = b->next) {
+        uint64_t *gen = cap->gen + b->id * w;
+        uint64_t *kill = cap->kill + b->id * w;
+        for (AlirInst *i = b->head; i; i = i->next) {
+            int read = -1, write = -1;
+            switch (i->op) {
+                case ALIR_OP_LOAD:
+                case ALIR_OP_GET_PTR:
+                    read = flux_slot_index(cap, i->op1);
+                    break;
+                case ALIR_OP_STORE:
+                    write = flux_slot_index(cap, i->op2);
+                    break;
+                case ALIR_OP_FREE_STACK:
+                    write = flux_slot_index(cap, i->op1);
+                    break;
+                default:
+                    break;
+            }
+            if (read >= 0 && !(kill[read / 64] & (1ULL << (read % 64)))) gen[read / 64] |= 1ULL << (read % 64);
+            if (write >= 0) kill[write / 64] |= 1ULL << (write % 64);
+        }
+    }
+
+    // A yield hands the values it keeps on to its resume block
+    AlirBlock **resumes = alir_alloc(cap->ctx->module, sizeof(AlirBlock*) * blocks);
+    for (int k = 0; k < cap->yield_count; k++) resumes[cap->yields[k]->block->id] = cap->yields[k]->resume;
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (AlirBlock *b = cap->func->blocks; b; b = b->next) {
+            uint64_t *live = cap->live + b->id * w;
+            for (int k = 0; k < w; k++) {
+                uint64_t out = resumes[b->id] ? cap->live[resumes[b->id]->id * w + k] : 0;
+                for (AlirInst *i = b->head; i; i = i->next) {
+                    int n = alir_branch_count(i);
+                    for (int e = 0; e < n; e++) {
+                        AlirValue **slot = alir_branch_slot(i, e);
+                        if (slot && (*slot)->block) out |= cap->live[(*slot)->block->id * w + k];
+                    }
+                }
+                uint64_t in = cap->gen[b->id * w + k] | (out & ~cap->kill[b->id * w + k]);
+                if (in != live[k]) {
+                    live[k] = in;
+                    changed = 1;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Checks whether a slot is live across a yield.
+ * @param cap The capture state.
+ * @param y The yield.
+ * @param s The slot index.
+ * @return Non-zero if the slot is live on entry to the yield's resume block.
+ */
+static int flux_live_at(FluxCapture *cap, FluxYield *y, int s) {
+    return (cap->live[y->resume->id * cap->words + s / 64] >> (s % 64)) & 1;
+}
+
+/**
+ * @brief Compares two types for sharing a context field.
+ * @param a First type.
+ * @param b Second type.
+ * @return Non-zero if values of both types fit the same field.
+ */
+static int flux_same_type(VarType a, VarType b) {
+    if (a.base != b.base || a.ptr_depth != b.ptr_depth || a.array_size != b.array_size) return 0;
+    if (a.is_unsigned != b.is_unsigned || a.is_func_ptr || b.is_func_ptr) return 0;
+    if (!a.class_name || !b.class_name) return a.class_name == b.class_name;
+    return strcmp(a.class_name, b.class_name) == 0;
+}
+
+/**
+ * @brief Appends a field to the context struct.
+ * @param cap The capture state.
+ * @param tail Tail link of the field list.
+ * @param name Field name.
+ * @param type Field type.
+ * @param index Field index.
+ * @return The new tail link.
+ */
+static AlirField** flux_add_field(FluxCapture *cap, AlirField **tail, const char *name, VarType type, int index) {
+    AlirField *f = alir_alloc(cap->ctx->module, sizeof(AlirField));
+    f->name = alir_strdup(cap->ctx->module, name);
+    f->type = type;
+    f->index = index;
+    *tail = f;
+    return &f->next;
+}
+
+/**
+ * @brief Builds a pointer to a context field in front of an instruction.
+ * @param cap The capture state.
+ * @param b The block.
+ * @param before The instruction to insert in front of.
+ * @param type Type of the field.
+ * @param index Field index.
+ * @return The field pointer.
+ */
+static AlirValue* flux_field_ptr(FluxCapture *cap, AlirBlock *b, AlirInst *before, VarType type, int index) {
+    AlirCtx *ctx = cap->ctx;
+    VarType pt = type; pt.ptr_depth++;
+    AlirValue *ptr = new_temp(ctx, pt);
+    flux_insert_before(b, before, mk_inst(ctx->module, ALIR_OP_GET_PTR, ptr, ctx->flux_ctx_ptr, alir_const_int(ctx->module, index)));
+    return ptr;
+}
+
+/**
+ * @brief Copies a spilled slot into its field before a yield and back after it.
+ * @param cap The capture state.
+ * @param slot The slot value.
+ * @param index Field index.
+ * @param y The yield.
+ */
+static void flux_spill(FluxCapture *cap, AlirValue *slot, int index, FluxYield *y) {
+    AlirCtx *ctx = cap->ctx;
+    AlirInst *ret = y->block->tail;
+    AlirValue *field = flux_field_ptr(cap, y->block, ret, slot->type, index);
+    AlirValue *val = new_temp(ctx, slot->type);
+    flux_insert_before(y->block, ret, mk_inst(ctx->module, ALIR_OP_LOAD, val, slot, NULL));
+    flux_insert_before(y->block, ret, mk_inst(ctx->module, ALIR_OP_STORE, NULL, val, field));
+
+    AlirInst *head = y->resume->head;
+    field = flux_field_ptr(cap, y->resume, head, slot->type, index);
+    val = new_temp(ctx, slot->type);
+    flux_insert_before(y->resume, head, mk_inst(ctx->module, ALIR_OP_LOAD, val, field, NULL));
+    flux_insert_before(y->resume, head, mk_inst(ctx->module, ALIR_OP_STORE, NULL, val, slot));
+}
+
+/**
+ * @brief Keeps the locals of a flux resume function that outlive a yield in its context.
+ *
+ * Every local starts out as a stack slot of the resume function. A slot that
+ * is live on entry to some resume block is captured: one that is only loaded
+ * and stored whole is copied into a context field at the yields where it is
+ * live and back when the generator resumes, so it stays a register in
+ * between, and slots of one type that are never live at the same yield share
+ * a field. A slot accessed through element pointers, or whose address is
+ * kept, lives in the context for good. Everything else, such as scratch
+ * arrays used between two emits, stays on the stack.
+ *
+ * @param ctx The ALIR context, positioned in the finished resume function.
+ * @param struct_name Name of the context struct (never nested in itself).
+ * @param first_field Index of the first field for locals.
+ * @param tail Tail link of the context field list.
+ */
+static void flux_capture(AlirCtx *ctx, const char *struct_name, int first_field, AlirField **tail) {
+    FluxCapture cap = {0};
+    cap.ctx = ctx;
+    cap.func = ctx->current_func;
+
+    for (FluxYield *y = ctx->flux_yields; y; y = y->next) cap.yield_count++;
+    cap.yields = alir_alloc(ctx->module, sizeof(FluxYield*) * (cap.yield_count ? cap.yield_count : 1));
+    int n = cap.yield_count;
+    for (FluxYield *y = ctx->flux_yields; y; y = y->next) cap.yields[--n] = y;
+
+    flux_collect_slots(&cap);
+    cap.words = (cap.slot_count + 63) / 64;
+    alir_build_uses(ctx->module, cap.func);
+    if (cap.slot_count) flux_liveness(&cap);
+
+    for (int s = 0; s < cap.slot_count; s++) {
+        FluxSlot *slot = &cap.slots[s];
+        AlirValue *v = slot->alloca->dest;
+        int derived = 0;
+        if (!flux_access_only(v, &derived)) slot->kind = FLUX_SLOT_ESCAPES;
+        else if (derived || v->type.array_size > 0) slot->kind = FLUX_SLOT_MEMORY;
+        else slot->kind = FLUX_SLOT_DIRECT;
+
+        // A generator looping over itself cannot hold its own context
+        if (v->type.base == TYPE_CLASS && v->type.ptr_depth == 0 && v->type.class_name && strcmp(v->type.class_name, struct_name) == 0) continue;
+        for (int k = 0; k < cap.yield_count && !slot->captured; k++) {
+            slot->captured = slot->kind == FLUX_SLOT_ESCAPES || flux_live_at(&cap, cap.yields[k], s);
+        }
+    }
+
+    int next_field = first_field, kept = 0;
+    int yw = (cap.yield_count + 63) / 64;
+    FluxField *shared = alir_alloc(ctx->module, sizeof(FluxField) * (cap.slot_count ? cap.slot_count : 1));
+    int shared_count = 0;
+    char name[32];
+
+    for (int s = 0; s < cap.slot_count; s++) {
+        FluxSlot *slot = &cap.slots[s];
+        if (!slot->captured) continue;
+        AlirValue *v = slot->alloca->dest;
+        kept++;
+
+        if (slot->kind != FLUX_SLOT_DIRECT) {
+            // The slot becomes a pointer into the context, set up on entry
+            snprintf(name, sizeof(name), "slot%d", next_field);
+            tail = flux_add_field(&cap, tail, name, v->type, next_field);
+            VarType pt = v->type; pt.ptr_depth++;
+            AlirValue *field = new_temp(ctx, pt);
+            alir_replace_all_uses(v, field);
+            AlirInst *i = slot->alloca;
+            i->op = ALIR_OP_GET_PTR;
+            i->dest = field;
+            i->op1 = ctx->flux_ctx_ptr;
+            i->op2 = alir_const_int(ctx->module, next_field++);
+            continue;
+        }
+
+        FluxField *f = NULL;
+        for (int k = 0; k < shared_count && !f; k++) {
+            if (!flux_same_type(shared[k].type, v->type)) continue;
+            int clash = 0;
+            for (int y = 0; y < cap.yield_count && !clash; y++) {
+                clash = flux_live_at(&cap, cap.yields[y], s) && ((shared[k].yields[y / 64] >> (y % 64)) & 1);
+            }
+            if (!clash) f = &shared[k];
+        }
+        if (!f) {
+            f = &shared[shared_count++];
+            f->type = v->type;
+            f->index = next_field++;
+            f->yields = alir_alloc(ctx->module, sizeof(uint64_t) * (yw ? yw : 1));
+            snprintf(name, sizeof(name), "slot%d", f->index);
+            tail = flux_add_field(&cap, tail, name, v->type, f->index);
+        }
+        for (int y = 0; y < cap.yield_count; y++) {
+            if (!flux_live_at(&cap, cap.yields[y], s)) continue;
+            f->yields[y / 64] |= 1ULL << (y % 64);
+            flux_spill(&cap, v, f->index, cap.yields[y]);
+        }
+    }
+
+    // The declaration markers have served their purpose
+    for (AlirBlock *b = cap.func->blocks; b; b = b->next) {
+        AlirInst *i = b->head;
+        while (i) {
+            AlirInst *next = i->next;
+            if (i->op == ALIR_OP_FREE_STACK && i->op1) flux_unlink(b, i);
+            i = next;
+        }
+    }
+
+    debug_alir("flux: %s keeps %d of %d slots in %d fields\n", struct_name, kept, cap.slot_count, next_field - first_field);
+    hashmap_free(&cap.slot_of);
 }
 
 // TODO should this use parser tho?
 /**
  * @brief Recursively collect flux (generator) variables from an AST subtree.
+ *
+ * Statement lists and else-if chains are walked iteratively; only nested
+ * bodies recurse.
+ *
  * @param ctx Compilation context.
  * @param node Current AST node.
  * @param idx_ptr Pointer to the current flux variable index counter.
  */
 void collect_flux_vars_recursive(AlirCtx *ctx, ASTNode *node, int *idx_ptr) {
-    if (!node) return;
-    
-    if (node->type == NODE_VAR_DECL) {
-        VarDeclNode *vn = (VarDeclNode*)node;
-        FluxVar *fv = alir_alloc(ctx->module, sizeof(FluxVar));
-        fv->name = alir_strdup(ctx->module, vn->name);
-        fv->type = vn->var_type;
-        fv->index = (*idx_ptr)++;
-        fv->next = ctx->flux_vars;
-        ctx->flux_vars = fv;
-    }
-    else if (node->type == NODE_IF) {
-        collect_flux_vars_recursive(ctx, ((IfNode*)node)->then_body, idx_ptr);
-        collect_flux_vars_recursive(ctx, ((IfNode*)node)->else_body, idx_ptr);
-    } 
-    else if (node->type == NODE_WHILE) {
-        collect_flux_vars_recursive(ctx, ((WhileNode*)node)->body, idx_ptr);
-    }
-    else if (node->type == NODE_LOOP) {
-        collect_flux_vars_recursive(ctx, ((LoopNode*)node)->body, idx_ptr);
-    }
-    else if (node->type == NODE_FOR_IN) {
-        ForInNode *fn = (ForInNode*)node;
-        FluxVar *fv = alir_alloc(ctx->module, sizeof(FluxVar));
-        fv->name = alir_strdup(ctx->module, fn->var_name);
-        fv->type = fn->iter_type; 
-        if (fv->type.base == TYPE_AUTO) fv->type = (VarType){TYPE_INT}; 
-        fv->index = (*idx_ptr)++;
-        fv->next = ctx->flux_vars;
-        ctx->flux_vars = fv;
-        collect_flux_vars_recursive(ctx, fn->body, idx_ptr);
-    }
-    else if (node->type == NODE_SWITCH) {
-        ASTNode *c = ((SwitchNode*)node)->cases;
-        while(c) {
-            collect_flux_vars_recursive(ctx, ((CaseNode*)c)->body, idx_ptr);
-            c = c->next;
+    for (; node; node = node->next) {
+        if (node->type == NODE_VAR_DECL) {
+            VarDeclNode *vn = (VarDeclNode*)node;
+            FluxVar *fv = alir_alloc(ctx->module, sizeof(FluxVar));
+            fv->name = alir_strdup(ctx->module, vn->name);
+            fv->type = vn->var_type;
+            fv->index = (*idx_ptr)++;
+            fv->next = ctx->flux_vars;
+            ctx->flux_vars = fv;
+        }
+        else if (node->type == NODE_IF) {
+            IfNode *in = (IfNode*)node;
+            while (in->else_body && in->else_body->type == NODE_IF && !in->else_body->next) {
+                collect_flux_vars_recursive(ctx, in->then_body, idx_ptr);
+                in = (IfNode*)in->else_body;
+            }
+            collect_flux_vars_recursive(ctx, in->then_body, idx_ptr);
+            collect_flux_vars_recursive(ctx, in->else_body, idx_ptr);
+        } 
+        else if (node->type == NODE_WHILE) {
+            collect_flux_vars_recursive(ctx, ((WhileNode*)node)->body, idx_ptr);
+        }
+        else if (node->type == NODE_LOOP) {
+            collect_flux_vars_recursive(ctx, ((LoopNode*)node)->body, idx_ptr);
+        }
+        else if (node->type == NODE_FOR_IN) {
+            ForInNode *fn = (ForInNode*)node;
+            FluxVar *fv = alir_alloc(ctx->module, sizeof(FluxVar));
+            fv->name = alir_strdup(ctx->module, fn->var_name);
+            fv->type = fn->iter_type; 
+            if (fv->type.base == TYPE_AUTO) fv->type = (VarType){TYPE_INT}; 
+            fv->index = (*idx_ptr)++;
+            fv->next = ctx->flux_vars;
+            ctx->flux_vars = fv;
+            collect_flux_vars_recursive(ctx, fn->body, idx_ptr);
+        }
+        else if (node->type == NODE_SWITCH) {
+            ASTNode *c = ((SwitchNode*)node)->cases;
+            while(c) {
+                collect_flux_vars_recursive(ctx, ((CaseNode*)c)->body, idx_ptr);
+                c = c->next;
+            }
+            collect_flux_vars_recursive(ctx, ((SwitchNode*)node)->default_case, idx_ptr);
         }
-        collect_flux_vars_recursive(ctx, ((SwitchNode*)node)->default_case, idx_ptr);
     }
-    
-    collect_flux_vars_recursive(ctx, node->next, idx_ptr);
 }
 
 
@@ -90,7 +535,7 @@ void alir_gen_flux_def(AlirCtx *ctx, FuncDefNode *fn, const char *class_name) {
     while(p) { param_count++; p = p->next; }
     
     int start_locals = struct_idx + param_count + (class_name ? 1 : 0);
-    int current_idx = start_locals;
+    int current_idx = 0;
     
     collect_flux_vars_recursive(ctx, fn->body, &current_idx);
     
@@ -124,17 +569,7 @@ void alir_gen_flux_def(AlirCtx *ctx, FuncDefNode *fn, const char *class_name) {
         p = p->next;
     }
     
-    FluxVar *fv = ctx->flux_vars;
-    while(fv) {
-        AlirField *f = alir_alloc(ctx->module, sizeof(AlirField));
-        f->name = alir_strdup(ctx->module, fv->name);
-        f->type = fv->type;
-        f->index = fv->index;
-        *tail=f; tail=&f->next;
-        fv = fv->next;
-    }
-    
-    alir_register_struct(ctx->module, struct_name, fields, 0);
+    // Locals get their fields once the resume function shows which outlive a yield
     
     // 3. Generate INIT Function (The Generator Factory)
     VarType ret_type_by_val = {TYPE_CLASS, 0, alir_strdup(ctx->module, struct_name)};
@@ -150,7 +585,7 @@ void alir_gen_flux_def(AlirCtx *ctx, FuncDefNode *fn, const char *class_name) {
     
     ctx->current_block = alir_add_block(ctx->module, ctx->current_func, "entry");
     
-    AlirValue *ctx_ptr = new_temp(ctx, ret_type_ptr);
+    AlirValue *ctx_ptr = new_temp(ctx, ret_type_by_val);
     emit(ctx, mk_inst(ctx->module, ALIR_OP_ALLOCA, ctx_ptr, NULL, NULL));
     
     AlirValue *ptr_state = new_temp(ctx, (VarType){TYPE_INT, 1});
@@ -236,12 +671,13 @@ void alir_gen_flux_def(AlirCtx *ctx, FuncDefNode *fn, const char *class_name) {
         p = p->next;
     }
     
-    fv = ctx->flux_vars;
+    // Locals start out as slots of the resume function; flux_capture moves the
+    // ones live across a yield into the context
+    FluxVar *fv = ctx->flux_vars;
     while(fv) {
-        VarType pt = fv->type; pt.ptr_depth++;
-        AlirValue *ptr = new_temp(ctx, pt);
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_GET_PTR, ptr, ctx->flux_ctx_ptr, alir_const_int(ctx->module, fv->index)));
-        alir_add_symbol(ctx, fv->name, ptr, fv->type);
+        AlirValue *slot = new_temp(ctx, fv->type);
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_ALLOCA, slot, NULL, NULL));
+        alir_add_symbol(ctx, fv->name, slot, fv->type);
         fv = fv->next;
     }
     
@@ -249,13 +685,13 @@ void alir_gen_flux_def(AlirCtx *ctx, FuncDefNode *fn, const char *class_name) {
     AlirBlock *dispatch_bb = alir_add_block(ctx->module, ctx->current_func, "dispatch");
     AlirBlock *end_bb = alir_add_block(ctx->module, ctx->current_func, "flux_end");
     
-    // Build pending if/else chain for flux dispatch
+    // Collect the resume cases of the flux dispatch switch
     AlirSwitchCase *c0 = alir_alloc(ctx->module, sizeof(AlirSwitchCase));
-    c0->value = 0; c0->label = start_bb->label;
+    c0->value = 0; c0->block = start_bb;
     ctx->flux_resume_cases = c0;
     
     // Branch from entry to dispatch
-    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, dispatch_bb->label), NULL));
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, dispatch_bb), NULL));
     
     // Emit body in start_bb first so yields can register their resume blocks/cases
     ctx->current_block = start_bb;
@@ -267,62 +703,35 @@ void alir_gen_flux_def(AlirCtx *ctx, FuncDefNode *fn, const char *class_name) {
         AlirValue *p_fin = new_temp(ctx, (VarType){TYPE_BOOL, 1});
         emit(ctx, mk_inst(ctx->module, ALIR_OP_GET_PTR, p_fin, ctx->flux_ctx_ptr, alir_const_int(ctx->module, 1)));
         emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, alir_const_int(ctx->module, 1), p_fin));
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, end_bb->label), NULL));
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, end_bb), NULL));
     }
     
-    // Emit dispatch chain in dispatch_bb after body so all yield states are known
+    // Emit dispatch in dispatch_bb after body so all yield states are known
     ctx->current_block = dispatch_bb;
-    
     {
-        AlirSwitchCase *cases = ctx->flux_resume_cases;
         int num_cases = 0;
-        while (cases) { num_cases++; cases = cases->next; }
-
-        // Pre-create fallthrough check blocks so their actual labels are used
-        AlirBlock **check_blocks = alir_alloc(ctx->module, sizeof(AlirBlock*) * num_cases);
-        for (int i = 1; i < num_cases; i++) {
-            char hint[64];
-            snprintf(hint, sizeof(hint), "switch_check_%d", num_cases - i);
-            check_blocks[i] = alir_add_block(ctx->module, ctx->current_func, hint);
-        }
-
-        cases = ctx->flux_resume_cases;
-        int case_idx = 0;
-        while (cases) {
-            AlirValue *cmp = new_temp(ctx, (VarType){TYPE_BOOL, 0});
-            emit(ctx, mk_inst(ctx->module, ALIR_OP_EQ, cmp, current_state, alir_const_int(ctx->module, cases->value)));
-
-            AlirValue *target = alir_val_label(ctx->module, cases->label);
-            AlirValue *fallthrough;
-            if (case_idx + 1 < num_cases) {
-                fallthrough = alir_val_label(ctx->module, check_blocks[case_idx + 1]->label);
-            } else {
-                fallthrough = alir_val_label(ctx->module, end_bb->label);
-            }
-
-            AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cmp, target);
-            br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-            br->args[0] = fallthrough;
-            br->arg_count = 1;
-            emit(ctx, br);
+        for (AlirSwitchCase *cases = ctx->flux_resume_cases; cases; cases = cases->next) num_cases++;
 
-            if (case_idx + 1 < num_cases) {
-                ctx->current_block = check_blocks[case_idx + 1];
-            }
-
-            cases = cases->next;
-            case_idx++;
+        AlirInst *sw = alir_switch_create(ctx->module, current_state, end_bb, num_cases);
+        for (AlirSwitchCase *cases = ctx->flux_resume_cases; cases; cases = cases->next) {
+            alir_switch_add_case(ctx->module, sw, cases->value, cases->block);
         }
+        emit(ctx, sw);
     }
     
     ctx->current_block = end_bb;
     if (!ctx->current_block->tail || !is_terminator_op(ctx->current_block->tail->op)) {
         emit(ctx, mk_inst(ctx->module, ALIR_OP_RET, NULL, NULL, NULL));
     }
+
+    // 5. Keep what outlives a yield in the context, then register it
+    flux_capture(ctx, struct_name, start_locals, tail);
+    alir_register_struct(ctx->module, struct_name, fields, 0);
     
     ctx->in_flux_resume = 0;
     ctx->flux_vars = NULL;
     ctx->flux_resume_cases = NULL;
+    ctx->flux_yields = NULL;
 }
 
 /**
@@ -351,15 +760,305 @@ void alir_gen_flux_yield(AlirCtx *ctx, EmitNode *en) {
         
         char label[32]; snprintf(label, sizeof(label), "resume_%d", next_state);
         AlirBlock *resume_bb = alir_add_block(ctx->module, ctx->current_func, label);
+
+        FluxYield *y = alir_alloc(ctx->module, sizeof(FluxYield));
+        y->block = ctx->current_block;
+        y->resume = resume_bb;
+        y->next = ctx->flux_yields;
+        ctx->flux_yields = y;
         ctx->current_block = resume_bb;
         
         AlirSwitchCase *nc = alir_alloc(ctx->module, sizeof(AlirSwitchCase));
         nc->value = next_state;
-        nc->label = resume_bb->label;
+        nc->block = resume_bb;
         nc->next = ctx->flux_resume_cases;
         ctx->flux_resume_cases = nc;
         
+    } else if (ctx->flux_fusion) {
+        alir_flux_fuse_emit(ctx, en);
     } else {
         alir_gen_expr(ctx, en->value);
     }
 }
+
+/**
+ * @brief A generator whose body is being generated inside a for-in loop.
+ */
+typedef struct FluxFusion {
+    FuncDefNode *gen;
+    ForInNode *loop;
+    VarType iter_type;
+    AlirValue *var_ptr;             // Slot of the loop variable
+    AlirBlock *end_bb;              // Where the loop goes once the generator is done
+    AlirSymbol *outer_symbols;      // Names of the loop body
+    HashMap outer_map;
+    struct FluxFusion *parent;      // Fusion the for-in itself was generated in, or NULL
+} FluxFusion;
+
+/**
+ * @brief Registers the flux functions of an AST so for-in loops can find their bodies.
+ *
+ * Methods are left out: their generators need the object they run on.
+ *
+ * @param ctx The ALIR context.
+ * @param root Root AST node.
+ */
+void alir_scan_flux_defs(AlirCtx *ctx, ASTNode *root) {
+    if (!ctx->flux_defs.buckets) {
+        hashmap_init(&ctx->flux_defs, ctx->module->compiler_ctx ? ctx->module->compiler_ctx->arena : NULL, 16);
+    }
+    for (ASTNode *curr = root; curr; curr = curr->next) {
+        if (curr->type == NODE_FUNC_DEF) {
+            FuncDefNode *fn = (FuncDefNode*)curr;
+            if (fn->is_flux && !fn->is_macro && !fn->class_name && fn->body) {
+                hashmap_put(&ctx->flux_defs, fn->mangled_name ? fn->mangled_name : fn->name, fn);
+                        }
+        } else if (curr->type == NODE_NAMESPACE) {
+            alir_scan_flux_defs(ctx, ((NamespaceNode*)curr)->body);
+        } else if (curr->type == NODE_IMPORT) {
+            alir_scan_flux_defs(ctx, ((ImportNode*)curr)->resolved_body);
+        } else if (curr->type == NODE_IMPORT_EXPR) {
+            alir_scan_flux_defs(ctx, ((ImportExprNode*)curr)->resolved_body);
+        }
+    }
+}
+
+/**
+ * @brief Checks that statements can be generated in place and counts their emits.
+ * @param node First statement.
+ * @param emits Receives the number of emits.
+ * @return Non-zero if nothing in them needs a function of their own (defers, meta blocks).
+ */
+static int flux_fusable(ASTNode *node, int *emits) {
+    for (; node; node = node->next) {
+        switch (node->type) {
+            case NODE_DEFER:
+            case NODE_META:
+            case NODE_POSTMETA:
+            case NODE_FUNC_DEF:
+            case NODE_CLASS:
+                return 0;
+            case NODE_EMIT:
+                (*emits)++;
+                break;
+            case NODE_IF: {
+                IfNode *in = (IfNode*)node;
+                if (!flux_fusable(in->then_body, emits) || !flux_fusable(in->else_body, emits)) return 0;
+                break;
+            }
+            case NODE_WHILE:
+                if (!flux_fusable(((WhileNode*)node)->body, emits)) return 0;
+                break;
+            case NODE_LOOP:
+                if (!flux_fusable(((LoopNode*)node)->body, emits)) return 0;
+                break;
+            case NODE_FOR_IN:
+                if (!flux_fusable(((ForInNode*)node)->body, emits)) return 0;
+                break;
+            case NODE_SWITCH: {
+                SwitchNode *sn = (SwitchNode*)node;
+                for (ASTNode *c = sn->cases; c; c = c->next) {
+                    if (!flux_fusable(((CaseNode*)c)->body, emits)) return 0;
+                }
+                if (!flux_fusable(sn->default_case, emits)) return 0;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Moves a block to the end of its function.
+ *
+ * Backends emit blocks in list order, and the end of a fused loop uses values
+ * of the generator body generated after it was created.
+ *
+ * @param func The function.
+ * @param block The block to move.
+ */
+static void flux_move_block_last(AlirFunction *func, AlirBlock *block) {
+    AlirBlock **link = &func->blocks;
+    while (*link && *link != block) link = &(*link)->next;
+    if (!*link || !block->next) return;
+    *link = block->next;
+    AlirBlock *tail = block->next;
+    while (tail->next) tail = tail->next;
+    tail->next = block;
+    block->next = NULL;
+}
+
+/**
+ * @brief Checks that a call names a function, not a method or a function pointer.
+ * @param ctx The ALIR context.
+ * @param cn The call AST node.
+ * @return Non-zero if the callee is found by its name alone.
+ */
+static int flux_plain_callee(AlirCtx *ctx, CallNode *cn) {
+    if (!cn->target) return 1;
+    if (cn->target->type == NODE_VAR_REF) {
+        VarRefNode *vn = (VarRefNode*)cn->target;
+        return !vn->is_class_member && !alir_find_symbol(ctx, vn->name);
+    }
+    if (cn->target->type == NODE_MEMBER_ACCESS && ctx->sem) {
+        VarType obj_t = sem_get_node_type(ctx->sem, ((MemberAccessNode*)cn->target)->object);
+        return obj_t.base == TYPE_NAMESPACE;
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the generator a for-in loop could be fused with.
+ * @param ctx The ALIR context.
+ * @param fn The for-in AST node.
+ * @return The generator definition, or NULL if the loop has to go through its resume function.
+ */
+static FuncDefNode* flux_fusion_target(AlirCtx *ctx, ForInNode *fn) {
+    if (ctx->in_flux_resume || !ctx->flux_defs.buckets) return NULL;
+    if (!fn->collection || fn->collection->type != NODE_CALL) return NULL;
+    CallNode *cn = (CallNode*)fn->collection;
+    const char *name = cn->mangled_name ? cn->mangled_name : cn->name;
+    if (!name || !flux_plain_callee(ctx, cn)) return NULL;
+    FuncDefNode *gen = hashmap_get(&ctx->flux_defs, name);
+    if (!gen) return NULL;
+
+    // A generator looping over itself would be generated forever
+    for (FluxFusion *f = ctx->flux_fusion; f; f = f->parent) {
+        if (f->gen == gen) return NULL;
+    }
+
+    int args = 0, params = 0;
+    for (ASTNode *a = cn->args; a; a = a->next) args++;
+    for (Parameter *p = gen->params; p; p = p->next) params++;
+    if (args != params) return NULL;
+
+    int emits = 0, body_emits = 0;
+    if (!flux_fusable(gen->body, &emits) || emits < 1 || emits > FLUX_FUSE_MAX_EMITS) return NULL;
+    // The loop body is copied once per emit, so it may not register defers either
+    if (!flux_fusable(fn->body, &body_emits)) return NULL;
+    return gen;
+}
+
+/**
+ * @brief Generates a for-in over a generator call as one plain loop, if it can.
+ *
+ * The arguments are evaluated once, before the loop, as the generator's
+ * factory would. Break in the loop body leaves the whole loop and continue
+ * resumes the generator after its emit.
+ *
+ * @param ctx The ALIR context.
+ * @param fn The for-in AST node.
+ * @return Non-zero if the loop was generated, 0 to lower it through the resume function.
+ */
+int alir_flux_fuse_for_in(AlirCtx *ctx, ForInNode *fn) {
+    FuncDefNode *gen = flux_fusion_target(ctx, fn);
+    if (!gen) return 0;
+    CallNode *cn = (CallNode*)fn->collection;
+    debug_alir("flux: fusing generator %s into a for-in loop\n", gen->name);
+
+    // Arguments and the loop variable live in the names of the loop
+    int params = 0;
+    for (Parameter *p = gen->params; p; p = p->next) params++;
+    AlirValue **args = alir_alloc(ctx->module, sizeof(AlirValue*) * (params ? params : 1));
+    ASTNode *a = cn->args;
+    for (int k = 0; k < params; k++, a = a->next) {
+        args[k] = alir_gen_expr(ctx, a);
+        if (!args[k]) args[k] = alir_const_int(ctx->module, 0); // Safety net
+    }
+
+    VarType iter_type = fn->iter_type;
+    if (iter_type.base == TYPE_AUTO || iter_type.base == TYPE_UNKNOWN) iter_type = gen->ret_type;
+    AlirValue *var_ptr = new_temp(ctx, iter_type);
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_ALLOCA, var_ptr, NULL, NULL));
+    alir_add_symbol(ctx, fn->var_name, var_ptr, iter_type);
+
+    FluxFusion f = {0};
+    f.gen = gen;
+    f.loop = fn;
+    f.iter_type = iter_type;
+    f.var_ptr = var_ptr;
+    f.end_bb = alir_add_block(ctx->module, ctx->current_func, "for_end");
+    f.outer_symbols = ctx->symbols;
+    f.outer_map = ctx->symbol_map;
+    f.parent = ctx->flux_fusion;
+
+    // The generator body sees its parameters and its own locals only
+    ctx->symbols = NULL;
+    hashmap_init(&ctx->symbol_map, ctx->module->compiler_ctx ? ctx->module->compiler_ctx->arena : NULL, 32);
+    Parameter *p = gen->params;
+    for (int k = 0; k < params; k++, p = p->next) {
+        AlirValue *slot = new_temp(ctx, p->type);
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_ALLOCA, slot, NULL, NULL));
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, promote(ctx, args[k], p->type), slot));
+        alir_add_symbol(ctx, p->name, slot, p->type);
+    }
+
+    ctx->flux_fusion = &f;
+    push_loop(ctx, NULL, NULL);
+    for (ASTNode *s = gen->body; s; s = s->next) alir_gen_stmt(ctx, s);
+    pop_loop(ctx);
+    if (!ctx->current_block->tail || !is_terminator_op(ctx->current_block->tail->op)) {
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, f.end_bb), NULL));
+    }
+    ctx->flux_fusion = f.parent;
+    flux_move_block_last(ctx->current_func, f.end_bb);
+
+    ctx->symbols = f.outer_symbols;
+    ctx->symbol_map = f.outer_map;
+    ctx->current_block = f.end_bb;
+    return 1;
+}
+
+/**
+ * @brief Generates an emit of a fused generator: the loop body, once.
+ *
+ * The body is generated in the names and the fusion it was written in, and
+ * comes back to a new block where the generator goes on.
+ *
+ * @param ctx The ALIR context.
+ * @param en The emit AST node.
+ */
+void alir_flux_fuse_emit(AlirCtx *ctx, EmitNode *en) {
+    FluxFusion *f = ctx->flux_fusion;
+    AlirValue *val = alir_gen_expr(ctx, en->value);
+    if (!val) val = alir_const_int(ctx->module, 0); // Safety net
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, promote(ctx, val, f->iter_type), f->var_ptr));
+
+    AlirSymbol *gen_symbols = ctx->symbols;
+    HashMap gen_map = ctx->symbol_map;
+    ctx->symbols = f->outer_symbols;
+    ctx->symbol_map = f->outer_map;
+    ctx->flux_fusion = f->parent;
+
+    AlirBlock *next_bb = alir_add_block(ctx->module, ctx->current_func, "flux_next");
+    push_loop(ctx, next_bb, f->end_bb);
+    for (ASTNode *s = f->loop->body; s; s = s->next) alir_gen_stmt(ctx, s);
+    pop_loop(ctx);
+    if (!ctx->current_block->tail || !is_terminator_op(ctx->current_block->tail->op)) {
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, next_bb), NULL));
+    }
+
+    // Locals the body declared stay visible to its next copy
+    ctx->flux_fusion = f;
+    f->outer_symbols = ctx->symbols;
+    f->outer_map = ctx->symbol_map;
+    ctx->symbols = gen_symbols;
+    ctx->symbol_map = gen_map;
+    ctx->current_block = next_bb;
+}
+
+/**
+ * @brief Generates a return of a fused generator, which ends the loop.
+ *
+ * The loop never reads what a generator returns, so the value is only
+ * evaluated for its effects.
+ *
+ * @param ctx The ALIR context.
+ * @param rn The return AST node.
+ */
+void alir_flux_fuse_return(AlirCtx *ctx, ReturnNode *rn) {
+    if (rn->value) alir_gen_expr(ctx, rn->value);
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, ctx->flux_fusion->end_bb), NULL));
+}
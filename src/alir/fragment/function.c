@@ -80,9 +80,14 @@ void alir_gen_function_def(AlirCtx *ctx, FuncDefNode *fn, const char *class_name
     ctx->current_func = alir_add_function(ctx->module, func_name, fn->ret_type, 0);
     ctx->current_func->is_varargs = fn->is_varargs;
     ctx->current_func->is_extern = fn->is_extern;
-    ctx->current_func->is_pure = fn->is_pure;
+    // Prefer the call-graph summary; fall back to the declared modifiers
+    SemSymbol *effects = sem_effect_lookup(ctx->sem, fn);
+    ctx->current_func->is_pure = effects ? effects->is_pure : fn->is_pure;
+    ctx->current_func->is_total = effects ? effects->is_total : fn->is_total;
+    ctx->current_func->is_pristine = effects ? (effects->is_pristine && !effects->returns_tainted) : fn->is_pristine;
     ctx->current_func->reason = fn->base.reason ? alir_strdup(ctx->module, fn->base.reason) : NULL;
     if (fn->cconv) ctx->current_func->cconv = alir_strdup(ctx->module, fn->cconv);
+    ctx->current_func->inline_hint = fn->inline_hint;
 
     int initial_params = 0;
     if (class_name) {
@@ -454,78 +459,7 @@ AlirValue* alir_gen_call(AlirCtx *ctx, CallNode *cn) {
         if (sym && sym->kind == SYM_FUNC && sym->is_macro && sym->node_ptr) {
             FuncDefNode *fd = (FuncDefNode*)sym->node_ptr;
 
-            // Collect macro arguments and parameters
-            int num_params = 0;
-            Parameter *p = fd->params;
-            while(p) { num_params++; p = p->next; }
-
-            char **param_names = NULL;
-            ASTNode **param_args = NULL;
-            ASTNode *varargs_head = NULL;
-
-            if (num_params > 0) {
-                param_names = alir_alloc(ctx->module, num_params * sizeof(char*));
-                param_args = alir_alloc(ctx->module, num_params * sizeof(ASTNode*));
-                p = fd->params;
-                ASTNode *a = cn->args;
-                for (int i=0; i<num_params && a; i++) {
-                    param_names[i] = p->name;
-                    param_args[i] = a;
-                    p = p->next;
-                    a = a->next;
-                }
-                varargs_head = a; // Any remaining args are varargs
-            } else {
-                varargs_head = cn->args;
-            }
-
-            // Clone the AST body so we don't modify the original macro definition
-            CompilerContext *cctx = ctx->module->compiler_ctx;
-            ASTNode *cloned_body = ast_clone(cctx, fd->body, NULL, NULL, 0, NULL, NULL, 0);
-
-            // Rewrite variable references and varargs inside the cloned body
-            cloned_body = ast_rewrite_macro(cctx, cloned_body, varargs_head, param_names, param_args, num_params);
-
-            // Run semantic analysis on the expanded macro body in the macro's defining namespace
-            extern void sem_check_block(SemanticCtx *ctx, ASTNode *block);
-            const char *old_ns = NULL;
-            char ns_buf[256] = "";
-            if (ctx->sem && ctx->sem->compiler_ctx && fd->mangled_name) {
-                old_ns = arena_strdup(ctx->sem->compiler_ctx->arena, diag_get_namespace(ctx->sem->compiler_ctx));
-                debug_alir("macro: mangled='%s', old_ns='%s'\n", fd->mangled_name, old_ns);
-                const char *dot = strrchr(fd->mangled_name, '.');
-                if (dot) {
-                    int ns_len = (int)(dot - fd->mangled_name);
-                    if (ns_len >= (int)sizeof(ns_buf)) ns_len = sizeof(ns_buf) - 1;
-                    memcpy(ns_buf, fd->mangled_name, ns_len);
-                    ns_buf[ns_len] = '\0';
-                    debug_alir("macro: setting ns to '%s'\n", ns_buf);
-                    diag_set_namespace(ctx->sem->compiler_ctx, ns_buf);
-                }
-            }
-            SemScope *macro_scope = arena_alloc(ctx->module->compiler_ctx->arena, sizeof(SemScope));
-            memset(macro_scope, 0, sizeof(SemScope));
-            macro_scope->parent = ctx->sem->current_scope;
-            macro_scope->is_function_scope = 1;
-            ctx->sem->current_scope = macro_scope;
-
-            debug_alir("macro: before sem_check_block, ns='%s'\n", diag_get_namespace(ctx->sem->compiler_ctx));
-            sem_check_block(ctx->sem, cloned_body);
-            debug_alir("macro: after sem_check_block, ns='%s'\n", diag_get_namespace(ctx->sem->compiler_ctx));
-
-            // Pop the scope
-            ctx->sem->current_scope = macro_scope->parent;
-
-            // Compile the rewritten AST directly into the current caller's ALIR block
-            ASTNode *curr = cloned_body;
-            while (curr) {
-                alir_gen_stmt(ctx, curr);
-                curr = curr->next;
-            }
-
-            if (old_ns && ctx->sem && ctx->sem->compiler_ctx) {
-                diag_set_namespace(ctx->sem->compiler_ctx, old_ns);
-            }
+            alir_gen_macro_expansion(ctx, fd, NULL, cn->args, 1);
 
             return new_temp(ctx, (VarType){TYPE_VOID, 0});
         }
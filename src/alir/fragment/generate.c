@@ -305,16 +305,16 @@ void alir_stmt_while(AlirCtx *ctx, ASTNode *node) {
     AlirBlock *end_bb = alir_add_block(ctx->module, ctx->current_func, "while_end");
 
     if (!wn->is_do_while) {
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
     }
 
     ctx->current_block = cond_bb;
     AlirValue *cond = alir_gen_expr(ctx, wn->condition);
     if (!cond) cond = alir_const_int(ctx->module, 0);
 
-    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cond, alir_val_label(ctx->module, body_bb->label));
+    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cond, alir_val_block(ctx->module, body_bb));
     br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-    br->args[0] = alir_val_label(ctx->module, end_bb->label);
+    br->args[0] = alir_val_block(ctx->module, end_bb);
     br->arg_count = 1;
     emit(ctx, br);
 
@@ -324,7 +324,7 @@ void alir_stmt_while(AlirCtx *ctx, ASTNode *node) {
     pop_loop(ctx);
 
     if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
     }
 
     ctx->current_block = end_bb;
@@ -348,7 +348,7 @@ void alir_for_in_int(AlirCtx *ctx, ASTNode  *node, AlirValue *col) {
     alir_add_symbol(ctx, fn->var_name, var_ptr, fn->iter_type);
     emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, alir_const_int(ctx->module, 0), var_ptr));
 
-    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
     ctx->current_block = cond_bb;
 
     // i < limit
@@ -357,9 +357,9 @@ void alir_for_in_int(AlirCtx *ctx, ASTNode  *node, AlirValue *col) {
     AlirValue *valid = new_temp(ctx, (VarType){TYPE_BOOL});
     emit(ctx, mk_inst(ctx->module, ALIR_OP_LT, valid, i_val, limit));
 
-    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, valid, alir_val_label(ctx->module, body_bb->label));
+    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, valid, alir_val_block(ctx->module, body_bb));
     br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-    br->args[0] = alir_val_label(ctx->module, end_bb->label);
+    br->args[0] = alir_val_block(ctx->module, end_bb);
     br->arg_count = 1;
     emit(ctx, br);
 
@@ -374,7 +374,7 @@ void alir_for_in_int(AlirCtx *ctx, ASTNode  *node, AlirValue *col) {
         AlirValue *i_next = new_temp(ctx, fn->iter_type);
         emit(ctx, mk_inst(ctx->module, ALIR_OP_ADD, i_next, i_curr, alir_const_int(ctx->module, 1)));
         emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, i_next, var_ptr));
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
     }
     pop_loop(ctx);
     ctx->current_block = end_bb;
@@ -405,7 +405,7 @@ void alir_for_in_onstack(AlirCtx *ctx, ASTNode *node, AlirValue *col, AlirValue
     emit(ctx, mk_inst(ctx->module, ALIR_OP_ALLOCA, val_var, NULL, NULL));
     alir_add_symbol(ctx, fn->var_name, val_var, fn->iter_type);
 
-    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
 
     // --- COND BLOCK (idx < limit) ---
     ctx->current_block = cond_bb;
@@ -415,9 +415,9 @@ void alir_for_in_onstack(AlirCtx *ctx, ASTNode *node, AlirValue *col, AlirValue
     AlirValue *valid = new_temp(ctx, (VarType){TYPE_BOOL});
     emit(ctx, mk_inst(ctx->module, ALIR_OP_LT, valid, curr_idx, limit));
 
-    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, valid, alir_val_label(ctx->module, body_bb->label));
+    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, valid, alir_val_block(ctx->module, body_bb));
     br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-    br->args[0] = alir_val_label(ctx->module, end_bb->label);
+    br->args[0] = alir_val_block(ctx->module, end_bb);
     br->arg_count = 1;
     emit(ctx, br);
 
@@ -445,7 +445,7 @@ void alir_for_in_onstack(AlirCtx *ctx, ASTNode *node, AlirValue *col, AlirValue
         AlirValue *next_idx = new_temp(ctx, (VarType){TYPE_INT, 0});
         emit(ctx, mk_inst(ctx->module, ALIR_OP_ADD, next_idx, curr_idx, alir_const_int(ctx->module, 1)));
         emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, next_idx, idx_var));
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
     }
 
     pop_loop(ctx);
@@ -476,7 +476,7 @@ void alir_for_in_ptr(AlirCtx *ctx, ASTNode *node, AlirValue *col, AlirValue *lim
     emit(ctx, mk_inst(ctx->module, ALIR_OP_ALLOCA, val_var, NULL, NULL));
     alir_add_symbol(ctx, fn->var_name, val_var, fn->iter_type);
 
-    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
 
     // --- COND BLOCK (idx < limit) ---
     ctx->current_block = cond_bb;
@@ -486,9 +486,9 @@ void alir_for_in_ptr(AlirCtx *ctx, ASTNode *node, AlirValue *col, AlirValue *lim
     AlirValue *valid = new_temp(ctx, (VarType){TYPE_BOOL});
     emit(ctx, mk_inst(ctx->module, ALIR_OP_LT, valid, curr_idx, limit));
 
-    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, valid, alir_val_label(ctx->module, body_bb->label));
+    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, valid, alir_val_block(ctx->module, body_bb));
     br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-    br->args[0] = alir_val_label(ctx->module, end_bb->label);
+    br->args[0] = alir_val_block(ctx->module, end_bb);
     br->arg_count = 1;
     emit(ctx, br);
 
@@ -520,7 +520,7 @@ void alir_for_in_ptr(AlirCtx *ctx, ASTNode *node, AlirValue *col, AlirValue *lim
         AlirValue *next_idx = new_temp(ctx, (VarType){TYPE_INT, 0});
         emit(ctx, mk_inst(ctx->module, ALIR_OP_ADD, next_idx, curr_idx, alir_const_int(ctx->module, 1)));
         emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, next_idx, idx_var));
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
     }
 
     pop_loop(ctx);
@@ -543,7 +543,7 @@ void alir_for_in_flux(AlirCtx *ctx, ASTNode *node, AlirValue *col) {
     AlirBlock *body_bb = alir_add_block(ctx->module, ctx->current_func, "for_body");
     AlirBlock *end_bb = alir_add_block(ctx->module, ctx->current_func, "for_end");
 
-    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
     ctx->current_block = cond_bb;
 
     // Call Resume
@@ -562,11 +562,11 @@ void alir_for_in_flux(AlirCtx *ctx, ASTNode *node, AlirValue *col) {
 
     // valid = (finished == false)
     AlirValue *valid = new_temp(ctx, (VarType){TYPE_BOOL});
-    AlirValue *false_val = alir_const_int(ctx->module, 0); false_val->type.base = TYPE_BOOL; emit(ctx, mk_inst(ctx->module, ALIR_OP_EQ, valid, is_fin, false_val));
+    AlirValue *false_val = alir_const_bool(ctx->module, 0); emit(ctx, mk_inst(ctx->module, ALIR_OP_EQ, valid, is_fin, false_val));
 
-    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, valid, alir_val_label(ctx->module, body_bb->label));
+    AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, valid, alir_val_block(ctx->module, body_bb));
     br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-    br->args[0] = alir_val_label(ctx->module, end_bb->label);
+    br->args[0] = alir_val_block(ctx->module, end_bb);
     br->arg_count = 1;
     emit(ctx, br);
 
@@ -589,7 +589,7 @@ void alir_for_in_flux(AlirCtx *ctx, ASTNode *node, AlirValue *col) {
     ASTNode *s = fn->body; while(s) { alir_gen_stmt(ctx, s); s=s->next; }
 
     if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, cond_bb->label), NULL));
+        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, cond_bb), NULL));
     }
     pop_loop(ctx);
     ctx->current_block = end_bb;
@@ -604,12 +604,16 @@ void alir_for_in_flux(AlirCtx *ctx, ASTNode *node, AlirValue *col) {
  */
 void alir_stmt_for_in(AlirCtx *ctx, ASTNode *node) {
     ForInNode *fn = (ForInNode*)node;
+    if (alir_flux_fuse_for_in(ctx, fn)) return;
+
     VarType col_t = sem_get_node_type(ctx->sem, fn->collection);
     AlirValue *col_ptr = NULL;
 
     AlirValue *col = NULL;
+    int col_is_addr = 0;
     if (fn->collection->type == NODE_VAR_REF) {
         col = alir_gen_addr(ctx, fn->collection);
+        col_is_addr = col != NULL;
         if (!col) col = alir_gen_expr(ctx, fn->collection);
     } else {
         col = alir_gen_expr(ctx, fn->collection);
@@ -646,6 +650,12 @@ void alir_stmt_for_in(AlirCtx *ctx, ASTNode *node) {
     }
 
     if (col && alir_is_integer_type(col->type) && (col->type.ptr_depth + col->type.array_size) == 0) {
+        // A variable bound arrives as its slot; the range is fixed on entry
+        if (col_is_addr) {
+            AlirValue *bound = new_temp(ctx, col->type);
+            emit(ctx, mk_inst(ctx->module, ALIR_OP_LOAD, bound, col, NULL));
+            col = bound;
+        }
         return alir_for_in_int(ctx, node, col);
     }
 
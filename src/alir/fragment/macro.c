@@ -0,0 +1,246 @@
+/**
+ * @file macro.c
+ * @brief Inline macro expansion for ALIR generation, with an expansion cache.
+ *
+ * Expanding a macro means cloning its body, substituting the arguments and
+ * re-running semantic analysis on the copy. Doing that per call site makes
+ * macro-heavy code (std print helpers) grow the arena linearly with the number
+ * of calls, so expansions are cached per macro and argument shape. A cached
+ * body keeps one placeholder node per substituted argument; a later call with
+ * the same shape re-targets the placeholders at its own arguments and lowers
+ * the already checked body again.
+ */
+#include "alir.h"
+#include <stdarg.h>
+
+/**
+ * @brief A pre-checked macro body reusable for one argument shape.
+ */
+typedef struct MacroExpansion {
+    ASTNode *body;          // Rewritten and checked body
+    ASTNode **slots;        // Argument placeholders inside body
+    int *origins;           // Call argument index each placeholder stands for
+    int slot_count;
+    int active;             // Currently being lowered (recursive expansion)
+} MacroExpansion;
+
+/**
+ * @brief Append a formatted fragment to a cache key buffer.
+ * @param buf The key buffer.
+ * @param cap The buffer capacity.
+ * @param len Current key length; updated, or set past cap on overflow.
+ * @param fmt Format string.
+ */
+static void macro_key_append(char *buf, int cap, int *len, const char *fmt, ...) {
+    if (*len >= cap) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *len, cap - *len, fmt, ap);
+    va_end(ap);
+    *len = (n < 0) ? cap : *len + n;
+}
+
+/**
+ * @brief Build the cache key for a macro call from its argument shapes.
+ * @param ctx The ALIR context.
+ * @param fd The macro definition.
+ * @param call_args The call arguments ("this" first when bound).
+ * @param count Number of call arguments.
+ * @param with_values Include literal values (for value-dependent macros).
+ * @param buf Output buffer.
+ * @param cap Output buffer capacity.
+ * @return 1 if the key fits in the buffer, 0 otherwise.
+ */
+static int macro_build_key(AlirCtx *ctx, FuncDefNode *fd, ASTNode **call_args, int count, int with_values, char *buf, int cap) {
+    int len = 0;
+    macro_key_append(buf, cap, &len, "%p/%d", (void*)fd, count);
+    for (int i = 0; i < count; i++) {
+        ASTNode *a = call_args[i];
+        VarType t = sem_get_node_type(ctx->sem, a);
+        macro_key_append(buf, cap, &len, "|%d:%d.%d.%s.%d.%d.%d%d",
+                         a->type, t.base, t.ptr_depth, t.class_name ? t.class_name : "",
+                         t.array_size, t.array_depth, t.is_func_ptr, t.is_tainted);
+        if (with_values && a->type == NODE_LITERAL) {
+            LiteralNode *ln = (LiteralNode*)a;
+            if (ln->var_type.base == TYPE_CHAR && ln->var_type.ptr_depth > 0) {
+                macro_key_append(buf, cap, &len, "=\"%s\"", ln->val.str_val ? ln->val.str_val : "");
+            } else {
+                macro_key_append(buf, cap, &len, "=%lld", (long long)ln->val.long_val);
+            }
+        }
+    }
+    return len < cap;
+}
+
+/**
+ * @brief Clone, rewrite and check a macro body for one call.
+ * @param ctx The ALIR context.
+ * @param fd The macro definition.
+ * @param call_args The call arguments ("this" first when bound).
+ * @param count Number of call arguments.
+ * @param has_this Whether call_args[0] binds "this".
+ * @param scoped Check the body inside a fresh macro scope.
+ * @param trace Receives the inserted placeholders.
+ * @return The checked body.
+ */
+static ASTNode* macro_expand_body(AlirCtx *ctx, FuncDefNode *fd, ASTNode **call_args, int count, int has_this, int scoped, MacroArgTrace *trace) {
+    int num_params = 0;
+    Parameter *p = fd->params;
+    while (p) { num_params++; p = p->next; }
+
+    int total_params = num_params + (has_this ? 1 : 0);
+    if (total_params > count) total_params = count;
+
+    char **param_names = NULL;
+    ASTNode **param_args = NULL;
+    if (total_params > 0) {
+        param_names = alir_alloc(ctx->module, total_params * sizeof(char*));
+        param_args = alir_alloc(ctx->module, total_params * sizeof(ASTNode*));
+        int i = 0;
+        if (has_this) {
+            param_names[0] = "this";
+            param_args[0] = call_args[0];
+            i = 1;
+        }
+        p = fd->params;
+        for (; i < total_params; i++) {
+            param_names[i] = p->name;
+            param_args[i] = call_args[i];
+            p = p->next;
+        }
+    }
+    // Any remaining args are varargs; call_args mirrors the linked argument list
+    ASTNode *varargs_head = total_params < count ? call_args[total_params] : NULL;
+
+    CompilerContext *cctx = ctx->module->compiler_ctx;
+    ASTNode *body = ast_clone(cctx, fd->body, NULL, NULL, 0, NULL, NULL, 0);
+    body = ast_rewrite_macro(cctx, body, varargs_head, param_names, param_args, total_params, trace);
+
+    if (scoped) {
+        SemScope *macro_scope = arena_alloc(cctx->arena, sizeof(SemScope));
+        memset(macro_scope, 0, sizeof(SemScope));
+        macro_scope->parent = ctx->sem->current_scope;
+        macro_scope->is_function_scope = 1;
+        ctx->sem->current_scope = macro_scope;
+
+        debug_alir("macro: before sem_check_block, ns='%s'\n", diag_get_namespace(ctx->sem->compiler_ctx));
+        sem_check_block(ctx->sem, body);
+        debug_alir("macro: after sem_check_block, ns='%s'\n", diag_get_namespace(ctx->sem->compiler_ctx));
+
+        ctx->sem->current_scope = macro_scope->parent;
+    } else {
+        sem_check_block(ctx->sem, body);
+    }
+    return body;
+}
+
+/**
+ * @brief Turn a rewrite trace into a cache entry.
+ * @param ctx The ALIR context.
+ * @param body The checked body.
+ * @param trace The rewrite trace.
+ * @param call_args The call arguments the trace refers to.
+ * @param count Number of call arguments.
+ * @return The entry, or NULL if a placeholder cannot be traced to an argument.
+ */
+static MacroExpansion* macro_make_entry(AlirCtx *ctx, ASTNode *body, MacroArgTrace *trace, ASTNode **call_args, int count) {
+    MacroExpansion *me = alir_alloc(ctx->module, sizeof(MacroExpansion));
+    me->body = body;
+    me->slot_count = trace->count;
+    if (trace->count > 0) {
+        me->slots = alir_alloc(ctx->module, sizeof(ASTNode*) * trace->count);
+        me->origins = alir_alloc(ctx->module, sizeof(int) * trace->count);
+    }
+    for (int i = 0; i < trace->count; i++) {
+        int idx = -1;
+        for (int j = 0; j < count; j++) {
+            if (call_args[j] == trace->origins[i]) { idx = j; break; }
+        }
+        if (idx < 0) return NULL;
+        me->slots[i] = trace->slots[i];
+        me->origins[i] = idx;
+    }
+    return me;
+}
+
+/**
+ * @brief Expand a macro call inline, reusing a cached expansion when possible.
+ * @param ctx The ALIR context.
+ * @param fd The macro definition.
+ * @param this_arg The receiver bound to "this", or NULL.
+ * @param args The call-site argument list.
+ * @param scoped Check and lower in the macro's namespace and scope.
+ */
+void alir_gen_macro_expansion(AlirCtx *ctx, FuncDefNode *fd, ASTNode *this_arg, ASTNode *args, int scoped) {
+    int count = this_arg ? 1 : 0;
+    for (ASTNode *a = args; a; a = a->next) count++;
+
+    ASTNode *stack_args[16];
+    ASTNode **call_args = count <= 16 ? stack_args : alir_alloc(ctx->module, sizeof(ASTNode*) * count);
+    int n = 0;
+    if (this_arg) call_args[n++] = this_arg;
+    for (ASTNode *a = args; a; a = a->next) call_args[n++] = a;
+
+    // Run semantic analysis and lowering in the macro's defining namespace
+    char old_ns_buf[256];
+    const char *old_ns = NULL;
+    if (scoped && ctx->sem->compiler_ctx && fd->mangled_name) {
+        const char *cur_ns = diag_get_namespace(ctx->sem->compiler_ctx);
+        if (cur_ns) {
+            snprintf(old_ns_buf, sizeof(old_ns_buf), "%s", cur_ns);
+            old_ns = old_ns_buf;
+        }
+        debug_alir("macro: mangled='%s', old_ns='%s'\n", fd->mangled_name, old_ns);
+        const char *dot = strrchr(fd->mangled_name, '.');
+        if (dot) {
+            char ns_buf[256];
+            int ns_len = (int)(dot - fd->mangled_name);
+            if (ns_len >= (int)sizeof(ns_buf)) ns_len = sizeof(ns_buf) - 1;
+            memcpy(ns_buf, fd->mangled_name, ns_len);
+            ns_buf[ns_len] = '\0';
+            debug_alir("macro: setting ns to '%s'\n", ns_buf);
+            diag_set_namespace(ctx->sem->compiler_ctx, ns_buf);
+        }
+    }
+
+    // Macros whose expansion looked at literal values (metas.*) are keyed by value too
+    char dep_key[64];
+    snprintf(dep_key, sizeof(dep_key), "dep/%p", (void*)fd);
+    int with_values = hashmap_has(&ctx->macro_cache, dep_key);
+
+    char key[1024];
+    int cacheable = macro_build_key(ctx, fd, call_args, count, with_values, key, sizeof(key));
+    MacroExpansion *me = cacheable ? hashmap_get(&ctx->macro_cache, key) : NULL;
+
+    ASTNode *body = NULL;
+    if (me && !me->active) {
+        debug_alir("macro: reusing expansion of '%s'\n", fd->name);
+        for (int i = 0; i < me->slot_count; i++) {
+            ast_refresh_macro_arg(me->slots[i], call_args[me->origins[i]]);
+        }
+        body = me->body;
+    } else {
+        MacroArgTrace trace = {0};
+        body = macro_expand_body(ctx, fd, call_args, count, this_arg != NULL, scoped, &trace);
+        me = NULL;
+        if (cacheable) {
+            if (trace.value_dependent && !with_values) {
+                hashmap_put(&ctx->macro_cache, dep_key, fd);
+                cacheable = macro_build_key(ctx, fd, call_args, count, 1, key, sizeof(key));
+            }
+            me = cacheable ? macro_make_entry(ctx, body, &trace, call_args, count) : NULL;
+            if (me && !hashmap_get(&ctx->macro_cache, key)) hashmap_put(&ctx->macro_cache, key, me);
+        }
+    }
+
+    // Compile the rewritten AST directly into the current caller's ALIR block
+    if (me) me->active = 1;
+    for (ASTNode *curr = body; curr; curr = curr->next) {
+        alir_gen_stmt(ctx, curr);
+    }
+    if (me) me->active = 0;
+
+    if (old_ns) {
+        diag_set_namespace(ctx->sem->compiler_ctx, old_ns);
+    }
+}
@@ -1,17 +1,16 @@
 #include "alir.h"
 
 /**
- * @brief Generate IR for a binary operation expression.
+ * @brief Emit a binary operation whose operands have already been generated.
  * @param ctx The ALIR context.
  * @param bn The binary operation AST node.
+ * @param l Value of the left operand.
+ * @param r Value of the right operand.
  * @return Result value, or NULL on failure.
  */
-AlirValue* alir_gen_binary_op(AlirCtx *ctx, BinaryOpNode *bn) {
+static AlirValue* alir_emit_binary_op(AlirCtx *ctx, BinaryOpNode *bn, AlirValue *l, AlirValue *r) {
     if (bn->overloaded_func_name) {
         // Emit as function call
-        AlirValue *l = alir_gen_expr(ctx, bn->left);
-        AlirValue *r = alir_gen_expr(ctx, bn->right);
-
         AlirValue **args = arena_alloc(ctx->sem->compiler_ctx->arena, 2 * sizeof(AlirValue*));
         args[0] = l;
         args[1] = r;
@@ -29,9 +28,6 @@ AlirValue* alir_gen_binary_op(AlirCtx *ctx, BinaryOpNode *bn) {
         return res;
     }
 
-    AlirValue *l = alir_gen_expr(ctx, bn->left);
-    AlirValue *r = alir_gen_expr(ctx, bn->right);
-
     if (!l) {
         l = new_temp(ctx, (VarType){TYPE_INT, 0});
         emit(ctx, mk_inst(ctx->module, ALIR_OP_ALLOCA, l, NULL, NULL));
@@ -191,6 +187,42 @@ AlirValue* alir_gen_binary_op(AlirCtx *ctx, BinaryOpNode *bn) {
     return dest;
 }
 
+/**
+ * @brief Generate IR for a binary operation expression.
+ *
+ * The left spine of a left-deep chain such as `a + b + c + ...` is collected
+ * first and emitted bottom-up, so long chains do not recurse per operator.
+ *
+ * @param ctx The ALIR context.
+ * @param bn The binary operation AST node.
+ * @return Result value, or NULL on failure.
+ */
+AlirValue* alir_gen_binary_op(AlirCtx *ctx, BinaryOpNode *bn) {
+    BinaryOpNode *local[64];
+    BinaryOpNode **spine = local;
+    int count = 0, capacity = 64;
+
+    BinaryOpNode *curr = bn;
+    while (1) {
+        if (count == capacity) {
+            BinaryOpNode **grown = arena_alloc(ctx->sem->compiler_ctx->arena, sizeof(BinaryOpNode*) * capacity * 2);
+            memcpy(grown, spine, sizeof(BinaryOpNode*) * count);
+            spine = grown;
+            capacity *= 2;
+        }
+        spine[count++] = curr;
+        if (!curr->left || curr->left->type != NODE_BINARY_OP) break;
+        curr = (BinaryOpNode*)curr->left;
+    }
+
+    AlirValue *val = alir_gen_expr(ctx, curr->left);
+    for (int i = count - 1; i >= 0; i--) {
+        AlirValue *r = alir_gen_expr(ctx, spine[i]->right);
+        val = alir_emit_binary_op(ctx, spine[i], val, r);
+    }
+    return val;
+}
+
 /**
  * @brief Generate IR for a unary operation expression.
  * @param ctx The ALIR context.
@@ -47,6 +47,7 @@ int is_terminator(AlirOpcode op) {
     return op == ALIR_OP_RET ||
            op == ALIR_OP_JUMP ||
            op == ALIR_OP_CONDI ||
+           op == ALIR_OP_SWITCH ||
            op == ALIR_OP_PANIC;
 }
 
@@ -336,7 +337,11 @@ void alir_scan_and_register_classes(AlirCtx *ctx, ASTNode *root) {
 
 
 /**
- * @brief Generate IR for a switch statement, emitting cascading equality branches.
+ * @brief Generate IR for a switch statement as a single multi-way branch.
+ *
+ * Every case statement gets its own block. A value listed twice keeps the
+ * first case, as a chain of comparisons would.
+ *
  * @param ctx The ALIR context.
  * @param sn The switch AST node.
  */
@@ -349,75 +354,43 @@ void alir_gen_switch(AlirCtx *ctx, SwitchNode *sn) {
 
     if (sn->default_case) default_bb = alir_add_block(ctx->module, ctx->current_func, "switch_default");
 
+    int num_nodes = 0;
+    for (ASTNode *c = sn->cases; c; c = c->next) num_nodes++;
+
     // Build case blocks first so labels are available for jumps
-    typedef struct { AlirBlock *bb; long value; } CaseBlock;
-    CaseBlock case_blocks[64];
-    int num_cases = 0;
+    AlirBlock **case_blocks = alir_alloc(ctx->module, sizeof(AlirBlock*) * (num_nodes ? num_nodes : 1));
+    AlirInst *sw = alir_switch_create(ctx->module, cond, default_bb, num_nodes);
+    Arena *arena = ctx->module->compiler_ctx ? ctx->module->compiler_ctx->arena : NULL;
+    HashMap seen;
+    hashmap_init(&seen, arena, num_nodes > 16 ? num_nodes * 2 : 32);
+    char key[32];
+
     ASTNode *c = sn->cases;
-    while(c) {
+    for (int i = 0; c; c = c->next, i++) {
         CaseNode *cn = (CaseNode*)c;
-        AlirBlock *case_bb = alir_add_block(ctx->module, ctx->current_func, "case");
+        case_blocks[i] = alir_add_block(ctx->module, ctx->current_func, "case");
 
         // Handle multiple cases grouped in an array literal (e.g. case 1, 2:)
-        if (cn->value && cn->value->type == NODE_ARRAY_LIT) {
-            ArrayLitNode *al = (ArrayLitNode*)cn->value;
-            ASTNode *elem = al->elements;
-            while(elem && num_cases < 64) {
-                case_blocks[num_cases].bb = case_bb;
-                case_blocks[num_cases].value = alir_eval_constant_int(ctx, elem);
-                num_cases++;
-                elem = elem->next;
-            }
-        } else {
-            if (num_cases < 64) {
-                case_blocks[num_cases].bb = case_bb;
-                case_blocks[num_cases].value = alir_eval_constant_int(ctx, cn->value);
-                num_cases++;
-            }
-        }
-        c = c->next;
-    }
-
-    // Emit cascading if/else chain: eq + conditional branch to case, else check next
-    // Pre-create all fallthrough check blocks so we can use their actual unique labels
-    AlirBlock *check_blocks[64];
-    for (int i = 1; i < num_cases; i++) {
-        char hint[64];
-        snprintf(hint, sizeof(hint), "switch_check_%d", num_cases - i);
-        check_blocks[i] = alir_add_block(ctx->module, ctx->current_func, hint);
-    }
-
-    for (int i = 0; i < num_cases; i++) {
-        AlirValue *cmp = new_temp(ctx, (VarType){TYPE_BOOL, 0});
-        emit(ctx, mk_inst(ctx->module, ALIR_OP_EQ, cmp, cond, alir_const_int(ctx->module, case_blocks[i].value)));
-
-        AlirValue *target = alir_val_label(ctx->module, case_blocks[i].bb->label);
-        AlirValue *fallthrough;
-        if (i + 1 < num_cases) {
-            fallthrough = alir_val_label(ctx->module, check_blocks[i + 1]->label);
-        } else {
-            fallthrough = alir_val_label(ctx->module, default_bb->label);
-        }
-
-        AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cmp, target);
-        br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-        br->args[0] = fallthrough;
-        br->arg_count = 1;
-        emit(ctx, br);
-
-        if (i + 1 < num_cases) {
-            ctx->current_block = check_blocks[i + 1];
+        int grouped = cn->value && cn->value->type == NODE_ARRAY_LIT;
+        ASTNode *elem = grouped ? ((ArrayLitNode*)cn->value)->elements : cn->value;
+        while (elem) {
+            long value = alir_eval_constant_int(ctx, elem);
+            snprintf(key, sizeof(key), "%ld", value);
+            if (!hashmap_get(&seen, key)) {
+                hashmap_put(&seen, key, case_blocks[i]);
+                alir_switch_add_case(ctx->module, sw, value, case_blocks[i]);
+            }
+            elem = grouped ? elem->next : NULL;
         }
     }
+    if (!arena) hashmap_free(&seen);
+    emit(ctx, sw);
 
     c = sn->cases;
     int case_idx = 0;
     while(c) {
         CaseNode *cn = (CaseNode*)c;
-        AlirBlock *case_bb = NULL;
-        if (case_idx < num_cases) {
-            case_bb = case_blocks[case_idx].bb;
-        }
+        AlirBlock *case_bb = case_blocks[case_idx];
 
         if (case_bb) {
             ctx->current_block = case_bb;
@@ -430,10 +403,9 @@ void alir_gen_switch(AlirCtx *ctx, SwitchNode *sn) {
             AlirInst *tail = ctx->current_block->tail;
             if (!tail || !is_terminator(tail->op)) {
                 if (!cn->is_leak) {
-                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, end_bb->label), NULL));
+                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, end_bb), NULL));
                 } else {
-                    char *target_label = default_bb->label;
-                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, target_label), NULL));
+                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, default_bb), NULL));
                 }
             }
         }
@@ -451,7 +423,7 @@ void alir_gen_switch(AlirCtx *ctx, SwitchNode *sn) {
 
         AlirInst *tail = ctx->current_block->tail;
         if (!tail || !is_terminator(tail->op)) {
-            emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, end_bb->label), NULL));
+            emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, end_bb), NULL));
         }
     }
 
@@ -710,6 +682,7 @@ AlirModule* alir_generate(SemanticCtx *sem, ASTNode *root) {
     ctx.module = alir_create_module(sem ? sem->compiler_ctx : NULL, "main_module");
     hashmap_init(&ctx.const_fold_map, ctx.module->compiler_ctx ? ctx.module->compiler_ctx->arena : NULL, 64);
     hashmap_init(&ctx.symbol_map, ctx.module->compiler_ctx ? ctx.module->compiler_ctx->arena : NULL, 128);
+    hashmap_init(&ctx.macro_cache, ctx.module->compiler_ctx ? ctx.module->compiler_ctx->arena : NULL, 32);
 
     if (sem) {
         ctx.module->src = sem->current_source;
@@ -731,6 +704,9 @@ AlirModule* alir_generate(SemanticCtx *sem, ASTNode *root) {
     // 1.5. FOLD TOP-LEVEL CONST DECLARATIONS WITH CONSTANT INITIALIZERS
     scan_and_fold_consts(&ctx, root);
 
+    // 1.6. REMEMBER FLUX BODIES, SO FOR-IN LOOPS OVER THEM CAN BE FUSED
+    alir_scan_flux_defs(&ctx, root);
+
     // 2. GEN FUNCTIONS (Recursively to handle classes & namespaces)
     alir_gen_functions_recursive(&ctx, root, NULL);
 
@@ -123,23 +123,18 @@ AlirValue* alir_gen_cast(AlirCtx *ctx, CastNode *cn) {
             if (operand->type.base == TYPE_DOUBLE) val = (long)operand->val.double_val;
             else if (operand->type.base == TYPE_SINGLE) val = (long)operand->val.single_val;
             else val = operand->val.int_val;
-            AlirValue *c = alir_const_int(ctx->module, val);
-            c->type = res_type;
-            return c;
+            Value bits = { .unsigned_long_val = 0 };
+            bits.int_val = val;
+            return alir_const_value(ctx->module, res_type, bits);
         } else if (res_type.base == TYPE_DOUBLE || res_type.base == TYPE_SINGLE) {
             double val = 0;
             if (operand->type.base == TYPE_DOUBLE) val = operand->val.double_val;
             else if (operand->type.base == TYPE_SINGLE) val = operand->val.single_val;
             else val = (double)operand->val.int_val;
-            if (res_type.base == TYPE_DOUBLE) {
-                AlirValue *c = alir_const_double(ctx->module, val);
-                c->type = res_type;
-                return c;
-            } else {
-                AlirValue *c = alir_const_float(ctx->module, (float)val);
-                c->type = res_type;
-                return c;
-            }
+            Value bits = { .unsigned_long_val = 0 };
+            if (res_type.base == TYPE_DOUBLE) bits.double_val = val;
+            else bits.single_val = (float)val;
+            return alir_const_value(ctx->module, res_type, bits);
         }
     }
 
@@ -290,57 +285,7 @@ AlirValue* alir_gen_method_call(AlirCtx *ctx, MethodCallNode *mc) {
         if (sym && sym->kind == SYM_FUNC && sym->is_macro && sym->node_ptr) {
             FuncDefNode *fd = (FuncDefNode*)sym->node_ptr;
 
-            int num_params = 0;
-            Parameter *p = fd->params;
-            while(p) { num_params++; p = p->next; }
-
-            // Add 1 for "this" if not static
-            int total_params = mc->is_static ? num_params : (num_params + 1);
-
-            char **param_names = NULL;
-            ASTNode **param_args = NULL;
-            ASTNode *varargs_head = NULL;
-
-            if (total_params > 0) {
-                param_names = alir_alloc(ctx->module, total_params * sizeof(char*));
-                param_args = alir_alloc(ctx->module, total_params * sizeof(ASTNode*));
-                
-                int i = 0;
-                if (!mc->is_static) {
-                    param_names[0] = "this";
-                    param_args[0] = mc->object;
-                    i = 1;
-                }
-
-                p = fd->params;
-                ASTNode *a = mc->args;
-                for (; i < total_params && a; i++) {
-                    param_names[i] = p->name;
-                    param_args[i] = a;
-                    p = p->next;
-                    a = a->next;
-                }
-                varargs_head = a; // Any remaining args are varargs
-            } else {
-                varargs_head = mc->args;
-            }
-
-            CompilerContext *cctx = ctx->module->compiler_ctx;
-            extern ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarType *replace_with, int num_params, char **rename_from, char **rename_to, int num_renames);
-            ASTNode *cloned_body = ast_clone(cctx, fd->body, NULL, NULL, 0, NULL, NULL, 0);
-
-            extern ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *body, ASTNode *varargs_head, char **param_names, ASTNode **param_args, int num_params);
-            cloned_body = ast_rewrite_macro(cctx, cloned_body, varargs_head, param_names, param_args, total_params);
-
-            extern void sem_check_block(SemanticCtx *ctx, ASTNode *block);
-            sem_check_block(ctx->sem, cloned_body);
-
-            ASTNode *curr = cloned_body;
-            while (curr) {
-                extern void alir_gen_stmt(AlirCtx *ctx, ASTNode *node);
-                alir_gen_stmt(ctx, curr);
-                curr = curr->next;
-            }
+            alir_gen_macro_expansion(ctx, fd, mc->is_static ? NULL : mc->object, mc->args, 0);
 
             // Macros do not return values as expression results yet
             return NULL;
@@ -654,37 +599,20 @@ AlirValue* alir_gen_expr(AlirCtx *ctx, ASTNode *node) {
                             item = item->next;
                         }
 
-                        // Emit cascading if/else: eq + conditional branch
-                        // Pre-create fallthrough check blocks so their actual unique labels are used
-                        AlirBlock **check_blocks = alir_alloc(ctx->module, sizeof(AlirBlock*) * num_cases);
-                        for (int j = 1; j < num_cases; j++) {
-                            char hint[64];
-                            snprintf(hint, sizeof(hint), "switch_check_%d", num_cases - j);
-                            check_blocks[j] = alir_add_block(ctx->module, ctx->current_func, hint);
-                        }
-
+                        // Dispatch on the enum value; duplicate values keep their first name
+                        AlirInst *sw = alir_switch_create(ctx->module, cond, default_bb, num_cases);
+                        Arena *arena = ctx->module->compiler_ctx ? ctx->module->compiler_ctx->arena : NULL;
+                        HashMap seen;
+                        hashmap_init(&seen, arena, num_cases > 16 ? num_cases * 2 : 32);
                         for (int i = 0; i < num_cases; i++) {
-                            AlirValue *cmp = new_temp(ctx, (VarType){TYPE_BOOL, 0});
-                            emit(ctx, mk_inst(ctx->module, ALIR_OP_EQ, cmp, cond, alir_const_int(ctx->module, case_values[i])));
-
-                            AlirValue *target = alir_val_label(ctx->module, case_blocks[i]->label);
-                            AlirValue *fallthrough;
-                            if (i + 1 < num_cases) {
-                                fallthrough = alir_val_label(ctx->module, check_blocks[i + 1]->label);
-                            } else {
-                                fallthrough = alir_val_label(ctx->module, default_bb->label);
-                            }
-
-                            AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cmp, target);
-                            br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-                            br->args[0] = fallthrough;
-                            br->arg_count = 1;
-                            emit(ctx, br);
-
-                            if (i + 1 < num_cases) {
-                                ctx->current_block = check_blocks[i + 1];
-                            }
+                            char key[32];
+                            snprintf(key, sizeof(key), "%ld", case_values[i]);
+                            if (hashmap_get(&seen, key)) continue;
+                            hashmap_put(&seen, key, case_blocks[i]);
+                            alir_switch_add_case(ctx->module, sw, case_values[i], case_blocks[i]);
                         }
+                        if (!arena) hashmap_free(&seen);
+                        emit(ctx, sw);
 
                         // Emit case bodies
                         item = enum_sym->inner_scope->symbols;
@@ -692,14 +620,14 @@ AlirValue* alir_gen_expr(AlirCtx *ctx, ASTNode *node) {
                             ctx->current_block = case_blocks[i];
                             AlirValue *glob = alir_module_add_string_literal(ctx->module, item->name, str_type);
                             emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, glob, dest));
-                            emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, end_bb->label), NULL));
+                            emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, end_bb), NULL));
                             item = item->next;
                         }
 
                         ctx->current_block = default_bb;
                         AlirValue *glob_def = alir_module_add_string_literal(ctx->module, "Unknown", str_type);
                         emit(ctx, mk_inst(ctx->module, ALIR_OP_STORE, NULL, glob_def, dest));
-                        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, end_bb->label), NULL));
+                        emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, end_bb), NULL));
 
                         ctx->current_block = end_bb;
                         AlirValue *res = new_temp(ctx, str_type);
@@ -0,0 +1,272 @@
+/**
+ * @file pack.c
+ * @brief Dense, index-based storage for ALIR functions.
+ */
+#include "alir.h"
+#include <stdint.h>
+
+/**
+ * @brief Returns the canonical handle of a type, adding it to the module table.
+ * @param mod The ALIR module.
+ * @param t The type.
+ * @return The type handle.
+ */
+AlirTypeRef alir_type_ref(AlirModule *mod, VarType t) {
+    Arena *arena = mod->compiler_ctx ? mod->compiler_ctx->arena : NULL;
+    if (!mod->type_capacity) {
+        hashmap_init(&mod->type_map, arena, 64);
+        mod->type_capacity = 16;
+        mod->types = alir_alloc(mod, sizeof(VarType) * mod->type_capacity);
+    }
+
+    char key[256];
+    snprintf(key, sizeof(key), "%d:%d:%s:%d:%d:%p:%p:%d:%d%d%d%d%d",
+             t.base, t.ptr_depth, t.class_name ? t.class_name : "", t.array_size, t.array_depth,
+             (void*)t.fp_ret_type, (void*)t.fp_param_types, t.fp_param_count,
+             t.is_unsigned, t.is_func_ptr, t.fp_is_varargs, t.is_tainted, t.is_pristine);
+    uintptr_t found = (uintptr_t)hashmap_get(&mod->type_map, key);
+    if (found) return (AlirTypeRef)(found - 1);
+
+    if (mod->type_count == mod->type_capacity) {
+        VarType *grown = alir_alloc(mod, sizeof(VarType) * mod->type_capacity * 2);
+        memcpy(grown, mod->types, sizeof(VarType) * mod->type_count);
+        mod->types = grown;
+        mod->type_capacity *= 2;
+    }
+    AlirTypeRef ref = mod->type_count++;
+    mod->types[ref] = t;
+    hashmap_put(&mod->type_map, key, (void*)(uintptr_t)(ref + 1));
+    return ref;
+}
+
+/**
+ * @brief Returns the type behind a canonical handle.
+ * @param mod The ALIR module.
+ * @param ref The type handle.
+ * @return The type.
+ */
+VarType* alir_type_get(AlirModule *mod, AlirTypeRef ref) {
+    return &mod->types[ref];
+}
+
+/**
+ * @brief Returns the argument references of a packed instruction.
+ * @param inst The instruction.
+ * @return Its arg_count argument references.
+ */
+AlirValueRef* alir_packed_args(AlirPackedInst *inst) {
+    return inst->arg_count > ALIR_PACKED_INLINE_ARGS ? inst->args : inst->inline_args;
+}
+
+typedef struct PackState {
+    AlirModule *mod;
+    AlirPackedFunction *pf;
+    uint32_t value_capacity;
+    AlirValueRef *temp_refs;    // temp id -> value reference
+    int temp_limit;
+    HashMap named;              // kind + name, or pointer -> value reference
+    HashMap blocks;             // block pointer -> block index + 1
+} PackState;
+
+/**
+ * @brief Appends a copy of an operand to the value table.
+ * @param st The packing state.
+ * @param v The operand.
+ * @return The new value reference.
+ */
+static AlirValueRef pack_new_value(PackState *st, AlirValue *v) {
+    AlirPackedFunction *pf = st->pf;
+    if (pf->value_count == st->value_capacity) {
+        AlirPackedValue *grown = alir_alloc(st->mod, sizeof(AlirPackedValue) * st->value_capacity * 2);
+        memcpy(grown, pf->values, sizeof(AlirPackedValue) * pf->value_count);
+        pf->values = grown;
+        st->value_capacity *= 2;
+    }
+    AlirValueRef ref = pf->value_count++;
+    AlirPackedValue *pv = &pf->values[ref];
+    pv->kind = (uint8_t)v->kind;
+    pv->pooled = (uint8_t)v->pooled;
+    pv->type = alir_type_ref(st->mod, v->type);
+    pv->temp_id = v->temp_id;
+    pv->block = -1;
+    pv->val = v->val;
+    if (v->kind == ALIR_VAL_LABEL && v->block) {
+        char key[32];
+        snprintf(key, sizeof(key), "%p", (void*)v->block);
+        uintptr_t b = (uintptr_t)hashmap_get(&st->blocks, key);
+        if (b) pv->block = (int32_t)(b - 1);
+    }
+    return ref;
+}
+
+/**
+ * @brief Returns the reference of an operand, adding it to the value table.
+ *
+ * Temps are shared by id and variables, globals and labels by name, so every
+ * distinct operand appears once. Other values are shared by pointer. A label
+ * resolves to the index of its target block when that block belongs to the
+ * function.
+ *
+ * @param st The packing state.
+ * @param v The operand, or NULL.
+ * @return The value reference, or ALIR_VALUE_NONE.
+ */
+static AlirValueRef pack_value(PackState *st, AlirValue *v) {
+    if (!v) return ALIR_VALUE_NONE;
+
+    if (v->kind == ALIR_VAL_TEMP && v->temp_id >= 0 && v->temp_id < st->temp_limit) {
+        AlirValueRef *slot = &st->temp_refs[v->temp_id];
+        if (!*slot) *slot = pack_new_value(st, v);
+        return *slot;
+    }
+
+    char buf[128];
+    char *key = buf;
+    if ((v->kind == ALIR_VAL_VAR || v->kind == ALIR_VAL_GLOBAL || v->kind == ALIR_VAL_LABEL) && v->val.str_val) {
+        size_t len = strlen(v->val.str_val) + 1;
+        if (len + 1 > sizeof(buf)) key = alir_alloc(st->mod, len + 1);
+        key[0] = (char)('0' + v->kind);
+        memcpy(key + 1, v->val.str_val, len);
+    } else {
+        snprintf(buf, sizeof(buf), "%p", (void*)v);
+    }
+
+    uintptr_t found = (uintptr_t)hashmap_get(&st->named, key);
+    if (found) return (AlirValueRef)found;
+    AlirValueRef ref = pack_new_value(st, v);
+    hashmap_put(&st->named, key, (void*)(uintptr_t)ref);
+    return ref;
+}
+
+/**
+ * @brief Packs the linked form of a function into dense arrays.
+ * @param mod The ALIR module.
+ * @param func The function.
+ * @return The packed function.
+ */
+AlirPackedFunction* alir_pack_function(AlirModule *mod, AlirFunction *func) {
+    Arena *arena = mod->compiler_ctx ? mod->compiler_ctx->arena : NULL;
+    AlirPackedFunction *pf = alir_alloc(mod, sizeof(AlirPackedFunction));
+    pf->func = func;
+
+    PackState st = {0};
+    st.mod = mod;
+    st.pf = pf;
+
+    // Size everything up front so each array is allocated once
+    uint32_t block_count = 0, inst_count = 0, spill_args = 0;
+    int max_temp = -1;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        block_count++;
+        for (AlirInst *i = b->head; i; i = i->next) {
+            inst_count++;
+            if (i->arg_count > ALIR_PACKED_INLINE_ARGS) spill_args += i->arg_count;
+            if (i->dest && i->dest->kind == ALIR_VAL_TEMP && i->dest->temp_id > max_temp) max_temp = i->dest->temp_id;
+            if (i->op1 && i->op1->kind == ALIR_VAL_TEMP && i->op1->temp_id > max_temp) max_temp = i->op1->temp_id;
+            if (i->op2 && i->op2->kind == ALIR_VAL_TEMP && i->op2->temp_id > max_temp) max_temp = i->op2->temp_id;
+            for (int a = 0; a < i->arg_count; a++) {
+                if (i->args[a] && i->args[a]->kind == ALIR_VAL_TEMP && i->args[a]->temp_id > max_temp) max_temp = i->args[a]->temp_id;
+            }
+        }
+    }
+
+    pf->blocks = alir_alloc(mod, sizeof(AlirPackedBlock) * (block_count ? block_count : 1));
+    pf->insts = alir_alloc(mod, sizeof(AlirPackedInst) * (inst_count ? inst_count : 1));
+    AlirValueRef *spill = spill_args ? alir_alloc(mod, sizeof(AlirValueRef) * spill_args) : NULL;
+    st.value_capacity = inst_count + 16;
+    pf->values = alir_alloc(mod, sizeof(AlirPackedValue) * st.value_capacity);
+    pf->value_count = 1;    // values[0] stays the zeroed "none" sentinel
+    st.temp_limit = max_temp + 1;
+    st.temp_refs = alir_alloc(mod, sizeof(AlirValueRef) * (st.temp_limit ? st.temp_limit : 1));
+    hashmap_init(&st.named, arena, 64);
+    hashmap_init(&st.blocks, arena, block_count > 16 ? block_count * 2 : 32);
+
+    uint32_t bi = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next, bi++) {
+        char key[32];
+        snprintf(key, sizeof(key), "%p", (void*)b);
+        hashmap_put(&st.blocks, key, (void*)(uintptr_t)(bi + 1));
+    }
+
+    bi = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next, bi++) {
+        AlirPackedBlock *pb = &pf->blocks[bi];
+        pb->block = b;
+        pb->first = pf->inst_count;
+        for (AlirInst *i = b->head; i; i = i->next) {
+            AlirPackedInst *pi = &pf->insts[pf->inst_count++];
+            pi->op = (uint16_t)i->op;
+            pi->arg_count = (uint32_t)i->arg_count;
+            pi->custom_flag = i->custom_flag;
+            pi->dest = pack_value(&st, i->dest);
+            pi->op1 = pack_value(&st, i->op1);
+            pi->op2 = pack_value(&st, i->op2);
+            pi->line = i->line;
+            pi->col = i->col;
+            if (i->arg_count > ALIR_PACKED_INLINE_ARGS) {
+                pi->args = spill;
+                spill += i->arg_count;
+            }
+            AlirValueRef *args = alir_packed_args(pi);
+            for (int a = 0; a < i->arg_count; a++) args[a] = pack_value(&st, i->args[a]);
+        }
+        pb->count = pf->inst_count - pb->first;
+    }
+    pf->block_count = block_count;
+
+    if (!arena) {
+        hashmap_free(&st.named);
+        hashmap_free(&st.blocks);
+    }
+    return pf;
+}
+
+/**
+ * @brief Rebuilds the linked form of a function from its packed form.
+ * @param mod The ALIR module.
+ * @param pf The packed function.
+ */
+void alir_unpack_function(AlirModule *mod, AlirPackedFunction *pf) {
+    AlirValue **values = alir_alloc(mod, sizeof(AlirValue*) * (pf->value_count ? pf->value_count : 1));
+    for (uint32_t v = 1; v < pf->value_count; v++) {
+        AlirPackedValue *pv = &pf->values[v];
+        AlirValue *val = alir_alloc(mod, sizeof(AlirValue));
+        val->kind = (AlirValueKind)pv->kind;
+        val->type = *alir_type_get(mod, pv->type);
+        val->temp_id = pv->temp_id;
+        val->pooled = pv->pooled;
+        val->val = pv->val;
+        if (pv->block >= 0) val->block = pf->blocks[pv->block].block;
+        values[v] = val;
+    }
+
+    AlirInst *insts = alir_alloc(mod, sizeof(AlirInst) * (pf->inst_count ? pf->inst_count : 1));
+    for (uint32_t bi = 0; bi < pf->block_count; bi++) {
+        AlirPackedBlock *pb = &pf->blocks[bi];
+        AlirBlock *b = pb->block;
+        b->head = NULL;
+        b->tail = NULL;
+        for (uint32_t k = pb->first; k < pb->first + pb->count; k++) {
+            AlirPackedInst *pi = &pf->insts[k];
+            AlirInst *i = &insts[k];
+            i->op = (AlirOpcode)pi->op;
+            i->dest = values[pi->dest];
+            i->op1 = values[pi->op1];
+            i->op2 = values[pi->op2];
+            i->custom_flag = pi->custom_flag;
+            // The args array below has no spare PHI/SWITCH capacity
+            if (i->op == ALIR_OP_PHI || i->op == ALIR_OP_SWITCH) i->custom_flag = pi->arg_count / 2;
+            i->line = pi->line;
+            i->col = pi->col;
+            i->arg_count = pi->arg_count;
+            if (pi->arg_count) {
+                AlirValueRef *args = alir_packed_args(pi);
+                i->args = alir_alloc(mod, sizeof(AlirValue*) * pi->arg_count);
+                for (uint32_t a = 0; a < pi->arg_count; a++) i->args[a] = values[args[a]];
+            }
+            if (b->tail) b->tail->next = i;
+            else b->head = i;
+            b->tail = i;
+        }
+    }
+}
@@ -0,0 +1,155 @@
+/**
+ * @file phi.c
+ * @brief Phi instruction helpers for ALIR in SSA form.
+ */
+#include "alir.h"
+
+/**
+ * @brief Creates an empty phi.
+ * @param mod The ALIR module.
+ * @param dest The value the phi defines.
+ * @param capacity Number of incoming pairs to reserve.
+ * @return The new phi instruction.
+ */
+AlirInst* alir_phi_create(AlirModule *mod, AlirValue *dest, int capacity) {
+    AlirInst *phi = mk_inst(mod, ALIR_OP_PHI, dest, NULL, NULL);
+    if (capacity < 1) capacity = 1;
+    phi->args = alir_alloc(mod, sizeof(AlirValue*) * capacity * 2);
+    phi->custom_flag = capacity;
+    if (dest) dest->def = phi;
+    return phi;
+}
+
+/**
+ * @brief Inserts a phi at the head of a block.
+ * @param block The block.
+ * @param phi The phi instruction.
+ */
+void alir_phi_insert(AlirBlock *block, AlirInst *phi) {
+    phi->next = block->head;
+    block->head = phi;
+    if (!block->tail) block->tail = phi;
+}
+
+/**
+ * @brief Finds the pair index of a predecessor in a phi.
+ * @param phi The phi instruction.
+ * @param pred The predecessor block.
+ * @return The index of the label slot, or -1.
+ */
+static int phi_find(AlirInst *phi, AlirBlock *pred) {
+    for (int k = 0; k + 1 < phi->arg_count; k += 2) {
+        if (phi->args[k] && phi->args[k]->block == pred) return k;
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns the value a phi takes when entered from a block.
+ * @param phi The phi instruction.
+ * @param pred The predecessor block.
+ * @return The incoming value, or NULL if the phi has no entry for pred.
+ */
+AlirValue* alir_phi_incoming(AlirInst *phi, AlirBlock *pred) {
+    int k = phi_find(phi, pred);
+    return k < 0 ? NULL : phi->args[k + 1];
+}
+
+/**
+ * @brief Appends an incoming pair to a phi, keeping the def-use chains valid.
+ *
+ * A phi read back from the binary format has no reserved room, so the args
+ * grow on demand; the use records follow their slots to the new array.
+ *
+ * @param mod The ALIR module.
+ * @param phi The phi instruction.
+ * @param pred The predecessor block.
+ * @param val The value flowing in from pred.
+ */
+void alir_phi_add_incoming(AlirModule *mod, AlirInst *phi, AlirBlock *pred, AlirValue *val) {
+    int capacity = phi->custom_flag > phi->arg_count / 2 ? phi->custom_flag : phi->arg_count / 2;
+    if (phi->arg_count / 2 == capacity) {
+        capacity = capacity ? capacity * 2 : 2;
+        AlirValue **grown = alir_alloc(mod, sizeof(AlirValue*) * capacity * 2);
+        if (phi->arg_count) memcpy(grown, phi->args, sizeof(AlirValue*) * phi->arg_count);
+        for (AlirUse *u = phi->operand_uses; u; u = u->next_operand) {
+            u->slot = grown + (u->slot - phi->args);
+        }
+        phi->args = grown;
+    }
+    phi->custom_flag = capacity;
+
+    int k = phi->arg_count;
+    phi->arg_count += 2;
+    phi->args[k] = alir_val_block(mod, pred);
+    phi->args[k + 1] = NULL;
+    alir_set_operand(mod, phi, &phi->args[k + 1], val);
+}
+
+/**
+ * @brief Removes the entry of one predecessor from every phi of a block.
+ *
+ * The last pair moves into the freed slot, so entries are unordered.
+ *
+ * @param mod The ALIR module.
+ * @param block The block holding the phis.
+ * @param pred The predecessor block.
+ */
+void alir_phi_remove_pred(AlirModule *mod, AlirBlock *block, AlirBlock *pred) {
+    for (AlirInst *phi = block->head; phi && phi->op == ALIR_OP_PHI; phi = phi->next) {
+        int k = phi_find(phi, pred);
+        if (k < 0) continue;
+        int last = phi->arg_count - 2;
+        if (k != last) {
+            phi->args[k] = phi->args[last];
+            alir_set_operand(mod, phi, &phi->args[k + 1], phi->args[last + 1]);
+        }
+        alir_set_operand(mod, phi, &phi->args[last + 1], NULL);
+        phi->args[last] = NULL;
+        phi->arg_count -= 2;
+    }
+}
+
+/**
+ * @brief Drops the phi entries of a block whose predecessor is not in a set.
+ *
+ * The kept entries slide down in order, re-recording their uses as the
+ * slots move.
+ *
+ * @param mod The ALIR module.
+ * @param block The block holding the phis.
+ * @param preds Blocks to keep, keyed by "%p" of the block.
+ */
+void alir_phi_keep_preds(AlirModule *mod, AlirBlock *block, HashMap *preds) {
+    char key[32];
+    for (AlirInst *phi = block->head; phi && phi->op == ALIR_OP_PHI; phi = phi->next) {
+        alir_drop_uses(phi);
+        phi->dest->def = phi;
+        int kept = 0;
+        for (int k = 0; k + 1 < phi->arg_count; k += 2) {
+            snprintf(key, sizeof(key), "%p", (void*)phi->args[k]->block);
+            if (!hashmap_get(preds, key)) continue;
+            AlirValue *val = phi->args[k + 1];
+            phi->args[kept] = phi->args[k];
+            phi->args[kept + 1] = NULL;
+            alir_set_operand(mod, phi, &phi->args[kept + 1], val);
+            kept += 2;
+        }
+        for (int k = kept; k < phi->arg_count; k++) phi->args[k] = NULL;
+        phi->arg_count = kept;
+    }
+}
+
+/**
+ * @brief Renames a predecessor in every phi of a block.
+ * @param mod The ALIR module.
+ * @param block The block holding the phis.
+ * @param from The old predecessor block.
+ * @param to The new predecessor block.
+ */
+void alir_phi_rename_pred(AlirModule *mod, AlirBlock *block, AlirBlock *from, AlirBlock *to) {
+    for (AlirInst *phi = block->head; phi && phi->op == ALIR_OP_PHI; phi = phi->next) {
+        int k = phi_find(phi, from);
+        if (k >= 0) phi->args[k] = alir_val_block(mod, to);
+    }
+}
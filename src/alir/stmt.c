@@ -28,6 +28,7 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
 
         if (fv) {
             AlirSymbol *sym = alir_find_symbol(ctx, vn->name);
+            if (sym) alir_flux_mark_decl(ctx, sym->ptr);
             if (sym && vn->initializer) {
                 AlirValue *val = alir_gen_expr(ctx, vn->initializer);
                 if (!val) {
@@ -119,16 +120,16 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
 
             AlirBlock *target_else = else_bb ? else_bb : merge_bb;
 
-            AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cond, alir_val_label(ctx->module, then_bb->label));
+            AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cond, alir_val_block(ctx->module, then_bb));
             br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-            br->args[0] = alir_val_label(ctx->module, target_else->label);
+            br->args[0] = alir_val_block(ctx->module, target_else);
             br->arg_count = 1;
             emit(ctx, br);
 
             ctx->current_block = then_bb;
             ASTNode *s = cn->body; while(s) { alir_gen_stmt(ctx, s); s=s->next; }
             if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
-                emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, merge_bb->label), NULL));
+                emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, merge_bb), NULL));
             }
 
             if (else_bb) {
@@ -154,7 +155,7 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
 
                 s = cn->residue_body; while(s) { alir_gen_stmt(ctx, s); s=s->next; }
                 if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
-                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, merge_bb->label), NULL));
+                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, merge_bb), NULL));
                 }
             }
 
@@ -194,9 +195,9 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
             AlirBlock *residue_bb = un->residue_body ? alir_add_block(ctx->module, ctx->current_func, "untaint_residue") : NULL;
             AlirBlock *merge_bb = alir_add_block(ctx->module, ctx->current_func, "untaint_merge");
 
-            AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cond, alir_val_label(ctx->module, merge_bb->label));
+            AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cond, alir_val_block(ctx->module, merge_bb));
             br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-            br->args[0] = alir_val_label(ctx->module, residue_bb ? residue_bb->label : merge_bb->label);
+            br->args[0] = alir_val_block(ctx->module, residue_bb ? residue_bb : merge_bb);
             br->arg_count = 1;
             emit(ctx, br);
 
@@ -211,7 +212,7 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
 
                 ASTNode *s = un->residue_body; while(s) { alir_gen_stmt(ctx, s); s=s->next; }
                 if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
-                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, merge_bb->label), NULL));
+                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, merge_bb), NULL));
                 }
             }
 
@@ -296,14 +297,14 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
             AlirBlock *body_bb = alir_add_block(ctx->module, ctx->current_func, "loop_body");
             AlirBlock *end_bb = alir_add_block(ctx->module, ctx->current_func, "loop_end");
 
-            emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, body_bb->label), NULL));
+            emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, body_bb), NULL));
 
             ctx->current_block = body_bb;
             push_loop(ctx, body_bb, end_bb);
 
             ASTNode *s = ln->body; while(s) { alir_gen_stmt(ctx, s); s=s->next; }
             pop_loop(ctx);
-            emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, body_bb->label), NULL));
+            emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, body_bb), NULL));
 
             ctx->current_block = end_bb;
             break;
@@ -315,11 +316,11 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
         }
 
         case NODE_BREAK:
-            if (ctx->loop_break) emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, ctx->loop_break->label), NULL));
+            if (ctx->loop_break) emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, ctx->loop_break), NULL));
             break;
 
         case NODE_CONTINUE:
-            if (ctx->loop_continue) emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, ctx->loop_continue->label), NULL));
+            if (ctx->loop_continue) emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, ctx->loop_continue), NULL));
             break;
 
         case NODE_DEFER: {
@@ -333,6 +334,11 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
         }
 
         case NODE_RETURN: {
+            // A return in a fused generator only ends the for-in loop it was fused into
+            if (ctx->flux_fusion) {
+                alir_flux_fuse_return(ctx, (ReturnNode*)node);
+                break;
+            }
             for (int i = ctx->defer_count - 1; i >= 0; i--) {
                 alir_gen_stmt(ctx, ctx->defers[i]);
             }
@@ -398,47 +404,67 @@ void alir_gen_stmt(AlirCtx *ctx, ASTNode *node) {
 
 
         case NODE_IF: {
+            // An else-if chain is lowered link by link into one shared merge
+            // block instead of recursing (and merging) once per link
             IfNode *in = (IfNode*)node;
-            AlirValue *cond = alir_gen_expr(ctx, in->condition);
-            if (!cond) cond = alir_const_int(ctx->module, 0); // Safety net
-
-            if (cond->kind == ALIR_VAL_CONST && (cond->type.base == TYPE_INT || cond->type.base == TYPE_BOOL)) {
-                if (cond->val.int_val) {
-                    ASTNode *s = in->then_body; while(s){ alir_gen_stmt(ctx,s); s=s->next; }
-                } else if (in->else_body) {
-                    ASTNode *s = in->else_body; while(s){ alir_gen_stmt(ctx,s); s=s->next; }
+            AlirBlock *merge_bb = NULL;
+            while (in) {
+                ctx->current_line = in->base.line;
+                ctx->current_col = in->base.col;
+                AlirValue *cond = alir_gen_expr(ctx, in->condition);
+                if (!cond) cond = alir_const_int(ctx->module, 0); // Safety net
+
+                ASTNode *else_body = in->else_body;
+                IfNode *next_if = (else_body && else_body->type == NODE_IF && !else_body->next) ? (IfNode*)else_body : NULL;
+                ASTNode *s;
+
+                if (cond->kind == ALIR_VAL_CONST && (cond->type.base == TYPE_INT || cond->type.base == TYPE_BOOL)) {
+                    if (cond->val.int_val) {
+                        s = in->then_body; while(s){ alir_gen_stmt(ctx,s); s=s->next; }
+                    } else if (next_if) {
+                        in = next_if;
+                        continue;
+                    } else if (else_body) {
+                        s = else_body; while(s){ alir_gen_stmt(ctx,s); s=s->next; }
+                    }
+                    break;
                 }
-                break;
-            }
 
-            AlirBlock *then_bb = alir_add_block(ctx->module, ctx->current_func, "then");
-            AlirBlock *else_bb = in->else_body ? alir_add_block(ctx->module, ctx->current_func, "else") : NULL;
-            AlirBlock *merge_bb = alir_add_block(ctx->module, ctx->current_func, "merge");
+                AlirBlock *then_bb = alir_add_block(ctx->module, ctx->current_func, "then");
+                AlirBlock *else_bb = else_body ? alir_add_block(ctx->module, ctx->current_func, "else") : NULL;
+                if (!merge_bb) merge_bb = alir_add_block(ctx->module, ctx->current_func, "merge");
 
-            AlirBlock *target_else = else_bb ? else_bb : merge_bb;
+                AlirBlock *target_else = else_bb ? else_bb : merge_bb;
 
-            AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cond, alir_val_label(ctx->module, then_bb->label));
-            br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
-            br->args[0] = alir_val_label(ctx->module, target_else->label);
-            br->arg_count = 1;
-            emit(ctx, br);
+                AlirInst *br = mk_inst(ctx->module, ALIR_OP_CONDI, NULL, cond, alir_val_block(ctx->module, then_bb));
+                br->args = alir_alloc(ctx->module, sizeof(AlirValue*));
+                br->args[0] = alir_val_block(ctx->module, target_else);
+                br->arg_count = 1;
+                emit(ctx, br);
 
-            ctx->current_block = then_bb;
-            ASTNode *s = in->then_body; while(s){ alir_gen_stmt(ctx,s); s=s->next; }
+                ctx->current_block = then_bb;
+                s = in->then_body; while(s){ alir_gen_stmt(ctx,s); s=s->next; }
 
-            if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
-                emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, merge_bb->label), NULL));
-            }
+                if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
+                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, merge_bb), NULL));
+                }
+                if (!else_bb) break;
 
-            if (else_bb) {
                 ctx->current_block = else_bb;
-                s = in->else_body; while(s){ alir_gen_stmt(ctx,s); s=s->next; }
-                if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
-                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_label(ctx->module, merge_bb->label), NULL));
+                if (next_if) {
+                    in = next_if;
+                    continue;
                 }
+                s = else_body; while(s){ alir_gen_stmt(ctx,s); s=s->next; }
+                break;
             }
 
-            ctx->current_block = merge_bb;
+            if (merge_bb) {
+                if (!ctx->current_block->tail || !is_terminator(ctx->current_block->tail->op)) {
+                    emit(ctx, mk_inst(ctx->module, ALIR_OP_JUMP, NULL, alir_val_block(ctx->module, merge_bb), NULL));
+                }
+                ctx->current_block = merge_bb;
+            }
             break;
         }
 
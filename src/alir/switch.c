@@ -0,0 +1,80 @@
+/**
+ * @file switch.c
+ * @brief Multi-way branch helpers for ALIR.
+ */
+#include "alir.h"
+
+/**
+ * @brief Creates a switch without cases.
+ * @param mod The ALIR module.
+ * @param cond The value being dispatched on.
+ * @param default_bb The block taken when no case matches.
+ * @param capacity Number of cases to reserve.
+ * @return The new switch instruction.
+ */
+AlirInst* alir_switch_create(AlirModule *mod, AlirValue *cond, AlirBlock *default_bb, int capacity) {
+    AlirInst *sw = mk_inst(mod, ALIR_OP_SWITCH, NULL, cond, alir_val_block(mod, default_bb));
+    if (capacity < 1) capacity = 1;
+    sw->args = alir_alloc(mod, sizeof(AlirValue*) * capacity * 2);
+    sw->custom_flag = capacity;
+    return sw;
+}
+
+/**
+ * @brief Appends a case to a switch.
+ *
+ * The table grows on demand, so callers that cannot count their cases up
+ * front may pass a small capacity.
+ *
+ * @param mod The ALIR module.
+ * @param sw The switch instruction.
+ * @param value The case value.
+ * @param target The block taken for that value.
+ */
+void alir_switch_add_case(AlirModule *mod, AlirInst *sw, long value, AlirBlock *target) {
+    int capacity = sw->custom_flag > sw->arg_count / 2 ? sw->custom_flag : sw->arg_count / 2;
+    if (sw->arg_count / 2 == capacity) {
+        capacity = capacity ? capacity * 2 : 2;
+        AlirValue **grown = alir_alloc(mod, sizeof(AlirValue*) * capacity * 2);
+        if (sw->arg_count) memcpy(grown, sw->args, sizeof(AlirValue*) * sw->arg_count);
+        sw->args = grown;
+    }
+    sw->custom_flag = capacity;
+
+    // The whole long is kept, since alir_const_int only fills int_val
+    sw->args[sw->arg_count++] = alir_const_value(mod, (VarType){TYPE_INT, 0}, (Value){ .long_val = value });
+    sw->args[sw->arg_count++] = alir_val_block(mod, target);
+}
+
+/**
+ * @brief Returns the number of cases of a switch.
+ * @param sw The switch instruction.
+ * @return Its case count.
+ */
+int alir_switch_case_count(AlirInst *sw) {
+    return sw->arg_count / 2;
+}
+
+/**
+ * @brief Returns the value of one case of a switch.
+ * @param sw The switch instruction.
+ * @param k The case index.
+ * @return The case value.
+ */
+long alir_switch_case_value(AlirInst *sw, int k) {
+    AlirValue *v = sw->args[2 * k];
+    return v ? v->val.long_val : 0;
+}
+
+/**
+ * @brief Returns the block a switch branches to for a value.
+ * @param sw The switch instruction.
+ * @param value The dispatched value.
+ * @return The matching case target, or the default block.
+ */
+AlirBlock* alir_switch_target(AlirInst *sw, long value) {
+    for (int k = 0; k + 1 < sw->arg_count; k += 2) {
+        if (sw->args[k] && sw->args[k]->val.long_val == value) return sw->args[k + 1]->block;
+    }
+    return sw->op2 ? sw->op2->block : NULL;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file use.c
+ * @brief Def-use chain maintenance for ALIR instructions.
+ */
+#include "alir.h"
+
+/**
+ * @brief Whether a value gets a use list.
+ *
+ * Pooled constants and globals are read by many functions, possibly on
+ * several threads, so they keep none.
+ *
+ * @param v The value.
+ * @return Non-zero if uses of the value are tracked.
+ */
+static int use_tracked(AlirValue *v) {
+    return v && v->kind != ALIR_VAL_LABEL && v->kind != ALIR_VAL_TYPE && !v->pooled;
+}
+
+/**
+ * @brief Pushes a use onto the front of a value's use list.
+ * @param v The value.
+ * @param u The use record.
+ */
+static void use_link(AlirValue *v, AlirUse *u) {
+    u->next = v->uses;
+    if (v->uses) v->uses->pprev = &u->next;
+    u->pprev = &v->uses;
+    v->uses = u;
+}
+
+/**
+ * @brief Removes a use from the use list it is on.
+ * @param u The use record.
+ */
+static void use_unlink(AlirUse *u) {
+    if (!u->pprev) return;
+    *u->pprev = u->next;
+    if (u->next) u->next->pprev = u->pprev;
+    u->next = NULL;
+    u->pprev = NULL;
+}
+
+/**
+ * @brief Records that an operand slot reads the value currently stored in it.
+ * @param mod The ALIR module.
+ * @param inst The instruction owning the slot.
+ * @param slot The operand slot.
+ */
+static void use_add(AlirModule *mod, AlirInst *inst, AlirValue **slot) {
+    if (!use_tracked(*slot)) return;
+    AlirUse *u = alir_alloc(mod, sizeof(AlirUse));
+    u->user = inst;
+    u->slot = slot;
+    u->next_operand = inst->operand_uses;
+    inst->operand_uses = u;
+    use_link(*slot, u);
+}
+
+/**
+ * @brief Clears the chains of an instruction and of the values it touches.
+ * @param inst The instruction.
+ */
+static void use_reset_inst(AlirInst *inst) {
+    inst->operand_uses = NULL;
+    if (inst->dest) {
+        inst->dest->def = NULL;
+        inst->dest->uses = NULL;
+    }
+    if (use_tracked(inst->op1)) inst->op1->uses = NULL;
+    if (use_tracked(inst->op2)) inst->op2->uses = NULL;
+    for (int i = 0; i < inst->arg_count; i++) {
+        if (use_tracked(inst->args[i])) inst->args[i]->uses = NULL;
+    }
+}
+
+/**
+ * @brief Rebuilds the def pointers and use lists of a function.
+ * @param mod The ALIR module.
+ * @param func The function.
+ */
+void alir_build_uses(AlirModule *mod, AlirFunction *func) {
+    if (!func) return;
+
+    // Values may be shared with other functions, so clear everything first
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) use_reset_inst(i);
+    }
+
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->dest && !i->dest->def) i->dest->def = i;
+            use_add(mod, i, &i->op1);
+            use_add(mod, i, &i->op2);
+            for (int a = 0; a < i->arg_count; a++) use_add(mod, i, &i->args[a]);
+        }
+    }
+}
+
+/**
+ * @brief Sets one operand slot of an instruction, keeping the chains valid.
+ * @param mod The ALIR module.
+ * @param inst The instruction owning the slot.
+ * @param slot The operand slot.
+ * @param val The new operand, or NULL.
+ */
+void alir_set_operand(AlirModule *mod, AlirInst *inst, AlirValue **slot, AlirValue *val) {
+    // An empty slot holds no use, so filling it (e.g. a new phi entry) needs no search
+    AlirUse **link = *slot ? &inst->operand_uses : NULL;
+    while (link && *link) {
+        AlirUse *u = *link;
+        if (u->slot == slot) {
+            use_unlink(u);
+            *link = u->next_operand;
+            break;
+        }
+        link = &u->next_operand;
+    }
+    *slot = val;
+    use_add(mod, inst, slot);
+}
+
+/**
+ * @brief Rewrites every use of a value to read another value instead.
+ * @param from The value being replaced.
+ * @param to The replacement.
+ */
+void alir_replace_all_uses(AlirValue *from, AlirValue *to) {
+    if (!from || from == to || from->pooled) return;
+
+    AlirUse *u = from->uses;
+    from->uses = NULL;
+    while (u) {
+        AlirUse *next = u->next;
+        *u->slot = to;
+        u->pprev = NULL;
+        u->next = NULL;
+        if (use_tracked(to)) use_link(to, u);
+        u = next;
+    }
+}
+
+/**
+ * @brief Unlinks the operand uses of an instruction that is being removed.
+ * @param inst The instruction.
+ */
+void alir_drop_uses(AlirInst *inst) {
+    if (!inst) return;
+    for (AlirUse *u = inst->operand_uses; u; u = u->next_operand) use_unlink(u);
+    inst->operand_uses = NULL;
+    if (inst->dest && inst->dest->def == inst) inst->dest->def = NULL;
+}
@@ -37,6 +37,9 @@ pub enum AlirOpcode {
     Cast,
     Sizeof,
     Alignof,
+
+    Phi,
+    Switch,
 }
 
 #[repr(C)]
@@ -86,6 +89,8 @@ pub struct AlirFunction {
     pub is_varargs: std::ffi::c_int,
     pub is_extern: std::ffi::c_int,
     pub is_pure: std::ffi::c_int,
+    pub is_total: std::ffi::c_int,
+    pub is_pristine: std::ffi::c_int,
     pub reason: *mut c_char,
     pub cconv: *mut c_char,
     pub next: *mut AlirFunction,
@@ -4,6 +4,7 @@
  */
 #include "../../include/codegen_llvm/codegen.h"
 #include "../../include/common/hashmap.h"
+#include <llvm-c/DebugInfo.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -230,6 +231,47 @@ LLVMValueRef get_llvm_value(CodegenCtx *ctx, AlirValue *v) {
     }
 }
 
+/**
+ * @brief Passes what optlir knows about a counted loop on to LLVM.
+ *
+ * The branch closing the loop gets llvm.loop metadata saying it terminates,
+ * and the header test gets branch weights carrying the trip count.
+ *
+ * @param ctx The codegen context.
+ * @param b The ALIR block just translated.
+ * @param bb The LLVM block it ended in.
+ */
+static void annotate_loop(CodegenCtx *ctx, AlirBlock *b, LLVMBasicBlockRef bb) {
+    LLVMValueRef term = LLVMGetBasicBlockTerminator(bb);
+    if (!term) return;
+
+    if (b->loop_latch) {
+        // A loop id names itself as its first operand
+        LLVMMetadataRef self = LLVMTemporaryMDNode(ctx->llvm_ctx, NULL, 0);
+        const char *progress = "llvm.loop.mustprogress";
+        LLVMMetadataRef prop = LLVMMDStringInContext2(ctx->llvm_ctx, progress, strlen(progress));
+        LLVMMetadataRef prop_node = LLVMMDNodeInContext2(ctx->llvm_ctx, &prop, 1);
+        LLVMMetadataRef ops[2] = { self, prop_node };
+        LLVMMetadataRef loop_id = LLVMMDNodeInContext2(ctx->llvm_ctx, ops, 2);
+        LLVMMetadataReplaceAllUsesWith(self, loop_id);
+        LLVMSetMetadata(term, LLVMGetMDKindIDInContext(ctx->llvm_ctx, "llvm.loop", 9), LLVMMetadataAsValue(ctx->llvm_ctx, loop_id));
+    }
+
+    // optlir only counts loops whose test stays in on the true edge
+    if (b->trip_count > 0 && LLVMIsConditional(term)) {
+        LLVMTypeRef i32 = LLVMInt32TypeInContext(ctx->llvm_ctx);
+        unsigned long long stay = b->trip_count > 0x7fffffffL ? 0x7fffffffULL : (unsigned long long)b->trip_count;
+        const char *name = "branch_weights";
+        LLVMMetadataRef ops[3] = {
+            LLVMMDStringInContext2(ctx->llvm_ctx, name, strlen(name)),
+            LLVMValueAsMetadata(LLVMConstInt(i32, stay, 0)),
+            LLVMValueAsMetadata(LLVMConstInt(i32, 1, 0)),
+        };
+        LLVMSetMetadata(term, LLVMGetMDKindIDInContext(ctx->llvm_ctx, "prof", 4),
+                        LLVMMetadataAsValue(ctx->llvm_ctx, LLVMMDNodeInContext2(ctx->llvm_ctx, ops, 3)));
+    }
+}
+
 /**
  * @brief Generates the full LLVM module from the ALIR module.
  * @param ctx The codegen context.
@@ -472,7 +514,9 @@ LLVMModuleRef codegen_generate(CodegenCtx *ctx) {
             b = b->next;
         }
 
-        // Evaluate Instructions
+        // Evaluate Instructions, noting the LLVM block each ALIR block ends in for phis
+        HashMap exits;
+        hashmap_init(&exits, ctx->arena, 32);
         b = func->blocks;
         while(b) {
             LLVMBasicBlockRef bb = hashmap_get(&ctx->block_map, b->label);
@@ -499,9 +543,13 @@ LLVMModuleRef codegen_generate(CodegenCtx *ctx) {
                     LLVMBuildUnreachable(ctx->builder);
                 }
             }
+            annotate_loop(ctx, b, current_bb);
+            hashmap_put(&exits, b->label, current_bb);
 
             b = b->next;
         }
+        translate_phi_incoming(ctx, func, &exits);
+        if (!ctx->arena) hashmap_free(&exits);
 
         if (!ctx->arena) free(ctx->temps);
         ctx->temps = NULL;
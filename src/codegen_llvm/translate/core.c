@@ -63,10 +63,12 @@ void translate_inst(CodegenCtx *ctx, AlirInst *inst) {
             
         case ALIR_OP_JUMP:
         case ALIR_OP_CONDI:
+        case ALIR_OP_SWITCH:
         case ALIR_OP_CALL:
         case ALIR_OP_RET:
         case ALIR_OP_FALLBACK:
         case ALIR_OP_PANIC:
+        case ALIR_OP_PHI:
             res = translate_flow(ctx, inst, op1, op2, is_float);
             break;
             
@@ -39,6 +39,39 @@ LLVMValueRef translate_flow(CodegenCtx *ctx, AlirInst *inst, LLVMValueRef op1, L
             }
             break;
         }
+        case ALIR_OP_SWITCH: {
+            if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(ctx->builder)) != NULL) break;
+            LLVMBasicBlockRef default_bb = hashmap_get(&ctx->block_map, inst->op2->val.str_val);
+            if (!default_bb || !op1) {
+                debug_codegen("cannot lower switch to default '%s': %s\n", inst->op2->val.str_val,
+                              default_bb ? "no switch value" : "unknown block");
+                break;
+            }
+            LLVMValueRef value = op1;
+            if (LLVMGetTypeKind(LLVMTypeOf(value)) != LLVMIntegerTypeKind) {
+                value = LLVMBuildPtrToInt(ctx->builder, value, LLVMInt64TypeInContext(ctx->llvm_ctx), "switch_val");
+            }
+            int cases = alir_switch_case_count(inst);
+            LLVMValueRef sw = LLVMBuildSwitch(ctx->builder, value, default_bb, cases);
+            for (int k = 0; k < cases; k++) {
+                LLVMBasicBlockRef case_bb = hashmap_get(&ctx->block_map, inst->args[2 * k + 1]->val.str_val);
+                if (!case_bb) continue;
+                LLVMValueRef on = LLVMConstInt(LLVMTypeOf(value), (unsigned long long)alir_switch_case_value(inst, k), 1);
+                LLVMAddCase(sw, on, case_bb);
+            }
+            break;
+        }
+        case ALIR_OP_PHI: {
+            // Incoming values may come from blocks not translated yet; translate_phi_incoming adds them
+            LLVMTypeRef ty;
+            if (inst->dest->type.ptr_depth > 0) {
+                ty = LLVMPointerType(LLVMInt8TypeInContext(ctx->llvm_ctx), 0);
+            } else {
+                ty = get_llvm_type(ctx, inst->dest->type);
+            }
+            res = LLVMBuildPhi(ctx->builder, ty, "phi");
+            break;
+        }
         case ALIR_OP_CALL: {
             LLVMValueRef func = get_llvm_value(ctx, inst->op1);
             LLVMTypeRef func_ty = NULL;
@@ -355,3 +388,66 @@ LLVMValueRef translate_flow(CodegenCtx *ctx, AlirInst *inst, LLVMValueRef op1, L
     }
     return res;
 }
+
+/**
+ * @brief Convert a phi operand to the phi type at the end of its predecessor.
+ * @param ctx Code generation context.
+ * @param val The incoming value.
+ * @param ty The phi type.
+ * @param from The LLVM block the value flows out of.
+ * @return The converted value.
+ */
+static LLVMValueRef phi_operand_cast(CodegenCtx *ctx, LLVMValueRef val, LLVMTypeRef ty, LLVMBasicBlockRef from) {
+    LLVMValueRef term = LLVMGetBasicBlockTerminator(from);
+    if (term) LLVMPositionBuilderBefore(ctx->builder, term);
+    else LLVMPositionBuilderAtEnd(ctx->builder, from);
+
+    LLVMTypeKind src = LLVMGetTypeKind(LLVMTypeOf(val));
+    LLVMTypeKind dst = LLVMGetTypeKind(ty);
+    if (src == LLVMIntegerTypeKind && dst == LLVMIntegerTypeKind) return LLVMBuildIntCast2(ctx->builder, val, ty, 1, "phi_cast");
+    if (src == LLVMIntegerTypeKind && dst == LLVMPointerTypeKind) return LLVMBuildIntToPtr(ctx->builder, val, ty, "phi_cast");
+    if (src == LLVMPointerTypeKind && dst == LLVMIntegerTypeKind) return LLVMBuildPtrToInt(ctx->builder, val, ty, "phi_cast");
+    if ((src == LLVMFloatTypeKind || src == LLVMDoubleTypeKind) && (dst == LLVMFloatTypeKind || dst == LLVMDoubleTypeKind)) {
+        return LLVMBuildFPCast(ctx->builder, val, ty, "phi_cast");
+    }
+    return LLVMBuildBitCast(ctx->builder, val, ty, "phi_cast");
+}
+
+/**
+ * @brief Add the incoming values of every phi of a translated function.
+ *
+ * Runs once all blocks are translated, so every incoming value exists. A
+ * predecessor is named by the LLVM block its ALIR block ended in, since
+ * translation may split an ALIR block. LLVM wants one entry per edge, so a
+ * switch reaching the block through several cases repeats its entry.
+ *
+ * @param ctx Code generation context.
+ * @param func The ALIR function.
+ * @param exits Map from ALIR block label to the LLVM block it ended in.
+ */
+void translate_phi_incoming(CodegenCtx *ctx, AlirFunction *func, HashMap *exits) {
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *inst = b->head; inst && inst->op == ALIR_OP_PHI; inst = inst->next) {
+            LLVMValueRef phi = get_llvm_value(ctx, inst->dest);
+            if (!phi) continue;
+            LLVMTypeRef ty = LLVMTypeOf(phi);
+            for (int k = 0; k + 1 < inst->arg_count; k += 2) {
+                LLVMBasicBlockRef from = hashmap_get(exits, inst->args[k]->val.str_val);
+                if (!from) continue;
+                LLVMValueRef val = get_llvm_value(ctx, inst->args[k + 1]);
+                if (!val) val = LLVMGetUndef(ty);
+                else if (LLVMTypeOf(val) != ty) val = phi_operand_cast(ctx, val, ty, from);
+
+                LLVMValueRef term = LLVMGetBasicBlockTerminator(from);
+                LLVMBasicBlockRef here = LLVMGetInstructionParent(phi);
+                unsigned edges = 0;
+                unsigned succ_count = term ? LLVMGetNumSuccessors(term) : 0;
+                for (unsigned e = 0; e < succ_count; e++) {
+                    if (LLVMGetSuccessor(term, e) == here) edges++;
+                }
+                if (edges == 0) edges = 1;
+                for (unsigned e = 0; e < edges; e++) LLVMAddIncoming(phi, &val, &from, 1);
+            }
+        }
+    }
+}
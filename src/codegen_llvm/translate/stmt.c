@@ -32,6 +32,8 @@ LLVMValueRef translate_stmt(CodegenCtx *ctx, AlirInst *inst, LLVMValueRef op1, L
                         size = LLVMBuildZExt(ctx->builder, size, LLVMInt64TypeInContext(ctx->llvm_ctx), "sz_ext");
                     }
                     res = LLVMBuildArrayAlloca(ctx->builder, LLVMInt8TypeInContext(ctx->llvm_ctx), size, "alloc");
+                    // Sized slots stand in for malloc, which hands out 16-byte aligned memory
+                    LLVMSetAlignment(res, 16);
                 } else {
                     res = LLVMBuildAlloca(ctx->builder, ty, "alloc");
                 }
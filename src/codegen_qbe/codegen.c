@@ -11,6 +11,7 @@
 
 int s_next_qbe_temp = 0;
 AlirFunction *s_current_qbe_function = NULL;
+AlirBlock *s_current_qbe_block = NULL;
 
 /**
  * @brief Returns the size in bytes of a variable of the given type.
@@ -123,6 +124,146 @@ static int get_struct_size(AlirModule *module, const char *struct_name) {
     return (offset + 7) & ~7;
 }
 
+/**
+ * @brief Counts the points where a block is split into several QBE blocks.
+ * @param b The ALIR block.
+ * @return The number of FALLBACK instructions in the block.
+ */
+int qbe_block_splits(AlirBlock *b) {
+    int count = 0;
+    for (AlirInst *i = b->head; i; i = i->next) {
+        if (i->op == ALIR_OP_FALLBACK) count++;
+    }
+    return count;
+}
+
+/**
+ * @brief A run of consecutive switch case values sharing one target.
+ */
+typedef struct QbeSwitchRange {
+    long low;
+    long high;
+    AlirBlock *target;
+} QbeSwitchRange;
+
+/**
+ * @brief Orders switch ranges by their signed low value.
+ * @param a The first range.
+ * @param b The second range.
+ * @return Negative, zero or positive as for qsort.
+ */
+static int qbe_range_cmp(const void *a, const void *b) {
+    long x = ((const QbeSwitchRange*)a)->low, y = ((const QbeSwitchRange*)b)->low;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Orders switch ranges by their unsigned low value.
+ * @param a The first range.
+ * @param b The second range.
+ * @return Negative, zero or positive as for qsort.
+ */
+static int qbe_range_cmp_unsigned(const void *a, const void *b) {
+    unsigned long x = (unsigned long)((const QbeSwitchRange*)a)->low;
+    unsigned long y = (unsigned long)((const QbeSwitchRange*)b)->low;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Emits the decision tree of a switch over sorted case ranges.
+ *
+ * QBE has no indirect branch, so there is no jump table: the ranges are
+ * halved with one comparison per level, and the last few are tested in a
+ * row, a whole run of values with one subtract and compare.
+ *
+ * @param out The output stream.
+ * @param sw The SWITCH instruction.
+ * @param from The block holding the switch.
+ * @param ranges The case ranges, sorted.
+ * @param lo First range to dispatch.
+ * @param hi One past the last range to dispatch.
+ * @param t QBE type of the dispatched value.
+ */
+static void qbe_switch_tree(FILE *out, AlirInst *sw, AlirBlock *from, QbeSwitchRange *ranges, int lo, int hi, char t) {
+    const char *sign = sw->op1->type.is_unsigned ? "u" : "s";
+    if (hi - lo <= 3) {
+        for (int k = lo; k < hi; k++) {
+            int id = s_next_qbe_temp++;
+            if (ranges[k].low == ranges[k].high) {
+                fprintf(out, "\t%%sw_c_%d =w ceq%c ", id, t);
+                print_val(out, sw->op1);
+                fprintf(out, ", %ld\n", ranges[k].low);
+            } else {
+                fprintf(out, "\t%%sw_d_%d =%c sub ", id, t);
+                print_val(out, sw->op1);
+                fprintf(out, ", %ld\n", ranges[k].low);
+                fprintf(out, "\t%%sw_c_%d =w cule%c %%sw_d_%d, %ld\n", id, t, id, ranges[k].high - ranges[k].low);
+            }
+            fprintf(out, "\tjnz %%sw_c_%d, @%s.to.%s, @%s.sw%d\n", id, from->label, ranges[k].target->label, from->label, id);
+            fprintf(out, "@%s.sw%d\n", from->label, id);
+        }
+        fprintf(out, "\tjmp @%s.to.%s\n", from->label, sw->op2->val.str_val);
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    int id = s_next_qbe_temp++;
+    fprintf(out, "\t%%sw_c_%d =w c%slt%c ", id, sign, t);
+    print_val(out, sw->op1);
+    fprintf(out, ", %ld\n", ranges[mid].low);
+    fprintf(out, "\tjnz %%sw_c_%d, @%s.sw%d.lt, @%s.sw%d.ge\n", id, from->label, id, from->label, id);
+    fprintf(out, "@%s.sw%d.lt\n", from->label, id);
+    qbe_switch_tree(out, sw, from, ranges, lo, mid, t);
+    fprintf(out, "@%s.sw%d.ge\n", from->label, id);
+    qbe_switch_tree(out, sw, from, ranges, mid, hi, t);
+}
+
+/**
+ * @brief Emits a switch as a decision tree ending in one landing block per target.
+ *
+ * Each target is entered through `@<label>.to.<target>`, so the phis of a
+ * target see a single QBE predecessor whichever comparison matched.
+ *
+ * @param out The output stream.
+ * @param sw The SWITCH instruction.
+ * @param from The block holding the switch.
+ */
+static void qbe_emit_switch(FILE *out, AlirInst *sw, AlirBlock *from) {
+    char t = qbe_type(sw->op1->type);
+    if (t != 'l') t = 'w';
+
+    int cases = alir_switch_case_count(sw);
+    QbeSwitchRange *ranges = malloc(sizeof(QbeSwitchRange) * (cases ? cases : 1));
+    for (int k = 0; k < cases; k++) {
+        ranges[k].low = ranges[k].high = alir_switch_case_value(sw, k);
+        ranges[k].target = sw->args[2 * k + 1]->block;
+    }
+    qsort(ranges, cases, sizeof(QbeSwitchRange), sw->op1->type.is_unsigned ? qbe_range_cmp_unsigned : qbe_range_cmp);
+
+    // Runs of consecutive values with one target become a single range
+    int count = 0;
+    for (int k = 0; k < cases; k++) {
+        if (count > 0 && ranges[count - 1].target == ranges[k].target && ranges[count - 1].high + 1 == ranges[k].low) {
+            ranges[count - 1].high = ranges[k].low;
+        } else {
+            ranges[count++] = ranges[k];
+        }
+    }
+    qbe_switch_tree(out, sw, from, ranges, 0, count, t);
+    free(ranges);
+
+    HashMap landed;
+    hashmap_init(&landed, NULL, cases > 16 ? cases * 2 : 32);
+    int n = alir_branch_count(sw);
+    for (int k = 0; k < n; k++) {
+        AlirValue **slot = alir_branch_slot(sw, k);
+        if (!slot || hashmap_get(&landed, (*slot)->val.str_val)) continue;
+        hashmap_put(&landed, (*slot)->val.str_val, *slot);
+        fprintf(out, "@%s.to.%s\n\tjmp @%s\n", from->label, (*slot)->val.str_val, (*slot)->val.str_val);
+    }
+    hashmap_free(&landed);
+}
+
 /**
  * @brief Finds the highest temporary ID used across all instructions in the module.
  * @param module The ALIR module to scan.
@@ -170,6 +311,7 @@ void emit_inst(FILE *out, AlirModule *module, AlirInst *inst, AlirBlock *next_bl
         case ALIR_OP_ALLOCA: {
             int sz;
             int align = get_qbe_type_align_for_var(inst->dest->type);
+            if (inst->op1) align = 16; // Sized slots stand in for malloc, which hands out 16-byte aligned memory
             if (inst->op1 && inst->op1->kind == ALIR_VAL_CONST) {
                 sz = (int)inst->op1->val.long_val;
             } else if (inst->op1 && inst->op1->kind == ALIR_VAL_INT) {
@@ -432,6 +574,9 @@ void emit_inst(FILE *out, AlirModule *module, AlirInst *inst, AlirBlock *next_bl
             fprintf(out, "\n");
             break;
         }
+        case ALIR_OP_SWITCH:
+            qbe_emit_switch(out, inst, s_current_qbe_block);
+            break;
         case ALIR_OP_CALL: {
             char call_dt = dt;
             if (inst->op1 && inst->op1->kind == ALIR_VAL_VAR && inst->op1->val.str_val) {
@@ -804,6 +949,22 @@ void emit_inst(FILE *out, AlirModule *module, AlirInst *inst, AlirBlock *next_bl
                 fprintf(out, "\thlt\n");
             }
             break;
+        case ALIR_OP_PHI: {
+            char rt = qbe_type(inst->dest->type);
+            if (rt == 'v') rt = 'w';
+            fprintf(out, "\t");
+            print_val(out, inst->dest);
+            fprintf(out, " =%c phi", rt);
+            for (int k = 0; k + 1 < inst->arg_count; k += 2) {
+                AlirBlock *pred = inst->args[k]->block;
+                fprintf(out, "%s @%s", k > 0 ? "," : "", inst->args[k]->val.str_val);
+                if (pred && pred->tail && pred->tail->op == ALIR_OP_SWITCH) fprintf(out, ".to.%s ", s_current_qbe_block->label);
+                else fprintf(out, "%s ", pred && qbe_block_splits(pred) ? ".exit" : "");
+                print_val(out, inst->args[k + 1]);
+            }
+            fprintf(out, "\n");
+            break;
+        }
         case ALIR_OP_FALLBACK: {
             int lbl = s_next_qbe_temp++;
             char rt = qbe_type(inst->dest->type);
@@ -72,9 +72,13 @@ int backend_run_alir(AlirModule *module, const char *basename, const char *link_
         AlirBlock *curr_block = f->blocks;
         while (curr_block) {
             AlirBlock *next_block = curr_block->next;
+            s_current_qbe_block = curr_block;
             fprintf(out, "\t@%s\n", curr_block->label ? curr_block->label : "L");
+            int splits = qbe_block_splits(curr_block);
             for (AlirInst *i = curr_block->head; i; i = i->next) {
                 emit_inst(out, module, i, next_block);
+                // Phis of successors name the QBE block the rest of this one runs in
+                if (i->op == ALIR_OP_FALLBACK && --splits == 0) fprintf(out, "@%s.exit\n", curr_block->label);
             }
             curr_block = next_block;
         }
@@ -117,6 +117,30 @@ void arena_free(Arena *a) {
     }
 }
 
+/**
+ * @brief Moves the blocks of one arena into another, so they live as long as it does.
+ * @param a The arena taking the blocks.
+ * @param from The arena giving them up.
+ */
+void arena_adopt(Arena *a, Arena *from) {
+    if (!a || !from) return;
+    if (from->head) {
+        // In front of the list: allocation only ever moves on from current, so the
+        // adopted blocks are never handed out again before a reset
+        ArenaBlock *last = from->head;
+        while (last->next) last = last->next;
+        last->next = a->head;
+        a->head = from->head;
+        if (!a->current) a->current = last;
+    }
+    from->head = NULL;
+    from->current = NULL;
+    if (from->interner.strings) {
+        free(from->interner.strings);
+        from->interner.strings = NULL;
+    }
+}
+
 /**
  * @brief Computes a FNV-1a hash for a byte buffer.
  * @param str The input buffer.
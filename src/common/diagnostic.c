@@ -117,13 +117,145 @@ int levenshtein_dist(const char *s1, const char *s2) {
     return matrix[len1][len2];
 }
 
+/**
+ * @brief Computes the Levenshtein distance between two strings, giving up early.
+ *
+ * Only two DP rows are kept, and the computation stops as soon as a whole row
+ * exceeds max_dist since the distance can only grow from there.
+ *
+ * @param s1 First string.
+ * @param s2 Second string.
+ * @param max_dist The largest distance of interest.
+ * @return The edit distance, or max_dist + 1 if it exceeds max_dist.
+ */
+int levenshtein_bounded(const char *s1, const char *s2, int max_dist) {
+    if (!s1 || !s2) return max_dist + 1;
+    int len1 = strlen(s1);
+    int len2 = strlen(s2);
+    if (len1 - len2 > max_dist || len2 - len1 > max_dist) return max_dist + 1;
+    if (len2 > len1) {
+        const char *ts = s1; s1 = s2; s2 = ts;
+        int tl = len1; len1 = len2; len2 = tl;
+    }
+
+    int rows[2][len2 + 1];
+    int *prev = rows[0];
+    int *cur = rows[1];
+    for (int j = 0; j <= len2; j++) prev[j] = j;
+
+    for (int i = 1; i <= len1; i++) {
+        cur[0] = i;
+        int row_min = i;
+        for (int j = 1; j <= len2; j++) {
+            int cost = (s1[i - 1] == s2[j - 1]) ? 0 : 1;
+            cur[j] = min3(prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + cost);
+            if (cur[j] < row_min) row_min = cur[j];
+        }
+        if (row_min > max_dist) return max_dist + 1;
+        int *t = prev; prev = cur; cur = t;
+    }
+    return prev[len2] > max_dist ? max_dist + 1 : prev[len2];
+}
+
+/**
+ * @brief Inserts a word into a BK-tree (duplicates are ignored).
+ * @param tree The tree.
+ * @param arena Arena for the node; the word is not copied.
+ * @param word The word.
+ */
+void bk_tree_insert(BKTree *tree, Arena *arena, const char *word) {
+    if (!word) return;
+    BKNode *node = arena_alloc_type(arena, BKNode);
+    memset(node, 0, sizeof(BKNode));
+    node->word = word;
+    node->order = tree->count;
+
+    if (!tree->root) {
+        tree->root = node;
+        tree->count++;
+        return;
+    }
+
+    int word_len = strlen(word);
+    BKNode *curr = tree->root;
+    while (1) {
+        int curr_len = strlen(curr->word);
+        int d = levenshtein_bounded(word, curr->word, word_len > curr_len ? word_len : curr_len);
+        if (d == 0) return;
+
+        BKNode *child = curr->children;
+        while (child && child->dist != d) child = child->sibling;
+        if (!child) {
+            node->dist = d;
+            node->sibling = curr->children;
+            curr->children = node;
+            if (d > curr->max_child) curr->max_child = d;
+            tree->count++;
+            return;
+        }
+        curr = child;
+    }
+}
+
+/**
+ * @brief Search state for bk_tree_closest.
+ */
+typedef struct BKSearch {
+    const char *word;
+    int max_dist;
+    const char *best;
+    int best_dist;
+    int best_order;
+} BKSearch;
+
+/**
+ * @brief Visits a BK-tree node, pruning children outside the search radius.
+ * @param node The node.
+ * @param st The search state.
+ */
+static void bk_tree_search(BKNode *node, BKSearch *st) {
+    int radius = st->best ? st->best_dist : st->max_dist;
+    // Beyond radius + max_child no child can fall inside the radius
+    int d = levenshtein_bounded(st->word, node->word, radius + node->max_child);
+
+    if (d < st->best_dist || (d == st->best_dist && node->order < st->best_order)) {
+        st->best = node->word;
+        st->best_dist = d;
+        st->best_order = node->order;
+        radius = d;
+    }
+
+    for (BKNode *child = node->children; child; child = child->sibling) {
+        if (child->dist >= d - radius && child->dist <= d + radius) {
+            bk_tree_search(child, st);
+            radius = st->best ? st->best_dist : st->max_dist;
+        }
+    }
+}
+
+/**
+ * @brief Finds the closest word in a BK-tree.
+ * @param tree The tree.
+ * @param word The word to match.
+ * @param max_dist The largest accepted distance.
+ * @param out_dist Optional output for the distance of the match.
+ * @return The closest word, or NULL.
+ */
+const char* bk_tree_closest(BKTree *tree, const char *word, int max_dist, int *out_dist) {
+    if (!tree || !tree->root || !word) return NULL;
+    BKSearch st = {word, max_dist, NULL, max_dist + 1, 0};
+    bk_tree_search(tree->root, &st);
+    if (out_dist) *out_dist = st.best_dist;
+    return st.best;
+}
+
 /**
  * @brief Finds the closest keyword to an identifier using Levenshtein distance.
  * @param ident The identifier to match.
  * @return The closest keyword, or NULL if none is within distance 3.
  */
 const char* find_closest_keyword(const char *ident) {
-    const char *keywords[] = {
+    static const char *keywords[] = {
         "int", "void", "char", "bool", "single", "double", "return",
         "if", "else", "while", "loop", "break", "continue", "class", "struct",
         "namespace", "import", "link", "extern", "define", "has", "is",
@@ -135,18 +267,16 @@ const char* find_closest_keyword(const char *ident) {
         "then",
         NULL
     };
+    static Arena keyword_arena;
+    static BKTree keyword_tree;
 
-    const char *best = NULL;
-    int min_dist = 100;
-
-    for (int i = 0; keywords[i] != NULL; i++) {
-        int d = levenshtein_dist(ident, keywords[i]);
-        if (d < min_dist && d < 3) {
-            min_dist = d;
-            best = keywords[i];
+    if (!keyword_tree.root) {
+        arena_init(&keyword_arena);
+        for (int i = 0; keywords[i] != NULL; i++) {
+            bk_tree_insert(&keyword_tree, &keyword_arena, keywords[i]);
         }
     }
-    return best;
+    return bk_tree_closest(&keyword_tree, ident, 2, NULL);
 }
 
 static void print_source_snippet(Lexer *l, Token t) {
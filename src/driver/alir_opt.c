@@ -0,0 +1,220 @@
+/**
+ * @file alir_opt.c
+ * @brief Standalone ALIR optimizer: runs optlir pipelines on a .balir module.
+ *
+ * The module is loaded from a file written by `alkyl --emit-balir`, so the
+ * optimizer can be timed and checked without the front end.
+ */
+#include "alir/alir.h"
+#include "alir/emitter.h"
+#include "alick/alick.h"
+#include "optlir/optlir.h"
+#include "optlir/pass.h"
+#include "common/arena.h"
+#include "common/context.h"
+#include "common/common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Returns a monotonic-enough wall clock reading.
+ * @return Nanoseconds.
+ */
+static long long opt_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Prints the command line usage.
+ * @param prog The program name.
+ */
+static void opt_usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s <in.balir> [-O1|-O2|-O3] [--passes=<list>] [--runs <n>]\n"
+            "       [-j <threads>] [--eval-steps <n>] [--eval-memory <bytes>]\n"
+            "       [-o <out.balir>] [--emit-alir <out.alir>] [--opt-stats] [--pack-check]\n"
+            "       [--list-passes]\n",
+            prog);
+}
+
+/**
+ * @brief Emits a module as text ALIR into a string.
+ * @param module The module.
+ * @return The text (malloc'd), or NULL.
+ */
+static char* opt_emit_string(AlirModule *module) {
+    FILE *f = tmpfile();
+    if (!f) return NULL;
+    alir_emit_stream(module, f);
+    long len = ftell(f);
+    char *text = len >= 0 ? malloc(len + 1) : NULL;
+    if (text) {
+        rewind(f);
+        text[fread(text, 1, len, f)] = '\0';
+    }
+    fclose(f);
+    return text;
+}
+
+/**
+ * @brief Packs and unpacks every function, checking that the text ALIR is unchanged.
+ * @param module The module; its functions are replaced by the unpacked form.
+ * @param input The .balir file, for diagnostics.
+ * @return 0 on success, otherwise the line of the failure.
+ */
+static int opt_pack_roundtrip(AlirModule *module, const char *input) {
+    char *before = opt_emit_string(module);
+    for (AlirFunction *func = module->functions; func; func = func->next) {
+        alir_unpack_function(module, alir_pack_function(module, func));
+        alir_build_uses(module, func);
+    }
+    char *after = opt_emit_string(module);
+
+    int ret = 0;
+    if (!before || !after || strcmp(before, after) != 0) {
+        fprintf(stderr, "alir-opt: %s changes when packed and unpacked\n", input);
+        ret = __LINE__;
+    } else if (alick_check_module(module) > 0) {
+        fprintf(stderr, "alir-opt: %s fails alick after packing and unpacking\n", input);
+        ret = __LINE__;
+    }
+    free(before);
+    free(after);
+    return ret;
+}
+
+/**
+ * @brief Loads a module, optimizes it once and checks the result.
+ * @param input The .balir file.
+ * @param opt_level The optimization level.
+ * @param pipeline The passes to run.
+ * @param out Path for the optimized .balir, or NULL.
+ * @param out_alir Path for the optimized text ALIR, or NULL.
+ * @param pack_check Whether to round-trip the optimized module through the packed form.
+ * @param nanos Receives the time spent in the pipeline.
+ * @return 0 on success, otherwise the line of the failure.
+ */
+static int opt_run_once(const char *input, int opt_level, const char *pipeline,
+                        const char *out, const char *out_alir, int pack_check, long long *nanos) {
+    Arena arena;
+    CompilerContext ctx;
+    arena_init(&arena);
+    context_init(&ctx, &arena);
+
+    int ret = 0;
+    AlirModule *module = alir_read_binary(&ctx, input);
+    if (!module) {
+        fprintf(stderr, "alir-opt: %s is not a readable .balir module\n", input);
+        ret = __LINE__;
+    } else if (alick_check_module(module) > 0) {
+        fprintf(stderr, "alir-opt: %s fails alick before optimization\n", input);
+        ret = __LINE__;
+    }
+
+    if (!ret) {
+        long long start = opt_now();
+        optlir_run_pipeline(module, opt_level, pipeline);
+        *nanos = opt_now() - start;
+
+        if (alick_check_module(module) > 0) {
+            fprintf(stderr, "alir-opt: %s fails alick after optimization\n", input);
+            ret = __LINE__;
+        }
+    }
+
+    if (!ret && pack_check) ret = opt_pack_roundtrip(module, input);
+    if (!ret && out && alir_write_binary(module, out) != 0) {
+        fprintf(stderr, "alir-opt: cannot write %s\n", out);
+        ret = __LINE__;
+    }
+    if (!ret && out_alir) alir_emit_to_file(module, out_alir);
+
+    arena_free(&arena);
+    return ret;
+}
+
+/**
+ * @brief Entry point of alir-opt.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return Exit code.
+ */
+int main(int argc, char **argv) {
+    const char *input = NULL;
+    const char *output = NULL;
+    const char *output_alir = NULL;
+    const char *passes = NULL;
+    int opt_level = 2;
+    int runs = 1;
+    int opt_stats = 0;
+    int pack_check = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (streq_lit(argv[i], "-O1")) {
+            opt_level = 1;
+        } else if (streq_lit(argv[i], "-O2") || streq_lit(argv[i], "--opt")) {
+            opt_level = 2;
+        } else if (streq_lit(argv[i], "-O3")) {
+            opt_level = 3;
+        } else if (strncmp(argv[i], "--passes=", 9) == 0) {
+            passes = argv[i] + 9;
+            if (!optlir_pipeline_valid(passes, stderr)) return __LINE__;
+        } else if (streq_lit(argv[i], "--runs") && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+            if (runs < 1) runs = 1;
+        } else if (streq_lit(argv[i], "-j") && i + 1 < argc) {
+            optlir_set_jobs(atoi(argv[++i]));
+        } else if (streq_lit(argv[i], "--eval-steps") && i + 1 < argc) {
+            optlir_pure_set_budget(atol(argv[++i]), 0);
+        } else if (streq_lit(argv[i], "--eval-memory") && i + 1 < argc) {
+            optlir_pure_set_budget(0, atol(argv[++i]));
+        } else if (streq_lit(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (streq_lit(argv[i], "--emit-alir") && i + 1 < argc) {
+            output_alir = argv[++i];
+        } else if (streq_lit(argv[i], "--opt-stats")) {
+            opt_stats = 1;
+        } else if (streq_lit(argv[i], "--pack-check")) {
+            pack_check = 1;
+        } else if (streq_lit(argv[i], "--list-passes")) {
+            printf("-O1: %s\n-O2: %s\n-O3: %s\n", optlir_default_pipeline(1),
+                   optlir_default_pipeline(2), optlir_default_pipeline(3));
+            return 0;
+        } else if (argv[i][0] == '-') {
+            opt_usage(argv[0]);
+            return __LINE__;
+        } else {
+            input = argv[i];
+        }
+    }
+
+    if (!input) {
+        opt_usage(argv[0]);
+        return __LINE__;
+    }
+
+    const char *pipeline = passes ? passes : optlir_default_pipeline(opt_level);
+    long long total = 0, best = 0, worst = 0;
+
+    // Every run starts from a freshly loaded module; only the last one is written
+    for (int run = 0; run < runs; run++) {
+        long long nanos = 0;
+        int last = run == runs - 1;
+        int ret = opt_run_once(input, opt_level, pipeline, last ? output : NULL,
+                               last ? output_alir : NULL, pack_check, &nanos);
+        if (ret) return ret;
+        total += nanos;
+        if (!run || nanos < best) best = nanos;
+        if (nanos > worst) worst = nanos;
+    }
+
+    printf("alir-opt: %s -O%d %d run%s min %.3f ms mean %.3f ms max %.3f ms\n",
+           input, opt_level, runs, runs == 1 ? "" : "s",
+           best / 1e6, total / 1e6 / runs, worst / 1e6);
+    if (opt_stats) optlir_print_stats(stderr);
+    return 0;
+}
@@ -83,13 +83,15 @@ static void display_init(void) {
 
 /**
  * @brief Runs the interactive REPL (read-eval-print loop).
+ * @param trace_incremental Print which declarations each line reuses, checks or drops.
  * @return 0 on normal exit.
  */
-int run_repl(void) {
+int run_repl(int trace_incremental) {
     display_init();
 
     SemanticSettings sem_settings = default_sem_settings();
     sem_settings.namespace_ausearch_warning = false;
+    sem_settings.incremental_trace = trace_incremental;
     MetalirRunner *r = metalir_runner_create("ethyl_repl", &sem_settings, 0);
 
     metalir_load_module(r, "std/ethyl");
@@ -121,6 +123,7 @@ int run_repl(void) {
         r->sem.current_filename = "ethyl_repl";
 
         metalir_resolve_imports(r, &root);
+        sem_incremental_prepare(&r->sem, &root);
 
         int sem_errs = sem_check_program(&r->sem, root);
         if (sem_errs > 0) {
@@ -392,7 +395,10 @@ int import_module(const char *module_name) {
  */
 int main(int argc, char *argv[]) {
     if (argc == 1) {
-        return run_repl();
+        return run_repl(0);
+    }
+    if (argc == 2 && streq_lit(argv[1], "--trace-incremental")) {
+        return run_repl(1);
     }
 
     for (int i = 1; i < argc; i++) {
@@ -422,6 +428,6 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    fprintf(stderr, "Usage: %s [file.kyl|file.zyl] | -m <module> | --module <module>\n", argv[0]);
+    fprintf(stderr, "Usage: %s [file.kyl|file.zyl] | -m <module> | --module <module> | --trace-incremental\n", argv[0]);
     return 1;
 }
@@ -13,6 +13,7 @@
 #include "optlir/optlir.h"
 #include "optlir/unused.h"
 #include "optlir/local.h"
+#include "optlir/pass.h"
 #include "common/linker.h"
 #include "common/debug.h"
 #include "parser/c_parser.h"
@@ -90,7 +91,9 @@ int main(int argc, char **argv) {
     int emit_alir = 0;
     int emit_balir = 0;
     int emit_ast = 0;
+    int opt_stats = 0;
     int optimization_level = 0;
+    const char *optlir_passes = NULL;
     char link_flags[1024] = {0};
     char custom_output_basename[256] = {0};
     LinkerType current_linker = LINKER_GCC;
@@ -130,6 +133,17 @@ int main(int argc, char **argv) {
             emit_balir = 1;
         } else if (streq_lit(argv[i], "--emit-ast")) {
             emit_ast = 1;
+        } else if (streq_lit(argv[i], "--opt-stats")) {
+            opt_stats = 1;
+        } else if (strncmp(argv[i], "--optlir-passes=", 16) == 0) {
+            optlir_passes = argv[i] + 16;
+            if (!optlir_pipeline_valid(optlir_passes, stderr)) return __LINE__;
+        } else if (strncmp(argv[i], "--optlir-jobs=", 14) == 0) {
+            optlir_set_jobs(atoi(argv[i] + 14));
+        } else if (strncmp(argv[i], "--optlir-eval-steps=", 20) == 0) {
+            optlir_pure_set_budget(atol(argv[i] + 20), 0);
+        } else if (strncmp(argv[i], "--optlir-eval-memory=", 21) == 0) {
+            optlir_pure_set_budget(0, atol(argv[i] + 21));
         } else if (streq_lit(argv[i], "--allow-vector-init")) {
             parser_settings.allow_vector_initialization = 1;
         } else if (streq_lit(argv[i], "-c")) {
@@ -175,6 +189,8 @@ int main(int argc, char **argv) {
             filename = argv[i];
         }
     }
+    // A custom pipeline is only run by the optimizing build
+    if (optlir_passes && optimization_level == 0) optimization_level = 2;
 
     Arena arena;
     CompilerContext comp_ctx;
@@ -345,12 +361,9 @@ int main(int argc, char **argv) {
     debug_step("Finished alir check and analysis. Start alir optimization.");
 
     if (optimization_level > 0) {
-        optlir_remove_unused(alir_module);
-
-        optlir_optimize(alir_module, optimization_level);
-
-        // is this necessary tho?
-        optlir_remove_unused(alir_module);
+        if (optlir_passes) optlir_run_pipeline(alir_module, optimization_level, optlir_passes);
+        else optlir_optimize(alir_module, optimization_level);
+        if (opt_stats) optlir_print_stats(stderr);
 
         int alick_error_post = alick_check_module(alir_module);
         if (alick_error_post > 0) {
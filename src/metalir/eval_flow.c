@@ -4,6 +4,33 @@
  */
 #include "vm_internal.h"
 
+/**
+ * @brief Returns the case table of a switch, building it on first use.
+ *
+ * Dispatch is then one hash lookup however many cases the switch has.
+ *
+ * @param vm The MetalirVM instance.
+ * @param inst The SWITCH instruction.
+ * @return Map from "%lld" of a case value to its target block.
+ */
+static HashMap* vm_switch_table(MetalirVM *vm, AlirInst *inst) {
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)inst);
+    HashMap *table = hashmap_get(&vm->switch_tables, key);
+    if (table) return table;
+
+    int cases = alir_switch_case_count(inst);
+    table = arena_alloc(vm->arena, sizeof(HashMap));
+    hashmap_init(table, vm->arena, cases > 8 ? cases * 2 : 16);
+    for (int k = 0; k < cases; k++) {
+        char value[32];
+        snprintf(value, sizeof(value), "%lld", (long long)alir_switch_case_value(inst, k));
+        hashmap_put(table, value, inst->args[2 * k + 1]->block);
+    }
+    hashmap_put(&vm->switch_tables, key, table);
+    return table;
+}
+
 /**
  * @brief Evaluate a flow-control instruction in the MetalirVM.
  * @param ctx The VM execution context.
@@ -13,7 +40,7 @@ void vm_eval_flow(VMContext *ctx, AlirInst *inst) {
     switch(inst->op) {
 case ALIR_OP_JUMP: {
                     if (inst->op1 && inst->op1->kind == ALIR_VAL_LABEL) {
-                        (*ctx->next_block) = find_block(ctx->func, inst->op1->val.str_val);
+                        (*ctx->next_block) = inst->op1->block;
                     }
                      break;
                  }
@@ -25,14 +52,27 @@ case ALIR_OP_CONDI: {
                     
                     if (cond) {
                         if (inst->op2 && inst->op2->kind == ALIR_VAL_LABEL) 
-                            (*ctx->next_block) = find_block(ctx->func, inst->op2->val.str_val);
+                            (*ctx->next_block) = inst->op2->block;
                     } else {
                         if (inst->arg_count > 0 && inst->args[0]->kind == ALIR_VAL_LABEL)
-                            (*ctx->next_block) = find_block(ctx->func, inst->args[0]->val.str_val);
+                            (*ctx->next_block) = inst->args[0]->block;
                     }
                     break;
                 }
                     break;
+case ALIR_OP_SWITCH: {
+                    long long cond = 0;
+                    if (inst->op1->kind == ALIR_VAL_TEMP) cond = ctx->registers[inst->op1->temp_id].as.int_val;
+                    else if (inst->op1->kind == ALIR_VAL_CONST) cond = inst->op1->val.long_long_val;
+                    else if (inst->op1->kind == ALIR_VAL_VAR) cond = metalir_vm_resolve_var(inst->op1, ctx->module, ctx->vm, ctx->args, ctx->arg_count);
+
+                    char key[32];
+                    snprintf(key, sizeof(key), "%lld", cond);
+                    AlirBlock *target = hashmap_get(vm_switch_table(ctx->vm, inst), key);
+                    if (!target && inst->op2) target = inst->op2->block;
+                    (*ctx->next_block) = target;
+                    break;
+                }
 case ALIR_OP_RET: {
                     if (inst->op1) {
                         if (inst->op1->kind == ALIR_VAL_TEMP) { 
@@ -47,6 +47,7 @@ MetalirRunner* metalir_runner_create(const char *module_name,
     SemanticSettings ss = {0};
     if (sem_settings) memcpy(&ss, sem_settings, sizeof(SemanticSettings));
     sem_init(&r->sem, &r->ctx, &ss);
+    r->sem.incremental = 1;
     r->module = alir_create_module(&r->ctx, module_name);
     r->sem.current_source = "";
     r->sem.current_filename = module_name;
@@ -514,6 +515,7 @@ long long metalir_execute_parse(MetalirRunner *r, ASTNode *root,
                                 const char *source, const char *filename) {
     r->sem.current_source = source;
     r->sem.current_filename = filename;
+    sem_incremental_prepare(&r->sem, &root);
     int errs = sem_check_program(&r->sem, root);
     if (errs > 0) {
         r->ctx.semantic_error_count = 0;
@@ -30,6 +30,7 @@ MetalirVM* metalir_vm_init(Arena *arena) {
     vm->registers = arena_alloc(arena, MAX_VM_STACK * sizeof(VMValue));
     vm->globals = NULL;
     vm->status = 0;
+    hashmap_init(&vm->switch_tables, arena, 16);
     return vm;
 }
 
@@ -41,21 +42,6 @@ void metalir_vm_free(MetalirVM *vm) {
     (void)vm;
 }
 
-/**
- * @brief Find a block in a function by its label.
- * @param func The ALIR function.
- * @param label The block label to find.
- * @return The block, or NULL if not found.
- */
-AlirBlock* find_block(AlirFunction *func, const char *label) {
-    AlirBlock *curr = func->blocks;
-    while(curr) {
-        if (curr->label && streq_lit(curr->label, label)) return curr;
-        curr = curr->next;
-    }
-    return NULL;
-}
-
 /**
  * @brief Resolve an ALIR value to a concrete long long at runtime.
  * @param val The ALIR value to resolve.
@@ -108,6 +94,65 @@ long long metalir_vm_resolve_var(AlirValue *val, AlirModule *module, MetalirVM *
     return 0;
 }
 
+/**
+ * @brief Reads the value a phi takes from an incoming operand.
+ * @param vm The VM instance.
+ * @param module The ALIR module.
+ * @param v The incoming operand.
+ * @param registers The register file of the running function.
+ * @param args Function call arguments.
+ * @param arg_count Number of arguments.
+ * @return The operand value.
+ */
+static VMValue vm_phi_read(MetalirVM *vm, AlirModule *module, AlirValue *v, VMValue *registers, long long *args, int arg_count) {
+    VMValue out = {0};
+    if (!v) return out;
+    if (v->kind == ALIR_VAL_TEMP) return registers[v->temp_id];
+    if (v->kind == ALIR_VAL_CONST) {
+        if (v->type.base == TYPE_DOUBLE && v->type.ptr_depth == 0) out.as.single_val = v->val.double_val;
+        else if (v->type.base == TYPE_SINGLE && v->type.ptr_depth == 0) out.as.single_val = v->val.single_val;
+        else out.as.int_val = v->val.long_long_val;
+    } else if (v->kind == ALIR_VAL_VAR) {
+        out.as.int_val = metalir_vm_resolve_var(v, module, vm, args, arg_count);
+    }
+    return out;
+}
+
+/**
+ * @brief Enters a block, evaluating its phis for the edge taken.
+ *
+ * All phis of a block read before any of them writes, so a phi reading
+ * another phi of the same block sees the value from the predecessor.
+ *
+ * @param vm The VM instance.
+ * @param module The ALIR module.
+ * @param block The block being entered.
+ * @param pred The block control came from, or NULL at function entry.
+ * @param registers The register file of the running function.
+ * @param args Function call arguments.
+ * @param arg_count Number of arguments.
+ * @return The first instruction after the phis.
+ */
+static AlirInst* vm_enter_block(MetalirVM *vm, AlirModule *module, AlirBlock *block, AlirBlock *pred, VMValue *registers, long long *args, int arg_count) {
+    int count = 0;
+    AlirInst *inst = block->head;
+    for (; inst && inst->op == ALIR_OP_PHI; inst = inst->next) count++;
+    if (count == 0 || !pred) return inst;
+
+    VMValue *incoming = malloc(sizeof(VMValue) * count);
+    int n = 0;
+    for (AlirInst *phi = block->head; phi != inst; phi = phi->next) {
+        incoming[n++] = vm_phi_read(vm, module, alir_phi_incoming(phi, pred), registers, args, arg_count);
+    }
+    n = 0;
+    for (AlirInst *phi = block->head; phi != inst; phi = phi->next) {
+        if (phi->dest && phi->dest->kind == ALIR_VAL_TEMP) registers[phi->dest->temp_id] = incoming[n];
+        n++;
+    }
+    free(incoming);
+    return inst;
+}
+
 /**
  * @brief Execute an ALIR function in the MetalirVM.
  * @param vm The MetalirVM instance.
@@ -137,6 +182,9 @@ long long metalir_vm_execute(MetalirVM *vm, AlirModule *module, AlirFunction *fu
             if (i->dest && i->dest->kind == ALIR_VAL_TEMP && i->dest->temp_id >= max_temp_id) max_temp_id = i->dest->temp_id + 1;
             if (i->op1 && i->op1->kind == ALIR_VAL_TEMP && i->op1->temp_id >= max_temp_id) max_temp_id = i->op1->temp_id + 1;
             if (i->op2 && i->op2->kind == ALIR_VAL_TEMP && i->op2->temp_id >= max_temp_id) max_temp_id = i->op2->temp_id + 1;
+            for (int k = 0; i->op == ALIR_OP_PHI && k < i->arg_count; k++) {
+                if (i->args[k] && i->args[k]->kind == ALIR_VAL_TEMP && i->args[k]->temp_id >= max_temp_id) max_temp_id = i->args[k]->temp_id + 1;
+            }
         }
     }
 
@@ -148,10 +196,11 @@ long long metalir_vm_execute(MetalirVM *vm, AlirModule *module, AlirFunction *fu
     long long ret_val = 0;
     vm->status = 0;
 
+    AlirBlock *prev_block = NULL;
     AlirBlock *curr_block = func->blocks;
     while (curr_block) {
         AlirBlock *next_block = curr_block->next;
-        AlirInst *inst = curr_block->head;
+        AlirInst *inst = vm_enter_block(vm, module, curr_block, prev_block, registers, args, arg_count);
         while (inst) {
 
             VMContext ctx = {
@@ -201,6 +250,7 @@ long long metalir_vm_execute(MetalirVM *vm, AlirModule *module, AlirFunction *fu
                     break;
                 case ALIR_OP_JUMP:
                 case ALIR_OP_CONDI:
+                case ALIR_OP_SWITCH:
                 case ALIR_OP_RET:
                     vm_eval_flow(&ctx, inst);
                     break;
@@ -247,6 +297,7 @@ long long metalir_vm_execute(MetalirVM *vm, AlirModule *module, AlirFunction *fu
 
             inst = inst->next;
         }
+        prev_block = curr_block;
         curr_block = next_block;
     }
     ret_val = vm->status;
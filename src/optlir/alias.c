@@ -0,0 +1,110 @@
+/**
+ * @file alias.c
+ * @brief Alias classes of the memory an ALIR function touches.
+ */
+#include "optlir/alias.h"
+#include "common/arena.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Computes the alias classes of a function.
+ * @param module The ALIR module.
+ * @param func The function (def-use chains valid).
+ * @param alias Receives the classes.
+ */
+void optlir_alias_build(AlirModule *module, AlirFunction *func, OptlirAlias *alias) {
+    Arena *arena = alir_arena(module);
+    hashmap_init(&alias->classes, arena, 32);
+    alias->count = 1;
+
+    int capacity = 16;
+    AlirValue **addrs = alir_alloc(module, sizeof(AlirValue*) * capacity);
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->op != ALIR_OP_ALLOCA || !i->dest) continue;
+
+            int count = 0, local = 1;
+            addrs[count++] = i->dest;
+            for (int k = 0; k < count && local; k++) {
+                for (AlirUse *u = addrs[k]->uses; u; u = u->next) {
+                    AlirInst *user = u->user;
+                    if (user->op == ALIR_OP_LOAD && u->slot == &user->op1) continue;
+                    if (user->op == ALIR_OP_STORE && u->slot == &user->op2) continue;
+                    if (user->op == ALIR_OP_GET_PTR && u->slot == &user->op1 && user->dest) {
+                        if (count == capacity) {
+                            AlirValue **grown = alir_alloc(module, sizeof(AlirValue*) * capacity * 2);
+                            memcpy(grown, addrs, sizeof(AlirValue*) * count);
+                            addrs = grown;
+                            capacity *= 2;
+                        }
+                        addrs[count++] = user->dest;
+                        continue;
+                    }
+                    local = 0;
+                    break;
+                }
+            }
+            if (!local) continue;
+
+            int c = alias->count++;
+            char key[32];
+            for (int k = 0; k < count; k++) {
+                snprintf(key, sizeof(key), "%p", (void*)addrs[k]);
+                hashmap_put(&alias->classes, key, (void*)(uintptr_t)c);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the alias class of an address.
+ * @param alias The alias classes.
+ * @param addr The address.
+ * @return The class of its stack slot, or 0 for memory reachable from elsewhere.
+ */
+int optlir_alias_class(OptlirAlias *alias, AlirValue *addr) {
+    if (!addr || addr->kind != ALIR_VAL_TEMP) return 0;
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)addr);
+    return (int)(uintptr_t)hashmap_get(&alias->classes, key);
+}
+
+/**
+ * @brief Whether a value may be an address.
+ * @param v The value.
+ * @return Non-zero for pointers, aggregates and stack slots.
+ */
+static int alias_may_point(AlirValue *v) {
+    if (!v) return 0;
+    VarType t = v->type;
+    if (t.ptr_depth > 0 || t.array_depth > 0 || t.base == TYPE_CLASS || t.base == TYPE_ARRAY) return 1;
+    // A slot is typed after what it holds
+    return v->def && (v->def->op == ALIR_OP_ALLOCA || v->def->op == ALIR_OP_GET_PTR);
+}
+
+/**
+ * @brief Returns the function a call reaches directly, if it is pure on values.
+ * @param module The ALIR module.
+ * @param call The call instruction.
+ * @return The callee, or NULL for impure, indirect and address-taking calls.
+ */
+AlirFunction* optlir_alias_pure_callee(AlirModule *module, AlirInst *call) {
+    AlirValue *f = call->op1;
+    if (!f || (f->kind != ALIR_VAL_VAR && f->kind != ALIR_VAL_GLOBAL) || !f->val.str_val) return NULL;
+    AlirFunction *callee = hashmap_get(&module->func_map, f->val.str_val);
+    if (!callee || !callee->is_pure || callee->is_extern) return NULL;
+    for (int k = 0; k < call->arg_count; k++) {
+        if (alias_may_point(call->args[k])) return NULL;
+    }
+    return callee;
+}
+
+/**
+ * @brief Releases the classes when they were not allocated from an arena.
+ * @param alias The alias classes.
+ */
+void optlir_alias_free(OptlirAlias *alias) {
+    hashmap_free(&alias->classes);
+}
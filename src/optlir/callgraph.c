@@ -0,0 +1,279 @@
+/**
+ * @file callgraph.c
+ * @brief Call and reference graph of an ALIR module.
+ *
+ * Every function, global and struct gets one node, found through a name
+ * table, so an edge is resolved once when the graph is built and
+ * liveness is one worklist walk from the roots.
+ */
+#include "optlir/callgraph.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Whether a variable name is a parameter ("p<k>").
+ * @param name The name of a variable value.
+ * @return Non-zero for parameter names.
+ */
+static int cg_is_param(const char *name) {
+    if (name[0] != 'p' || !name[1]) return 0;
+    for (const char *c = name + 1; *c; c++) {
+        if (!isdigit((unsigned char)*c)) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Appends a node index to a growing edge list.
+ * @param module The ALIR module owning the storage.
+ * @param list The edge list.
+ * @param count Its length.
+ * @param cap Its capacity.
+ * @param to The node index to append.
+ */
+static void cg_push(AlirModule *module, int **list, int *count, int *cap, int to) {
+    if (*count >= *cap) {
+        int new_cap = *cap ? *cap * 2 : 4;
+        int *grown = alir_alloc(module, sizeof(int) * new_cap);
+        if (*count) memcpy(grown, *list, sizeof(int) * *count);
+        *list = grown;
+        *cap = new_cap;
+    }
+    (*list)[(*count)++] = to;
+}
+
+/**
+ * @brief Adds a node for a symbol unless the name already has one.
+ * @param cg The call graph.
+ * @param kind What the symbol is.
+ * @param name The symbol name.
+ * @return The node index.
+ */
+static int cg_add_node(OptlirCallGraph *cg, OptlirCgKind kind, const char *name) {
+    HashMap *names = kind == OPTLIR_CG_STRUCT ? &cg->structs : &cg->index;
+    int n = (int)(uintptr_t)hashmap_get(names, name) - 1;
+    if (n >= 0) return n;
+    n = cg->count++;
+    OptlirCgNode *node = &cg->nodes[n];
+    node->kind = kind;
+    node->name = name;
+    node->next_suffix = -1;
+    hashmap_put(names, name, (void*)(uintptr_t)(n + 1));
+    return n;
+}
+
+/**
+ * @brief Adds a reference edge, once per pair of nodes.
+ * @param cg The call graph.
+ * @param seen Per-node stamp of the last source that referenced it.
+ * @param from The source node.
+ * @param to The referenced node.
+ */
+static void cg_ref(OptlirCallGraph *cg, int *seen, int from, int to) {
+    if (to < 0 || to == from || seen[to] == from + 1) return;
+    seen[to] = from + 1;
+    OptlirCgNode *node = &cg->nodes[from];
+    cg_push(cg->module, &node->refs, &node->ref_count, &node->ref_cap, to);
+}
+
+/**
+ * @brief Adds reference edges to the structs a type names.
+ *
+ * A class name matches the struct of that name and every struct whose name
+ * ends in ".<class name>".
+ *
+ * @param cg The call graph.
+ * @param seen Per-node reference stamps.
+ * @param from The source node.
+ * @param type The type.
+ */
+static void cg_type_ref(OptlirCallGraph *cg, int *seen, int from, VarType *type) {
+    if (!type || type->base != TYPE_CLASS || !type->class_name) return;
+    cg_ref(cg, seen, from, optlir_callgraph_find_struct(cg, type->class_name));
+    int s = (int)(uintptr_t)hashmap_get(&cg->suffixes, type->class_name) - 1;
+    for (; s >= 0; s = cg->nodes[s].next_suffix) cg_ref(cg, seen, from, s);
+}
+
+/**
+ * @brief Adds the edge for a value naming a symbol.
+ * @param cg The call graph.
+ * @param seen Per-node reference stamps.
+ * @param from The source node.
+ * @param v The value.
+ */
+static void cg_value_ref(OptlirCallGraph *cg, int *seen, int from, AlirValue *v) {
+    if (!v) return;
+    cg_type_ref(cg, seen, from, &v->type);
+    if ((v->kind != ALIR_VAL_VAR && v->kind != ALIR_VAL_GLOBAL) || !v->val.str_val) return;
+    if (v->kind == ALIR_VAL_VAR && cg_is_param(v->val.str_val)) return;
+    cg_ref(cg, seen, from, optlir_callgraph_find(cg, v->val.str_val));
+}
+
+/**
+ * @brief Collects the call and reference edges of a function.
+ * @param cg The call graph.
+ * @param seen Per-node reference stamps.
+ * @param n The function node.
+ */
+static void cg_scan_function(OptlirCallGraph *cg, int *seen, int n) {
+    AlirFunction *f = cg->nodes[n].func;
+    cg_type_ref(cg, seen, n, &f->ret_type);
+    for (AlirParam *p = f->params; p; p = p->next) cg_type_ref(cg, seen, n, &p->type);
+
+    for (AlirBlock *b = f->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->dest) cg_type_ref(cg, seen, n, &i->dest->type);
+            int callee = i->op == ALIR_OP_CALL ? optlir_callgraph_callee(cg, i) : -1;
+            if (callee >= 0) {
+                OptlirCgNode *node = &cg->nodes[n];
+                cg_push(cg->module, &node->calls, &node->call_count, &node->call_cap, callee);
+                cg->nodes[callee].callers++;
+                cg_type_ref(cg, seen, n, &i->op1->type);
+            } else {
+                cg_value_ref(cg, seen, n, i->op1);
+            }
+            cg_value_ref(cg, seen, n, i->op2);
+            for (int k = 0; k < i->arg_count; k++) cg_value_ref(cg, seen, n, i->args[k]);
+        }
+    }
+
+    if (f->is_flux) {
+        char resume_name[512];
+        snprintf(resume_name, sizeof(resume_name), "%s_Resume", f->name);
+        cg_ref(cg, seen, n, optlir_callgraph_find(cg, resume_name));
+    }
+}
+
+/**
+ * @brief Builds the call and reference graph of a module.
+ * @param module The ALIR module.
+ * @param cg Receives the graph.
+ */
+void optlir_callgraph_build(AlirModule *module, OptlirCallGraph *cg) {
+    Arena *arena = alir_arena(module);
+    memset(cg, 0, sizeof(*cg));
+    cg->module = module;
+
+    int total = 0;
+    for (AlirFunction *f = module->functions; f; f = f->next) total++;
+    for (AlirGlobal *g = module->globals; g; g = g->next) total++;
+    for (AlirStruct *st = module->structs; st; st = st->next) total++;
+    cg->nodes = alir_alloc(module, sizeof(OptlirCgNode) * (total ? total : 1));
+    hashmap_init(&cg->index, arena, total > 16 ? total * 2 : 32);
+    hashmap_init(&cg->structs, arena, 32);
+    hashmap_init(&cg->suffixes, arena, 32);
+
+    for (AlirFunction *f = module->functions; f; f = f->next) {
+        int n = cg_add_node(cg, OPTLIR_CG_FUNCTION, f->name);
+        if (cg->nodes[n].kind == OPTLIR_CG_FUNCTION && !cg->nodes[n].func) cg->nodes[n].func = f;
+    }
+    cg->func_count = cg->count;
+    for (AlirGlobal *g = module->globals; g; g = g->next) {
+        int n = cg_add_node(cg, OPTLIR_CG_GLOBAL, g->name);
+        if (cg->nodes[n].kind == OPTLIR_CG_GLOBAL) cg->nodes[n].global = g;
+    }
+    for (AlirStruct *st = module->structs; st; st = st->next) {
+        int n = cg_add_node(cg, OPTLIR_CG_STRUCT, st->name);
+        if (cg->nodes[n].type) continue;
+        cg->nodes[n].type = st;
+        const char *dot = strrchr(st->name, '.');
+        if (!dot) continue;
+        cg->nodes[n].next_suffix = (int)(uintptr_t)hashmap_get(&cg->suffixes, dot + 1) - 1;
+        hashmap_put(&cg->suffixes, dot + 1, (void*)(uintptr_t)(n + 1));
+    }
+
+    int *seen = alir_alloc(module, sizeof(int) * (cg->count ? cg->count : 1));
+    for (int n = 0; n < cg->count; n++) {
+        OptlirCgNode *node = &cg->nodes[n];
+        if (node->func) {
+            cg_scan_function(cg, seen, n);
+        } else if (node->global) {
+            cg_type_ref(cg, seen, n, &node->global->type);
+        } else if (node->type) {
+            for (AlirField *field = node->type->fields; field; field = field->next) {
+                cg_type_ref(cg, seen, n, &field->type);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the node of a function or global.
+ * @param cg The call graph.
+ * @param name The symbol name.
+ * @return The node index, or -1 when the module does not define the name.
+ */
+int optlir_callgraph_find(OptlirCallGraph *cg, const char *name) {
+    if (!name) return -1;
+    return (int)(uintptr_t)hashmap_get(&cg->index, name) - 1;
+}
+
+/**
+ * @brief Returns the node of a struct type.
+ * @param cg The call graph.
+ * @param name The struct name.
+ * @return The node index, or -1 when the module has no such struct.
+ */
+int optlir_callgraph_find_struct(OptlirCallGraph *cg, const char *name) {
+    if (!name) return -1;
+    return (int)(uintptr_t)hashmap_get(&cg->structs, name) - 1;
+}
+
+/**
+ * @brief Returns the function a call reaches directly.
+ * @param cg The call graph.
+ * @param call The call instruction.
+ * @return The callee node index, or -1 for indirect and unknown callees.
+ */
+int optlir_callgraph_callee(OptlirCallGraph *cg, AlirInst *call) {
+    AlirValue *f = call->op1;
+    if (!f || (f->kind != ALIR_VAL_VAR && f->kind != ALIR_VAL_GLOBAL) || !f->val.str_val) return -1;
+    if (f->kind == ALIR_VAL_VAR && cg_is_param(f->val.str_val)) return -1;
+    int n = optlir_callgraph_find(cg, f->val.str_val);
+    return n >= 0 && cg->nodes[n].kind == OPTLIR_CG_FUNCTION ? n : -1;
+}
+
+/**
+ * @brief Marks every symbol reachable from the program roots as live.
+ * @param cg The call graph.
+ * @return Number of live nodes.
+ */
+int optlir_callgraph_mark_live(OptlirCallGraph *cg) {
+    int *work = alir_alloc(cg->module, sizeof(int) * (cg->count ? cg->count : 1));
+    int top = 0, live = 0;
+    for (int n = 0; n < cg->count; n++) cg->nodes[n].live = 0;
+
+    int root = optlir_callgraph_find(cg, "main");
+    if (root >= 0) {
+        cg->nodes[root].live = 1;
+        work[top++] = root;
+    }
+
+    while (top > 0) {
+        OptlirCgNode *node = &cg->nodes[work[--top]];
+        live++;
+        for (int e = 0; e < node->call_count + node->ref_count; e++) {
+            int to = e < node->call_count ? node->calls[e] : node->refs[e - node->call_count];
+            if (cg->nodes[to].live) continue;
+            debug_optlir("callgraph: %s keeps %s\n", node->name, cg->nodes[to].name);
+            cg->nodes[to].live = 1;
+            work[top++] = to;
+        }
+    }
+    return live;
+}
+
+/**
+ * @brief Releases the lookup tables when they were not allocated from an arena.
+ * @param cg The call graph.
+ */
+void optlir_callgraph_free(OptlirCallGraph *cg) {
+    if (cg->module->compiler_ctx && cg->module->compiler_ctx->arena) return;
+    hashmap_free(&cg->index);
+    hashmap_free(&cg->structs);
+    hashmap_free(&cg->suffixes);
+}
@@ -0,0 +1,239 @@
+/**
+ * @file dom.c
+ * @brief Dominator tree and dominance frontiers of ALIR functions.
+ */
+#include "optlir/dom.h"
+#include "common/arena.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Key a block by its address for the index map.
+ * @param b The block.
+ * @param key Buffer of at least 32 bytes receiving the key.
+ */
+static void dom_key(AlirBlock *b, char *key) {
+    snprintf(key, 32, "%p", (void*)b);
+}
+
+/**
+ * @brief Returns the index of a block.
+ * @param dom The dominator information.
+ * @param b The block.
+ * @return Its index, or -1 if the block is unreachable.
+ */
+int optlir_dom_index(OptlirDomTree *dom, AlirBlock *b) {
+    char key[32];
+    dom_key(b, key);
+    return (int)(uintptr_t)hashmap_get(&dom->index, key) - 1;
+}
+
+/**
+ * @brief Whether one block dominates another.
+ * @param dom The dominator information.
+ * @param a Index of the dominating block.
+ * @param b Index of the dominated block.
+ * @return Non-zero if every path from the entry to b passes through a.
+ */
+int optlir_dominates(OptlirDomTree *dom, int a, int b) {
+    return dom->pre[a] <= dom->pre[b] && dom->post[b] <= dom->post[a];
+}
+
+/**
+ * @brief Numbers the reachable blocks in depth-first preorder.
+ * @param module The ALIR module.
+ * @param dom The dominator information receiving blocks, count and index.
+ * @param entry The entry block.
+ * @param total Number of blocks in the function.
+ * @param parent Receives the depth-first parent of every index.
+ */
+static void dom_number(AlirModule *module, OptlirDomTree *dom, AlirBlock *entry, int total, int *parent) {
+    int *stack = alir_alloc(module, sizeof(int) * total);
+    BlockEdge **edge = alir_alloc(module, sizeof(BlockEdge*) * total);
+    char key[32];
+
+    dom->blocks[0] = entry;
+    dom->count = 1;
+    parent[0] = -1;
+    dom_key(entry, key);
+    hashmap_put(&dom->index, key, (void*)(uintptr_t)1);
+    stack[0] = 0;
+    edge[0] = entry->succ;
+    int top = 1;
+
+    while (top > 0) {
+        int n = stack[top - 1];
+        BlockEdge *e = edge[top - 1];
+        if (!e) {
+            top--;
+            continue;
+        }
+        edge[top - 1] = e->next;
+        dom_key(e->block, key);
+        if (hashmap_get(&dom->index, key)) continue;
+
+        int c = dom->count++;
+        dom->blocks[c] = e->block;
+        parent[c] = n;
+        hashmap_put(&dom->index, key, (void*)(uintptr_t)(c + 1));
+        stack[top] = c;
+        edge[top] = e->block->succ;
+        top++;
+    }
+}
+
+/**
+ * @brief Path-compresses the link forest above a vertex (Lengauer-Tarjan).
+ *
+ * Afterwards label[v] is the vertex of minimal semidominator on the path
+ * from v up to its forest root, excluding the root.
+ *
+ * @param ancestor Forest links, -1 at roots.
+ * @param label Best vertex of each compressed path.
+ * @param semi Semidominator numbers.
+ * @param stack Scratch stack of at least count entries.
+ * @param v The vertex.
+ */
+static void dom_compress(int *ancestor, int *label, int *semi, int *stack, int v) {
+    int top = 0;
+    for (int x = v; ancestor[ancestor[x]] != -1; x = ancestor[x]) stack[top++] = x;
+    while (top > 0) {
+        int y = stack[--top];
+        int a = ancestor[y];
+        if (semi[label[a]] < semi[label[y]]) label[y] = label[a];
+        ancestor[y] = ancestor[a];
+    }
+}
+
+/**
+ * @brief Computes the dominator tree and dominance frontiers of a function.
+ *
+ * Immediate dominators come from Semi-NCA: Lengauer-Tarjan semidominators,
+ * then each idom is the nearest common ancestor of the depth-first parent
+ * and the semidominator. A frontier walk stops at a block already holding
+ * the join, since the earlier walk through it went all the way up.
+ *
+ * @param module The ALIR module.
+ * @param func The function (pred/succ edges must be valid).
+ * @return The dominator information, or NULL for a function without blocks.
+ */
+OptlirDomTree* optlir_dom_build(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks) return NULL;
+    Arena *arena = alir_arena(module);
+
+    int total = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) total++;
+
+    OptlirDomTree *dom = alir_alloc(module, sizeof(OptlirDomTree));
+    dom->blocks = alir_alloc(module, sizeof(AlirBlock*) * total);
+    hashmap_init(&dom->index, arena, total > 16 ? total * 2 : 32);
+    int *parent = alir_alloc(module, sizeof(int) * total);
+    dom_number(module, dom, func->blocks, total, parent);
+    int n = dom->count;
+
+    // Predecessor indices, unreachable predecessors dropped
+    int *pred_first = alir_alloc(module, sizeof(int) * (n + 1));
+    int pred_total = 0;
+    for (int i = 0; i < n; i++) {
+        pred_first[i] = pred_total;
+        for (BlockEdge *e = dom->blocks[i]->pred; e; e = e->next) pred_total++;
+    }
+    pred_first[n] = pred_total;
+    int *preds = alir_alloc(module, sizeof(int) * (pred_total ? pred_total : 1));
+    int *pred_end = alir_alloc(module, sizeof(int) * n);
+    dom->preds = preds;
+    dom->pred_first = pred_first;
+    dom->pred_end = pred_end;
+    for (int i = 0; i < n; i++) {
+        int k = pred_first[i];
+        for (BlockEdge *e = dom->blocks[i]->pred; e; e = e->next) {
+            int p = optlir_dom_index(dom, e->block);
+            if (p >= 0) preds[k++] = p;
+        }
+        pred_end[i] = k;
+    }
+
+    // Semidominators
+    int *semi = alir_alloc(module, sizeof(int) * n);
+    int *label = alir_alloc(module, sizeof(int) * n);
+    int *ancestor = alir_alloc(module, sizeof(int) * n);
+    int *stack = alir_alloc(module, sizeof(int) * n);
+    for (int i = 0; i < n; i++) {
+        semi[i] = i;
+        label[i] = i;
+        ancestor[i] = -1;
+    }
+    for (int w = n - 1; w > 0; w--) {
+        for (int k = pred_first[w]; k < pred_end[w]; k++) {
+            int u = preds[k];
+            if (ancestor[u] != -1) {
+                dom_compress(ancestor, label, semi, stack, u);
+                u = label[u];
+            }
+            if (semi[u] < semi[w]) semi[w] = semi[u];
+        }
+        ancestor[w] = parent[w];
+    }
+
+    // Immediate dominators
+    dom->idom = alir_alloc(module, sizeof(int) * n);
+    dom->idom[0] = 0;
+    for (int w = 1; w < n; w++) {
+        int d = parent[w];
+        while (d > semi[w]) d = dom->idom[d];
+        dom->idom[w] = d;
+    }
+
+    // Tree links, children in increasing index order
+    dom->child = alir_alloc(module, sizeof(int) * n);
+    dom->sibling = alir_alloc(module, sizeof(int) * n);
+    for (int i = 0; i < n; i++) {
+        dom->child[i] = -1;
+        dom->sibling[i] = -1;
+    }
+    for (int i = n - 1; i > 0; i--) {
+        dom->sibling[i] = dom->child[dom->idom[i]];
+        dom->child[dom->idom[i]] = i;
+    }
+
+    // Pre/post numbers of the tree for constant-time dominance queries
+    dom->pre = alir_alloc(module, sizeof(int) * n);
+    dom->post = alir_alloc(module, sizeof(int) * n);
+    int *next_child = alir_alloc(module, sizeof(int) * n);
+    int pre_n = 0, post_n = 0, top = 1;
+    stack[0] = 0;
+    dom->pre[0] = pre_n++;
+    next_child[0] = dom->child[0];
+    while (top > 0) {
+        int v = stack[top - 1];
+        int c = next_child[v];
+        if (c < 0) {
+            dom->post[v] = post_n++;
+            top--;
+            continue;
+        }
+        next_child[v] = dom->sibling[c];
+        dom->pre[c] = pre_n++;
+        next_child[c] = dom->child[c];
+        stack[top++] = c;
+    }
+
+    // Dominance frontiers
+    dom->frontier = alir_alloc(module, sizeof(OptlirIndexList*) * n);
+    for (int i = 0; i < n; i++) {
+        if (pred_end[i] - pred_first[i] < 2) continue;
+        for (int k = pred_first[i]; k < pred_end[i]; k++) {
+            int runner = preds[k];
+            while (runner != dom->idom[i]) {
+                if (dom->frontier[runner] && dom->frontier[runner]->index == i) break;
+                OptlirIndexList *df = alir_alloc(module, sizeof(OptlirIndexList));
+                df->index = i;
+                df->next = dom->frontier[runner];
+                dom->frontier[runner] = df;
+                if (runner == 0) break;
+                runner = dom->idom[runner];
+            }
+        }
+    }
+    return dom;
+}
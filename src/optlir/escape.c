@@ -0,0 +1,549 @@
+/**
+ * @file escape.c
+ * @brief Interprocedural escape analysis turning heap allocations into stack slots.
+ *
+ * A pointer escapes when something may still hold it after the function
+ * returns: it is stored to memory, returned, freed, or passed to code that
+ * may do any of these. Values computed from it (casts, element addresses,
+ * phis, and calls returning a parameter) are followed like the pointer itself.
+ */
+#include "optlir/escape.h"
+#include "optlir/pass.h"
+#include "optlir/loop.h"
+#include "optlir/local.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#define ESCAPE_CAPTURED     1   // The pointer may outlive the call
+#define ESCAPE_RETURNED     2   // The call may return the pointer or an address inside it
+
+#define ESCAPE_SAME         ((void*)2)  // Walk mark: the root address itself, cast at most
+#define ESCAPE_DERIVED      ((void*)1)  // Walk mark: an address computed from the root
+
+/**
+ * @brief A C library function known to keep none of its pointer arguments.
+ */
+typedef struct EscapeExtern {
+    const char *name;
+    int returns;            // Argument it returns, or -1
+} EscapeExtern;
+
+static const EscapeExtern escape_externs[] = {
+    {"printf", -1}, {"puts", -1}, {"putchar", -1}, {"sprintf", -1}, {"snprintf", -1},
+    {"strlen", -1}, {"strcmp", -1}, {"strncmp", -1}, {"memcmp", -1},
+    {"memset", 0}, {"memcpy", 0}, {"memmove", 0}, {"strcpy", 0}, {"strncpy", 0}, {"strcat", 0},
+    {"read", -1}, {"write", -1}, {"fread", -1}, {"fwrite", -1},
+};
+
+/**
+ * @brief State of one escape analysis run.
+ */
+typedef struct EscapeRun {
+    AlirModule *module;
+    OptlirCallGraph *cg;
+    unsigned char **summary;    // Function node -> flags of each parameter, NULL if unknown
+} EscapeRun;
+
+/**
+ * @brief One walk over the values computed from a root pointer.
+ */
+typedef struct EscapeWalk {
+    EscapeRun *run;
+    HashMap seen;               // "%p" of a value -> ESCAPE_SAME or ESCAPE_DERIVED
+    AlirValue **work;
+    int count;
+    int cap;
+    AlirInst **frees;           // Calls of free on the root, when they are collected
+    int free_count;
+    int free_cap;
+    int collect_frees;          // Zero: freeing the root captures it
+    unsigned flags;
+} EscapeWalk;
+
+/**
+ * @brief Returns the parameter index a value name refers to.
+ * @param name The name of a variable value.
+ * @return The index of "p<k>", or -1 for any other name.
+ */
+static int escape_param_index(const char *name) {
+    if (!name || name[0] != 'p' || !isdigit((unsigned char)name[1])) return -1;
+    int k = 0;
+    for (const char *c = name + 1; *c; c++) {
+        if (!isdigit((unsigned char)*c)) return -1;
+        k = k * 10 + (*c - '0');
+    }
+    return k;
+}
+
+/**
+ * @brief Returns the name a call targets directly.
+ * @param call The call instruction.
+ * @return The callee name, or NULL for indirect calls.
+ */
+static const char* escape_callee_name(AlirInst *call) {
+    AlirValue *f = call->op1;
+    if (!f || (f->kind != ALIR_VAL_VAR && f->kind != ALIR_VAL_GLOBAL) || !f->val.str_val) return NULL;
+    return f->val.str_val;
+}
+
+/**
+ * @brief Whether a name refers to a C library function rather than one of the module.
+ * @param run The escape analysis state.
+ * @param name The callee name.
+ * @return Non-zero if the module has no body for it.
+ */
+static int escape_is_extern(EscapeRun *run, const char *name) {
+    AlirFunction *f = hashmap_get(&run->module->func_map, name);
+    return !f || f->is_extern || !f->blocks;
+}
+
+/**
+ * @brief Looks up a C library function that keeps none of its pointer arguments.
+ * @param name The callee name.
+ * @return The entry, or NULL if the function is not known.
+ */
+static const EscapeExtern* escape_find_extern(const char *name) {
+    for (size_t k = 0; k < sizeof(escape_externs) / sizeof(escape_externs[0]); k++) {
+        if (strcmp(escape_externs[k].name, name) == 0) return &escape_externs[k];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Starts a walk.
+ * @param w The walk.
+ * @param run The escape analysis state.
+ * @param collect_frees Whether calls of free on the root are collected rather than capturing.
+ */
+static void escape_walk_init(EscapeWalk *w, EscapeRun *run, int collect_frees) {
+    memset(w, 0, sizeof(*w));
+    w->run = run;
+    w->collect_frees = collect_frees;
+    hashmap_init(&w->seen, alir_arena(run->module), 32);
+}
+
+/**
+ * @brief Queues a value computed from the root.
+ * @param w The walk.
+ * @param v The value.
+ * @param same Non-zero if it is the root address itself.
+ */
+static void escape_push(EscapeWalk *w, AlirValue *v, int same) {
+    if (!v) return;
+    if (v->kind != ALIR_VAL_TEMP) {
+        w->flags |= ESCAPE_CAPTURED;
+        return;
+    }
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)v);
+    if (hashmap_get(&w->seen, key)) return;
+    hashmap_put(&w->seen, key, same ? ESCAPE_SAME : ESCAPE_DERIVED);
+
+    if (w->count == w->cap) {
+        int cap = w->cap ? w->cap * 2 : 16;
+        AlirValue **grown = alir_alloc(w->run->module, sizeof(AlirValue*) * cap);
+        if (w->count) memcpy(grown, w->work, sizeof(AlirValue*) * w->count);
+        w->work = grown;
+        w->cap = cap;
+    }
+    w->work[w->count++] = v;
+}
+
+/**
+ * @brief Remembers a call of free on the root.
+ * @param w The walk.
+ * @param call The call instruction.
+ */
+static void escape_add_free(EscapeWalk *w, AlirInst *call) {
+    if (w->free_count == w->free_cap) {
+        int cap = w->free_cap ? w->free_cap * 2 : 4;
+        AlirInst **grown = alir_alloc(w->run->module, sizeof(AlirInst*) * cap);
+        if (w->free_count) memcpy(grown, w->frees, sizeof(AlirInst*) * w->free_count);
+        w->frees = grown;
+        w->free_cap = cap;
+    }
+    w->frees[w->free_count++] = call;
+}
+
+/**
+ * @brief Follows the root pointer into a call argument.
+ * @param w The walk.
+ * @param call The call instruction.
+ * @param k The argument index.
+ * @param same Non-zero if the argument is the root address itself.
+ */
+static void escape_call_arg(EscapeWalk *w, AlirInst *call, int k, int same) {
+    EscapeRun *run = w->run;
+    const char *name = escape_callee_name(call);
+
+    if (name && strcmp(name, "free") == 0 && escape_is_extern(run, name)) {
+        if (w->collect_frees && same && (!call->dest || !call->dest->uses)) escape_add_free(w, call);
+        else w->flags |= ESCAPE_CAPTURED;
+        return;
+    }
+
+    int n = optlir_callgraph_callee(run->cg, call);
+    if (n >= 0 && run->summary[n]) {
+        AlirFunction *callee = run->cg->nodes[n].func;
+        unsigned flags = k < callee->param_count ? run->summary[n][k] : ESCAPE_CAPTURED;
+        if (flags & ESCAPE_CAPTURED) w->flags |= ESCAPE_CAPTURED;
+        else if (flags & ESCAPE_RETURNED) escape_push(w, call->dest, 0);
+        return;
+    }
+
+    const EscapeExtern *ext = name && escape_is_extern(run, name) ? escape_find_extern(name) : NULL;
+    if (!ext) {
+        w->flags |= ESCAPE_CAPTURED;
+        return;
+    }
+    if (ext->returns == k) escape_push(w, call->dest, 0);
+}
+
+/**
+ * @brief Follows the root pointer into one operand slot.
+ * @param w The walk.
+ * @param user The instruction reading the value.
+ * @param slot The operand slot.
+ * @param same Non-zero if the value is the root address itself.
+ */
+static void escape_use(EscapeWalk *w, AlirInst *user, AlirValue **slot, int same) {
+    switch (user->op) {
+        case ALIR_OP_LOAD:
+            if (slot != &user->op1) w->flags |= ESCAPE_CAPTURED;
+            break;
+        case ALIR_OP_STORE:
+            // Writing through the pointer is fine; writing the pointer itself is not
+            if (slot != &user->op2) w->flags |= ESCAPE_CAPTURED;
+            break;
+        case ALIR_OP_GET_PTR:
+            if (slot == &user->op1) escape_push(w, user->dest, 0);
+            else w->flags |= ESCAPE_CAPTURED;
+            break;
+        case ALIR_OP_CAST:
+        case ALIR_OP_BITCAST:
+            // A pointer turned into an integer can go anywhere
+            if (user->dest && user->dest->type.ptr_depth > 0) escape_push(w, user->dest, same);
+            else w->flags |= ESCAPE_CAPTURED;
+            break;
+        case ALIR_OP_PHI:
+            escape_push(w, user->dest, 0);
+            break;
+        case ALIR_OP_LT: case ALIR_OP_GT: case ALIR_OP_LTE: case ALIR_OP_GTE:
+        case ALIR_OP_EQ: case ALIR_OP_NEQ:
+            break;
+        case ALIR_OP_CONDI:
+            if (slot != &user->op1) w->flags |= ESCAPE_CAPTURED;
+            break;
+        case ALIR_OP_CALL:
+            if (user->args && slot >= user->args && slot < user->args + user->arg_count) {
+                escape_call_arg(w, user, (int)(slot - user->args), same);
+            } else {
+                w->flags |= ESCAPE_CAPTURED;
+            }
+            break;
+        case ALIR_OP_RET:
+            w->flags |= ESCAPE_RETURNED;
+            break;
+        default:
+            w->flags |= ESCAPE_CAPTURED;
+            break;
+    }
+}
+
+/**
+ * @brief Follows every queued value until the walk is done or the root is captured.
+ * @param w The walk (def-use chains of the function valid).
+ */
+static void escape_drain(EscapeWalk *w) {
+    while (w->count > 0 && !(w->flags & ESCAPE_CAPTURED)) {
+        AlirValue *v = w->work[--w->count];
+        char key[32];
+        snprintf(key, sizeof(key), "%p", (void*)v);
+        int same = hashmap_get(&w->seen, key) == ESCAPE_SAME;
+        for (AlirUse *u = v->uses; u && !(w->flags & ESCAPE_CAPTURED); u = u->next) {
+            escape_use(w, u->user, u->slot, same);
+        }
+    }
+}
+
+/**
+ * @brief Computes what a function may do with one of its parameters.
+ * @param run The escape analysis state.
+ * @param func The function (def-use chains valid).
+ * @param index The parameter index.
+ * @return ESCAPE_* flags.
+ */
+static unsigned escape_param(EscapeRun *run, AlirFunction *func, int index) {
+    EscapeWalk w;
+    escape_walk_init(&w, run, 0);
+    for (AlirBlock *b = func->blocks; b && !(w.flags & ESCAPE_CAPTURED); b = b->next) {
+        for (AlirInst *i = b->head; i && !(w.flags & ESCAPE_CAPTURED); i = i->next) {
+            AlirValue **slots[2] = {&i->op1, &i->op2};
+            for (int s = 0; s < 2; s++) {
+                AlirValue *v = *slots[s];
+                if (v && v->kind == ALIR_VAL_VAR && escape_param_index(v->val.str_val) == index) {
+                    escape_use(&w, i, slots[s], 1);
+                }
+            }
+            for (int k = 0; k < i->arg_count; k++) {
+                AlirValue *v = i->args[k];
+                if (v && v->kind == ALIR_VAL_VAR && escape_param_index(v->val.str_val) == index) {
+                    escape_use(&w, i, &i->args[k], 1);
+                }
+            }
+        }
+    }
+    escape_drain(&w);
+    hashmap_free(&w.seen);
+    return w.flags;
+}
+
+/**
+ * @brief Computes the parameter summaries of every function until none changes.
+ * @param run The escape analysis state; receives the summaries.
+ */
+static void escape_summarize(EscapeRun *run) {
+    OptlirCallGraph *cg = run->cg;
+    int count = cg->func_count;
+    run->summary = alir_alloc(run->module, sizeof(unsigned char*) * (count ? count : 1));
+
+    // Callers of each function, so a changed summary requeues exactly them
+    int *first = alir_alloc(run->module, sizeof(int) * (count + 1));
+    int edges = 0;
+    for (int n = 0; n < count; n++) {
+        for (int c = 0; c < cg->nodes[n].call_count; c++) first[cg->nodes[n].calls[c] + 1]++;
+        edges += cg->nodes[n].call_count;
+    }
+    for (int n = 0; n < count; n++) first[n + 1] += first[n];
+    int *callers = alir_alloc(run->module, sizeof(int) * (edges ? edges : 1));
+    int *fill = alir_alloc(run->module, sizeof(int) * (count ? count : 1));
+    for (int n = 0; n < count; n++) {
+        for (int c = 0; c < cg->nodes[n].call_count; c++) {
+            int callee = cg->nodes[n].calls[c];
+            callers[first[callee] + fill[callee]++] = n;
+        }
+    }
+
+    int *queue = alir_alloc(run->module, sizeof(int) * (count ? count : 1));
+    char *queued = alir_alloc(run->module, count ? count : 1);
+    int head = 0, size = 0;
+    for (int n = 0; n < count; n++) {
+        AlirFunction *func = cg->nodes[n].func;
+        if (func->is_extern || !func->blocks || func->is_flux) continue;
+        run->summary[n] = alir_alloc(run->module, func->param_count ? func->param_count : 1);
+        queue[size++] = n;
+        queued[n] = 1;
+    }
+
+    int rounds = 0;
+    while (size > 0) {
+        int n = queue[head];
+        head = (head + 1) % count;
+        size--;
+        queued[n] = 0;
+        rounds++;
+
+        AlirFunction *func = cg->nodes[n].func;
+        alir_build_uses(run->module, func);
+        int changed = 0;
+        for (int k = 0; k < func->param_count; k++) {
+            if (run->summary[n][k] & ESCAPE_CAPTURED) continue;
+            unsigned flags = run->summary[n][k] | escape_param(run, func, k);
+            if (flags != run->summary[n][k]) {
+                run->summary[n][k] = (unsigned char)flags;
+                changed = 1;
+            }
+        }
+        if (!changed) continue;
+        for (int c = first[n]; c < first[n + 1]; c++) {
+            int caller = callers[c];
+            if (queued[caller] || !run->summary[caller]) continue;
+            queue[(head + size) % count] = caller;
+            size++;
+            queued[caller] = 1;
+        }
+    }
+    debug_optlir("escape: summaries settled after %d function visits\n", rounds);
+}
+
+/**
+ * @brief Whether a function can reach itself through direct calls.
+ * @param run The escape analysis state.
+ * @param n The function node.
+ * @return Non-zero for recursive functions.
+ */
+static int escape_recursive(EscapeRun *run, int n) {
+    OptlirCallGraph *cg = run->cg;
+    int count = cg->func_count;
+    char *seen = alir_alloc(run->module, count);
+    int *stack = alir_alloc(run->module, sizeof(int) * count);
+    int sp = 0;
+    stack[sp++] = n;
+    while (sp > 0) {
+        OptlirCgNode *node = &cg->nodes[stack[--sp]];
+        for (int c = 0; c < node->call_count; c++) {
+            int callee = node->calls[c];
+            if (callee == n) return 1;
+            if (seen[callee]) continue;
+            seen[callee] = 1;
+            stack[sp++] = callee;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the constant size of a malloc call the stack could hold.
+ * @param run The escape analysis state.
+ * @param i The instruction.
+ * @return The size in bytes, or 0 if the instruction is no such call.
+ */
+static long escape_malloc_size(EscapeRun *run, AlirInst *i) {
+    if (i->op != ALIR_OP_CALL || !i->dest || i->dest->kind != ALIR_VAL_TEMP || i->arg_count != 1) return 0;
+    const char *name = escape_callee_name(i);
+    if (!name || strcmp(name, "malloc") != 0 || !escape_is_extern(run, name)) return 0;
+    ConstVal size = optlir_const_of(i->args[0]);
+    if (!size.is_const || size.is_float || size.int_val <= 0 || size.int_val > OPTLIR_ESCAPE_MAX_BYTES) return 0;
+    return (long)size.int_val;
+}
+
+/**
+ * @brief Whether a pointer computed from an allocation reaches the next
+ * iteration of a loop around it, through a phi of the loop header.
+ * @param w The finished walk over the allocation.
+ * @param forest The loops of the function.
+ * @param bi Dominator index of the block holding the allocation.
+ * @return Non-zero if one allocation would serve two iterations at once.
+ */
+static int escape_loop_carried(EscapeWalk *w, OptlirLoopForest *forest, int bi) {
+    OptlirDomTree *dom = forest->dom;
+    for (OptlirLoop *loop = forest->innermost[bi]; loop; loop = loop->parent) {
+        AlirBlock *header = dom->blocks[loop->header];
+        for (AlirInst *i = header->head; i && i->op == ALIR_OP_PHI; i = i->next) {
+            char key[32];
+            snprintf(key, sizeof(key), "%p", (void*)i->dest);
+            if (hashmap_get(&w->seen, key)) return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Unlinks an instruction from the block holding it.
+ * @param func The function.
+ * @param inst The instruction.
+ * @return The block it was in, or NULL if no block holds it.
+ */
+static AlirBlock* escape_unlink(AlirFunction *func, AlirInst *inst) {
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        AlirInst *prev = NULL;
+        for (AlirInst *i = b->head; i; prev = i, i = i->next) {
+            if (i != inst) continue;
+            if (prev) prev->next = i->next;
+            else b->head = i->next;
+            if (b->tail == i) b->tail = prev;
+            i->next = NULL;
+            return b;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Moves the malloc calls of one function that do not escape onto its stack.
+ * @param run The escape analysis state.
+ * @param n The function node.
+ * @return Number of allocations moved.
+ */
+static int escape_function(EscapeRun *run, int n) {
+    AlirModule *module = run->module;
+    AlirFunction *func = run->cg->nodes[n].func;
+
+    int candidates = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (escape_malloc_size(run, i)) candidates++;
+        }
+    }
+    if (!candidates || escape_recursive(run, n)) return 0;
+
+    alir_build_uses(module, func);
+    OptlirDomTree *dom = optlir_require_dom(module, func);
+    if (!dom) return 0;
+    OptlirLoopForest *forest = optlir_loops_build(module, dom);
+
+    AlirInst **moved = alir_alloc(module, sizeof(AlirInst*) * candidates);
+    AlirInst **frees = NULL;
+    int moved_count = 0, free_count = 0, free_cap = 0;
+    long frame = 0;
+    for (int bi = 0; bi < dom->count; bi++) {
+        for (AlirInst *i = dom->blocks[bi]->head; i; i = i->next) {
+            long size = escape_malloc_size(run, i);
+            if (!size || frame + size > OPTLIR_ESCAPE_FRAME_BYTES) continue;
+
+            EscapeWalk w;
+            escape_walk_init(&w, run, 1);
+            escape_push(&w, i->dest, 1);
+            escape_drain(&w);
+            int local = !w.flags && !escape_loop_carried(&w, forest, bi);
+            hashmap_free(&w.seen);
+            if (!local) continue;
+
+            frame += size;
+            moved[moved_count++] = i;
+            if (free_count + w.free_count > free_cap) {
+                free_cap = (free_count + w.free_count) * 2;
+                AlirInst **grown = alir_alloc(module, sizeof(AlirInst*) * free_cap);
+                if (free_count) memcpy(grown, frees, sizeof(AlirInst*) * free_count);
+                frees = grown;
+            }
+            if (w.free_count) memcpy(frees + free_count, w.frees, sizeof(AlirInst*) * w.free_count);
+            free_count += w.free_count;
+        }
+    }
+    if (!moved_count) return 0;
+
+    // Sized slots at the top of the entry block stay fixed parts of the frame
+    AlirBlock *entry = func->blocks;
+    for (int k = moved_count - 1; k >= 0; k--) {
+        AlirInst *i = moved[k];
+        long size = escape_malloc_size(run, i);
+        escape_unlink(func, i);
+        i->op = ALIR_OP_ALLOCA;
+        i->op1 = alir_const_int(module, size);
+        i->op2 = NULL;
+        i->args = NULL;
+        i->arg_count = 0;
+        i->next = entry->head;
+        entry->head = i;
+        if (!entry->tail) entry->tail = i;
+        debug_optlir("escape: %s: %ld-byte malloc moved to the stack\n", func->name, size);
+    }
+    for (int k = 0; k < free_count; k++) {
+        if (escape_unlink(func, frees[k])) optlir_stats.escape_frees_removed++;
+    }
+    optlir_stats.escape_moved += moved_count;
+    return moved_count;
+}
+
+/**
+ * @brief Moves malloc calls whose memory never outlives the function onto its stack.
+ * @param module The ALIR module (SSA form).
+ * @param cg The call graph of the module.
+ * @return Number of allocations moved.
+ */
+int optlir_escape_heap(AlirModule *module, OptlirCallGraph *cg) {
+    if (!module || !alir_arena(module) || !cg->func_count) return 0;
+    EscapeRun run = {module, cg, NULL};
+    escape_summarize(&run);
+
+    int moved = 0;
+    for (int n = 0; n < cg->func_count; n++) {
+        if (run.summary[n]) moved += escape_function(&run, n);
+    }
+    return moved;
+}
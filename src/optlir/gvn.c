@@ -0,0 +1,360 @@
+/**
+ * @file gvn.c
+ * @brief Dominator-based global value numbering over ALIR functions.
+ *
+ * Uses share the value of their def, so an SSA value is numbered by its
+ * address and an instruction by its opcode, result type and operands. The
+ * table is walked down the dominator tree: an entry is only reused by the
+ * blocks its own block dominates.
+ *
+ * Memory is split into the alias classes of alias.h. Each class has a
+ * generation that a store to it bumps; calls that are not pure bump class 0,
+ * which is all they can reach. A load is numbered with the generation of its
+ * class and with the epoch of its block, which starts over wherever paths
+ * join.
+ */
+#include "optlir.h"
+#include "optlir/local.h"
+#include "optlir/dom.h"
+#include "optlir/alias.h"
+#include "optlir/gvn.h"
+#include "optlir/pass.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief A value some instruction computed, reusable below its block.
+ */
+typedef struct GvnEntry {
+    AlirValue *leader;
+    int block;                  // Dominator index of the defining block
+    struct GvnEntry *shadow;    // Entry of the same key from an outer scope
+} GvnEntry;
+
+typedef struct GvnCtx {
+    AlirModule *module;
+    OptlirDomTree *dom;
+    HashMap table;              // expression key -> GvnEntry*
+    OptlirAlias alias;
+    int *gen;                   // alias class -> memory generation
+    int epoch;                  // Memory epoch of the current block
+    int counter;                // Last generation handed out
+    int *log_class;             // Undo log of generation changes
+    int *log_gen;
+    int log_top;
+    int log_capacity;
+} GvnCtx;
+
+/**
+ * @brief Appends formatted text to an expression key.
+ * @param key The key buffer.
+ * @param len Length used so far, advanced past the text.
+ * @param size Size of the buffer.
+ * @param fmt Format string.
+ * @return Zero once the key no longer fits.
+ */
+static int gvn_put(char *key, int *len, int size, const char *fmt, ...) {
+    if (*len >= size) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(key + *len, size - *len, fmt, ap);
+    va_end(ap);
+    *len += n;
+    return *len < size;
+}
+
+/**
+ * @brief Appends a type to an expression key.
+ * @param key The key buffer.
+ * @param len Length used so far.
+ * @param size Size of the buffer.
+ * @param t The type.
+ * @return Zero once the key no longer fits.
+ */
+static int gvn_put_type(char *key, int *len, int size, VarType t) {
+    return gvn_put(key, len, size, "%d.%d.%d.%d.%d.%d.%s", t.base, t.ptr_depth, t.array_size, t.array_depth,
+                   t.is_unsigned, t.is_tainted, t.class_name ? t.class_name : "");
+}
+
+/**
+ * @brief Appends an operand to an expression key.
+ *
+ * SSA values go in by address, since their uses share the value of the def;
+ * constants, names and types go in by content.
+ *
+ * @param key The key buffer.
+ * @param len Length used so far.
+ * @param size Size of the buffer.
+ * @param v The operand.
+ * @return Zero once the key no longer fits.
+ */
+static int gvn_put_value(char *key, int *len, int size, AlirValue *v) {
+    if (!v) return gvn_put(key, len, size, "|_");
+    switch (v->kind) {
+        case ALIR_VAL_TEMP:
+            return gvn_put(key, len, size, "|%p", (void*)v);
+        case ALIR_VAL_VAR:
+        case ALIR_VAL_GLOBAL:
+            return gvn_put(key, len, size, "|%c%s", v->kind == ALIR_VAL_VAR ? 'v' : 'g', v->val.str_val ? v->val.str_val : "");
+        case ALIR_VAL_LABEL:
+            return gvn_put(key, len, size, "|l%p", (void*)v->block);
+        case ALIR_VAL_TYPE:
+            return gvn_put(key, len, size, "|y") && gvn_put_type(key, len, size, v->type);
+        default:
+            // Constants are zeroed on allocation, so the whole union compares
+            return gvn_put(key, len, size, "|c%d:", v->kind) && gvn_put_type(key, len, size, v->type) &&
+                   gvn_put(key, len, size, ":%llx", v->val.unsigned_long_val);
+    }
+}
+
+/**
+ * @brief Whether an opcode computes its result from its operands alone.
+ * @param op The opcode.
+ * @return Non-zero for arithmetic, comparisons, casts and addressing.
+ */
+static int gvn_pure_op(AlirOpcode op) {
+    if (op >= ALIR_OP_ADD && op <= ALIR_OP_NEQ) return 1;
+    return op == ALIR_OP_CAST || op == ALIR_OP_BITCAST || op == ALIR_OP_GET_PTR ||
+           op == ALIR_OP_SIZEOF || op == ALIR_OP_ALIGNOF;
+}
+
+/**
+ * @brief Whether the operands of an opcode can be swapped.
+ * @param op The opcode.
+ * @return Non-zero for commutative operations.
+ */
+static int gvn_commutative(AlirOpcode op) {
+    switch (op) {
+        case ALIR_OP_ADD: case ALIR_OP_MUL: case ALIR_OP_FADD: case ALIR_OP_FMUL:
+        case ALIR_OP_AND: case ALIR_OP_OR: case ALIR_OP_XOR:
+        case ALIR_OP_EQ: case ALIR_OP_NEQ:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Starts a new generation of one alias class, logging the old one.
+ * @param ctx The GVN context.
+ * @param c The alias class written to.
+ */
+static void gvn_clobber(GvnCtx *ctx, int c) {
+    if (ctx->log_top == ctx->log_capacity) {
+        int capacity = ctx->log_capacity ? ctx->log_capacity * 2 : 64;
+        int *grown_class = alir_alloc(ctx->module, sizeof(int) * capacity);
+        int *grown_gen = alir_alloc(ctx->module, sizeof(int) * capacity);
+        if (ctx->log_top) {
+            memcpy(grown_class, ctx->log_class, sizeof(int) * ctx->log_top);
+            memcpy(grown_gen, ctx->log_gen, sizeof(int) * ctx->log_top);
+        }
+        ctx->log_class = grown_class;
+        ctx->log_gen = grown_gen;
+        ctx->log_capacity = capacity;
+    }
+    ctx->log_class[ctx->log_top] = c;
+    ctx->log_gen[ctx->log_top++] = ctx->gen[c];
+    ctx->gen[c] = ++ctx->counter;
+}
+
+/**
+ * @brief Builds the key of a load from an address in the current memory state.
+ * @param ctx The GVN context.
+ * @param key The key buffer.
+ * @param size Size of the buffer.
+ * @param type The loaded type.
+ * @param addr The address.
+ * @return Zero if the key does not fit.
+ */
+static int gvn_load_key(GvnCtx *ctx, char *key, int size, VarType type, AlirValue *addr) {
+    int len = 0, c = optlir_alias_class(&ctx->alias, addr);
+    return gvn_put(key, &len, size, "L:") && gvn_put_type(key, &len, size, type) &&
+           gvn_put_value(key, &len, size, addr) &&
+           gvn_put(key, &len, size, "@%d.%d.%d", ctx->epoch, c, ctx->gen[c]);
+}
+
+/**
+ * @brief Builds the key of an instruction.
+ * @param ctx The GVN context.
+ * @param i The instruction.
+ * @param key The key buffer.
+ * @param size Size of the buffer.
+ * @return Zero if the instruction is not numbered.
+ */
+static int gvn_key(GvnCtx *ctx, AlirInst *i, char *key, int size) {
+    if (!i->dest) return 0;
+    if (i->op == ALIR_OP_LOAD) return gvn_load_key(ctx, key, size, i->dest->type, i->op1);
+
+    int memory = 0;
+    if (i->op == ALIR_OP_CALL) {
+        // Globals it reads are shared memory
+        if (!optlir_alias_pure_callee(ctx->module, i)) return 0;
+        memory = 1;
+    } else if (!gvn_pure_op(i->op)) {
+        return 0;
+    }
+
+    AlirValue *a = i->op1, *b = i->op2;
+    int len = 0;
+    if (gvn_commutative(i->op)) {
+        char ka[128], kb[128];
+        int la = 0, lb = 0;
+        if (!gvn_put_value(ka, &la, sizeof(ka), a) || !gvn_put_value(kb, &lb, sizeof(kb), b)) return 0;
+        if (strcmp(ka, kb) > 0) {
+            a = i->op2;
+            b = i->op1;
+        }
+    }
+    if (!gvn_put(key, &len, size, "%d:", i->op) || !gvn_put_type(key, &len, size, i->dest->type) ||
+        !gvn_put_value(key, &len, size, a) || !gvn_put_value(key, &len, size, b)) {
+        return 0;
+    }
+    for (int k = 0; k < i->arg_count; k++) {
+        if (!gvn_put_value(key, &len, size, i->args[k])) return 0;
+    }
+    if (memory && !gvn_put(key, &len, size, "@%d.%d", ctx->epoch, ctx->gen[0])) return 0;
+    return 1;
+}
+
+/**
+ * @brief Finds the value a key stands for in a block.
+ * @param ctx The GVN context.
+ * @param key The expression key.
+ * @param bi Dominator index of the block.
+ * @return The entry of a dominating definition, or NULL.
+ */
+static GvnEntry* gvn_lookup(GvnCtx *ctx, const char *key, int bi) {
+    GvnEntry *e = hashmap_get(&ctx->table, key);
+    while (e && !optlir_dominates(ctx->dom, e->block, bi)) e = e->shadow;
+    return e;
+}
+
+/**
+ * @brief Records the value a key stands for from a block down.
+ * @param ctx The GVN context.
+ * @param key The expression key.
+ * @param bi Dominator index of the block.
+ * @param leader The value.
+ */
+static void gvn_record(GvnCtx *ctx, const char *key, int bi, AlirValue *leader) {
+    GvnEntry *e = alir_alloc(ctx->module, sizeof(GvnEntry));
+    e->leader = leader;
+    e->block = bi;
+    e->shadow = hashmap_get(&ctx->table, key);
+    hashmap_put(&ctx->table, key, e);
+}
+
+/**
+ * @brief Numbers the instructions of one block, removing the redundant ones.
+ * @param ctx The GVN context.
+ * @param bi Dominator index of the block.
+ * @return Number of instructions removed.
+ */
+static int gvn_block(GvnCtx *ctx, int bi) {
+    AlirBlock *b = ctx->dom->blocks[bi];
+    char key[512];
+    int removed = 0;
+
+    AlirInst *prev = NULL, *i = b->head;
+    while (i) {
+        AlirInst *next = i->next;
+        if (i->op == ALIR_OP_STORE) {
+            gvn_clobber(ctx, optlir_alias_class(&ctx->alias, i->op2));
+            // Later loads of the same address read the stored value
+            if (i->op1 && gvn_load_key(ctx, key, sizeof(key), i->op1->type, i->op2)) {
+                gvn_record(ctx, key, bi, i->op1);
+            }
+        } else if (i->op == ALIR_OP_CALL && !optlir_alias_pure_callee(ctx->module, i)) {
+            gvn_clobber(ctx, 0);
+        } else if (gvn_key(ctx, i, key, sizeof(key))) {
+            GvnEntry *e = gvn_lookup(ctx, key, bi);
+            if (e) {
+                alir_replace_all_uses(i->dest, e->leader);
+                alir_drop_uses(i);
+                if (prev) prev->next = next;
+                else b->head = next;
+                if (b->tail == i) b->tail = prev;
+                removed++;
+                i = next;
+                continue;
+            }
+            gvn_record(ctx, key, bi, i->dest);
+        }
+        prev = i;
+        i = next;
+    }
+    return removed;
+}
+
+/**
+ * @brief Removes instructions recomputing a value a dominating one computed.
+ * @param module The ALIR module.
+ * @param func The function (SSA form).
+ * @return Number of instructions removed.
+ */
+int optlir_gvn_function(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks || func->is_extern) return 0;
+    Arena *arena = alir_arena(module);
+
+    optlir_require_uses(module, func);
+    GvnCtx ctx = {0};
+    ctx.module = module;
+    ctx.dom = optlir_require_dom(module, func);
+    int n = ctx.dom->count;
+    hashmap_init(&ctx.table, arena, 64);
+    optlir_alias_build(module, func, &ctx.alias);
+    ctx.gen = alir_alloc(module, sizeof(int) * ctx.alias.count);
+
+    // Walk the dominator tree; the log restores the memory state on the way back up
+    int *stack = alir_alloc(module, sizeof(int) * n);
+    int *next_child = alir_alloc(module, sizeof(int) * n);
+    int *mark = alir_alloc(module, sizeof(int) * n);
+    int *epoch = alir_alloc(module, sizeof(int) * n);
+    int removed = 0, top = 0;
+    stack[top++] = 0;
+    next_child[0] = -2;
+
+    while (top > 0) {
+        int bi = stack[top - 1];
+        if (next_child[bi] == -2) {
+            // Memory only carries over from the parent if it is the sole way in
+            mark[bi] = ctx.log_top;
+            epoch[bi] = ctx.epoch;
+            OptlirDomTree *dom = ctx.dom;
+            int straight = dom->pred_end[bi] - dom->pred_first[bi] == 1 && dom->preds[dom->pred_first[bi]] == dom->idom[bi];
+            if (bi > 0 && !straight) ctx.epoch = ++ctx.counter;
+            next_child[bi] = dom->child[bi];
+            removed += gvn_block(&ctx, bi);
+            continue;
+        }
+
+        int c = next_child[bi];
+        if (c >= 0) {
+            next_child[bi] = ctx.dom->sibling[c];
+            next_child[c] = -2;
+            stack[top++] = c;
+            continue;
+        }
+
+        while (ctx.log_top > mark[bi]) {
+            ctx.log_top--;
+            ctx.gen[ctx.log_class[ctx.log_top]] = ctx.log_gen[ctx.log_top];
+        }
+        ctx.epoch = epoch[bi];
+        top--;
+    }
+
+    if (removed > 0) {
+        optlir_stats.gvn_eliminated += removed;
+        debug_optlir("gvn: %s: %d instructions eliminated\n", func->name, removed);
+    }
+    if (!arena) {
+        hashmap_free(&ctx.table);
+        optlir_alias_free(&ctx.alias);
+    }
+    return removed;
+}
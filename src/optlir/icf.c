@@ -0,0 +1,488 @@
+/**
+ * @file icf.c
+ * @brief Identical function folding over optimized ALIR.
+ *
+ * Two functions fold when their bodies match block for block and
+ * instruction for instruction. Temps only have to be used the same way,
+ * so they are numbered by first occurrence; labels stand for the position
+ * of their block; a function naming itself, as a recursive call does,
+ * matches the other naming itself.
+ */
+#include "optlir/icf.h"
+#include "optlir/local.h"
+#include "alir/use.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ICF_THUNK_SIZE  2       // Instructions of a thunk: the call and the return
+
+/**
+ * @brief A function that may fold, or that others may fold into.
+ */
+typedef struct IcfFunc {
+    AlirFunction *func;
+    uint64_t hash;
+    int size;                   // Instruction count
+    int max_temp;               // Largest temp id of the body
+    int taken;                  // Its address is taken, so its name has to keep working
+    HashMap blocks;             // "%p" of a block -> position + 1
+    struct IcfFunc *into;       // Function its direct calls now reach, or NULL
+    struct IcfFunc *next;       // Next function of the same hash
+} IcfFunc;
+
+/**
+ * @brief Temps of one function numbered in order of first occurrence.
+ */
+typedef struct IcfTemps {
+    int *num;                   // temp id -> number + 1, 0 before its first occurrence
+    int count;
+} IcfTemps;
+
+/**
+ * @brief Mixes a word into a hash.
+ * @param h The hash so far.
+ * @param v The word.
+ * @return The new hash.
+ */
+static uint64_t icf_mix(uint64_t h, uint64_t v) {
+    h ^= v;
+    return h * 1099511628211ULL;
+}
+
+/**
+ * @brief Mixes a string into a hash.
+ * @param h The hash so far.
+ * @param s The string, or NULL.
+ * @return The new hash.
+ */
+static uint64_t icf_mix_str(uint64_t h, const char *s) {
+    if (!s) return icf_mix(h, 0xff);
+    for (; *s; s++) h = icf_mix(h, (unsigned char)*s);
+    return icf_mix(h, 0);
+}
+
+/**
+ * @brief Mixes a type into a hash, leaving out its signedness.
+ * @param h The hash so far.
+ * @param t The type.
+ * @return The new hash.
+ */
+static uint64_t icf_mix_type(uint64_t h, const VarType *t) {
+    h = icf_mix(h, (uint64_t)t->base);
+    h = icf_mix(h, (uint64_t)t->ptr_depth);
+    h = icf_mix(h, (uint64_t)t->array_size);
+    h = icf_mix(h, (uint64_t)t->array_depth);
+    h = icf_mix(h, (uint64_t)(t->is_func_ptr | t->is_tainted << 1));
+    return icf_mix_str(h, t->class_name);
+}
+
+/**
+ * @brief Whether two strings are equal, NULL matching only NULL.
+ * @param a First string.
+ * @param b Second string.
+ * @return Non-zero if equal.
+ */
+static int icf_str_eq(const char *a, const char *b) {
+    if (!a || !b) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+/**
+ * @brief Whether two types are the same to the backends.
+ * @param a First type.
+ * @param b Second type.
+ * @param strict Non-zero if the signedness has to match as well.
+ * @return Non-zero if the types are interchangeable.
+ */
+static int icf_type_eq(const VarType *a, const VarType *b, int strict) {
+    if (a->base != b->base || a->ptr_depth != b->ptr_depth) return 0;
+    if (a->array_size != b->array_size || a->array_depth != b->array_depth) return 0;
+    if (a->is_func_ptr != b->is_func_ptr || a->is_tainted != b->is_tainted) return 0;
+    if (a->is_pristine != b->is_pristine || (strict && a->is_unsigned != b->is_unsigned)) return 0;
+    if (!icf_str_eq(a->class_name, b->class_name)) return 0;
+    if (!a->is_func_ptr) return 1;
+
+    if (a->fp_is_varargs != b->fp_is_varargs || a->fp_param_count != b->fp_param_count) return 0;
+    if (!a->fp_ret_type != !b->fp_ret_type) return 0;
+    if (a->fp_ret_type && !icf_type_eq(a->fp_ret_type, b->fp_ret_type, 1)) return 0;
+    for (int k = 0; k < a->fp_param_count; k++) {
+        if (!icf_type_eq(&a->fp_param_types[k], &b->fp_param_types[k], 1)) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Whether an operand slot of an instruction reads the signedness of its type.
+ *
+ * The backends choose zero or sign extension for casts and call
+ * arguments, and unsigned or signed forms of shifts right, ordered
+ * compares and switch ranges, from it. Everywhere else int and unsigned
+ * int make the same code.
+ *
+ * @param i The instruction.
+ * @param slot 0 for the destination, 1 for op1, 2 for op2, 3 for the arguments.
+ * @return Non-zero if the signedness of the slot matters.
+ */
+static int icf_strict(AlirInst *i, int slot) {
+    switch (i->op) {
+        case ALIR_OP_CAST: return slot <= 1;
+        case ALIR_OP_SWITCH: return slot == 1;
+        case ALIR_OP_SHR: case ALIR_OP_DIV: case ALIR_OP_MOD:
+        case ALIR_OP_LT: case ALIR_OP_GT: case ALIR_OP_LTE: case ALIR_OP_GTE:
+            return slot == 1 || slot == 2;
+        case ALIR_OP_CALL: return slot == 3;
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Returns the position of a block in its function.
+ * @param f The function.
+ * @param b The block.
+ * @return The position + 1, or 0 for a block of another function.
+ */
+static int icf_block_pos(IcfFunc *f, AlirBlock *b) {
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)b);
+    return (int)(uintptr_t)hashmap_get(&f->blocks, key);
+}
+
+/**
+ * @brief Numbers a temp at its first occurrence.
+ * @param t The numbering of the function.
+ * @param f The function.
+ * @param v The temp.
+ * @return The slot holding its number + 1, or NULL for ids outside the function's range.
+ */
+static int* icf_temp(IcfTemps *t, IcfFunc *f, AlirValue *v) {
+    if (v->temp_id < 0 || v->temp_id > f->max_temp) return NULL;
+    return &t->num[v->temp_id];
+}
+
+/**
+ * @brief Mixes an operand into the hash of a function.
+ * @param f The function.
+ * @param t The numbering of its temps.
+ * @param h The hash so far.
+ * @param v The operand, or NULL.
+ * @return The new hash.
+ */
+static uint64_t icf_mix_value(IcfFunc *f, IcfTemps *t, uint64_t h, AlirValue *v) {
+    if (!v) return icf_mix(h, 0xfe);
+    h = icf_mix(h, (uint64_t)v->kind);
+    h = icf_mix_type(h, &v->type);
+    switch (v->kind) {
+        case ALIR_VAL_TEMP: {
+            int *num = icf_temp(t, f, v);
+            if (num && !*num) *num = ++t->count;
+            return icf_mix(h, num ? (uint64_t)*num : 0);
+        }
+        case ALIR_VAL_VAR:
+        case ALIR_VAL_GLOBAL:
+            if (icf_str_eq(v->val.str_val, f->func->name)) return icf_mix(h, 0xfd);
+            return icf_mix_str(h, v->val.str_val);
+        case ALIR_VAL_LABEL:
+            if (v->block) return icf_mix(h, (uint64_t)icf_block_pos(f, v->block));
+            return icf_mix_str(h, v->val.str_val);
+        case ALIR_VAL_TYPE:
+            return icf_mix_str(h, v->val.str_val);
+        case ALIR_VAL_CONST: {
+            ConstVal c = optlir_const_of(v);
+            uint64_t bits = (uint64_t)c.int_val;
+            if (c.is_float) memcpy(&bits, &c.double_val, sizeof(bits));
+            return icf_mix(h, bits);
+        }
+        default:
+            return icf_mix(h, v->val.unsigned_long_val);
+    }
+}
+
+/**
+ * @brief Hashes a function body and records its size, temp range and block positions.
+ * @param module The ALIR module.
+ * @param f The function.
+ */
+static void icf_hash(AlirModule *module, IcfFunc *f) {
+    AlirFunction *func = f->func;
+    hashmap_init(&f->blocks, alir_arena(module), 64);
+    f->size = 0;
+    f->max_temp = -1;
+    int pos = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        char key[32];
+        snprintf(key, sizeof(key), "%p", (void*)b);
+        hashmap_put(&f->blocks, key, (void*)(uintptr_t)++pos);
+        for (AlirInst *i = b->head; i; i = i->next) {
+            f->size++;
+            if (i->dest && i->dest->kind == ALIR_VAL_TEMP && i->dest->temp_id > f->max_temp) {
+                f->max_temp = i->dest->temp_id;
+            }
+        }
+    }
+
+    IcfTemps t = {calloc((size_t)f->max_temp + 2, sizeof(int)), 0};
+    uint64_t h = icf_mix_type(1469598103934665603ULL, &func->ret_type);
+    h = icf_mix(h, (uint64_t)func->param_count);
+    for (AlirParam *p = func->params; p; p = p->next) h = icf_mix_type(h, &p->type);
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        h = icf_mix(h, 0xfc);
+        for (AlirInst *i = b->head; i; i = i->next) {
+            h = icf_mix(h, (uint64_t)i->op);
+            h = icf_mix(h, (uint64_t)i->arg_count);
+            h = icf_mix_value(f, &t, h, i->dest);
+            h = icf_mix_value(f, &t, h, i->op1);
+            h = icf_mix_value(f, &t, h, i->op2);
+            for (int k = 0; k < i->arg_count; k++) h = icf_mix_value(f, &t, h, i->args[k]);
+        }
+    }
+    free(t.num);
+    f->hash = h;
+}
+
+/**
+ * @brief Two functions being compared and how their temps correspond so far.
+ */
+typedef struct IcfPair {
+    IcfFunc *a;
+    IcfFunc *b;
+    int *num_a;                 // temp id of a -> number + 1
+    int *num_b;                 // temp id of b -> number + 1
+    int count;
+} IcfPair;
+
+/**
+ * @brief Whether two operands at the same place of two bodies do the same.
+ * @param p The pair being compared.
+ * @param x Operand of the first body, or NULL.
+ * @param y Operand of the second body, or NULL.
+ * @param strict Non-zero if the signedness of their types has to match.
+ * @return Non-zero if they match.
+ */
+static int icf_value_eq(IcfPair *p, AlirValue *x, AlirValue *y, int strict) {
+    if (!x || !y) return x == y;
+    if (x->kind != y->kind || !icf_type_eq(&x->type, &y->type, strict)) return 0;
+    switch (x->kind) {
+        case ALIR_VAL_TEMP: {
+            if (x->temp_id < 0 || x->temp_id > p->a->max_temp) return 0;
+            if (y->temp_id < 0 || y->temp_id > p->b->max_temp) return 0;
+            int *na = &p->num_a[x->temp_id], *nb = &p->num_b[y->temp_id];
+            if (!*na && !*nb) *na = *nb = ++p->count;
+            return *na == *nb;
+        }
+        case ALIR_VAL_VAR:
+        case ALIR_VAL_GLOBAL: {
+            int self_x = icf_str_eq(x->val.str_val, p->a->func->name);
+            int self_y = icf_str_eq(y->val.str_val, p->b->func->name);
+            if (self_x || self_y) return self_x && self_y;
+            return icf_str_eq(x->val.str_val, y->val.str_val);
+        }
+        case ALIR_VAL_LABEL:
+            if (x->block && y->block) return icf_block_pos(p->a, x->block) == icf_block_pos(p->b, y->block);
+            return !x->block && !y->block && icf_str_eq(x->val.str_val, y->val.str_val);
+        case ALIR_VAL_TYPE:
+            return icf_str_eq(x->val.str_val, y->val.str_val);
+        case ALIR_VAL_CONST: {
+            if (x == y) return 1;   // Pooled constants, shared by both bodies
+            ConstVal cx = optlir_const_of(x), cy = optlir_const_of(y);
+            if (cx.is_float != cy.is_float) return 0;
+            return cx.is_float ? memcmp(&cx.double_val, &cy.double_val, sizeof(double)) == 0
+                               : cx.int_val == cy.int_val;
+        }
+        default:
+            return x->val.unsigned_long_val == y->val.unsigned_long_val;
+    }
+}
+
+/**
+ * @brief Whether two instructions at the same place of two bodies do the same.
+ * @param p The pair being compared.
+ * @param x Instruction of the first body.
+ * @param y Instruction of the second body.
+ * @return Non-zero if they match.
+ */
+static int icf_inst_eq(IcfPair *p, AlirInst *x, AlirInst *y) {
+    if (x->op != y->op || x->arg_count != y->arg_count) return 0;
+    if (!icf_value_eq(p, x->dest, y->dest, icf_strict(x, 0))) return 0;
+    if (!icf_value_eq(p, x->op1, y->op1, icf_strict(x, 1))) return 0;
+    if (!icf_value_eq(p, x->op2, y->op2, icf_strict(x, 2))) return 0;
+    for (int k = 0; k < x->arg_count; k++) {
+        if (!icf_value_eq(p, x->args[k], y->args[k], icf_strict(x, 3))) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Whether two functions of the same hash are identical.
+ * @param a The function that stays.
+ * @param b The function that would fold into it.
+ * @return Non-zero if every caller of b may call a instead.
+ */
+static int icf_equal(IcfFunc *a, IcfFunc *b) {
+    AlirFunction *fa = a->func, *fb = b->func;
+    if (a->size != b->size || fa->param_count != fb->param_count) return 0;
+    if (!icf_type_eq(&fa->ret_type, &fb->ret_type, 0) || !icf_str_eq(fa->cconv, fb->cconv)) return 0;
+    for (AlirParam *pa = fa->params, *pb = fb->params; pa && pb; pa = pa->next, pb = pb->next) {
+        if (!icf_type_eq(&pa->type, &pb->type, 0)) return 0;
+    }
+
+    IcfPair p = {a, b, calloc((size_t)a->max_temp + 2, sizeof(int)), calloc((size_t)b->max_temp + 2, sizeof(int)), 0};
+    int same = 1;
+    AlirBlock *ba = fa->blocks, *bb = fb->blocks;
+    for (; same && ba && bb; ba = ba->next, bb = bb->next) {
+        AlirInst *ia = ba->head, *ib = bb->head;
+        for (; same && ia && ib; ia = ia->next, ib = ib->next) same = icf_inst_eq(&p, ia, ib);
+        if (ia || ib) same = 0;
+    }
+    if (ba || bb) same = 0;
+    free(p.num_a);
+    free(p.num_b);
+    return same;
+}
+
+/**
+ * @brief Replaces the body of a function by a call of the function it folds into.
+ * @param module The ALIR module.
+ * @param f The function that folds.
+ * @param into The function that stays.
+ */
+static void icf_make_thunk(AlirModule *module, IcfFunc *f, IcfFunc *into) {
+    AlirFunction *func = f->func;
+    func->blocks = NULL;
+    func->block_count = 0;
+    AlirBlock *entry = alir_add_block(module, func, "entry");
+
+    AlirValue **args = alir_alloc(module, sizeof(AlirValue*) * (func->param_count ? func->param_count : 1));
+    int k = 0;
+    for (AlirParam *p = func->params; p; p = p->next, k++) {
+        char name[16];
+        snprintf(name, sizeof(name), "p%d", k);
+        args[k] = alir_val_var(module, name);
+        args[k]->type = p->type;
+    }
+
+    int returns = func->ret_type.base != TYPE_VOID || func->ret_type.ptr_depth > 0;
+    AlirValue *res = returns ? alir_val_temp(module, func->ret_type, 0) : NULL;
+    AlirInst *call = mk_inst(module, ALIR_OP_CALL, res, alir_val_var(module, into->func->name), NULL);
+    call->args = args;
+    call->arg_count = func->param_count;
+    alir_append_inst(entry, call);
+    alir_append_inst(entry, mk_inst(module, ALIR_OP_RET, NULL, res, NULL));
+}
+
+/**
+ * @brief Sends the direct calls of folded functions to the functions they fold into.
+ * @param module The ALIR module.
+ * @param cg The call graph of the module.
+ * @param by_node Candidate of each function node, or NULL.
+ */
+static void icf_redirect(AlirModule *module, OptlirCallGraph *cg, IcfFunc **by_node) {
+    for (int n = 0; n < cg->func_count; n++) {
+        for (AlirBlock *b = cg->nodes[n].func->blocks; b; b = b->next) {
+            for (AlirInst *i = b->head; i; i = i->next) {
+                if (i->op != ALIR_OP_CALL) continue;
+                int c = optlir_callgraph_callee(cg, i);
+                IcfFunc *f = c >= 0 ? by_node[c] : NULL;
+                if (!f || !f->into) continue;
+                AlirValue *callee = alir_alloc(module, sizeof(AlirValue));
+                *callee = *i->op1;
+                callee->val.str_val = f->into->func->name;
+                callee->def = NULL;
+                callee->uses = NULL;
+                alir_set_operand(module, i, &i->op1, callee);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Whether a function may fold into another or have others fold into it.
+ * @param func The function.
+ * @return Non-zero for plain functions with a body, main aside.
+ */
+static int icf_candidate(AlirFunction *func) {
+    if (!func->blocks || func->is_extern || func->is_flux || func->is_varargs) return 0;
+    return strcmp(func->name, "main") != 0;
+}
+
+/**
+ * @brief Runs one folding round over the functions not folded yet.
+ * @param module The ALIR module.
+ * @param cg The call graph of the module.
+ * @param by_node Candidate of each function node, or NULL.
+ * @return Number of functions folded.
+ */
+static int icf_round(AlirModule *module, OptlirCallGraph *cg, IcfFunc **by_node) {
+    HashMap buckets;
+    hashmap_init(&buckets, alir_arena(module), 64);
+    int folded = 0;
+    for (int n = 0; n < cg->func_count; n++) {
+        IcfFunc *f = by_node[n];
+        if (!f || f->into) continue;
+        icf_hash(module, f);
+        f->next = NULL;
+
+        char key[32];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)f->hash);
+        IcfFunc *head = hashmap_get(&buckets, key), *into = NULL, *last = NULL;
+        for (IcfFunc *g = head; g && !into; g = g->next) {
+            if (icf_equal(g, f)) into = g;
+            last = g;
+        }
+        if (!into) {
+            if (last) last->next = f;
+            else hashmap_put(&buckets, key, f);
+            continue;
+        }
+        // A thunk costs a call and a return, more than folding a body that small saves
+        if (f->taken && f->size <= ICF_THUNK_SIZE) continue;
+
+        f->into = into;
+        int saved = f->taken ? f->size - ICF_THUNK_SIZE : f->size;
+        if (f->taken) icf_make_thunk(module, f, into);
+        optlir_stats.icf_folded++;
+        optlir_stats.icf_bytes_saved += saved * OPTLIR_ICF_INST_BYTES;
+        folded++;
+        debug_optlir("icf: %s folded into %s%s\n", f->func->name, into->func->name, f->taken ? " as a thunk" : "");
+    }
+    if (folded) icf_redirect(module, cg, by_node);
+    if (!alir_arena(module)) hashmap_free(&buckets);
+    return folded;
+}
+
+/**
+ * @brief Folds functions whose optimized bodies are the same into one.
+ * @param module The ALIR module.
+ * @param cg The call graph of the module.
+ * @return Number of functions folded.
+ */
+int optlir_fold_identical(AlirModule *module, OptlirCallGraph *cg) {
+    if (!module || !alir_arena(module) || cg->func_count < 2) return 0;
+    IcfFunc **by_node = alir_alloc(module, sizeof(IcfFunc*) * cg->func_count);
+    int candidates = 0;
+    for (int n = 0; n < cg->func_count; n++) {
+        if (!icf_candidate(cg->nodes[n].func)) continue;
+        by_node[n] = alir_alloc(module, sizeof(IcfFunc));
+        by_node[n]->func = cg->nodes[n].func;
+        candidates++;
+    }
+    if (candidates < 2) return 0;
+
+    // Any use of a function but a direct call is a reference edge
+    for (int n = 0; n < cg->count; n++) {
+        for (int e = 0; e < cg->nodes[n].ref_count; e++) {
+            int to = cg->nodes[n].refs[e];
+            if (to < cg->func_count && by_node[to]) by_node[to]->taken = 1;
+        }
+    }
+
+    int folded = 0;
+    for (int round = 0; round < OPTLIR_ICF_MAX_ROUNDS; round++) {
+        int changes = icf_round(module, cg, by_node);
+        if (!changes) break;
+        folded += changes;
+    }
+    return folded;
+}
@@ -0,0 +1,462 @@
+/**
+ * @file indvar.c
+ * @brief Induction variables, strength reduction and trip counts of ALIR loops.
+ *
+ * Only loops with a preheader and a single latch are looked at, so every
+ * header phi has one entry from outside and one from the back edge. A
+ * derived value is rebuilt as a header phi of its own: the preheader
+ * computes its first value and the latch steps it, which leaves a GET_PTR
+ * of a counter as a pointer bump and a multiple of one as an add.
+ */
+#include "optlir.h"
+#include "optlir/local.h"
+#include "optlir/dom.h"
+#include "optlir/loop.h"
+#include "optlir/indvar.h"
+#include "optlir/pass.h"
+#include "alir/phi.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief A counter advanced by a constant on every trip.
+ */
+typedef struct IndvarIv {
+    AlirInst *phi;
+    AlirValue *init;            // Value on entry
+    long long step;
+} IndvarIv;
+
+/**
+ * @brief State of one run over a function.
+ */
+typedef struct IndvarCtx {
+    AlirModule *module;
+    OptlirDomTree *dom;
+    OptlirLoopForest *forest;
+    HashMap defs;               // "%p" of a defined value -> dominator index + 1 of its block
+    int next_temp;
+} IndvarCtx;
+
+/**
+ * @brief Whether a type is a signed integer an induction variable may have.
+ * @param t The type.
+ * @return Non-zero for plain int, long and long long.
+ */
+static int indvar_int_type(VarType t) {
+    if (t.ptr_depth || t.array_depth || t.array_size || t.is_tainted) return 0;
+    return t.base == TYPE_INT || t.base == TYPE_LONG || t.base == TYPE_LONG_LONG;
+}
+
+/**
+ * @brief Returns the block defining a value.
+ * @param ctx The context.
+ * @param v The value.
+ * @return Its dominator index, or -1 if no instruction defines it.
+ */
+static int indvar_def_block(IndvarCtx *ctx, AlirValue *v) {
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)v);
+    return (int)(uintptr_t)hashmap_get(&ctx->defs, key) - 1;
+}
+
+/**
+ * @brief Returns the integer constant a value holds.
+ * @param v The value.
+ * @param out Receives the constant.
+ * @return Non-zero if the value is an integer constant.
+ */
+static int indvar_const(AlirValue *v, long long *out) {
+    ConstVal c = optlir_const_of(v);
+    if (!c.is_const || c.is_float || (v && v->type.ptr_depth)) return 0;
+    *out = c.int_val;
+    return 1;
+}
+
+/**
+ * @brief Makes an integer constant of a given type.
+ * @param module The ALIR module.
+ * @param type The type.
+ * @param n The value.
+ * @return The constant.
+ */
+static AlirValue* indvar_make_const(AlirModule *module, VarType type, long long n) {
+    return alir_const_value(module, type, (Value){ .long_long_val = n });
+}
+
+/**
+ * @brief Puts an instruction right before a block's terminator.
+ * @param b The block.
+ * @param i The instruction.
+ */
+static void indvar_insert_before_tail(AlirBlock *b, AlirInst *i) {
+    AlirInst **link = &b->head;
+    while (*link != b->tail) link = &(*link)->next;
+    i->next = b->tail;
+    *link = i;
+}
+
+/**
+ * @brief Builds an instruction whose operands are recorded as uses.
+ * @param module The ALIR module.
+ * @param op The opcode.
+ * @param dest The result.
+ * @param a First operand.
+ * @param b Second operand.
+ * @return The instruction.
+ */
+static AlirInst* indvar_inst(AlirModule *module, AlirOpcode op, AlirValue *dest, AlirValue *a, AlirValue *b) {
+    AlirInst *i = mk_inst(module, op, dest, NULL, NULL);
+    alir_set_operand(module, i, &i->op1, a);
+    alir_set_operand(module, i, &i->op2, b);
+    dest->def = i;
+    return i;
+}
+
+/**
+ * @brief Finds the basic induction variables of a loop.
+ * @param ctx The context.
+ * @param loop The loop.
+ * @param latch The latch.
+ * @param ivs Receives the variables.
+ * @param cap Capacity of ivs.
+ * @return Number found.
+ */
+static int indvar_find(IndvarCtx *ctx, OptlirLoop *loop, AlirBlock *latch, IndvarIv *ivs, int cap) {
+    int n = 0;
+    AlirBlock *header = ctx->dom->blocks[loop->header];
+    for (AlirInst *phi = header->head; phi && phi->op == ALIR_OP_PHI && n < cap; phi = phi->next) {
+        if (phi->arg_count != 4 || !phi->dest || !indvar_int_type(phi->dest->type)) continue;
+        // One entry comes round the back edge, the other from outside
+        int back = phi->args[0]->block == latch ? 0 : 2;
+        if (phi->args[back]->block != latch) continue;
+        AlirValue *init = phi->args[3 - back];
+        AlirValue *next = phi->args[back + 1];
+        AlirInst *d = next ? next->def : NULL;
+        if (!init || !d || (d->op != ALIR_OP_ADD && d->op != ALIR_OP_SUB)) continue;
+
+        long long step;
+        if (d->op1 == phi->dest && indvar_const(d->op2, &step)) {
+            if (d->op == ALIR_OP_SUB) step = -step;
+        } else if (d->op != ALIR_OP_ADD || d->op2 != phi->dest || !indvar_const(d->op1, &step)) {
+            continue;
+        }
+        if (step == 0) continue;
+        ivs[n++] = (IndvarIv){ phi, init, step };
+    }
+    return n;
+}
+
+/**
+ * @brief Returns the induction variable a value is.
+ * @param ivs The variables.
+ * @param n Their number.
+ * @param v The value.
+ * @return The variable, or NULL.
+ */
+static IndvarIv* indvar_lookup(IndvarIv *ivs, int n, AlirValue *v) {
+    for (int k = 0; k < n; k++) {
+        if (ivs[k].phi->dest == v) return &ivs[k];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Works out how often a loop's header test passes.
+ *
+ * The header has to be the only block leaving the loop, and its test a
+ * comparison of a counter that starts at a constant with a constant.
+ *
+ * @param ctx The context.
+ * @param loop The loop.
+ * @param ivs The induction variables of the loop.
+ * @param n Their number.
+ * @return The trip count, or -1 if it is not known.
+ */
+static long long indvar_trip_count(IndvarCtx *ctx, OptlirLoop *loop, IndvarIv *ivs, int n) {
+    AlirBlock *header = ctx->dom->blocks[loop->header];
+    AlirInst *br = header->tail;
+    if (!br || br->op != ALIR_OP_CONDI || br->arg_count != 1 || !br->op2 || !br->args[0]) return -1;
+    if (!optlir_loop_contains(ctx->forest, loop, optlir_dom_index(ctx->dom, br->op2->block))) return -1;
+    if (optlir_loop_contains(ctx->forest, loop, optlir_dom_index(ctx->dom, br->args[0]->block))) return -1;
+    for (int k = 0; k < loop->block_count; k++) {
+        int bi = loop->blocks[k];
+        AlirBlock *b = ctx->dom->blocks[bi];
+        if (bi == loop->header) continue;
+        if (!b->succ) return -1;
+        for (BlockEdge *e = b->succ; e; e = e->next) {
+            if (!optlir_loop_contains(ctx->forest, loop, optlir_dom_index(ctx->dom, e->block))) return -1;
+        }
+    }
+
+    AlirInst *cmp = br->op1 ? br->op1->def : NULL;
+    if (!cmp || indvar_def_block(ctx, br->op1) != loop->header) return -1;
+    AlirOpcode op = cmp->op;
+    if (op == ALIR_OP_NOT) {
+        // x >= y comes out of the front end as !(x < y)
+        cmp = cmp->op1 ? cmp->op1->def : NULL;
+        if (!cmp) return -1;
+        switch (cmp->op) {
+            case ALIR_OP_LT: op = ALIR_OP_GTE; break;
+            case ALIR_OP_GT: op = ALIR_OP_LTE; break;
+            case ALIR_OP_LTE: op = ALIR_OP_GT; break;
+            case ALIR_OP_GTE: op = ALIR_OP_LT; break;
+            default: return -1;
+        }
+    }
+    IndvarIv *iv = indvar_lookup(ivs, n, cmp->op1);
+    AlirValue *bound_val = cmp->op2;
+    if (!iv) {
+        // Put the counter on the left
+        iv = indvar_lookup(ivs, n, cmp->op2);
+        bound_val = cmp->op1;
+        if (op == ALIR_OP_LT) op = ALIR_OP_GT;
+        else if (op == ALIR_OP_GT) op = ALIR_OP_LT;
+        else if (op == ALIR_OP_LTE) op = ALIR_OP_GTE;
+        else if (op == ALIR_OP_GTE) op = ALIR_OP_LTE;
+    }
+    long long init, bound, step = iv ? iv->step : 0;
+    if (!iv || !indvar_const(iv->init, &init) || !indvar_const(bound_val, &bound)) return -1;
+    if (iv->phi->dest->type.base == TYPE_INT) {
+        // The counter must not wrap before the test fails
+        long long lo = -2147483648LL, hi = 2147483647LL;
+        if (bound + step < lo || bound + step > hi) return -1;
+    } else if (bound > (1LL << 52) || bound < -(1LL << 52) || step > (1LL << 20) || step < -(1LL << 20)) {
+        return -1;
+    }
+
+    switch (op) {
+        case ALIR_OP_LT:
+            if (step < 0) return -1;
+            return init < bound ? (bound - init + step - 1) / step : 0;
+        case ALIR_OP_LTE:
+            if (step < 0) return -1;
+            return init <= bound ? (bound - init) / step + 1 : 0;
+        case ALIR_OP_GT:
+            if (step > 0) return -1;
+            return init > bound ? (init - bound - step - 1) / -step : 0;
+        case ALIR_OP_GTE:
+            if (step > 0) return -1;
+            return init >= bound ? (init - bound) / -step + 1 : 0;
+        case ALIR_OP_NEQ:
+            if ((bound - init) % step != 0 || (bound - init) / step < 0) return -1;
+            return (bound - init) / step;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * @brief Replaces an address or multiple of a counter with a running value.
+ * @param ctx The context.
+ * @param i The instruction, already checked.
+ * @param iv The counter it derives from.
+ * @param pre The preheader.
+ * @param latch The latch.
+ * @param header The header.
+ */
+static void indvar_reduce(IndvarCtx *ctx, AlirInst *i, IndvarIv *iv, AlirBlock *pre, AlirBlock *latch, AlirBlock *header) {
+    AlirModule *module = ctx->module;
+    VarType type = i->dest->type;
+    AlirValue *run = alir_val_temp(module, type, ctx->next_temp++);
+    AlirValue *first = alir_val_temp(module, type, ctx->next_temp++);
+    AlirValue *next = alir_val_temp(module, type, ctx->next_temp++);
+
+    AlirInst *start, *advance;
+    if (i->op == ALIR_OP_GET_PTR) {
+        start = indvar_inst(module, ALIR_OP_GET_PTR, first, i->op1, iv->init);
+        advance = indvar_inst(module, ALIR_OP_GET_PTR, next, run, alir_const_int(module, iv->step));
+    } else {
+        AlirValue *factor = i->op1 == iv->phi->dest ? i->op2 : i->op1;
+        long long c;
+        indvar_const(factor, &c);
+        long long delta = i->op == ALIR_OP_MUL ? iv->step * c : iv->step * (1LL << c);
+        int left = i->op1 == iv->phi->dest;
+        start = indvar_inst(module, i->op, first, left ? iv->init : factor, left ? factor : iv->init);
+        advance = indvar_inst(module, ALIR_OP_ADD, next, run, indvar_make_const(module, type, delta));
+    }
+    indvar_insert_before_tail(pre, start);
+    indvar_insert_before_tail(latch, advance);
+
+    AlirInst *phi = alir_phi_create(module, run, 2);
+    alir_phi_add_incoming(module, phi, pre, first);
+    alir_phi_add_incoming(module, phi, latch, next);
+    alir_phi_insert(header, phi);
+
+    alir_replace_all_uses(i->dest, run);
+    alir_drop_uses(i);
+
+    // Loops around this one see the new values as defined where they are
+    char key[32];
+    AlirValue *made[3] = { first, next, run };
+    AlirBlock *where[3] = { pre, latch, header };
+    for (int k = 0; k < 3; k++) {
+        snprintf(key, sizeof(key), "%p", (void*)made[k]);
+        hashmap_put(&ctx->defs, key, (void*)(uintptr_t)(optlir_dom_index(ctx->dom, where[k]) + 1));
+    }
+}
+
+/**
+ * @brief Whether an instruction derives a running value from a counter.
+ * @param ctx The context.
+ * @param loop The loop.
+ * @param ivs The induction variables of the loop.
+ * @param n Their number.
+ * @param i The instruction.
+ * @return The counter, or NULL if the instruction stays.
+ */
+static IndvarIv* indvar_candidate(IndvarCtx *ctx, OptlirLoop *loop, IndvarIv *ivs, int n, AlirInst *i) {
+    if (!i->dest || i->dest->kind != ALIR_VAL_TEMP) return NULL;
+    long long c;
+    if (i->op == ALIR_OP_GET_PTR) {
+        IndvarIv *iv = indvar_lookup(ivs, n, i->op2);
+        if (!iv || !i->op1 || i->op1->type.is_tainted || i->dest->type.ptr_depth == 0) return NULL;
+        if (optlir_loop_contains(ctx->forest, loop, indvar_def_block(ctx, i->op1))) return NULL;
+        // Field addresses take a constant index; a class element is read as one
+        VarType base = i->op1->type, elem = i->dest->type;
+        if (base.ptr_depth > 0) base.ptr_depth--;
+        elem.ptr_depth--;
+        if (base.base == TYPE_CLASS && base.ptr_depth == 0) return NULL;
+        if (elem.base == TYPE_CLASS && elem.ptr_depth == 0) return NULL;
+        return iv;
+    }
+    if (!indvar_int_type(i->dest->type)) return NULL;
+    if (i->op == ALIR_OP_MUL) {
+        IndvarIv *iv = indvar_lookup(ivs, n, i->op1);
+        if (iv && indvar_const(i->op2, &c)) return iv;
+        iv = indvar_lookup(ivs, n, i->op2);
+        if (iv && indvar_const(i->op1, &c)) return iv;
+        return NULL;
+    }
+    if (i->op == ALIR_OP_SHL) {
+        IndvarIv *iv = indvar_lookup(ivs, n, i->op1);
+        if (iv && indvar_const(i->op2, &c) && c >= 0 && c < 31) return iv;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Strength-reduces one loop and records its trip count.
+ * @param ctx The context.
+ * @param loop The loop.
+ * @param dry Only tell whether anything could be reduced.
+ * @return Number of instructions strength-reduced, or found reducible when dry.
+ */
+static int indvar_loop(IndvarCtx *ctx, OptlirLoop *loop, int dry) {
+    if (loop->latch_count != 1) return 0;
+    AlirBlock *pre = loop->preheader;
+    AlirBlock *latch = ctx->dom->blocks[loop->latches[0]];
+    AlirBlock *header = ctx->dom->blocks[loop->header];
+    if ((pre && !pre->tail) || !latch->tail) return 0;
+
+    IndvarIv ivs[16];
+    int n = indvar_find(ctx, loop, latch, ivs, 16);
+    if (!n) return 0;
+
+    long long trips = dry ? -1 : indvar_trip_count(ctx, loop, ivs, n);
+    if (trips > 0) {
+        header->trip_count = (long)trips;
+        latch->loop_latch = 1;
+        optlir_stats.indvar_trip_counts++;
+        debug_optlir("indvar: %s runs %lld times\n", header->label, trips);
+    }
+
+    if (!dry && !pre) return 0;
+    int reduced = 0;
+    for (int k = 0; k < loop->block_count; k++) {
+        AlirBlock *b = ctx->dom->blocks[loop->blocks[k]];
+        AlirInst *prev = NULL, *i = b->head;
+        while (i) {
+            AlirInst *next = i->next;
+            IndvarIv *iv = indvar_candidate(ctx, loop, ivs, n, i);
+            if (!iv) {
+                prev = i;
+                i = next;
+                continue;
+            }
+            if (dry) return 1;
+            indvar_reduce(ctx, i, iv, pre, latch, header);
+            if (prev) prev->next = next;
+            else b->head = next;
+            if (b->tail == i) b->tail = prev;
+            reduced++;
+            i = next;
+        }
+    }
+    return reduced;
+}
+
+/**
+ * @brief Records the block of every value defined in the function.
+ * @param ctx The context.
+ */
+static void indvar_index_defs(IndvarCtx *ctx) {
+    Arena *arena = alir_arena(ctx->module);
+    hashmap_init(&ctx->defs, arena, 64);
+    char key[32];
+    for (int bi = 0; bi < ctx->dom->count; bi++) {
+        for (AlirInst *i = ctx->dom->blocks[bi]->head; i; i = i->next) {
+            if (!i->dest) continue;
+            if (i->dest->kind == ALIR_VAL_TEMP && i->dest->temp_id >= ctx->next_temp) ctx->next_temp = i->dest->temp_id + 1;
+            snprintf(key, sizeof(key), "%p", (void*)i->dest);
+            hashmap_put(&ctx->defs, key, (void*)(uintptr_t)(bi + 1));
+        }
+    }
+}
+
+/**
+ * @brief Rewrites values derived from a loop counter into running values and
+ * records the trip counts of counted loops.
+ * @param module The ALIR module.
+ * @param func The function (SSA form).
+ * @return Number of changes: instructions strength-reduced and preheaders created.
+ */
+int optlir_indvar_function(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks || func->is_extern) return 0;
+    Arena *arena = alir_arena(module);
+
+    // Marks from an earlier round may no longer hold; the stats count them once
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        if (b->trip_count > 0) optlir_stats.indvar_trip_counts--;
+        b->trip_count = 0;
+        b->loop_latch = 0;
+    }
+
+    optlir_require_uses(module, func);
+    IndvarCtx ctx = {0};
+    ctx.module = module;
+    ctx.dom = optlir_require_dom(module, func);
+    ctx.forest = optlir_loops_build(module, ctx.dom);
+    if (!ctx.forest->count) return 0;
+
+    indvar_index_defs(&ctx);
+
+    // Loops with something to reduce and no preheader get one first
+    int made = 0;
+    for (int k = 0; k < ctx.forest->count; k++) {
+        OptlirLoop *loop = ctx.forest->loops[k];
+        if (loop->preheader || !indvar_loop(&ctx, loop, 1)) continue;
+        if (optlir_loop_make_preheader(module, func, ctx.forest, loop)) made++;
+    }
+    if (made) {
+        if (!arena) hashmap_free(&ctx.defs);
+        optlir_invalidate(func, OPTLIR_AN_CFG);
+        ctx.dom = optlir_require_dom(module, func);
+        ctx.forest = optlir_loops_build(module, ctx.dom);
+        indvar_index_defs(&ctx);
+    }
+
+    int reduced = 0;
+    for (int k = 0; k < ctx.forest->count; k++) {
+        reduced += indvar_loop(&ctx, ctx.forest->loops[k], 0);
+    }
+
+    if (reduced > 0) {
+        optlir_stats.indvar_reduced += reduced;
+        debug_optlir("indvar: %s: %d instructions strength-reduced\n", func->name, reduced);
+    }
+    if (!arena) hashmap_free(&ctx.defs);
+    return reduced + made;
+}
@@ -0,0 +1,593 @@
+/**
+ * @file inline.c
+ * @brief Bottom-up ALIR function inliner with a size-based cost model.
+ *
+ * Functions are visited callees first, over the strongly connected
+ * components of the call graph, so a callee already has its own calls
+ * inlined when its size is measured. Calls inside a component (recursion)
+ * are never inlined.
+ */
+#include "optlir.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#define INLINE_THRESHOLD        24      // Callee instructions inlined at -O2
+#define INLINE_THRESHOLD_O3     48      // Callee instructions inlined at -O3
+#define INLINE_CONST_ARG_BONUS  6       // Per constant argument, for the folding it enables
+#define INLINE_PURE_BONUS       8       // Pure callees have no effects to keep in order
+#define INLINE_ONCE_BONUS       24      // A callee with one call site is removed afterwards
+#define INLINE_CALLER_LIMIT     4000    // Callers past this size get nothing more inlined
+
+/**
+ * @brief A function in the call graph.
+ */
+typedef struct InlineNode {
+    AlirFunction *func;
+    int *callees;           // Node indices of the direct callees
+    int callee_count;
+    int calls;              // Direct call sites in the module
+    int size;               // Instruction count
+    int scc;                // Strongly connected component
+    int index;              // Tarjan numbering, -1 if unvisited
+    int low;
+    int on_stack;
+} InlineNode;
+
+/**
+ * @brief State of one inliner run.
+ */
+typedef struct InlineRun {
+    AlirModule *module;
+    InlineNode *nodes;
+    int count;
+    OptlirCallGraph *cg;    // Module call graph; node k is the k-th function
+    int threshold;
+    int site;               // Inlined call sites so far, for unique labels
+    int next_temp;          // Next free temp id of the current caller
+    AlirValue **args;       // Arguments of the call being inlined
+    HashMap blocks;         // "%p" of a callee block -> its copy
+    HashMap temps;          // callee temp id -> its copy
+} InlineRun;
+
+/**
+ * @brief Returns the parameter index a value name refers to.
+ * @param name The name of a variable value.
+ * @return The index of "p<k>", or -1 for any other name.
+ */
+static int inline_param_index(const char *name) {
+    if (!name || name[0] != 'p' || !isdigit((unsigned char)name[1])) return -1;
+    int k = 0;
+    for (const char *c = name + 1; *c; c++) {
+        if (!isdigit((unsigned char)*c)) return -1;
+        k = k * 10 + (*c - '0');
+    }
+    return k;
+}
+
+/**
+ * @brief Returns the graph node a direct call targets.
+ * @param run The inliner state.
+ * @param call The call instruction.
+ * @return The callee node index, or -1 for indirect and unknown callees.
+ */
+static int inline_callee(InlineRun *run, AlirInst *call) {
+    return optlir_callgraph_callee(run->cg, call);
+}
+
+/**
+ * @brief Whether a variable name is a function of the module.
+ * @param run The inliner state.
+ * @param name The variable name.
+ * @return Non-zero for function names.
+ */
+static int inline_is_function(InlineRun *run, const char *name) {
+    int n = optlir_callgraph_find(run->cg, name);
+    return n >= 0 && n < run->cg->func_count;
+}
+
+/**
+ * @brief Counts the instructions of a function.
+ * @param func The function.
+ * @return Its instruction count.
+ */
+static int inline_size(AlirFunction *func) {
+    int n = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Takes the function nodes from the module call graph.
+ * @param run The inliner state receiving the nodes.
+ */
+static void inline_build_graph(InlineRun *run) {
+    run->count = run->cg->func_count;
+    run->nodes = alir_alloc(run->module, sizeof(InlineNode) * (run->count ? run->count : 1));
+
+    for (int n = 0; n < run->count; n++) {
+        OptlirCgNode *cg_node = &run->cg->nodes[n];
+        InlineNode *node = &run->nodes[n];
+        node->func = cg_node->func;
+        node->callees = cg_node->calls;
+        node->callee_count = cg_node->call_count;
+        node->calls = cg_node->callers;
+        node->size = inline_size(node->func);
+        node->index = -1;
+    }
+}
+
+/**
+ * @brief Orders the functions callees first (Tarjan's algorithm, iterative).
+ * @param run The inliner state; every node gets its component.
+ * @param order Receives the node indices, callees before their callers.
+ */
+static void inline_order(InlineRun *run, int *order) {
+    int *stack = alir_alloc(run->module, sizeof(int) * (run->count ? run->count : 1));
+    int *frames = alir_alloc(run->module, sizeof(int) * (run->count ? run->count : 1));
+    int *edge = alir_alloc(run->module, sizeof(int) * (run->count ? run->count : 1));
+    int sp = 0, fp = 0, next_index = 0, scc = 0, done = 0;
+
+    for (int root = 0; root < run->count; root++) {
+        if (run->nodes[root].index >= 0) continue;
+        frames[fp++] = root;
+        edge[root] = 0;
+        run->nodes[root].index = run->nodes[root].low = next_index++;
+        run->nodes[root].on_stack = 1;
+        stack[sp++] = root;
+
+        while (fp > 0) {
+            int v = frames[fp - 1];
+            InlineNode *node = &run->nodes[v];
+            if (edge[v] < node->callee_count) {
+                int w = node->callees[edge[v]++];
+                InlineNode *callee = &run->nodes[w];
+                if (callee->index < 0) {
+                    callee->index = callee->low = next_index++;
+                    callee->on_stack = 1;
+                    stack[sp++] = w;
+                    edge[w] = 0;
+                    frames[fp++] = w;
+                } else if (callee->on_stack && callee->index < node->low) {
+                    node->low = callee->index;
+                }
+                continue;
+            }
+
+            fp--;
+            if (node->low == node->index) {
+                int w;
+                do {
+                    w = stack[--sp];
+                    run->nodes[w].on_stack = 0;
+                    run->nodes[w].scc = scc;
+                    order[done++] = w;
+                } while (w != v);
+                scc++;
+            }
+            if (fp > 0) {
+                InlineNode *parent = &run->nodes[frames[fp - 1]];
+                if (node->low < parent->low) parent->low = node->low;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Whether a function type is returned through a register.
+ * @param type The return type.
+ * @return Non-zero for scalars and pointers, zero for aggregates.
+ */
+static int inline_scalar_return(VarType type) {
+    if (type.is_tainted) return 0;
+    if (type.ptr_depth > 0) return 1;
+    if (type.array_depth > 0 || type.array_size > 0) return 0;
+    return type.base != TYPE_CLASS && type.base != TYPE_ARRAY;
+}
+
+/**
+ * @brief Whether a type is a plain number, converted implicitly at calls.
+ * @param type The type.
+ * @return Non-zero for integer, boolean and floating-point scalars.
+ */
+static int inline_numeric(VarType type) {
+    if (type.ptr_depth > 0 || type.array_depth > 0) return 0;
+    return type.base >= TYPE_INT && type.base <= TYPE_LONG_DOUBLE;
+}
+
+/**
+ * @brief Converts the arguments of a call to the callee's parameter types.
+ *
+ * A call converts its numeric arguments implicitly; once the body reads the
+ * arguments directly, the conversion has to be spelled out, as promote()
+ * does while generating ALIR.
+ *
+ * @param run The inliner state.
+ * @param b The block receiving the casts.
+ * @param call The call instruction.
+ * @param callee The called function.
+ * @return The argument values the body reads.
+ */
+static AlirValue** inline_args(InlineRun *run, AlirBlock *b, AlirInst *call, AlirFunction *callee) {
+    AlirValue **args = alir_alloc(run->module, sizeof(AlirValue*) * (call->arg_count ? call->arg_count : 1));
+    AlirParam *param = callee->params;
+    for (int k = 0; k < call->arg_count; k++, param = param ? param->next : NULL) {
+        AlirValue *arg = call->args[k];
+        args[k] = arg;
+        if (!arg || !param || !inline_numeric(arg->type) || !inline_numeric(param->type)) continue;
+        if (arg->type.base == param->type.base) continue;
+
+        AlirValue *dest = alir_val_temp(run->module, param->type, run->next_temp++);
+        AlirInst *cast = mk_inst(run->module, ALIR_OP_CAST, dest, NULL, NULL);
+        cast->line = call->line;
+        cast->col = call->col;
+        dest->def = cast;
+        alir_set_operand(run->module, cast, &cast->op1, arg);
+        alir_append_inst(b, cast);
+        args[k] = dest;
+    }
+    return args;
+}
+
+/**
+ * @brief Whether a callee's body can be copied into a caller at a call.
+ *
+ * The body may only refer to its parameters, other functions, globals and
+ * its own temps, may not size its stack at run time, and has to return.
+ * Aggregates returned by value, as the flux init functions do with their
+ * context and tainted functions do with their error, are left to the
+ * backends. A panic purges out of a function that returns an aggregate
+ * instead of exiting, so it only moves into callers that return a scalar.
+ *
+ * @param run The inliner state.
+ * @param call The call instruction.
+ * @param caller The calling function.
+ * @param callee The called function.
+ * @return Non-zero if the call can be inlined.
+ */
+static int inline_legal(InlineRun *run, AlirInst *call, AlirFunction *caller, AlirFunction *callee) {
+    if (!callee->blocks || callee->is_extern || callee->is_flux || callee->is_varargs) return 0;
+    if (callee->cconv || callee->inline_hint < 0) return 0;
+    if (call->arg_count != callee->param_count) return 0;
+    if (call->dest && callee->ret_type.base == TYPE_VOID && callee->ret_type.ptr_depth == 0) return 0;
+    if (callee->ret_type.base != TYPE_VOID && !inline_scalar_return(callee->ret_type)) return 0;
+
+    VarType rt = caller->ret_type;
+    int panic_exits = rt.base == TYPE_VOID && rt.ptr_depth == 0 ? !rt.is_tainted : inline_scalar_return(rt);
+    int returns = 0;
+    for (AlirBlock *b = callee->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->op == ALIR_OP_RET) returns++;
+            if (i->op == ALIR_OP_ALLOCA && i->op1) return 0;
+            if (i->op == ALIR_OP_PANIC && !panic_exits) return 0;
+            AlirValue *ops[2] = {i->op1, i->op2};
+            for (int k = 0; k < 2; k++) {
+                AlirValue *v = ops[k];
+                if (!v || v->kind != ALIR_VAL_VAR) continue;
+                int p = inline_param_index(v->val.str_val);
+                if (p >= callee->param_count) return 0;
+                if (p < 0 && !inline_is_function(run, v->val.str_val)) return 0;
+            }
+            for (int k = 0; k < i->arg_count; k++) {
+                AlirValue *v = i->args[k];
+                if (!v || v->kind != ALIR_VAL_VAR) continue;
+                int p = inline_param_index(v->val.str_val);
+                if (p >= callee->param_count) return 0;
+                if (p < 0 && !inline_is_function(run, v->val.str_val)) return 0;
+            }
+        }
+    }
+    return returns > 0;
+}
+
+/**
+ * @brief Applies the cost model to a call.
+ * @param run The inliner state.
+ * @param call The call instruction.
+ * @param callee The callee node.
+ * @return Non-zero if the call is worth inlining.
+ */
+static int inline_worth(InlineRun *run, AlirInst *call, InlineNode *callee) {
+    if (callee->func->inline_hint > 0) return 1;
+
+    int budget = run->threshold;
+    for (int k = 0; k < call->arg_count; k++) {
+        if (call->args[k] && call->args[k]->kind == ALIR_VAL_CONST) budget += INLINE_CONST_ARG_BONUS;
+    }
+    if (callee->func->is_pure) budget += INLINE_PURE_BONUS;
+    if (callee->calls == 1) budget += INLINE_ONCE_BONUS;
+    return callee->size <= budget;
+}
+
+/**
+ * @brief Returns the caller-side copy of a callee value.
+ *
+ * Labels move to the copied blocks, parameters become the call arguments
+ * and every temp gets a fresh id in the caller. Other values are copied so
+ * that the caller's passes never rewrite a value the callee still reads,
+ * except pooled ones, which nothing rewrites.
+ *
+ * @param run The inliner state.
+ * @param v The callee value.
+ * @return The value to use in the caller.
+ */
+static AlirValue* inline_value(InlineRun *run, AlirValue *v) {
+    if (!v) return NULL;
+    char key[32];
+    switch (v->kind) {
+        case ALIR_VAL_LABEL: {
+            if (!v->block) return v;
+            snprintf(key, sizeof(key), "%p", (void*)v->block);
+            AlirBlock *copy = hashmap_get(&run->blocks, key);
+            return copy ? alir_val_block(run->module, copy) : v;
+        }
+        case ALIR_VAL_TYPE:
+            return v;
+        case ALIR_VAL_TEMP: {
+            snprintf(key, sizeof(key), "%d", v->temp_id);
+            AlirValue *copy = hashmap_get(&run->temps, key);
+            if (!copy) {
+                copy = alir_val_temp(run->module, v->type, run->next_temp++);
+                hashmap_put(&run->temps, key, copy);
+            }
+            return copy;
+        }
+        case ALIR_VAL_VAR: {
+            int p = inline_param_index(v->val.str_val);
+            if (p < 0) break;
+            // Constants get a copy per use, temps are shared with their def
+            v = run->args[p];
+            if (!v || v->kind != ALIR_VAL_CONST) return v;
+            break;
+        }
+        default:
+            break;
+    }
+    if (v->pooled) return v;
+    AlirValue *copy = alir_alloc(run->module, sizeof(AlirValue));
+    *copy = *v;
+    copy->def = NULL;
+    copy->uses = NULL;
+    return copy;
+}
+
+/**
+ * @brief Copies one callee instruction into the caller.
+ * @param run The inliner state.
+ * @param i The callee instruction.
+ * @return The copy, with its operands registered on the caller's chains.
+ */
+static AlirInst* inline_copy_inst(InlineRun *run, AlirInst *i) {
+    AlirModule *module = run->module;
+    AlirInst *n = mk_inst(module, i->op, inline_value(run, i->dest), NULL, NULL);
+    n->line = i->line;
+    n->col = i->col;
+    n->custom_flag = i->custom_flag;
+    if (n->dest) n->dest->def = n;
+    alir_set_operand(module, n, &n->op1, inline_value(run, i->op1));
+    alir_set_operand(module, n, &n->op2, inline_value(run, i->op2));
+    if (i->arg_count > 0) {
+        int capacity = i->arg_count;
+        if ((i->op == ALIR_OP_PHI || i->op == ALIR_OP_SWITCH) && i->custom_flag * 2 > capacity) {
+            capacity = i->custom_flag * 2;
+        }
+        n->args = alir_alloc(module, sizeof(AlirValue*) * capacity);
+        n->arg_count = i->arg_count;
+        for (int k = 0; k < i->arg_count; k++) {
+            alir_set_operand(module, n, &n->args[k], inline_value(run, i->args[k]));
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Makes a block for the caller with a label unique to this call site.
+ * @param run The inliner state.
+ * @param hint The label of the block it stands for.
+ * @return The new, empty block.
+ */
+static AlirBlock* inline_block(InlineRun *run, const char *hint) {
+    char label[160];
+    snprintf(label, sizeof(label), "i%d.%s", run->site, hint ? hint : "L");
+    AlirBlock *b = alir_alloc(run->module, sizeof(AlirBlock));
+    b->label = alir_strdup(run->module, label);
+    return b;
+}
+
+/**
+ * @brief Replaces a call with a copy of the callee's body.
+ *
+ * The block holding the call is split after it; the callee's returns jump
+ * to the second half, where a phi collects the returned values when there
+ * are several. Fixed-size stack slots of the callee move to the caller's
+ * entry block, so a call inside a loop keeps one slot.
+ *
+ * @param run The inliner state.
+ * @param caller The calling function.
+ * @param b The block holding the call.
+ * @param prev The instruction before the call, or NULL.
+ * @param call The call instruction.
+ * @param callee The called function.
+ * @return The block holding the instructions that followed the call.
+ */
+static AlirBlock* inline_call(InlineRun *run, AlirFunction *caller, AlirBlock *b, AlirInst *prev, AlirInst *call, AlirFunction *callee) {
+    AlirModule *module = run->module;
+    Arena *arena = alir_arena(module);
+    run->site++;
+    hashmap_init(&run->blocks, arena, callee->block_count > 16 ? callee->block_count * 2 : 32);
+    hashmap_init(&run->temps, arena, 64);
+
+    // Split the block after the call
+    AlirBlock *cont = inline_block(run, "ret");
+    cont->head = call->next;
+    cont->tail = cont->head ? b->tail : NULL;
+    if (prev) prev->next = NULL;
+    else b->head = NULL;
+    b->tail = prev;
+    if (cont->tail) {
+        int n = alir_branch_count(cont->tail);
+        for (int k = 0; k < n; k++) {
+            AlirValue **slot = alir_branch_slot(cont->tail, k);
+            if (slot && (*slot)->block) alir_phi_rename_pred(module, (*slot)->block, b, cont);
+        }
+    }
+
+    run->args = inline_args(run, b, call, callee);
+
+    // Copy the blocks, then their instructions
+    AlirBlock *first = NULL, *last = NULL;
+    char key[32];
+    for (AlirBlock *cb = callee->blocks; cb; cb = cb->next) {
+        AlirBlock *copy = inline_block(run, cb->label);
+        snprintf(key, sizeof(key), "%p", (void*)cb);
+        hashmap_put(&run->blocks, key, copy);
+        if (last) last->next = copy;
+        else first = copy;
+        last = copy;
+        copy->id = caller->block_count++;
+    }
+
+    AlirInst *hoisted = NULL, *hoisted_tail = NULL;
+    AlirBlock **ret_blocks = alir_alloc(module, sizeof(AlirBlock*) * callee->block_count);
+    AlirValue **ret_vals = alir_alloc(module, sizeof(AlirValue*) * callee->block_count);
+    int returns = 0;
+    AlirBlock *copy = first;
+    for (AlirBlock *cb = callee->blocks; cb; cb = cb->next, copy = copy->next) {
+        for (AlirInst *i = cb->head; i; i = i->next) {
+            if (i->op == ALIR_OP_RET) {
+                ret_blocks[returns] = copy;
+                ret_vals[returns++] = inline_value(run, i->op1);
+                alir_append_inst(copy, mk_inst(module, ALIR_OP_JUMP, NULL, alir_val_block(module, cont), NULL));
+                break;
+            }
+            AlirInst *n = inline_copy_inst(run, i);
+            if (n->op == ALIR_OP_ALLOCA) {
+                if (hoisted_tail) hoisted_tail->next = n;
+                else hoisted = n;
+                hoisted_tail = n;
+                continue;
+            }
+            alir_append_inst(copy, n);
+        }
+    }
+
+    alir_append_inst(b, mk_inst(module, ALIR_OP_JUMP, NULL, alir_val_block(module, first), NULL));
+    last->next = cont;
+    cont->next = b->next;
+    b->next = first;
+    cont->id = caller->block_count++;
+
+    if (hoisted) {
+        AlirBlock *entry = caller->blocks;
+        hoisted_tail->next = entry->head;
+        entry->head = hoisted;
+        if (!entry->tail) entry->tail = hoisted_tail;
+    }
+
+    // Hand the returned value to the call's users
+    if (call->dest && returns == 1) {
+        alir_replace_all_uses(call->dest, ret_vals[0]);
+    } else if (call->dest) {
+        AlirInst *phi = alir_phi_create(module, call->dest, returns);
+        for (int k = 0; k < returns; k++) alir_phi_add_incoming(module, phi, ret_blocks[k], ret_vals[k]);
+        alir_phi_insert(cont, phi);
+        call->dest->def = phi;
+    }
+    alir_drop_uses(call);
+
+    if (!arena) {
+        hashmap_free(&run->blocks);
+        hashmap_free(&run->temps);
+    }
+    return cont;
+}
+
+/**
+ * @brief Inlines the profitable calls of one function.
+ * @param run The inliner state.
+ * @param node The caller node.
+ * @return Number of calls inlined.
+ */
+static int inline_function(InlineRun *run, InlineNode *node) {
+    AlirFunction *caller = node->func;
+    if (!caller->blocks || caller->is_extern) return 0;
+
+    alir_build_uses(run->module, caller);
+    run->next_temp = 0;
+    for (AlirBlock *b = caller->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->dest && i->dest->kind == ALIR_VAL_TEMP && i->dest->temp_id >= run->next_temp) {
+                run->next_temp = i->dest->temp_id + 1;
+            }
+        }
+    }
+
+    int inlined = 0;
+    for (AlirBlock *b = caller->blocks; b; b = b->next) {
+        AlirInst *prev = NULL, *i = b->head;
+        while (i) {
+            int c = i->op == ALIR_OP_CALL && node->size <= INLINE_CALLER_LIMIT ? inline_callee(run, i) : -1;
+            InlineNode *callee = c >= 0 ? &run->nodes[c] : NULL;
+            if (!callee || callee->scc == node->scc ||
+                !inline_legal(run, i, caller, callee->func) || !inline_worth(run, i, callee)) {
+                prev = i;
+                i = i->next;
+                continue;
+            }
+
+            debug_optlir("inline: %s into %s\n", callee->func->name, caller->name);
+            node->size += callee->size - 1;
+            inlined++;
+            // Carry on with the instructions that followed the call
+            b = inline_call(run, caller, b, prev, i, callee->func);
+            prev = NULL;
+            i = b->head;
+        }
+    }
+    return inlined;
+}
+
+/**
+ * @brief Inlines small and annotated direct calls along a given call graph.
+ * @param module The ALIR module (SSA form).
+ * @param cg The call graph of the module.
+ * @param opt_level The optimization level, which scales the size threshold.
+ * @return Number of calls inlined.
+ */
+int optlir_inline_calls(AlirModule *module, OptlirCallGraph *cg, int opt_level) {
+    if (!module || !module->functions) return 0;
+
+    InlineRun run = {0};
+    run.module = module;
+    run.cg = cg;
+    run.threshold = opt_level >= 3 ? INLINE_THRESHOLD_O3 : INLINE_THRESHOLD;
+    inline_build_graph(&run);
+
+    int *order = alir_alloc(module, sizeof(int) * (run.count ? run.count : 1));
+    inline_order(&run, order);
+    int inlined = 0;
+    for (int k = 0; k < run.count; k++) {
+        InlineNode *node = &run.nodes[order[k]];
+        inlined += inline_function(&run, node);
+        node->size = inline_size(node->func);
+    }
+    optlir_stats.inlined_calls += inlined;
+    return inlined;
+}
+
+/**
+ * @brief Inlines small and annotated direct calls across the module.
+ * @param module The ALIR module (SSA form).
+ * @param opt_level The optimization level, which scales the size threshold.
+ */
+void optlir_inline(AlirModule *module, int opt_level) {
+    if (!module || !module->functions) return;
+    OptlirCallGraph cg;
+    optlir_callgraph_build(module, &cg);
+    optlir_inline_calls(module, &cg, opt_level);
+    optlir_callgraph_free(&cg);
+}
@@ -0,0 +1,278 @@
+/**
+ * @file licm.c
+ * @brief Loop-invariant code motion over ALIR functions.
+ *
+ * An operand is invariant in a loop when its def lies outside the loop;
+ * constants, globals and parameters have no def and always are. Loops are
+ * visited innermost first and their blocks in dominator preorder, so defs are
+ * seen before uses and whatever left an inner loop is looked at again as part
+ * of the loop around it.
+ *
+ * Loads need more care than arithmetic. The alias classes of alias.h say
+ * whether the loop may write what a load reads, and a load only moves ahead
+ * of the loop test when its address is known to be readable.
+ */
+#include "optlir.h"
+#include "optlir/local.h"
+#include "optlir/dom.h"
+#include "optlir/loop.h"
+#include "optlir/alias.h"
+#include "optlir/licm.h"
+#include "optlir/pass.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief State of one LICM run over a function.
+ */
+typedef struct LicmCtx {
+    AlirModule *module;
+    AlirFunction *func;
+    OptlirDomTree *dom;
+    OptlirLoopForest *forest;
+    OptlirAlias alias;
+    HashMap defs;               // "%p" of a defined value -> dominator index + 1 of its block
+    int *written;               // Per alias class: stamp of the last loop writing it
+    int *exiting;               // Per block: stamp of the last loop it leaves
+    int stamp;
+} LicmCtx;
+
+/**
+ * @brief Whether an opcode computes its result from its operands alone and
+ * cannot trap.
+ * @param i The instruction.
+ * @return Non-zero if it may run where it was not going to.
+ */
+static int licm_speculatable(AlirInst *i) {
+    if (!i->dest) return 0;
+    if (i->op == ALIR_OP_DIV || i->op == ALIR_OP_MOD) {
+        // Only a known divisor rules out division by zero and overflow
+        ConstVal d = optlir_const_of(i->op2);
+        return d.is_const && !d.is_float && d.int_val != 0 && d.int_val != -1;
+    }
+    if (i->op >= ALIR_OP_ADD && i->op <= ALIR_OP_NEQ) return 1;
+    return i->op == ALIR_OP_CAST || i->op == ALIR_OP_BITCAST || i->op == ALIR_OP_GET_PTR ||
+           i->op == ALIR_OP_SIZEOF || i->op == ALIR_OP_ALIGNOF;
+}
+
+/**
+ * @brief Records the block of every value defined in the function.
+ * @param ctx The LICM context.
+ */
+static void licm_index_defs(LicmCtx *ctx) {
+    Arena *arena = alir_arena(ctx->module);
+    hashmap_init(&ctx->defs, arena, 64);
+    char key[32];
+    for (int bi = 0; bi < ctx->dom->count; bi++) {
+        for (AlirInst *i = ctx->dom->blocks[bi]->head; i; i = i->next) {
+            if (!i->dest) continue;
+            snprintf(key, sizeof(key), "%p", (void*)i->dest);
+            hashmap_put(&ctx->defs, key, (void*)(uintptr_t)(bi + 1));
+        }
+    }
+}
+
+/**
+ * @brief Returns the block defining a value.
+ * @param ctx The LICM context.
+ * @param v The value.
+ * @return Its dominator index, or -1 if no instruction defines it.
+ */
+static int licm_def_block(LicmCtx *ctx, AlirValue *v) {
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)v);
+    return (int)(uintptr_t)hashmap_get(&ctx->defs, key) - 1;
+}
+
+/**
+ * @brief Whether a value is the same on every iteration of a loop.
+ * @param ctx The LICM context.
+ * @param loop The loop.
+ * @param v The value.
+ * @return Non-zero if it is not defined inside the loop.
+ */
+static int licm_invariant(LicmCtx *ctx, OptlirLoop *loop, AlirValue *v) {
+    if (!v) return 1;
+    return !optlir_loop_contains(ctx->forest, loop, licm_def_block(ctx, v));
+}
+
+/**
+ * @brief Whether all operands of an instruction are invariant in a loop.
+ * @param ctx The LICM context.
+ * @param loop The loop.
+ * @param i The instruction.
+ * @return Non-zero if they are.
+ */
+static int licm_operands_invariant(LicmCtx *ctx, OptlirLoop *loop, AlirInst *i) {
+    if (!licm_invariant(ctx, loop, i->op1) || !licm_invariant(ctx, loop, i->op2)) return 0;
+    for (int k = 0; k < i->arg_count; k++) {
+        if (!licm_invariant(ctx, loop, i->args[k])) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Stamps the alias classes a loop writes and the blocks it leaves from.
+ * @param ctx The LICM context.
+ * @param loop The loop.
+ */
+static void licm_scan_loop(LicmCtx *ctx, OptlirLoop *loop) {
+    ctx->stamp++;
+    for (int k = 0; k < loop->block_count; k++) {
+        int bi = loop->blocks[k];
+        AlirBlock *b = ctx->dom->blocks[bi];
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->op == ALIR_OP_STORE || i->op == ALIR_OP_FREE_STACK) {
+                ctx->written[optlir_alias_class(&ctx->alias, i->op == ALIR_OP_STORE ? i->op2 : i->op1)] = ctx->stamp;
+            } else if (i->op == ALIR_OP_CALL && !optlir_alias_pure_callee(ctx->module, i)) {
+                ctx->written[0] = ctx->stamp;
+            }
+        }
+        if (!b->succ) ctx->exiting[bi] = ctx->stamp;
+        for (BlockEdge *e = b->succ; e; e = e->next) {
+            int s = optlir_dom_index(ctx->dom, e->block);
+            if (!optlir_loop_contains(ctx->forest, loop, s)) ctx->exiting[bi] = ctx->stamp;
+        }
+    }
+}
+
+/**
+ * @brief Whether reading an address cannot fault wherever the function runs.
+ * @param ctx The LICM context.
+ * @param addr The address.
+ * @return Non-zero for stack slots, globals and fields of this.
+ */
+static int licm_dereferenceable(LicmCtx *ctx, AlirValue *addr) {
+    if (optlir_alias_class(&ctx->alias, addr) > 0) return 1;
+    while (addr && addr->def && addr->def->op == ALIR_OP_GET_PTR) addr = addr->def->op1;
+    if (!addr) return 0;
+    if (addr->kind == ALIR_VAL_GLOBAL) return 1;
+    AlirParam *self = ctx->func->params;
+    return addr->kind == ALIR_VAL_VAR && self && self->name && strcmp(self->name, "this") == 0 &&
+           addr->val.str_val && strcmp(addr->val.str_val, "p0") == 0;
+}
+
+/**
+ * @brief Whether a loop instruction may run in the preheader instead.
+ * @param ctx The LICM context, with the loop scanned.
+ * @param loop The loop.
+ * @param bi Dominator index of the block holding the instruction.
+ * @param i The instruction.
+ * @return Non-zero if it gives the same result there and cannot fault.
+ */
+static int licm_hoistable(LicmCtx *ctx, OptlirLoop *loop, int bi, AlirInst *i) {
+    if (i->op == ALIR_OP_LOAD) {
+        if (!i->dest || !licm_invariant(ctx, loop, i->op1)) return 0;
+        if (ctx->written[optlir_alias_class(&ctx->alias, i->op1)] == ctx->stamp) return 0;
+        if (licm_dereferenceable(ctx, i->op1)) return 1;
+        // Otherwise the load has to run on every trip through the loop anyway
+        for (int k = 0; k < loop->block_count; k++) {
+            int e = loop->blocks[k];
+            if (ctx->exiting[e] == ctx->stamp && !optlir_dominates(ctx->dom, bi, e)) return 0;
+        }
+        return 1;
+    }
+    return licm_speculatable(i) && licm_operands_invariant(ctx, loop, i);
+}
+
+/**
+ * @brief Moves the invariant instructions of a loop to its preheader.
+ * @param ctx The LICM context.
+ * @param loop The loop, with a preheader.
+ * @param dry Only count what could move, without moving it.
+ * @return Number of instructions moved, or found movable when dry.
+ */
+static int licm_loop(LicmCtx *ctx, OptlirLoop *loop, int dry) {
+    licm_scan_loop(ctx, loop);
+    AlirBlock *pre = loop->preheader;
+    int pre_index = pre ? optlir_dom_index(ctx->dom, pre) : -1;
+    int moved = 0;
+    char key[32];
+
+    for (int k = 0; k < loop->block_count; k++) {
+        int bi = loop->blocks[k];
+        AlirBlock *b = ctx->dom->blocks[bi];
+        AlirInst *prev = NULL, *i = b->head;
+        while (i) {
+            AlirInst *next = i->next;
+            if (i == b->tail || !licm_hoistable(ctx, loop, bi, i)) {
+                prev = i;
+                i = next;
+                continue;
+            }
+            moved++;
+            if (dry) return moved;
+
+            if (prev) prev->next = next;
+            else b->head = next;
+
+            AlirInst **link = &pre->head;
+            while (*link != pre->tail) link = &(*link)->next;
+            i->next = pre->tail;
+            *link = i;
+            snprintf(key, sizeof(key), "%p", (void*)i->dest);
+            hashmap_put(&ctx->defs, key, (void*)(uintptr_t)(pre_index + 1));
+            i = next;
+        }
+    }
+    return moved;
+}
+
+/**
+ * @brief Moves computations that give the same result on every iteration of
+ * a loop into its preheader.
+ * @param module The ALIR module.
+ * @param func The function (SSA form).
+ * @return Number of changes: instructions hoisted and preheaders created.
+ */
+int optlir_licm_function(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks || func->is_extern) return 0;
+    Arena *arena = alir_arena(module);
+
+    optlir_require_uses(module, func);
+    LicmCtx ctx = {0};
+    ctx.module = module;
+    ctx.func = func;
+    ctx.dom = optlir_require_dom(module, func);
+    ctx.forest = optlir_loops_build(module, ctx.dom);
+    if (!ctx.forest->count) return 0;
+    optlir_alias_build(module, func, &ctx.alias);
+    ctx.written = alir_alloc(module, sizeof(int) * ctx.alias.count);
+    ctx.exiting = alir_alloc(module, sizeof(int) * ctx.dom->count);
+    licm_index_defs(&ctx);
+
+    // Loops with something to move and no preheader get one first
+    int made = 0;
+    for (int k = 0; k < ctx.forest->count; k++) {
+        OptlirLoop *loop = ctx.forest->loops[k];
+        if (loop->preheader || !licm_loop(&ctx, loop, 1)) continue;
+        if (optlir_loop_make_preheader(module, func, ctx.forest, loop)) made++;
+    }
+    if (made) {
+        if (!arena) hashmap_free(&ctx.defs);
+        optlir_invalidate(func, OPTLIR_AN_CFG);
+        ctx.dom = optlir_require_dom(module, func);
+        ctx.forest = optlir_loops_build(module, ctx.dom);
+        ctx.exiting = alir_alloc(module, sizeof(int) * ctx.dom->count);
+        licm_index_defs(&ctx);
+    }
+
+    int hoisted = 0;
+    for (int k = 0; k < ctx.forest->count; k++) {
+        OptlirLoop *loop = ctx.forest->loops[k];
+        if (loop->preheader) hoisted += licm_loop(&ctx, loop, 0);
+    }
+
+    if (hoisted > 0) {
+        optlir_stats.licm_hoisted += hoisted;
+        debug_optlir("licm: %s: %d instructions hoisted\n", func->name, hoisted);
+    }
+    if (!arena) {
+        hashmap_free(&ctx.defs);
+        optlir_alias_free(&ctx.alias);
+    }
+    return hoisted + made;
+}
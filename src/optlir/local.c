@@ -4,19 +4,46 @@
  */
 #include "optlir.h"
 #include "optlir/local.h"
+#include "optlir/pass.h"
 #include "common/arena.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-ConstVal eval_pure_function(AlirModule *module, AlirFunction *func, AlirValue **args, int arg_count, VarType ret_type);
+_Thread_local OptlirStats optlir_stats;
+
+/**
+ * @brief Prints the optimization statistics.
+ * @param out The stream to print to.
+ */
+void optlir_print_stats(FILE *out) {
+    fprintf(out, "optlir: sccp: %d instructions folded, %d blocks removed\n",
+            optlir_stats.sccp_folded, optlir_stats.sccp_blocks_removed);
+    fprintf(out, "optlir: inline: %d calls inlined\n", optlir_stats.inlined_calls);
+    fprintf(out, "optlir: gvn: %d instructions eliminated\n", optlir_stats.gvn_eliminated);
+    fprintf(out, "optlir: licm: %d instructions hoisted\n", optlir_stats.licm_hoisted);
+    fprintf(out, "optlir: indvar: %d instructions strength-reduced, %d trip counts found\n",
+            optlir_stats.indvar_reduced, optlir_stats.indvar_trip_counts);
+    fprintf(out, "optlir: pure-calls: %d calls folded, %d memo hits, %d over budget, %.3f ms evaluating\n",
+            optlir_stats.pure_folded, optlir_stats.pure_memo_hits, optlir_stats.pure_over_budget,
+            optlir_stats.pure_nanos / 1e6);
+    fprintf(out, "optlir: escape: %d allocations moved to the stack, %d frees removed\n",
+            optlir_stats.escape_moved, optlir_stats.escape_frees_removed);
+    fprintf(out, "optlir: icf: %d functions folded, ~%d bytes saved\n",
+            optlir_stats.icf_folded, optlir_stats.icf_bytes_saved);
+    optlir_print_pass_stats(out);
+}
 
 /**
  * @brief Extract a constant value from an ALIR value if possible.
+ *
+ * Integers narrower than 64 bits are read through their own field, since
+ * alir_const_int and friends fill only that part of the union.
+ *
  * @param val The ALIR value.
  * @return The constant value wrapper.
  */
-static ConstVal get_const_for_value(AlirValue *val) {
+ConstVal optlir_const_of(AlirValue *val) {
     ConstVal res = {0};
     if (!val) return res;
 
@@ -26,8 +53,19 @@ static ConstVal get_const_for_value(AlirValue *val) {
         if (res.is_float) {
             if (val->type.base == TYPE_SINGLE) res.double_val = val->val.single_val;
             else res.double_val = val->val.double_val;
-        } else {
+        } else if (val->type.ptr_depth > 0) {
             res.int_val = val->val.long_long_val;
+        } else {
+            switch (val->type.base) {
+                case TYPE_INT:
+                case TYPE_ENUM: res.int_val = val->val.int_val; break;
+                case TYPE_UNSIGNED_INT: res.int_val = val->val.unsigned_int_val; break;
+                case TYPE_SHORT: res.int_val = (short)val->val.int_val; break;
+                case TYPE_CHAR: res.int_val = val->val.char_val; break;
+                case TYPE_UNSIGNED_CHAR:
+                case TYPE_BOOL: res.int_val = val->val.unsigned_char_val; break;
+                default: res.int_val = val->val.long_long_val; break;
+            }
         }
         return res;
     }
@@ -43,7 +81,7 @@ static ConstVal get_const_for_value(AlirValue *val) {
  * @param type The result type.
  * @return The computed constant value.
  */
-static ConstVal eval_const_binary(int op, ConstVal l, ConstVal r, VarType type) {
+ConstVal optlir_eval_binary(int op, ConstVal l, ConstVal r, VarType type) {
     ConstVal res = {0};
     res.is_float = (type.base == TYPE_SINGLE || type.base == TYPE_DOUBLE);
 
@@ -114,7 +152,7 @@ static ConstVal eval_const_binary(int op, ConstVal l, ConstVal r, VarType type)
  * @param type The result type.
  * @return The computed constant value.
  */
-static ConstVal eval_const_unary(int op, ConstVal v, VarType type) {
+ConstVal optlir_eval_unary(int op, ConstVal v, VarType type) {
     ConstVal res = {0};
     res.is_float = (type.base == TYPE_SINGLE || type.base == TYPE_DOUBLE);
 
@@ -136,6 +174,44 @@ static ConstVal eval_const_unary(int op, ConstVal v, VarType type) {
     return res;
 }
 
+/**
+ * @brief Convert a constant value to another scalar type.
+ * @param v The constant value.
+ * @param type The target type.
+ * @return The converted constant value.
+ */
+ConstVal optlir_eval_cast(ConstVal v, VarType type) {
+    ConstVal res = v;
+    if (v.is_float) {
+        if (type.base == TYPE_SINGLE) res.double_val = (float)v.double_val;
+        else if (type.base == TYPE_DOUBLE) res.double_val = v.double_val;
+        else res.int_val = (long long)v.double_val;
+    } else {
+        if (type.base == TYPE_SINGLE) res.double_val = (float)v.int_val;
+        else if (type.base == TYPE_DOUBLE) res.double_val = (double)v.int_val;
+        else res.int_val = v.int_val;
+    }
+    res.is_const = 1;
+    res.is_float = (type.base == TYPE_SINGLE || type.base == TYPE_DOUBLE);
+    return res;
+}
+
+/**
+ * @brief Turn a value into a constant in place, so every use reads the constant.
+ * @param dest The value (usually the destination of a folded instruction).
+ * @param res The constant it takes.
+ */
+void optlir_make_const(AlirValue *dest, ConstVal res) {
+    dest->kind = ALIR_VAL_CONST;
+    if (dest->type.base == TYPE_SINGLE) {
+        dest->val.single_val = (float)(res.is_float ? res.double_val : (double)res.int_val);
+    } else if (dest->type.base == TYPE_DOUBLE) {
+        dest->val.double_val = res.is_float ? res.double_val : (double)res.int_val;
+    } else {
+        dest->val.long_long_val = res.int_val;
+    }
+}
+
 /**
  * @brief Check if an operation is an identity for a given constant.
  * @param op The ALIR operation code.
@@ -161,12 +237,13 @@ static int is_self_cancel_op(int op) {
 }
 
 /**
- * @brief Remove an instruction from a block's instruction list.
+ * @brief Remove an instruction from a block's instruction list, dropping its uses.
  * @param block The ALIR block.
  * @param prev The previous instruction, or NULL if removing the head.
  * @param inst The instruction to remove.
  */
 static void remove_instruction(AlirBlock *block, AlirInst *prev, AlirInst *inst) {
+    alir_drop_uses(inst);
     if (prev) {
         prev->next = inst->next;
     } else {
@@ -178,129 +255,133 @@ static void remove_instruction(AlirBlock *block, AlirInst *prev, AlirInst *inst)
 }
 
 /**
- * @brief Free a block edge list (currently a no-op).
- * @param e The block edge to free.
+ * @brief Add a CFG edge, recording it in both the successor and predecessor lists.
+ * @param arena Arena allocator for edges.
+ * @param from The branching block.
+ * @param to The target block.
+ */
+static void add_edge(Arena *arena, AlirBlock *from, AlirBlock *to) {
+    BlockEdge *se = arena_alloc_type(arena, BlockEdge);
+    se->block = to;
+    se->next = from->succ;
+    from->succ = se;
+    BlockEdge *pe = arena_alloc_type(arena, BlockEdge);
+    pe->block = from;
+    pe->next = to->pred;
+    to->pred = pe;
+}
+
+/**
+ * @brief Unlink the first edge leading to a block from an edge list.
+ * @param list The edge list.
+ * @param block The block the edge leads to.
  */
-static void free_edges(BlockEdge *e) {
-    (void)e;
+static void unlink_edge(BlockEdge **list, AlirBlock *block) {
+    for (BlockEdge **e = list; *e; e = &(*e)->next) {
+        if ((*e)->block == block) {
+            *e = (*e)->next;
+            return;
+        }
+    }
 }
 
 /**
- * @brief Redirect all jump targets matching old_label to new_label within a block.
+ * @brief Remove one CFG edge from both the successor and predecessor lists.
+ * @param from The branching block.
+ * @param to The target block.
+ */
+static void remove_edge(AlirBlock *from, AlirBlock *to) {
+    unlink_edge(&from->succ, to);
+    unlink_edge(&to->pred, from);
+}
+
+/**
+ * @brief Point a branch target slot of a block at another block, keeping the edges valid.
+ * @param module The ALIR module.
+ * @param b The block owning the branch.
+ * @param slot The label operand slot.
+ * @param to The new target block.
+ */
+static void retarget_branch(AlirModule *module, AlirBlock *b, AlirValue **slot, AlirBlock *to) {
+    Arena *arena = alir_arena(module);
+    if ((*slot)->block) remove_edge(b, (*slot)->block);
+    *slot = alir_val_block(module, to);
+    add_edge(arena, b, to);
+}
+
+/**
+ * @brief Redirect every branch of a block that targets one block to another.
  * @param module The ALIR module.
  * @param b The block to process.
- * @param old_label The label to replace.
- * @param new_label The replacement label.
+ * @param from The old target block.
+ * @param to The new target block.
  */
-static void redirect_label_to(AlirModule *module, AlirBlock *b, const char *old_label, const char *new_label) {
-    if (!b || !old_label || !new_label || streq_lit(old_label, new_label)) return;
-    AlirInst *i = b->head;
-    while (i) {
-        if (i->op == ALIR_OP_JUMP && i->op1 && i->op1->kind == ALIR_VAL_LABEL &&
-            streq_lit(i->op1->val.str_val, old_label)) {
-            i->op1 = alir_val_label(module, new_label);
-        } else if (i->op == ALIR_OP_CONDI) {
-            if (i->op2 && i->op2->kind == ALIR_VAL_LABEL &&
-                streq_lit(i->op2->val.str_val, old_label)) {
-                i->op2 = alir_val_label(module, new_label);
-            }
-            if (i->arg_count > 0 && i->args[0] && i->args[0]->kind == ALIR_VAL_LABEL &&
-                streq_lit(i->args[0]->val.str_val, old_label)) {
-                i->args[0] = alir_val_label(module, new_label);
+static void redirect_branches(AlirModule *module, AlirBlock *b, AlirBlock *from, AlirBlock *to) {
+    for (AlirInst *i = b->head; i; i = i->next) {
+        int n = alir_branch_count(i);
+        for (int k = 0; k < n; k++) {
+            AlirValue **slot = alir_branch_slot(i, k);
+            if (slot && (*slot)->block == from) {
+                retarget_branch(module, b, slot, to);
             }
         }
-        i = i->next;
     }
 }
 
 /**
- * @brief Redirect a label in all blocks of a function.
- * @param module The ALIR module.
- * @param func The ALIR function.
- * @param old_label The label to replace.
- * @param new_label The replacement label.
+ * @brief Whether a block has at least one edge to another block.
+ * @param from The branching block.
+ * @param to The target block.
+ * @return 1 if an edge exists, 0 otherwise.
  */
-static void redirect_label_in_all_blocks(AlirModule *module, AlirFunction *func, const char *old_label, const char *new_label) {
-    AlirBlock *b = func->blocks;
-    while (b) {
-        redirect_label_to(module, b, old_label, new_label);
-        b = b->next;
+static int has_edge(AlirBlock *from, AlirBlock *to) {
+    for (BlockEdge *e = from->succ; e; e = e->next) {
+        if (e->block == to) return 1;
     }
+    return 0;
 }
 
-static AlirBlock* find_block_by_label(AlirFunction *func, const char *label);
-
 /**
  * @brief Build predecessor and successor edges for all blocks in a function.
+ *
+ * The CFG passes below keep the edges up to date as they rewrite branches,
+ * so this runs once per function and optimization round.
+ *
  * @param func The ALIR function.
  * @param arena Arena allocator for edges.
  */
-static void build_pred_succ(AlirFunction *func, Arena *arena) {
+void optlir_build_edges(AlirFunction *func, Arena *arena) {
     if (!func || !func->blocks) return;
-    AlirBlock *b = func->blocks;
-    while (b) {
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
         b->pred = NULL;
         b->succ = NULL;
-        b = b->next;
     }
-    b = func->blocks;
-    while (b) {
-        AlirInst *i = b->head;
-        while (i) {
-            if (i->op == ALIR_OP_JUMP && i->op1 && i->op1->kind == ALIR_VAL_LABEL) {
-                AlirBlock *t = find_block_by_label(func, i->op1->val.str_val);
-                if (t && t != b) {
-                    BlockEdge *se = arena_alloc_type(arena, BlockEdge);
-                    se->block = t;
-                    se->next = b->succ;
-                    b->succ = se;
-                    BlockEdge *pe = arena_alloc_type(arena, BlockEdge);
-                    pe->block = b;
-                    pe->next = t->pred;
-                    t->pred = pe;
-                }
-            } else if (i->op == ALIR_OP_CONDI) {
-                if (i->op2 && i->op2->kind == ALIR_VAL_LABEL) {
-                    AlirBlock *t = find_block_by_label(func, i->op2->val.str_val);
-                    if (t && t != b) {
-                        BlockEdge *se = arena_alloc_type(arena, BlockEdge);
-                        se->block = t;
-                        se->next = b->succ;
-                        b->succ = se;
-                        BlockEdge *pe = arena_alloc_type(arena, BlockEdge);
-                        pe->block = b;
-                        pe->next = t->pred;
-                        t->pred = pe;
-                    }
-                }
-                if (i->arg_count > 0 && i->args[0] && i->args[0]->kind == ALIR_VAL_LABEL) {
-                    AlirBlock *t = find_block_by_label(func, i->args[0]->val.str_val);
-                    if (t && t != b) {
-                        BlockEdge *se = arena_alloc_type(arena, BlockEdge);
-                        se->block = t;
-                        se->next = b->succ;
-                        b->succ = se;
-                        BlockEdge *pe = arena_alloc_type(arena, BlockEdge);
-                        pe->block = b;
-                        pe->next = t->pred;
-                        t->pred = pe;
-                    }
-                }
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            int n = alir_branch_count(i);
+            for (int k = 0; k < n; k++) {
+                AlirValue **slot = alir_branch_slot(i, k);
+                if (slot && (*slot)->block) add_edge(arena, b, (*slot)->block);
             }
-            i = i->next;
         }
-        b = b->next;
     }
 }
 
 /**
  * @brief Perform constant propagation on a single function.
+ *
+ * Expects valid def-use chains. A folded result is turned into a constant in
+ * place, so every use sees it without rewriting; an identity operation hands
+ * its uses over to the surviving operand.
+ *
  * @param module The ALIR module.
  * @param func The ALIR function.
+ * @return Number of instructions folded away.
  */
-static void constant_propagate_function(AlirModule *module, AlirFunction *func) {
+int optlir_constprop_function(AlirModule *module, AlirFunction *func) {
     (void)module;
-    if (!func || !func->blocks) return;
+    if (!func || !func->blocks) return 0;
+    int folded = 0;
 
     AlirBlock *b = func->blocks;
     while (b) {
@@ -311,30 +392,22 @@ static void constant_propagate_function(AlirModule *module, AlirFunction *func)
             int removed = 0;
 
             if (i->dest && i->op >= ALIR_OP_ADD && i->op <= ALIR_OP_NEQ) {
-                ConstVal l = get_const_for_value(i->op1);
-                ConstVal r = get_const_for_value(i->op2);
+                ConstVal l = optlir_const_of(i->op1);
+                ConstVal r = optlir_const_of(i->op2);
 
                 if (l.is_const && r.is_const) {
-                    ConstVal res = eval_const_binary(i->op, l, r, i->dest->type);
+                    ConstVal res = optlir_eval_binary(i->op, l, r, i->dest->type);
                     if (res.is_const) {
-                        i->dest->kind = ALIR_VAL_CONST;
-                        if (res.is_float) {
-                            if (i->dest->type.base == TYPE_SINGLE) i->dest->val.single_val = (float)res.double_val;
-                            else i->dest->val.double_val = res.double_val;
-                        } else {
-                            i->dest->val.long_long_val = res.int_val;
-                        }
+                        optlir_make_const(i->dest, res);
                         remove_instruction(b, prev, i);
                         removed = 1;
                     }
                 } else if (l.is_const && is_identity_op(i->op, l)) {
-                    i->dest->kind = ALIR_VAL_TEMP;
-                    i->dest->temp_id = i->op2->temp_id;
+                    alir_replace_all_uses(i->dest, i->op2);
                     remove_instruction(b, prev, i);
                     removed = 1;
                 } else if (r.is_const && is_identity_op(i->op, r)) {
-                    i->dest->kind = ALIR_VAL_TEMP;
-                    i->dest->temp_id = i->op1->temp_id;
+                    alir_replace_all_uses(i->dest, i->op1);
                     remove_instruction(b, prev, i);
                     removed = 1;
                 } else if (l.is_const && r.is_const && is_self_cancel_op(i->op)) {
@@ -354,17 +427,11 @@ static void constant_propagate_function(AlirModule *module, AlirFunction *func)
             }
 
             if (!removed && i->op == ALIR_OP_NOT && i->op1) {
-                ConstVal v = get_const_for_value(i->op1);
+                ConstVal v = optlir_const_of(i->op1);
                 if (v.is_const) {
-                    ConstVal res = eval_const_unary(ALIR_OP_NOT, v, i->dest->type);
+                    ConstVal res = optlir_eval_unary(ALIR_OP_NOT, v, i->dest->type);
                     if (res.is_const) {
-                        i->dest->kind = ALIR_VAL_CONST;
-                        if (res.is_float) {
-                            if (i->dest->type.base == TYPE_SINGLE) i->dest->val.single_val = (float)res.double_val;
-                            else i->dest->val.double_val = res.double_val;
-                        } else {
-                            i->dest->val.long_long_val = res.int_val;
-                        }
+                        optlir_make_const(i->dest, res);
                         remove_instruction(b, prev, i);
                         removed = 1;
                     }
@@ -372,27 +439,9 @@ static void constant_propagate_function(AlirModule *module, AlirFunction *func)
             }
 
             if (!removed && i->op == ALIR_OP_CAST && i->op1) {
-                ConstVal v = get_const_for_value(i->op1);
+                ConstVal v = optlir_const_of(i->op1);
                 if (v.is_const) {
-                    ConstVal res = v;
-                    if (v.is_float) {
-                        if (i->dest->type.base == TYPE_SINGLE) res.double_val = (float)v.double_val;
-                        else if (i->dest->type.base == TYPE_DOUBLE) res.double_val = v.double_val;
-                        else res.int_val = (long long)v.double_val;
-                    } else {
-                        if (i->dest->type.base == TYPE_SINGLE) res.double_val = (float)v.int_val;
-                        else if (i->dest->type.base == TYPE_DOUBLE) res.double_val = (double)v.int_val;
-                        else res.int_val = v.int_val;
-                    }
-                    res.is_const = 1;
-                    res.is_float = (i->dest->type.base == TYPE_SINGLE || i->dest->type.base == TYPE_DOUBLE);
-                    i->dest->kind = ALIR_VAL_CONST;
-                    if (res.is_float) {
-                        if (i->dest->type.base == TYPE_SINGLE) i->dest->val.single_val = (float)res.double_val;
-                        else i->dest->val.double_val = res.double_val;
-                    } else {
-                        i->dest->val.long_long_val = res.int_val;
-                    }
+                    optlir_make_const(i->dest, optlir_eval_cast(v, i->dest->type));
                     remove_instruction(b, prev, i);
                     removed = 1;
                 }
@@ -400,354 +449,317 @@ static void constant_propagate_function(AlirModule *module, AlirFunction *func)
 
             if (!removed) {
                 prev = i;
+            } else {
+                folded++;
             }
             i = next;
         }
         b = b->next;
     }
+    return folded;
 }
 
 /**
- * @brief Fold conditional branches with constant conditions in a function.
+ * @brief Key a block by its address for the per-pass block maps.
+ * @param b The block.
+ * @param key Buffer of at least 32 bytes receiving the key.
+ */
+static void block_key(AlirBlock *b, char *key) {
+    snprintf(key, 32, "%p", (void*)b);
+}
+
+/**
+ * @brief Fold conditional branches and switches with constant conditions in a function.
+ *
+ * The edges to the targets that are no longer taken are dropped. The phis of
+ * the dropped targets are trimmed to their remaining predecessors once all
+ * branches are folded, so a join losing many edges is rewritten only once.
+ *
  * @param module The ALIR module.
  * @param func The ALIR function.
+ * @return Number of branches folded.
  */
-static void fold_branches_function(AlirModule *module, AlirFunction *func) {
-    if (!func || !func->blocks) return;
+int optlir_fold_branches_function(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks) return 0;
+
+    Arena *arena = alir_arena(module);
+    AlirBlock **trimmed = NULL;
+    int trimmed_count = 0, folded = 0;
+    HashMap seen;
+    char key[32];
 
     AlirBlock *b = func->blocks;
     while (b) {
         AlirInst *i = b->head;
         while (i) {
-            if (i->op == ALIR_OP_CONDI && i->op1) {
-                ConstVal cond = get_const_for_value(i->op1);
-                if (cond.is_const) {
-                    const char *target_label = NULL;
-                    if (cond.int_val != 0 && i->op2) {
-                        target_label = i->op2->val.str_val;
-                    } else if (cond.int_val == 0 && i->arg_count > 0 && i->args[0]) {
-                        target_label = i->args[0]->val.str_val;
+            AlirBlock *to = NULL;
+            if ((i->op == ALIR_OP_CONDI || i->op == ALIR_OP_SWITCH) && i->op1) {
+                ConstVal cond = optlir_const_of(i->op1);
+                if (cond.is_const && i->op == ALIR_OP_SWITCH) {
+                    to = alir_switch_target(i, cond.int_val);
+                } else if (cond.is_const) {
+                    AlirValue **taken = alir_branch_slot(i, cond.int_val != 0 ? 0 : 1);
+                    if (taken) to = (*taken)->block;
+                }
+            }
+            if (to) {
+                // Drop every edge but one to the taken target
+                int kept = 0;
+                int n = alir_branch_count(i);
+                for (int k = 0; k < n; k++) {
+                    AlirValue **slot = alir_branch_slot(i, k);
+                    if (!slot || !(*slot)->block) continue;
+                    AlirBlock *d = (*slot)->block;
+                    if (d == to && !kept) {
+                        kept = 1;
+                        continue;
                     }
-                    if (target_label) {
-                        i->op = ALIR_OP_JUMP;
-                        i->op1 = alir_val_label(module, target_label);
-                        i->op2 = NULL;
-                        if (i->args) {
-                            i->args = NULL;
-                            i->arg_count = 0;
+                    remove_edge(b, d);
+                    if (d->head && d->head->op == ALIR_OP_PHI) {
+                        if (!trimmed) {
+                            trimmed = alir_alloc(module, sizeof(AlirBlock*) * func->block_count);
+                            hashmap_init(&seen, arena, func->block_count > 16 ? func->block_count * 2 : 32);
+                        }
+                        block_key(d, key);
+                        if (!hashmap_get(&seen, key)) {
+                            hashmap_put(&seen, key, d);
+                            trimmed[trimmed_count++] = d;
                         }
                     }
                 }
+                alir_drop_uses(i);
+                i->op = ALIR_OP_JUMP;
+                i->op1 = alir_val_block(module, to);
+                i->op2 = NULL;
+                if (i->args) {
+                    i->args = NULL;
+                    i->arg_count = 0;
+                }
+                folded++;
             }
             i = i->next;
         }
         b = b->next;
     }
-}
-
-typedef struct BlockSet {
-    AlirBlock **blocks;
-    int count;
-    int capacity;
-} BlockSet;
-
-/**
- * @brief Initialize a block set.
- * @param set The block set to initialize.
- * @param capacity Initial capacity.
- * @param arena Arena allocator.
- */
-static void block_set_init(BlockSet *set, int capacity, Arena *arena) {
-    set->blocks = arena_alloc(arena, sizeof(AlirBlock *) * capacity);
-    memset(set->blocks, 0, sizeof(AlirBlock *) * capacity);
-    set->count = 0;
-    set->capacity = capacity;
-}
 
-/**
- * @brief Add a block to a block set.
- * @param set The block set.
- * @param b The block to add.
- * @param arena Arena allocator for growth.
- */
-static void block_set_add(BlockSet *set, AlirBlock *b, Arena *arena) {
-    if (!b) return;
-    for (int i = 0; i < set->count; i++) {
-        if (set->blocks[i] == b) return;
-    }
-    if (set->count >= set->capacity) {
-        int new_cap = set->capacity * 2;
-        AlirBlock **new_blocks = arena_alloc(arena, sizeof(AlirBlock *) * new_cap);
-        memset(new_blocks + set->count, 0, (new_cap - set->count) * sizeof(AlirBlock *));
-        if (set->blocks) {
-            memcpy(new_blocks, set->blocks, set->count * sizeof(AlirBlock *));
+    for (int k = 0; k < trimmed_count; k++) {
+        HashMap preds;
+        hashmap_init(&preds, arena, 32);
+        for (BlockEdge *e = trimmed[k]->pred; e; e = e->next) {
+            block_key(e->block, key);
+            hashmap_put(&preds, key, e->block);
         }
-        set->blocks = new_blocks;
-        set->capacity = new_cap;
+        alir_phi_keep_preds(module, trimmed[k], &preds);
+        if (!arena) hashmap_free(&preds);
     }
-    set->blocks[set->count++] = b;
-}
-
-/**
- * @brief Check if a block is in a block set.
- * @param set The block set.
- * @param b The block to check.
- * @return 1 if present, 0 otherwise.
- */
-static int block_set_has(BlockSet *set, AlirBlock *b) {
-    if (!b) return 0;
-    for (int i = 0; i < set->count; i++) {
-        if (set->blocks[i] == b) return 1;
-    }
-    return 0;
-}
-
-/**
- * @brief Free a block set (reset fields).
- * @param set The block set to free.
- */
-static void block_set_free(BlockSet *set) {
-    set->blocks = NULL;
-    set->count = 0;
-    set->capacity = 0;
-}
-
-/**
- * @brief Find a block in a function by label.
- * @param func The ALIR function.
- * @param label The block label.
- * @return The block, or NULL if not found.
- */
-static AlirBlock* find_block_by_label(AlirFunction *func, const char *label) {
-    if (!func || !label) return NULL;
-    AlirBlock *b = func->blocks;
-    while (b) {
-        if (b->label && streq_lit(b->label, label)) return b;
-        b = b->next;
-    }
-    return NULL;
+    if (trimmed && !arena) hashmap_free(&seen);
+    return folded;
 }
 
 /**
  * @brief Mark all reachable blocks from the entry block.
- * @param func The ALIR function.
- * @param reachable Output block set of reachable blocks.
+ * @param func The ALIR function (edges must be valid).
+ * @param reachable Output map holding every reachable block.
  * @param arena Arena allocator for the stack.
+ * @return Number of reachable blocks.
  */
-static void mark_reachable_blocks(AlirFunction *func, BlockSet *reachable, Arena *arena) {
-    if (!func || !func->blocks) return;
-
-    block_set_init(reachable, func->block_count > 0 ? func->block_count : 8, arena);
+static int mark_reachable_blocks(AlirFunction *func, HashMap *reachable, Arena *arena) {
+    hashmap_init(reachable, arena, func->block_count > 16 ? func->block_count * 2 : 32);
 
     AlirBlock *entry = func->blocks;
-    if (!entry) return;
-
-    AlirBlock **stack = arena_alloc(arena, sizeof(AlirBlock *) * func->block_count);
+    AlirBlock **stack = arena_alloc(arena, sizeof(AlirBlock *) * (func->block_count > 0 ? func->block_count : 1));
     int stack_top = 0;
+    int count = 1;
+    char key[32];
+    block_key(entry, key);
+    hashmap_put(reachable, key, entry);
     stack[stack_top++] = entry;
-    block_set_add(reachable, entry, arena);
 
     while (stack_top > 0) {
         AlirBlock *b = stack[--stack_top];
-        AlirInst *i = b->head;
-        while (i) {
-            if (i->op == ALIR_OP_JUMP && i->op1 && i->op1->kind == ALIR_VAL_LABEL) {
-                AlirBlock *target = find_block_by_label(func, i->op1->val.str_val);
-                if (target && !block_set_has(reachable, target)) {
-                    block_set_add(reachable, target, arena);
-                    stack[stack_top++] = target;
-                }
-            } else if (i->op == ALIR_OP_CONDI && i->op1 && i->op2 && i->op2->kind == ALIR_VAL_LABEL) {
-                AlirBlock *target = find_block_by_label(func, i->op2->val.str_val);
-                if (target && !block_set_has(reachable, target)) {
-                    block_set_add(reachable, target, arena);
-                    stack[stack_top++] = target;
-                }
-                if (i->arg_count > 0 && i->args[0] && i->args[0]->kind == ALIR_VAL_LABEL) {
-                    target = find_block_by_label(func, i->args[0]->val.str_val);
-                    if (target && !block_set_has(reachable, target)) {
-                        block_set_add(reachable, target, arena);
-                        stack[stack_top++] = target;
-                    }
-                }
-            }
-            i = i->next;
+        for (BlockEdge *e = b->succ; e; e = e->next) {
+            block_key(e->block, key);
+            if (hashmap_get(reachable, key)) continue;
+            hashmap_put(reachable, key, e->block);
+            count++;
+            stack[stack_top++] = e->block;
         }
     }
+    return count;
 }
 
 /**
  * @brief Remove unreachable blocks from a function.
+ *
+ * The instructions of a removed block give up their uses, so the def-use
+ * chains of the survivors stay valid.
+ *
  * @param module The ALIR module.
- * @param func The ALIR function.
+ * @param func The ALIR function (edges must be valid).
+ * @return Number of blocks removed.
  */
-static void remove_unreachable_blocks_function(AlirModule *module, AlirFunction *func) {
-    if (!func || !func->blocks) return;
-
-    Arena *arena = module->compiler_ctx ? module->compiler_ctx->arena : NULL;
-    BlockSet reachable;
-    mark_reachable_blocks(func, &reachable, arena);
-
-    if (reachable.count == func->block_count) {
-        block_set_free(&reachable);
-        return;
-    }
+int optlir_remove_unreachable_function(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks) return 0;
 
-    AlirBlock **new_blocks = arena_alloc(arena, sizeof(AlirBlock *) * reachable.count);
-    memset(new_blocks, 0, sizeof(AlirBlock *) * reachable.count);
-    int new_count = 0;
+    Arena *arena = alir_arena(module);
+    HashMap reachable;
+    int reachable_count = mark_reachable_blocks(func, &reachable, arena);
+    int removed = 0;
 
-    AlirBlock *prev = NULL;
-    AlirBlock *b = func->blocks;
-    while (b) {
-        if (block_set_has(&reachable, b)) {
-            new_blocks[new_count++] = b;
-            prev = b;
-            b = b->next;
-        } else {
-            AlirBlock *to_remove = b;
-            b = b->next;
-            if (prev) prev->next = b;
-            else func->blocks = b;
-            func->block_count--;
-            free_edges(to_remove->pred);
-            free_edges(to_remove->succ);
+    if (reachable_count < func->block_count) {
+        AlirBlock *prev = NULL;
+        AlirBlock *b = func->blocks;
+        char key[32];
+        while (b) {
+            block_key(b, key);
+            if (hashmap_get(&reachable, key)) {
+                prev = b;
+                b = b->next;
+            } else {
+                AlirBlock *to_remove = b;
+                b = b->next;
+                if (prev) prev->next = b;
+                else func->blocks = b;
+                func->block_count--;
+                removed++;
+                while (to_remove->succ) remove_edge(to_remove, to_remove->succ->block);
+                for (AlirInst *i = to_remove->head; i; i = i->next) alir_drop_uses(i);
+            }
+        }
+        // Phis keep only the entries of surviving predecessors
+        for (b = func->blocks; b; b = b->next) {
+            if (b->head && b->head->op == ALIR_OP_PHI) alir_phi_keep_preds(module, b, &reachable);
         }
     }
 
-    block_set_free(&reachable);
+    if (!arena) hashmap_free(&reachable);
+    return removed;
 }
 
 /**
  * @brief Merge basic blocks where a block ends in an unconditional jump to its sole successor.
+ *
+ * The target's only incoming edge is the jump being removed, so nothing else
+ * refers to it; its phis collapse to their single incoming value and its
+ * outgoing edges move to the merged block.
+ *
  * @param module The ALIR module.
  * @param func The ALIR function.
- * @return 1 if any merge occurred, 0 otherwise.
+ * @return Number of blocks merged into their predecessor.
  */
-static int merge_blocks_function(AlirModule *module, AlirFunction *func) {
+int optlir_merge_blocks_function(AlirModule *module, AlirFunction *func) {
     if (!func || !func->blocks) return 0;
 
-    Arena *arena = module->compiler_ctx ? module->compiler_ctx->arena : NULL;
-    int overall_changed = 0;
-    int changed;
-    
-    do {
-        changed = 0;
-        {
-            AlirBlock *b = func->blocks;
-            while (b) {
-                free_edges(b->pred);
-                free_edges(b->succ);
-                b->pred = NULL;
-                b->succ = NULL;
-                b = b->next;
-            }
-            build_pred_succ(func, arena);
+    Arena *arena = alir_arena(module);
+    HashMap merged;
+    int merged_count = 0;
+    hashmap_init(&merged, arena, 32);
+    char key[32];
+
+    AlirBlock *b = func->blocks;
+    while (b) {
+        AlirInst *tail = b->head;
+        AlirInst *tail_prev = NULL;
+        while (tail && tail->next) {
+            tail_prev = tail;
+            tail = tail->next;
         }
 
-        AlirBlock *b = func->blocks;
-        while (b) {
-            AlirInst *tail = b->head;
-            AlirInst *tail_prev = NULL;
-            while (tail && tail->next) {
-                tail_prev = tail;
-                tail = tail->next;
-            }
+        AlirBlock *target = NULL;
+        if (tail && tail->op == ALIR_OP_JUMP && tail->op1 && tail->op1->kind == ALIR_VAL_LABEL) {
+            target = tail->op1->block;
+        }
+        if (!target || target == b || target == func->blocks || !target->pred || target->pred->next) {
+            b = b->next;
+            continue;
+        }
 
-            if (tail && tail->op == ALIR_OP_JUMP && tail->op1 && tail->op1->kind == ALIR_VAL_LABEL) {
-                const char *target_label = tail->op1->val.str_val;
-                AlirBlock *target = find_block_by_label(func, target_label);
-                
-                if (target && target != b && target != func->blocks) {
-                    int pred_count = 0;
-                    for (BlockEdge *e = target->pred; e; e = e->next) pred_count++;
-                    
-                    if (pred_count == 1) {
-                        // Remove jump from b
-                        if (b->head == tail) {
-                            b->head = NULL;
-                        } else {
-                            tail_prev->next = NULL;
-                        }
+        // Single-entry phis of the target are plain copies
+        while (target->head && target->head->op == ALIR_OP_PHI) {
+            AlirInst *phi = target->head;
+            alir_replace_all_uses(phi->dest, alir_phi_incoming(phi, b));
+            remove_instruction(target, NULL, phi);
+        }
 
-                        // Append target instructions to b
-                        if (target->head) {
-                            if (b->head) {
-                                AlirInst *last = b->head;
-                                while (last->next) last = last->next;
-                                last->next = target->head;
-                            } else {
-                                b->head = target->head;
-                            }
-                            b->tail = target->tail;
-                        } else {
-                            b->tail = tail_prev;
-                        }
+        // Remove jump from b
+        if (b->head == tail) {
+            b->head = NULL;
+        } else {
+            tail_prev->next = NULL;
+        }
 
-                        // Remove target from block list
-                        AlirBlock *t_prev = NULL;
-                        AlirBlock *curr = func->blocks;
-                        while (curr && curr != target) {
-                            t_prev = curr;
-                            curr = curr->next;
-                        }
-                        if (curr == target) {
-                            if (t_prev) t_prev->next = target->next;
-                            else func->blocks = target->next;
-                            func->block_count--;
-                        }
+        // Append target instructions to b
+        if (target->head) {
+            if (b->head) {
+                tail_prev->next = target->head;
+            } else {
+                b->head = target->head;
+            }
+            b->tail = target->tail;
+        } else {
+            b->tail = tail_prev;
+        }
+        target->head = NULL;
+        target->tail = NULL;
+
+        // b inherits the target's outgoing edges
+        remove_edge(b, target);
+        while (target->succ) {
+            BlockEdge *e = target->succ;
+            target->succ = e->next;
+            for (BlockEdge *p = e->block->pred; p; p = p->next) {
+                if (p->block == target) {
+                    p->block = b;
+                    break;
+                }
+            }
+            e->next = b->succ;
+            b->succ = e;
+            alir_phi_rename_pred(module, e->block, target, b);
+        }
 
-                        // If anything referenced the target label, redirect it to b's label
-                        if (!streq_lit(b->label, target_label)) {
-                            redirect_label_in_all_blocks(module, func, target_label, b->label);
-                        }
+        block_key(target, key);
+        hashmap_put(&merged, key, target);
+        merged_count++;
+        // Stay on b: it may now end in a jump to another mergeable block
+    }
 
-                        changed = 1;
-                        overall_changed = 1;
-                        break;
-                    }
-                }
+    if (merged_count) {
+        AlirBlock *prev = NULL;
+        for (AlirBlock *curr = func->blocks; curr; ) {
+            block_key(curr, key);
+            if (hashmap_get(&merged, key)) {
+                curr = curr->next;
+                if (prev) prev->next = curr;
+                else func->blocks = curr;
+                func->block_count--;
+            } else {
+                prev = curr;
+                curr = curr->next;
             }
-            b = b->next;
         }
-    } while (changed);
+    }
 
-    return overall_changed;
+    if (!arena) hashmap_free(&merged);
+    return merged_count;
 }
 
 /**
- * @brief Check if an ALIR temp value is used anywhere in the function.
- * @param func The ALIR function.
- * @param val The value to check.
+ * @brief Check if an ALIR temp value is read anywhere in the function.
+ *
+ * Being the address operand of a store writes the value's memory rather
+ * than reading it, so such uses are skipped.
+ *
+ * @param val The value to check (def-use chains must be valid).
+ * @param except A use to ignore, or NULL.
  * @return 1 if used, 0 otherwise.
  */
-static int value_is_used_somewhere(AlirFunction *func, AlirValue *val) {
+static int value_is_read(AlirValue *val, AlirUse *except) {
     if (!val || val->kind != ALIR_VAL_TEMP) return 1;
-
-    AlirBlock *b = func->blocks;
-    while (b) {
-        AlirInst *i = b->head;
-        while (i) {
-            if (i->op == ALIR_OP_STORE) {
-                if (i->op1 == val) return 1;
-                // op2 is the destination, so it's a def, not a use
-                i = i->next;
-                continue;
-            }
-            
-            if (i->op1 == val) return 1;
-            if (i->op2 == val) return 1;
-            if (i->dest == val) {
-                if (i->op == ALIR_OP_STORE) return 1;
-                i = i->next;
-                continue;
-            }
-            for (int j = 0; j < i->arg_count; j++) {
-                if (i->args[j] == val) return 1;
-            }
-            i = i->next;
-        }
-        b = b->next;
+    for (AlirUse *u = val->uses; u; u = u->next) {
+        if (u == except) continue;
+        if (u->user->op == ALIR_OP_STORE && u->slot == &u->user->op2) continue;
+        return 1;
     }
     return 0;
 }
@@ -755,132 +767,110 @@ static int value_is_used_somewhere(AlirFunction *func, AlirValue *val) {
 /**
  * @brief Remove dead store instructions (stores to unused allocas).
  * @param module The ALIR module.
- * @param func The ALIR function.
+ * @param func The ALIR function (def-use chains valid).
+ * @return Number of stores removed.
  */
-static void remove_dead_stores_function(AlirModule *module, AlirFunction *func) {
-    (void)module;
-    if (!func || !func->blocks) return;
+int optlir_dead_stores_function(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks) return 0;
+    Arena *arena = alir_arena(module);
+    if (!arena) return 0;
+
+    // Decide once per alloca, then sweep the stores into the dead ones
+    HashMap dead;
+    hashmap_init(&dead, arena, 64);
+    int dead_count = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->op == ALIR_OP_ALLOCA && i->dest && i->dest->def == i && !value_is_read(i->dest, NULL)) {
+                char key[32];
+                snprintf(key, sizeof(key), "%p", (void*)i->dest);
+                hashmap_put(&dead, key, i->dest);
+                dead_count++;
+            }
+        }
+    }
+    if (!dead_count) {
+        hashmap_free(&dead);
+        return 0;
+    }
 
-    AlirBlock *b = func->blocks;
-    while (b) {
-        AlirInst **pip = &b->head;
-        while (*pip) {
-            AlirInst *inst = *pip;
+    int removed = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        AlirInst *prev = NULL;
+        AlirInst *inst = b->head;
+        while (inst) {
+            AlirInst *next = inst->next;
             if (inst->op == ALIR_OP_STORE && inst->op2 && inst->op2->kind == ALIR_VAL_TEMP) {
-                int is_alloca = 0;
-                AlirBlock *db = func->blocks;
-                while (db && !is_alloca) {
-                    AlirInst *di = db->head;
-                    while (di) {
-                        if (di->dest == inst->op2 && di->op == ALIR_OP_ALLOCA) {
-                            is_alloca = 1;
-                            break;
-                        }
-                        di = di->next;
-                    }
-                    db = db->next;
-                }
-                
-                if (is_alloca && !value_is_used_somewhere(func, inst->op2)) {
-                    *pip = inst->next;
+                char key[32];
+                snprintf(key, sizeof(key), "%p", (void*)inst->op2);
+                if (hashmap_get(&dead, key)) {
+                    remove_instruction(b, prev, inst);
+                    removed++;
+                    inst = next;
                     continue;
                 }
             }
-            pip = &inst->next;
+            prev = inst;
+            inst = next;
         }
-        b = b->next;
     }
+    hashmap_free(&dead);
+    return removed;
 }
 
 /**
- * @brief Check if a temp is used anywhere except in a specific load instruction.
- * @param func The ALIR function.
- * @param temp The temp value to check.
- * @param exclude_load The load instruction to exclude.
- * @return 1 if used elsewhere, 0 otherwise.
+ * @brief Find the use record of one operand slot of an instruction.
+ * @param inst The instruction.
+ * @param slot The operand slot.
+ * @return The use, or NULL if the slot holds no tracked value.
  */
-static int is_temp_used_except_in_load(AlirFunction *func, AlirValue *temp, AlirInst *exclude_load) {
-    if (!func || !temp || temp->kind != ALIR_VAL_TEMP) return 1;
-
-    AlirBlock *b = func->blocks;
-    while (b) {
-        AlirInst *i = b->head;
-        while (i) {
-            if (i == exclude_load) {
-                i = i->next;
-                continue;
-            }
-            if (i->op == ALIR_OP_STORE) {
-                if (i->op1 == temp) return 1;
-                // op2 is the destination, so it's a def, not a use
-                i = i->next;
-                continue;
-            }
-
-            if (i->op1 == temp) return 1;
-            if (i->op2 == temp) return 1;
-            if (i->dest == temp) return 1;
-            for (int j = 0; j < i->arg_count; j++) {
-                if (i->args[j] == temp) return 1;
-            }
-            i = i->next;
-        }
-        b = b->next;
+static AlirUse* find_operand_use(AlirInst *inst, AlirValue **slot) {
+    for (AlirUse *u = inst->operand_uses; u; u = u->next_operand) {
+        if (u->slot == slot) return u;
     }
-    return 0;
+    return NULL;
 }
 
 /**
  * @brief Propagate parameter copies to eliminate redundant alloca/load/store sequences.
+ *
+ * An `alloca; store param; load` run whose slot is never touched again is
+ * replaced by the parameter itself.
+ *
  * @param module The ALIR module.
- * @param func The ALIR function.
+ * @param func The ALIR function (def-use chains valid).
+ * @return Number of copies replaced.
  */
-static void propagate_param_copies_function(AlirModule *module, AlirFunction *func) {
-    Arena *arena = module->compiler_ctx ? module->compiler_ctx->arena : NULL;
+int optlir_param_copies_function(AlirModule *module, AlirFunction *func) {
     (void)module;
-    if (!func || !func->blocks) return;
+    if (!func || !func->blocks) return 0;
+    int replaced = 0;
 
     AlirBlock *entry = func->blocks;
-    if (!entry) return;
-
+    AlirInst *prev = NULL;
     AlirInst *i = entry->head;
     while (i) {
         if (i->op == ALIR_OP_ALLOCA && i->dest) {
-            AlirInst *next = i->next;
-            if (next && next->op == ALIR_OP_STORE && next->op1 && next->op1->kind == ALIR_VAL_VAR && next->op2 == i->dest) {
-                AlirInst *next2 = next->next;
-                if (next2 && next2->op == ALIR_OP_LOAD && next2->op1 == i->dest) {
-                    if (!is_temp_used_except_in_load(func, i->dest, next2)) {
-                        char *param_name = arena_strdup(arena, next->op1->val.str_val);
-
-                        next2->op = 0;
-                        next2->dest->kind = ALIR_VAL_VAR;
-                        next2->dest->val.str_val = param_name;
-                        next2->op1 = NULL;
-                        next2->op2 = NULL;
-
-                        AlirInst *to_remove[2];
-                        to_remove[0] = i;
-                        to_remove[1] = next;
-
-                        for (int r = 0; r < 2; r++) {
-                            AlirInst *inst = to_remove[r];
-                            AlirInst *prev = NULL;
-                            AlirInst *curr = entry->head;
-                            while (curr && curr != inst) {
-                                prev = curr;
-                                curr = curr->next;
-                            }
-                            if (curr == inst) {
-                                remove_instruction(entry, prev, inst);
-                            }
-                        }
-                    }
+            AlirInst *store = i->next;
+            AlirInst *load = store ? store->next : NULL;
+            if (store && store->op == ALIR_OP_STORE && store->op1 && store->op1->kind == ALIR_VAL_VAR && store->op2 == i->dest &&
+                load && load->op == ALIR_OP_LOAD && load->op1 == i->dest && load->dest) {
+                if (!value_is_read(i->dest, find_operand_use(load, &load->op1))) {
+                    AlirInst *after = load->next;
+                    alir_replace_all_uses(load->dest, store->op1);
+                    remove_instruction(entry, store, load);
+                    remove_instruction(entry, i, store);
+                    remove_instruction(entry, prev, i);
+                    replaced++;
+                    i = after;
+                    continue;
                 }
             }
         }
+        prev = i;
         i = i->next;
     }
+    return replaced;
 }
 
 /**
@@ -901,9 +891,12 @@ static int all_args_const(AlirInst *inst) {
  * @brief Evaluate pure function calls at compile time if all arguments are constant.
  * @param module The ALIR module.
  * @param func The ALIR function.
+ * @param ev The evaluator, which remembers results across call sites.
+ * @return Number of calls replaced by their result.
  */
-static void eval_pure_call_function(AlirModule *module, AlirFunction *func) {
-    if (!func || !func->blocks || func->is_extern || !func->is_pure) return;
+int optlir_pure_calls_function(AlirModule *module, AlirFunction *func, OptlirPureEval *ev) {
+    if (!func || !func->blocks || func->is_extern) return 0;
+    int evaluated = 0;
 
     AlirBlock *b = func->blocks;
     while (b) {
@@ -913,25 +906,16 @@ static void eval_pure_call_function(AlirModule *module, AlirFunction *func) {
             AlirInst *next = i->next;
             int removed = 0;
 
-            if (i->op == ALIR_OP_CALL && i->op1 && i->op1->kind == ALIR_VAL_VAR && i->dest && all_args_const(i)) {
-                AlirFunction *callee = module->functions;
-                while (callee) {
-                    if (streq_lit(callee->name, i->op1->val.str_val) && callee->is_pure && !callee->is_extern && callee->block_count > 0) {
-                        ConstVal res = eval_pure_function(module, callee, i->args, i->arg_count, i->dest->type);
-                        if (res.is_const) {
-                            i->dest->kind = ALIR_VAL_CONST;
-                            if (res.is_float) {
-                                if (i->dest->type.base == TYPE_SINGLE) i->dest->val.single_val = (float)res.double_val;
-                                else i->dest->val.double_val = res.double_val;
-                            } else {
-                                i->dest->val.long_long_val = res.int_val;
-                            }
-                            remove_instruction(b, prev, i);
-                            removed = 1;
-                        }
-                        break;
-                    }
-                    callee = callee->next;
+            AlirValue *f = i->op1;
+            if (i->op == ALIR_OP_CALL && f && (f->kind == ALIR_VAL_VAR || f->kind == ALIR_VAL_GLOBAL) &&
+                f->val.str_val && i->dest && all_args_const(i)) {
+                AlirFunction *callee = hashmap_get(&module->func_map, f->val.str_val);
+                ConstVal res = {0};
+                if (callee && optlir_pure_eval_call(ev, callee, i->args, i->arg_count, &res)) {
+                    optlir_make_const(i->dest, optlir_eval_cast(res, i->dest->type));
+                    remove_instruction(b, prev, i);
+                    removed = 1;
+                    evaluated++;
                 }
             }
 
@@ -942,53 +926,96 @@ static void eval_pure_call_function(AlirModule *module, AlirFunction *func) {
         }
         b = b->next;
     }
+    optlir_stats.pure_folded += evaluated;
+    return evaluated;
+}
+
+/**
+ * @brief Hand the phi entries of a forwarded block over to its predecessors.
+ *
+ * The value coming in from the block is available at the end of each of its
+ * predecessors, since its definition dominates the block. A predecessor that
+ * already reaches the target directly would need two entries, so such a
+ * block is not forwarded.
+ *
+ * @param module The ALIR module.
+ * @param b The block being forwarded.
+ * @param target The block it jumps to.
+ * @return 1 if b can be forwarded, 0 otherwise.
+ */
+static int forward_phis(AlirModule *module, AlirBlock *b, AlirBlock *target) {
+    if (!target->head || target->head->op != ALIR_OP_PHI) return 1;
+    for (BlockEdge *e = b->pred; e; e = e->next) {
+        if (has_edge(e->block, target)) return 0;
+    }
+    if (b->pred && !b->pred->next) {
+        // The common case: the single predecessor takes over the entries as they are
+        alir_phi_rename_pred(module, target, b, b->pred->block);
+        return 1;
+    }
+    for (AlirInst *phi = target->head; phi && phi->op == ALIR_OP_PHI; phi = phi->next) {
+        AlirValue *val = alir_phi_incoming(phi, b);
+        for (BlockEdge *e = b->pred; e; e = e->next) {
+            if (!alir_phi_incoming(phi, e->block)) alir_phi_add_incoming(module, phi, e->block, val);
+        }
+    }
+    alir_phi_remove_pred(module, target, b);
+    return 1;
 }
 
 /**
  * @brief Forward empty blocks (single-jump blocks) to their successors.
+ *
+ * Only the predecessors of a forwarded block hold branches to it, so they
+ * are the only blocks rewritten.
+ *
  * @param module The ALIR module.
- * @param func The ALIR function.
+ * @param func The ALIR function (edges must be valid).
+ * @return Number of blocks forwarded.
  */
-static void forward_empty_blocks_function(AlirModule *module, AlirFunction *func) {
-    if (!func || !func->blocks) return;
-    
-    int changed;
+int optlir_forward_blocks_function(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks) return 0;
+
+    int changed, forwarded = 0;
     do {
         changed = 0;
         AlirBlock *b = func->blocks;
         while (b) {
             // We skip func->blocks (entry block) because we can't redirect implicit entry jumps.
             if (b != func->blocks && b->head && b->head->op == ALIR_OP_JUMP && b->head->next == NULL) {
-                if (b->head->op1 && b->head->op1->kind == ALIR_VAL_LABEL) {
-                    const char *target_label = b->head->op1->val.str_val;
-                    if (!streq_lit(b->label, target_label)) {
-                        redirect_label_in_all_blocks(module, func, b->label, target_label);
-                        // Prevent infinite loop by making it jump to itself, it will be removed as unreachable
-                        b->head->op1->val.str_val = b->label;
-                        changed = 1;
+                AlirValue *jump = b->head->op1;
+                if (jump && jump->kind == ALIR_VAL_LABEL && jump->block && jump->block != b) {
+                    AlirBlock *target = jump->block;
+                    if (!forward_phis(module, b, target)) {
+                        b = b->next;
+                        continue;
                     }
+                    while (b->pred) {
+                        AlirBlock *p = b->pred->block;
+                        redirect_branches(module, p, b, target);
+                        if (b->pred && b->pred->block == p) remove_edge(p, b);
+                    }
+                    // Prevent infinite loop by making it jump to itself, it will be removed as unreachable
+                    retarget_branch(module, b, &b->head->op1, b);
+                    changed = 1;
+                    forwarded++;
                 }
             }
             b = b->next;
         }
     } while (changed);
+    return forwarded;
 }
 
 /**
- * @brief Run all local ALIR optimization passes on a module.
+ * @brief Remove the stack release markers mem2reg leaves behind.
  * @param module The ALIR module.
- * @param opt_level Optimization level (0 = none, higher = more passes).
+ * @return Number of markers removed.
  */
-void optlir_optimize(AlirModule *module, int opt_level) {
-    if (!module || opt_level <= 0) return;
-
-    optlir_mem2reg_local(module);
-
-    // Clean up NOPs generated by mem2reg before further optimization passes
-    AlirFunction *f = module->functions;
-    while (f) {
-        AlirBlock *b = f->blocks;
-        while (b) {
+int optlir_strip_free_stack(AlirModule *module) {
+    int removed = 0;
+    for (AlirFunction *f = module->functions; f; f = f->next) {
+        for (AlirBlock *b = f->blocks; b; b = b->next) {
             AlirInst *prev = NULL;
             AlirInst *i = b->head;
             while (i) {
@@ -998,48 +1025,13 @@ void optlir_optimize(AlirModule *module, int opt_level) {
                     if (prev) prev->next = i;
                     else b->head = i;
                     if (b->tail == to_remove) b->tail = prev;
+                    removed++;
                 } else {
                     prev = i;
                     i = i->next;
                 }
             }
-            b = b->next;
-        }
-        f = f->next;
-    }
-    int max_iters = (opt_level >= 3) ? 5 : 1;
-    for (int iter = 0; iter < max_iters; iter++) {
-        AlirFunction *func = module->functions;
-        while (func) {
-            if (!func->is_extern) {
-                if (opt_level >= 1) {
-                    remove_unreachable_blocks_function(module, func);
-                    forward_empty_blocks_function(module, func);
-                }
-                if (opt_level >= 2) {
-                    constant_propagate_function(module, func);
-                    fold_branches_function(module, func);
-                    merge_blocks_function(module, func);
-                    remove_dead_stores_function(module, func);
-                    propagate_param_copies_function(module, func);
-                }
-                if (opt_level >= 3) {
-                    eval_pure_call_function(module, func);
-                }
-            }
-
-            {
-                AlirBlock *b = func->blocks;
-                while (b) {
-                    free_edges(b->pred);
-                    free_edges(b->succ);
-                    b->pred = NULL;
-                    b->succ = NULL;
-                    b = b->next;
-                }
-            }
-            func = func->next;
         }
     }
-    optlir_dce_allocs(module);
+    return removed;
 }
@@ -0,0 +1,305 @@
+/**
+ * @file loop.c
+ * @brief Natural loops of ALIR functions and their nesting forest.
+ *
+ * A back edge is an edge whose target dominates its source. The blocks of
+ * the loop it closes are found by walking predecessors back from the latch
+ * until the header. Loops nest by containment, so sorting them by size puts
+ * every loop before the loops around it.
+ */
+#include "optlir/loop.h"
+#include "alir/phi.h"
+#include "alir/use.h"
+#include "common/arena.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * @brief Orders packed (preorder << 32 | index) pairs.
+ * @param a First pair.
+ * @param b Second pair.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int loop_cmp_packed(const void *a, const void *b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Orders loops by size, then by header.
+ * @param a First loop pointer.
+ * @param b Second loop pointer.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int loop_cmp_size(const void *a, const void *b) {
+    const OptlirLoop *x = *(OptlirLoop* const*)a, *y = *(OptlirLoop* const*)b;
+    if (x->block_count != y->block_count) return x->block_count - y->block_count;
+    return x->header - y->header;
+}
+
+/**
+ * @brief Collects the blocks of the loop closed by back edges into a header.
+ * @param module The ALIR module.
+ * @param dom The dominator information.
+ * @param loop The loop, with header and latches set.
+ * @param mark Per-block stamps, stamp marks membership.
+ * @param stamp Stamp of this loop.
+ * @param work Worklist of at least dom->count entries.
+ */
+static void loop_collect(AlirModule *module, OptlirDomTree *dom, OptlirLoop *loop, int *mark, int stamp, int *work) {
+    int top = 0, count = 1;
+    mark[loop->header] = stamp;
+    for (int k = 0; k < loop->latch_count; k++) {
+        int l = loop->latches[k];
+        if (mark[l] == stamp) continue;
+        mark[l] = stamp;
+        work[top++] = l;
+        count++;
+    }
+    while (top > 0) {
+        int bi = work[--top];
+        for (int k = dom->pred_first[bi]; k < dom->pred_end[bi]; k++) {
+            int p = dom->preds[k];
+            if (mark[p] == stamp) continue;
+            mark[p] = stamp;
+            work[top++] = p;
+            count++;
+        }
+    }
+
+    // Members in dominator preorder; the header dominates them all, so it leads
+    long long *packed = alir_alloc(module, sizeof(long long) * count);
+    int n = 0;
+    packed[n++] = ((long long)dom->pre[loop->header] << 32) | loop->header;
+    for (int k = 0; k < loop->latch_count; k++) work[top++] = loop->latches[k];
+    int seen = stamp + 1;
+    mark[loop->header] = seen;
+    while (top > 0) {
+        int bi = work[--top];
+        if (mark[bi] != stamp) continue;
+        mark[bi] = seen;
+        packed[n++] = ((long long)dom->pre[bi] << 32) | bi;
+        for (int k = dom->pred_first[bi]; k < dom->pred_end[bi]; k++) {
+            if (mark[dom->preds[k]] == stamp) work[top++] = dom->preds[k];
+        }
+    }
+    qsort(packed, n, sizeof(long long), loop_cmp_packed);
+    loop->blocks = alir_alloc(module, sizeof(int) * n);
+    for (int k = 0; k < n; k++) loop->blocks[k] = (int)(packed[k] & 0xffffffff);
+    loop->block_count = n;
+}
+
+/**
+ * @brief Finds the natural loops of a function and how they nest.
+ * @param module The ALIR module (tables come from its arena).
+ * @param dom The dominator information of the function.
+ * @return The loops; a function without loops gets an empty forest.
+ */
+OptlirLoopForest* optlir_loops_build(AlirModule *module, OptlirDomTree *dom) {
+    OptlirLoopForest *forest = alir_alloc(module, sizeof(OptlirLoopForest));
+    int n = dom ? dom->count : 0;
+    forest->dom = dom;
+    forest->innermost = alir_alloc(module, sizeof(OptlirLoop*) * (n ? n : 1));
+    if (!n) return forest;
+
+    // Back edges, grouped by header
+    OptlirLoop **by_header = alir_alloc(module, sizeof(OptlirLoop*) * n);
+    for (int h = 0; h < n; h++) {
+        int latches = 0;
+        for (int k = dom->pred_first[h]; k < dom->pred_end[h]; k++) {
+            if (optlir_dominates(dom, h, dom->preds[k])) latches++;
+        }
+        if (!latches) continue;
+        OptlirLoop *loop = alir_alloc(module, sizeof(OptlirLoop));
+        loop->header = h;
+        loop->latches = alir_alloc(module, sizeof(int) * latches);
+        for (int k = dom->pred_first[h]; k < dom->pred_end[h]; k++) {
+            int p = dom->preds[k];
+            if (!optlir_dominates(dom, h, p)) continue;
+            int dup = 0;
+            for (int j = 0; j < loop->latch_count; j++) dup |= loop->latches[j] == p;
+            if (!dup) loop->latches[loop->latch_count++] = p;
+        }
+        by_header[h] = loop;
+        forest->count++;
+    }
+    if (!forest->count) return forest;
+
+    forest->loops = alir_alloc(module, sizeof(OptlirLoop*) * forest->count);
+    int *mark = alir_alloc(module, sizeof(int) * n);
+    int *work = alir_alloc(module, sizeof(int) * (dom->pred_first[n] + n + 1));
+    int count = 0;
+    for (int h = 0; h < n; h++) {
+        if (!by_header[h]) continue;
+        loop_collect(module, dom, by_header[h], mark, 2 * count + 1, work);
+        forest->loops[count++] = by_header[h];
+    }
+
+    // Smaller loops first; each block's innermost loop is the first to claim it
+    qsort(forest->loops, count, sizeof(OptlirLoop*), loop_cmp_size);
+    for (int k = 0; k < count; k++) {
+        OptlirLoop *loop = forest->loops[k];
+        for (int j = 0; j < loop->block_count; j++) {
+            int bi = loop->blocks[j];
+            OptlirLoop *r = forest->innermost[bi];
+            if (!r) {
+                forest->innermost[bi] = loop;
+                continue;
+            }
+            while (r->parent) r = r->parent;
+            if (r != loop) r->parent = loop;
+        }
+    }
+
+    // Outer loops are numbered before the loops they hold
+    for (int k = count - 1; k >= 0; k--) {
+        OptlirLoop *loop = forest->loops[k];
+        loop->depth = loop->parent ? loop->parent->depth + 1 : 1;
+        OptlirLoop **list = loop->parent ? &loop->parent->child : &forest->roots;
+        loop->sibling = *list;
+        *list = loop;
+    }
+
+    // A sole outside predecessor that only jumps to the header is already a preheader
+    for (int k = 0; k < count; k++) {
+        OptlirLoop *loop = forest->loops[k];
+        int outside = -1, outside_count = 0;
+        for (int j = dom->pred_first[loop->header]; j < dom->pred_end[loop->header]; j++) {
+            int p = dom->preds[j];
+            if (optlir_loop_contains(forest, loop, p)) continue;
+            outside = p;
+            outside_count++;
+        }
+        if (outside_count != 1) continue;
+        AlirBlock *pb = dom->blocks[outside];
+        if (pb->tail && pb->tail->op == ALIR_OP_JUMP) loop->preheader = pb;
+    }
+    return forest;
+}
+
+/**
+ * @brief Whether a loop holds a block, directly or through a nested loop.
+ * @param forest The loops.
+ * @param loop The loop.
+ * @param bi Dominator index of the block.
+ * @return Non-zero if the block belongs to the loop.
+ */
+int optlir_loop_contains(OptlirLoopForest *forest, OptlirLoop *loop, int bi) {
+    if (bi < 0) return 0;
+    for (OptlirLoop *l = forest->innermost[bi]; l; l = l->parent) {
+        if (l == loop) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns a temp number no instruction of a function defines yet.
+ * @param func The function.
+ * @return One past the highest temp number in use.
+ */
+static int loop_next_temp(AlirFunction *func) {
+    int next = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->dest && i->dest->kind == ALIR_VAL_TEMP && i->dest->temp_id >= next) next = i->dest->temp_id + 1;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Gives a loop a preheader.
+ * @param module The ALIR module.
+ * @param func The function.
+ * @param forest The loops.
+ * @param loop The loop.
+ * @return The preheader, or NULL for a loop headed by the entry block.
+ */
+AlirBlock* optlir_loop_make_preheader(AlirModule *module, AlirFunction *func, OptlirLoopForest *forest, OptlirLoop *loop) {
+    if (loop->preheader) return loop->preheader;
+    if (loop->header == 0) return NULL;
+
+    OptlirDomTree *dom = forest->dom;
+    AlirBlock *header = dom->blocks[loop->header];
+    Arena *arena = alir_arena(module);
+    HashMap outside;
+    hashmap_init(&outside, arena, 16);
+    AlirBlock *first = NULL;
+    char key[32];
+    for (int j = dom->pred_first[loop->header]; j < dom->pred_end[loop->header]; j++) {
+        int p = dom->preds[j];
+        if (optlir_loop_contains(forest, loop, p)) continue;
+        snprintf(key, sizeof(key), "%p", (void*)dom->blocks[p]);
+        hashmap_put(&outside, key, dom->blocks[p]);
+        if (!first) first = dom->blocks[p];
+    }
+
+    char label[160];
+    snprintf(label, sizeof(label), "%s.ph", header->label ? header->label : "loop");
+    AlirBlock *pre = alir_alloc(module, sizeof(AlirBlock));
+    pre->label = alir_strdup(module, label);
+    pre->id = func->block_count++;
+
+    // Header phis: the outside entries become one entry from the preheader
+    int phis = 0;
+    for (AlirInst *phi = header->head; phi && phi->op == ALIR_OP_PHI; phi = phi->next) phis++;
+    AlirValue **incoming = alir_alloc(module, sizeof(AlirValue*) * (phis ? phis : 1));
+    HashMap keep;
+    hashmap_init(&keep, arena, 16);
+    int p = 0, next_temp = -1;
+    for (AlirInst *phi = header->head; phi && phi->op == ALIR_OP_PHI; phi = phi->next, p++) {
+        AlirValue *same = NULL;
+        int entries = 0, differ = 0;
+        for (int k = 0; k + 1 < phi->arg_count; k += 2) {
+            snprintf(key, sizeof(key), "%p", (void*)phi->args[k]->block);
+            if (!hashmap_get(&outside, key)) {
+                hashmap_put(&keep, key, phi->args[k]->block);
+                continue;
+            }
+            if (entries++ && phi->args[k + 1] != same) differ = 1;
+            same = phi->args[k + 1];
+        }
+        if (!differ) {
+            incoming[p] = same;
+            continue;
+        }
+        if (next_temp < 0) next_temp = loop_next_temp(func);
+        AlirValue *dest = alir_val_temp(module, phi->dest->type, next_temp++);
+        AlirInst *merge = alir_phi_create(module, dest, entries);
+        for (int k = 0; k + 1 < phi->arg_count; k += 2) {
+            snprintf(key, sizeof(key), "%p", (void*)phi->args[k]->block);
+            if (hashmap_get(&outside, key)) alir_phi_add_incoming(module, merge, phi->args[k]->block, phi->args[k + 1]);
+        }
+        alir_phi_insert(pre, merge);
+        incoming[p] = dest;
+    }
+    if (phis) {
+        alir_phi_keep_preds(module, header, &keep);
+        p = 0;
+        for (AlirInst *phi = header->head; phi && phi->op == ALIR_OP_PHI; phi = phi->next, p++) {
+            if (incoming[p]) alir_phi_add_incoming(module, phi, pre, incoming[p]);
+        }
+    }
+
+    // Outside branches to the header go to the preheader instead
+    for (int j = dom->pred_first[loop->header]; j < dom->pred_end[loop->header]; j++) {
+        AlirBlock *pb = dom->blocks[dom->preds[j]];
+        snprintf(key, sizeof(key), "%p", (void*)pb);
+        if (!hashmap_get(&outside, key) || !pb->tail) continue;
+        int n = alir_branch_count(pb->tail);
+        for (int k = 0; k < n; k++) {
+            AlirValue **slot = alir_branch_slot(pb->tail, k);
+            if (slot && *slot && (*slot)->block == header) *slot = alir_val_block(module, pre);
+        }
+    }
+    alir_append_inst(pre, mk_inst(module, ALIR_OP_JUMP, NULL, alir_val_block(module, header), NULL));
+
+    pre->next = first->next;
+    first->next = pre;
+    loop->preheader = pre;
+    if (!arena) {
+        hashmap_free(&outside);
+        hashmap_free(&keep);
+    }
+    return pre;
+}
@@ -3,21 +3,28 @@
  * @brief Memory-to-register promotion pass for ALIR.
  */
 #include "optlir.h"
+#include "optlir/local.h"
+#include "optlir/dom.h"
 #include "common/arena.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 /**
  * @brief Promote stack allocations to registers where possible (local mem2reg pass).
+ *
+ * A load from a slot stored earlier in the same block hands its uses over to
+ * the stored value and becomes a NOP. The stored value is read from the store
+ * when the load is reached, so earlier replacements are already applied.
+ *
  * @param module The ALIR module.
  */
 void optlir_mem2reg_local(AlirModule *module) {
     AlirFunction *func = module->functions;
     while(func) {
-        HashMap repl_map;
-        hashmap_init(&repl_map, module->compiler_ctx->arena, 256);
-        
+        alir_build_uses(module, func);
+
         AlirBlock *b = func->blocks;
         while(b) {
             HashMap store_map;
@@ -28,16 +35,15 @@ void optlir_mem2reg_local(AlirModule *module) {
                 if (inst->op == ALIR_OP_STORE && inst->op2 && inst->op2->kind == ALIR_VAL_TEMP && inst->op1) {
                     char key[32];
                     snprintf(key, sizeof(key), "%d", inst->op2->temp_id);
-                    hashmap_put(&store_map, key, inst->op1);
+                    hashmap_put(&store_map, key, inst);
                 }
                 else if (inst->op == ALIR_OP_LOAD && inst->op1 && inst->op1->kind == ALIR_VAL_TEMP && inst->dest && inst->dest->kind == ALIR_VAL_TEMP) {
                     char key[32];
                     snprintf(key, sizeof(key), "%d", inst->op1->temp_id);
-                    AlirValue *val = hashmap_get(&store_map, key);
-                    if (val) {
-                        char dest_key[32];
-                        snprintf(dest_key, sizeof(dest_key), "%d", inst->dest->temp_id);
-                        hashmap_put(&repl_map, dest_key, val);
+                    AlirInst *store = hashmap_get(&store_map, key);
+                    if (store) {
+                        alir_replace_all_uses(inst->dest, store->op1);
+                        alir_drop_uses(inst);
                         
                         inst->op = ALIR_OP_FREE_STACK; // Make it a NOP
                         inst->dest = NULL;
@@ -49,122 +55,480 @@ void optlir_mem2reg_local(AlirModule *module) {
             hashmap_free(&store_map);
             b = b->next;
         }
-        
-        b = func->blocks;
-        while(b) {
-            AlirInst *inst = b->head;
-            while(inst) {
-                if (inst->op1 && inst->op1->kind == ALIR_VAL_TEMP) {
-                    char key[32]; snprintf(key, sizeof(key), "%d", inst->op1->temp_id);
-                    AlirValue *repl = hashmap_get(&repl_map, key);
-                    while(repl && repl->kind == ALIR_VAL_TEMP) {
-                        char k2[32]; snprintf(k2, sizeof(k2), "%d", repl->temp_id);
-                        AlirValue *r2 = hashmap_get(&repl_map, k2);
-                        if (r2) repl = r2; else break;
-                    }
-                    if (repl) inst->op1 = repl;
-                }
-                if (inst->op2 && inst->op2->kind == ALIR_VAL_TEMP) {
-                    char key[32]; snprintf(key, sizeof(key), "%d", inst->op2->temp_id);
-                    AlirValue *repl = hashmap_get(&repl_map, key);
-                    while(repl && repl->kind == ALIR_VAL_TEMP) {
-                        char k2[32]; snprintf(k2, sizeof(k2), "%d", repl->temp_id);
-                        AlirValue *r2 = hashmap_get(&repl_map, k2);
-                        if (r2) repl = r2; else break;
-                    }
-                    if (repl) inst->op2 = repl;
-                }
-                for(int i=0; i<inst->arg_count; i++) {
-                    if (inst->args[i] && inst->args[i]->kind == ALIR_VAL_TEMP) {
-                        char key[32]; snprintf(key, sizeof(key), "%d", inst->args[i]->temp_id);
-                        AlirValue *repl = hashmap_get(&repl_map, key);
-                        while(repl && repl->kind == ALIR_VAL_TEMP) {
-                            char k2[32]; snprintf(k2, sizeof(k2), "%d", repl->temp_id);
-                            AlirValue *r2 = hashmap_get(&repl_map, k2);
-                            if (r2) repl = r2; else break;
-                        }
-                        if (repl) inst->args[i] = repl;
-                    }
-                }
-                inst = inst->next;
-            }
-            b = b->next;
-        }
-        hashmap_free(&repl_map);
         func = func->next;
     }
 }
 
 /**
  * @brief Dead-code eliminate unused alloca instructions.
+ *
+ * An alloca whose only uses are the addresses of stores is never read, so the
+ * alloca and all of those stores become NOPs.
+ *
  * @param module The ALIR module.
  */
 void optlir_dce_allocs(AlirModule *module) {
     AlirFunction *func = module->functions;
     while(func) {
-        HashMap used_map;
-        hashmap_init(&used_map, module->compiler_ctx->arena, 256);
-        
-        HashMap alloc_map;
-        hashmap_init(&alloc_map, module->compiler_ctx->arena, 256);
-        
+        alir_build_uses(module, func);
+
         AlirBlock *b = func->blocks;
         while(b) {
             AlirInst *inst = b->head;
             while(inst) {
                 if (inst->op == ALIR_OP_ALLOCA && inst->dest && inst->dest->kind == ALIR_VAL_TEMP) {
-                    char key[32]; snprintf(key, sizeof(key), "%d", inst->dest->temp_id);
-                    hashmap_put(&alloc_map, key, (void*)1);
-                }
-                if (inst->op != ALIR_OP_STORE && inst->op != ALIR_OP_ALLOCA) {
-                    if (inst->op1 && inst->op1->kind == ALIR_VAL_TEMP) {
-                        char key[32]; snprintf(key, sizeof(key), "%d", inst->op1->temp_id);
-                        hashmap_put(&used_map, key, (void*)1);
-                    }
-                    if (inst->op2 && inst->op2->kind == ALIR_VAL_TEMP) {
-                        char key[32]; snprintf(key, sizeof(key), "%d", inst->op2->temp_id);
-                        hashmap_put(&used_map, key, (void*)1);
+                    int used = 0;
+                    for (AlirUse *u = inst->dest->uses; u && !used; u = u->next) {
+                        used = !(u->user->op == ALIR_OP_STORE && u->slot == &u->user->op2);
                     }
-                    for(int i=0; i<inst->arg_count; i++) {
-                        if (inst->args[i] && inst->args[i]->kind == ALIR_VAL_TEMP) {
-                            char key[32]; snprintf(key, sizeof(key), "%d", inst->args[i]->temp_id);
-                            hashmap_put(&used_map, key, (void*)1);
+                    if (!used) {
+                        // Only stores whose target is this unused ALLOCA are deleted.
+                        // A store through a GETPTR may still reach a used base.
+                        AlirUse *u = inst->dest->uses;
+                        while (u) {
+                            AlirUse *next = u->next;
+                            AlirInst *store = u->user;
+                            alir_drop_uses(store);
+                            store->op = ALIR_OP_FREE_STACK; // NOP
+                            store->op1 = NULL;
+                            store->op2 = NULL;
+                            u = next;
                         }
+                        alir_drop_uses(inst);
+                        inst->op = ALIR_OP_FREE_STACK; // NOP
+                        inst->dest = NULL;
                     }
                 }
                 inst = inst->next;
             }
             b = b->next;
         }
-        
-        b = func->blocks;
-        while(b) {
-            AlirInst *inst = b->head;
-            while(inst) {
-                if (inst->op == ALIR_OP_ALLOCA && inst->dest && inst->dest->kind == ALIR_VAL_TEMP) {
-                    char key[32]; snprintf(key, sizeof(key), "%d", inst->dest->temp_id);
-                    if (!hashmap_get(&used_map, key)) {
-                        inst->op = ALIR_OP_FREE_STACK; // NOP
-                        inst->dest = NULL;
-                    }
+        func = func->next;
+    }
+}
+
+/**
+ * @brief A stack slot being promoted to SSA values.
+ */
+typedef struct SsaVar {
+    AlirValue *slot;            // Address defined by the alloca
+    VarType type;
+    OptlirIndexList *defs;      // Blocks writing the slot (stores, the alloca)
+    OptlirIndexList *exposed;   // Blocks reading the slot before writing it
+    AlirValue *undef;           // Value of the slot before any store
+} SsaVar;
+
+/**
+ * @brief A phi placed for a promoted slot.
+ */
+typedef struct SsaPhi {
+    AlirInst *phi;
+    int var;
+    struct SsaPhi *next;        // Next phi of the same block
+    struct SsaPhi *all;         // Next phi of the function
+} SsaPhi;
+
+/**
+ * @brief Whether a value type lives in a register of every backend.
+ * @param t The type.
+ * @return Non-zero for plain scalars and pointers.
+ */
+static int ssa_scalar_type(VarType t) {
+    if (t.array_size || t.array_depth || t.is_tainted || t.is_func_ptr) return 0;
+    if (t.ptr_depth > 0) return 1;
+    switch (t.base) {
+        case TYPE_INT: case TYPE_UNSIGNED_INT: case TYPE_SHORT:
+        case TYPE_LONG: case TYPE_LONG_LONG: case TYPE_UNSIGNED_LONG: case TYPE_UNSIGNED_LONG_LONG:
+        case TYPE_CHAR: case TYPE_UNSIGNED_CHAR: case TYPE_BOOL:
+        case TYPE_SINGLE: case TYPE_DOUBLE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Whether a value read from or written to a slot has the slot's own type.
+ *
+ * Backends load with the slot type and store with the value type, so a
+ * mismatch reinterprets memory and the slot has to stay in memory.
+ *
+ * @param slot The slot type.
+ * @param t The type of the value.
+ * @return Non-zero if the value can stand in for the slot.
+ */
+static int ssa_same_type(VarType slot, VarType t) {
+    if (!ssa_scalar_type(t)) return 0;
+    if (slot.ptr_depth > 0) return t.ptr_depth > 0;
+    return t.ptr_depth == 0 && t.base == slot.base;
+}
+
+/**
+ * @brief Whether an alloca can be promoted to SSA values.
+ *
+ * The slot must be a scalar whose address is only ever loaded from or
+ * stored to, with values of its own type.
+ *
+ * @param inst The alloca (def-use chains must be valid).
+ * @return Non-zero if promotable.
+ */
+static int ssa_promotable(AlirInst *inst) {
+    AlirValue *slot = inst->dest;
+    if (inst->op1 || !slot || slot->kind != ALIR_VAL_TEMP || slot->def != inst) return 0;
+    if (!ssa_scalar_type(slot->type)) return 0;
+    for (AlirUse *u = slot->uses; u; u = u->next) {
+        AlirInst *user = u->user;
+        if (user->op == ALIR_OP_LOAD && u->slot == &user->op1 && user->dest) {
+            if (!ssa_same_type(slot->type, user->dest->type)) return 0;
+        } else if (user->op == ALIR_OP_STORE && u->slot == &user->op2 && user->op1 && user->op1 != slot) {
+            if (!ssa_same_type(slot->type, user->op1->type)) return 0;
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns the promoted slot an address operand names.
+ * @param vars Map from "%p" of a slot to its index + 1.
+ * @param addr The address operand.
+ * @return The slot index, or -1.
+ */
+static int ssa_var_of(HashMap *vars, AlirValue *addr) {
+    if (!addr || addr->kind != ALIR_VAL_TEMP) return -1;
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)addr);
+    return (int)(uintptr_t)hashmap_get(vars, key) - 1;
+}
+
+/**
+ * @brief Prepends a block index to a list.
+ * @param module The ALIR module.
+ * @param list The list head.
+ * @param index The block index.
+ */
+static void ssa_push(AlirModule *module, OptlirIndexList **list, int index) {
+    OptlirIndexList *node = alir_alloc(module, sizeof(OptlirIndexList));
+    node->index = index;
+    node->next = *list;
+    *list = node;
+}
+
+/**
+ * @brief Returns the zero a slot holds before its first store.
+ * @param module The ALIR module.
+ * @param var The slot.
+ * @return The shared zero constant of the slot.
+ */
+static AlirValue* ssa_undef(AlirModule *module, SsaVar *var) {
+    if (!var->undef) {
+        var->undef = alir_alloc(module, sizeof(AlirValue));
+        var->undef->kind = ALIR_VAL_CONST;
+        var->undef->type = var->type;
+    }
+    return var->undef;
+}
+
+/**
+ * @brief Turns a load or store of a promoted slot into a NOP.
+ * @param inst The instruction.
+ */
+static void ssa_nop(AlirInst *inst) {
+    alir_drop_uses(inst);
+    inst->op = ALIR_OP_FREE_STACK;
+    inst->dest = NULL;
+    inst->op1 = NULL;
+    inst->op2 = NULL;
+}
+
+/**
+ * @brief Whether two values are the same SSA value or equal constants.
+ * @param a The first value.
+ * @param b The second value.
+ * @return Non-zero if interchangeable.
+ */
+static int ssa_same_value(AlirValue *a, AlirValue *b) {
+    if (a == b) return 1;
+    return a && b && a->kind == ALIR_VAL_CONST && b->kind == ALIR_VAL_CONST &&
+           a->type.base == b->type.base && a->type.ptr_depth == b->type.ptr_depth &&
+           a->val.long_long_val == b->val.long_long_val;
+}
+
+/**
+ * @brief Removes phis that merge a single value, repeating as removals expose more.
+ *
+ * A removed phi becomes a NOP like the promoted loads and stores.
+ *
+ * @param module The ALIR module.
+ * @param all Every placed phi.
+ * @param vars The promoted slots.
+ */
+static void ssa_remove_trivial_phis(AlirModule *module, SsaPhi *all, SsaVar *vars) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (SsaPhi *p = all; p; p = p->all) {
+            AlirInst *phi = p->phi;
+            if (phi->op != ALIR_OP_PHI) continue;
+
+            AlirValue *same = NULL;
+            int trivial = 1;
+            for (int k = 1; k < phi->arg_count && trivial; k += 2) {
+                AlirValue *v = phi->args[k];
+                if (v == phi->dest || ssa_same_value(v, same)) continue;
+                if (same) trivial = 0;
+                else same = v;
+            }
+            if (!trivial) continue;
+
+            alir_replace_all_uses(phi->dest, same ? same : ssa_undef(module, &vars[p->var]));
+            alir_drop_uses(phi);
+            phi->op = ALIR_OP_FREE_STACK;
+            phi->dest = NULL;
+            phi->args = NULL;
+            phi->arg_count = 0;
+            changed = 1;
+        }
+    }
+}
+
+/**
+ * @brief Promotes the scalar stack slots of one function to SSA values.
+ * @param module The ALIR module.
+ * @param func The function.
+ */
+static void ssa_promote_function(AlirModule *module, AlirFunction *func) {
+    Arena *arena = alir_arena(module);
+    alir_build_uses(module, func);
+
+    // Promotable slots, and the first free temp id for the phis
+    HashMap var_map;
+    hashmap_init(&var_map, arena, 64);
+    int var_count = 0, var_capacity = 16, next_temp = 0;
+    SsaVar *vars = alir_alloc(module, sizeof(SsaVar) * var_capacity);
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->dest && i->dest->kind == ALIR_VAL_TEMP && i->dest->temp_id >= next_temp) next_temp = i->dest->temp_id + 1;
+            if (i->op != ALIR_OP_ALLOCA || !ssa_promotable(i)) continue;
+            if (var_count == var_capacity) {
+                SsaVar *grown = alir_alloc(module, sizeof(SsaVar) * var_capacity * 2);
+                memcpy(grown, vars, sizeof(SsaVar) * var_count);
+                vars = grown;
+                var_capacity *= 2;
+            }
+            vars[var_count].slot = i->dest;
+            vars[var_count].type = i->dest->type;
+            char key[32];
+            snprintf(key, sizeof(key), "%p", (void*)i->dest);
+            hashmap_put(&var_map, key, (void*)(uintptr_t)(++var_count));
+        }
+    }
+    if (!var_count) {
+        if (!arena) hashmap_free(&var_map);
+        return;
+    }
+
+    optlir_build_edges(func, arena);
+    OptlirDomTree *dom = optlir_dom_build(module, func);
+    int n = dom->count;
+
+    // Blocks writing each slot, and blocks reading it before writing it
+    int *written = alir_alloc(module, sizeof(int) * var_count);
+    int *read = alir_alloc(module, sizeof(int) * var_count);
+    for (int bi = 0; bi < n; bi++) {
+        for (AlirInst *i = dom->blocks[bi]->head; i; i = i->next) {
+            int v = -1;
+            if (i->op == ALIR_OP_STORE) v = ssa_var_of(&var_map, i->op2);
+            else if (i->op == ALIR_OP_ALLOCA) v = ssa_var_of(&var_map, i->dest);
+            if (v >= 0) {
+                if (written[v] != bi + 1) ssa_push(module, &vars[v].defs, bi);
+                written[v] = bi + 1;
+                continue;
+            }
+            if (i->op == ALIR_OP_LOAD && (v = ssa_var_of(&var_map, i->op1)) >= 0 && written[v] != bi + 1 && read[v] != bi + 1) {
+                ssa_push(module, &vars[v].exposed, bi);
+                read[v] = bi + 1;
+            }
+        }
+    }
+
+    // Phis at the iterated dominance frontier of the writes, where the slot is live
+    SsaPhi **at = alir_alloc(module, sizeof(SsaPhi*) * n);
+    SsaPhi *all = NULL;
+    int *live = alir_alloc(module, sizeof(int) * n);
+    int *defined = alir_alloc(module, sizeof(int) * n);
+    int *placed = alir_alloc(module, sizeof(int) * n);
+    int *work = alir_alloc(module, sizeof(int) * (dom->pred_first[n] + n + 1));
+    for (int v = 0; v < var_count; v++) {
+        int stamp = v + 1, top = 0;
+        for (OptlirIndexList *d = vars[v].defs; d; d = d->next) defined[d->index] = stamp;
+
+        // Live-in blocks: backwards from the exposed reads, stopping at writes
+        for (OptlirIndexList *r = vars[v].exposed; r; r = r->next) work[top++] = r->index;
+        while (top > 0) {
+            int bi = work[--top];
+            if (live[bi] == stamp) continue;
+            live[bi] = stamp;
+            for (int k = dom->pred_first[bi]; k < dom->pred_end[bi]; k++) {
+                int p = dom->preds[k];
+                if (live[p] != stamp && defined[p] != stamp) work[top++] = p;
+            }
+        }
+
+        for (OptlirIndexList *d = vars[v].defs; d; d = d->next) work[top++] = d->index;
+        while (top > 0) {
+            int bi = work[--top];
+            for (OptlirIndexList *f = dom->frontier[bi]; f; f = f->next) {
+                int y = f->index;
+                if (placed[y] == stamp || live[y] != stamp) continue;
+                placed[y] = stamp;
+
+                AlirBlock *yb = dom->blocks[y];
+                int capacity = 0;
+                for (BlockEdge *e = yb->pred; e; e = e->next) capacity++;
+                AlirValue *dest = alir_alloc(module, sizeof(AlirValue));
+                dest->kind = ALIR_VAL_TEMP;
+                dest->type = vars[v].type;
+                dest->temp_id = next_temp++;
+                SsaPhi *sp = alir_alloc(module, sizeof(SsaPhi));
+                sp->phi = alir_phi_create(module, dest, capacity);
+                sp->var = v;
+                sp->next = at[y];
+                at[y] = sp;
+                sp->all = all;
+                all = sp;
+                alir_phi_insert(yb, sp->phi);
+
+                if (defined[y] != stamp) {
+                    defined[y] = stamp;
+                    work[top++] = y;
                 }
-                else if (inst->op == ALIR_OP_STORE && inst->op2 && inst->op2->kind == ALIR_VAL_TEMP) {
-                    char key[32]; snprintf(key, sizeof(key), "%d", inst->op2->temp_id);
-                    // Only delete the store if the target is an unused ALLOCA.
-                    // If it is a GETPTR or anything else, we don't know if the base is used,
-                    // so it is unsafe to delete it blindly.
-                    if (hashmap_get(&alloc_map, key) && !hashmap_get(&used_map, key)) {
-                        inst->op = ALIR_OP_FREE_STACK; // NOP
-                        inst->op1 = NULL;
-                        inst->op2 = NULL;
+            }
+        }
+    }
+
+    // Rename along the dominator tree; the log restores values on the way back up
+    AlirValue **current = alir_alloc(module, sizeof(AlirValue*) * var_count);
+    int log_capacity = 64, log_top = 0;
+    int *log_var = alir_alloc(module, sizeof(int) * log_capacity);
+    AlirValue **log_val = alir_alloc(module, sizeof(AlirValue*) * log_capacity);
+    int *stack = alir_alloc(module, sizeof(int) * n);
+    int *mark = alir_alloc(module, sizeof(int) * n);
+    int *next_child = alir_alloc(module, sizeof(int) * n);
+    int *seen = alir_alloc(module, sizeof(int) * n);
+    int top = 0;
+    stack[top++] = 0;
+    next_child[0] = -2;
+
+    while (top > 0) {
+        int bi = stack[top - 1];
+        if (next_child[bi] == -2) {
+            // Entering the block
+            AlirBlock *b = dom->blocks[bi];
+            mark[bi] = log_top;
+            next_child[bi] = dom->child[bi];
+            for (AlirInst *i = b->head; i; i = i->next) {
+                int v = -1;
+                AlirValue *val = NULL;
+                if (i->op == ALIR_OP_PHI) {
+                    for (SsaPhi *sp = at[bi]; sp; sp = sp->next) {
+                        if (sp->phi == i) {
+                            v = sp->var;
+                            val = i->dest;
+                        }
+                    }
+                } else if (i->op == ALIR_OP_STORE && (v = ssa_var_of(&var_map, i->op2)) >= 0) {
+                    val = i->op1;
+                    ssa_nop(i);
+                } else if (i->op == ALIR_OP_ALLOCA && (v = ssa_var_of(&var_map, i->dest)) >= 0) {
+                    val = ssa_undef(module, &vars[v]);
+                    ssa_nop(i);
+                } else if (i->op == ALIR_OP_LOAD) {
+                    int lv = ssa_var_of(&var_map, i->op1);
+                    if (lv >= 0) {
+                        alir_replace_all_uses(i->dest, current[lv] ? current[lv] : ssa_undef(module, &vars[lv]));
+                        ssa_nop(i);
                     }
                 }
-                inst = inst->next;
+                if (v < 0) continue;
+
+                if (log_top == log_capacity) {
+                    int *grown_var = alir_alloc(module, sizeof(int) * log_capacity * 2);
+                    AlirValue **grown_val = alir_alloc(module, sizeof(AlirValue*) * log_capacity * 2);
+                    memcpy(grown_var, log_var, sizeof(int) * log_top);
+                    memcpy(grown_val, log_val, sizeof(AlirValue*) * log_top);
+                    log_var = grown_var;
+                    log_val = grown_val;
+                    log_capacity *= 2;
+                }
+                log_var[log_top] = v;
+                log_val[log_top++] = current[v];
+                current[v] = val;
             }
-            b = b->next;
+
+            // Fill this block's entry in the phis of its successors, once per successor
+            for (BlockEdge *e = b->succ; e; e = e->next) {
+                int si = optlir_dom_index(dom, e->block);
+                if (si < 0 || seen[si] == bi + 1) continue;
+                seen[si] = bi + 1;
+                for (SsaPhi *sp = at[si]; sp; sp = sp->next) {
+                    AlirValue *val = current[sp->var] ? current[sp->var] : ssa_undef(module, &vars[sp->var]);
+                    alir_phi_add_incoming(module, sp->phi, b, val);
+                }
+            }
+            continue;
         }
-        hashmap_free(&used_map);
-        hashmap_free(&alloc_map);
-        func = func->next;
+
+        int c = next_child[bi];
+        if (c >= 0) {
+            next_child[bi] = dom->sibling[c];
+            next_child[c] = -2;
+            stack[top++] = c;
+            continue;
+        }
+
+        // Leaving the block
+        while (log_top > mark[bi]) {
+            log_top--;
+            current[log_var[log_top]] = log_val[log_top];
+        }
+        top--;
+    }
+
+    // Code the entry cannot reach still names the slots; it reads the initial zero
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        if (optlir_dom_index(dom, b) >= 0) continue;
+        for (AlirInst *i = b->head; i; i = i->next) {
+            int v = -1;
+            if (i->op == ALIR_OP_LOAD && (v = ssa_var_of(&var_map, i->op1)) >= 0) {
+                alir_replace_all_uses(i->dest, ssa_undef(module, &vars[v]));
+                ssa_nop(i);
+            } else if ((i->op == ALIR_OP_STORE && ssa_var_of(&var_map, i->op2) >= 0) ||
+                       (i->op == ALIR_OP_ALLOCA && ssa_var_of(&var_map, i->dest) >= 0)) {
+                ssa_nop(i);
+            }
+        }
+    }
+
+    ssa_remove_trivial_phis(module, all, vars);
+    if (!arena) hashmap_free(&var_map);
+}
+
+/**
+ * @brief Promote scalar stack slots to SSA values across blocks (global mem2reg).
+ *
+ * Builds pruned SSA: a slot gets a phi only at the iterated dominance
+ * frontier of its stores, and only where it is live on entry. Loads then
+ * hand their uses to the value reaching them along the dominator tree, and
+ * the alloca, loads and stores become NOPs. Flux functions keep their slots,
+ * which outlive a single activation.
+ *
+ * @param module The ALIR module.
+ */
+void optlir_mem2reg_ssa(AlirModule *module) {
+    for (AlirFunction *func = module->functions; func; func = func->next) {
+        if (func->is_extern || func->is_flux || !func->blocks) continue;
+        ssa_promote_function(module, func);
     }
 }
@@ -0,0 +1,186 @@
+/**
+ * @file parallel.c
+ * @brief Work-stealing thread pool for running optlir work on many functions at once.
+ *
+ * Every worker owns a range of task indices behind a lock. It takes tasks
+ * from the front of its own range; once that is empty it takes the back half
+ * of the first other range that still has work, so a few expensive functions
+ * do not leave the other threads idle.
+ */
+#include "optlir/parallel.h"
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define PARALLEL_MAX_JOBS 64
+
+/**
+ * @brief Returns how many worker threads a job count asks for.
+ * @param requested The requested count; 0 or less means one per online CPU.
+ * @return At least 1.
+ */
+int optlir_parallel_jobs(int requested) {
+    int jobs = requested;
+#if !defined(_WIN32)
+    if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (jobs < 1) jobs = 1;
+    return jobs > PARALLEL_MAX_JOBS ? PARALLEL_MAX_JOBS : jobs;
+}
+
+/**
+ * @brief Runs the tasks of a loop one after another on the calling thread.
+ * @param loop The loop.
+ */
+static void parallel_run_serial(const OptlirParallelLoop *loop) {
+    if (loop->begin) loop->begin(loop->ctx, 0);
+    for (int t = 0; t < loop->count; t++) loop->run(loop->ctx, 0, t);
+    if (loop->end) loop->end(loop->ctx, 0);
+}
+
+#if !defined(_WIN32)
+
+/**
+ * @brief The tasks a worker still has to run: lo .. hi - 1.
+ */
+typedef struct ParallelRange {
+    pthread_mutex_t lock;
+    int lo;
+    int hi;
+} ParallelRange;
+
+/**
+ * @brief Shared state of one parallel loop.
+ */
+typedef struct ParallelRun {
+    const OptlirParallelLoop *loop;
+    ParallelRange *ranges;
+    int jobs;
+} ParallelRun;
+
+/**
+ * @brief What a worker thread is started with.
+ */
+typedef struct ParallelWorker {
+    ParallelRun *run;
+    int id;
+} ParallelWorker;
+
+/**
+ * @brief Takes the next task from the front of a worker's own range.
+ * @param range The range.
+ * @return The task, or -1 if the range is empty.
+ */
+static int parallel_pop(ParallelRange *range) {
+    pthread_mutex_lock(&range->lock);
+    int task = range->lo < range->hi ? range->lo++ : -1;
+    pthread_mutex_unlock(&range->lock);
+    return task;
+}
+
+/**
+ * @brief Moves the back half of another worker's range over to this one.
+ * @param run The parallel loop.
+ * @param self The stealing worker, whose range is empty.
+ * @return The first stolen task, or -1 if no worker has any left.
+ */
+static int parallel_steal(ParallelRun *run, int self) {
+    for (int k = 1; k < run->jobs; k++) {
+        ParallelRange *victim = &run->ranges[(self + k) % run->jobs];
+        pthread_mutex_lock(&victim->lock);
+        int left = victim->hi - victim->lo;
+        if (left <= 0) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        int take = (left + 1) / 2;
+        int first = victim->hi - take;
+        victim->hi = first;
+        pthread_mutex_unlock(&victim->lock);
+
+        ParallelRange *own = &run->ranges[self];
+        pthread_mutex_lock(&own->lock);
+        own->lo = first + 1;
+        own->hi = first + take;
+        pthread_mutex_unlock(&own->lock);
+        return first;
+    }
+    return -1;
+}
+
+/**
+ * @brief Runs tasks until neither the own range nor any other has work left.
+ * @param arg The ParallelWorker.
+ * @return NULL.
+ */
+static void* parallel_worker(void *arg) {
+    ParallelWorker *worker = arg;
+    ParallelRun *run = worker->run;
+    const OptlirParallelLoop *loop = run->loop;
+
+    if (loop->begin) loop->begin(loop->ctx, worker->id);
+    for (;;) {
+        int task = parallel_pop(&run->ranges[worker->id]);
+        if (task < 0) task = parallel_steal(run, worker->id);
+        if (task < 0) break;
+        loop->run(loop->ctx, worker->id, task);
+    }
+    if (loop->end) loop->end(loop->ctx, worker->id);
+    return NULL;
+}
+
+/**
+ * @brief Runs every task of a loop on up to jobs threads and waits for all of them.
+ * @param loop The loop.
+ * @param jobs Number of workers, including the calling thread.
+ */
+void optlir_parallel_for(const OptlirParallelLoop *loop, int jobs) {
+    if (jobs > loop->count) jobs = loop->count;
+    if (jobs > PARALLEL_MAX_JOBS) jobs = PARALLEL_MAX_JOBS;
+    if (jobs <= 1) {
+        parallel_run_serial(loop);
+        return;
+    }
+
+    ParallelRange ranges[PARALLEL_MAX_JOBS];
+    ParallelWorker workers[PARALLEL_MAX_JOBS];
+    pthread_t threads[PARALLEL_MAX_JOBS];
+    ParallelRun run = {loop, ranges, jobs};
+
+    for (int w = 0; w < jobs; w++) {
+        pthread_mutex_init(&ranges[w].lock, NULL);
+        ranges[w].lo = (int)((long long)loop->count * w / jobs);
+        ranges[w].hi = (int)((long long)loop->count * (w + 1) / jobs);
+        workers[w].run = &run;
+        workers[w].id = w;
+    }
+
+    // A worker that cannot be started leaves its range to be stolen
+    int started[PARALLEL_MAX_JOBS] = {0};
+    for (int w = 1; w < jobs; w++) {
+        started[w] = pthread_create(&threads[w], NULL, parallel_worker, &workers[w]) == 0;
+    }
+    parallel_worker(&workers[0]);
+    for (int w = 1; w < jobs; w++) {
+        if (started[w]) pthread_join(threads[w], NULL);
+    }
+
+    for (int w = 0; w < jobs; w++) pthread_mutex_destroy(&ranges[w].lock);
+}
+
+#else
+
+/**
+ * @brief Runs every task of a loop; without pthreads they all run on the calling thread.
+ * @param loop The loop.
+ * @param jobs Ignored.
+ */
+void optlir_parallel_for(const OptlirParallelLoop *loop, int jobs) {
+    (void)jobs;
+    parallel_run_serial(loop);
+}
+
+#endif
@@ -0,0 +1,663 @@
+/**
+ * @file pass.c
+ * @brief Pass manager of the ALIR optimizer.
+ *
+ * Every pass is registered once with the analyses it needs and the ones it
+ * keeps intact. A function carries its analyses from pass to pass, and only
+ * a pass that reports a change drops the ones it does not preserve.
+ *
+ * Function passes only touch the function they run on, so a group of them
+ * runs on many functions at once. Each worker thread allocates from an arena
+ * of its own and keeps its own statistics; both are handed back to the
+ * module once the group is done. Module passes and sequential function
+ * passes are the barriers in between.
+ */
+#include "optlir.h"
+#include "optlir/pass.h"
+#include "optlir/local.h"
+#include "optlir/sccp.h"
+#include "optlir/gvn.h"
+#include "optlir/licm.h"
+#include "optlir/indvar.h"
+#include "optlir/escape.h"
+#include "optlir/icf.h"
+#include "optlir/parallel.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define PASS_ROUNDS         2   // Rounds of a function pass group at -O1 and -O2
+#define PASS_ROUNDS_O3      5   // Rounds of a function pass group at -O3 and above
+#define PASS_NAME_MAX       64
+#define PASS_PARALLEL_BLOCKS 256    // Blocks a function group needs before it is worth threads
+
+#define AN_LOCAL (OPTLIR_AN_CFG | OPTLIR_AN_USES | OPTLIR_AN_DOM)
+
+/**
+ * @brief Runs the unused-symbol removal on the cached call graph.
+ * @param pm The pass manager.
+ * @return Number of symbols removed.
+ */
+static int pass_unused(OptlirPassManager *pm) {
+    return optlir_remove_unused_graph(pm->module, optlir_require_callgraph(pm));
+}
+
+/**
+ * @brief Runs block-local mem2reg.
+ * @param pm The pass manager.
+ * @return 1, since the pass does not count what it promotes.
+ */
+static int pass_mem2reg(OptlirPassManager *pm) {
+    optlir_mem2reg_local(pm->module);
+    return 1;
+}
+
+/**
+ * @brief Runs SSA construction.
+ * @param pm The pass manager.
+ * @return 1, since the pass does not count what it promotes.
+ */
+static int pass_ssa(OptlirPassManager *pm) {
+    optlir_mem2reg_ssa(pm->module);
+    return 1;
+}
+
+/**
+ * @brief Removes the stack release markers.
+ * @param pm The pass manager.
+ * @return Number of markers removed.
+ */
+static int pass_strip_free_stack(OptlirPassManager *pm) {
+    return optlir_strip_free_stack(pm->module);
+}
+
+/**
+ * @brief Runs the inliner on the cached call graph.
+ * @param pm The pass manager.
+ * @return Number of calls inlined.
+ */
+static int pass_inline(OptlirPassManager *pm) {
+    return optlir_inline_calls(pm->module, optlir_require_callgraph(pm), pm->opt_level);
+}
+
+/**
+ * @brief Moves heap allocations that do not escape onto the stack.
+ * @param pm The pass manager.
+ * @return Number of allocations moved.
+ */
+static int pass_escape(OptlirPassManager *pm) {
+    return optlir_escape_heap(pm->module, optlir_require_callgraph(pm));
+}
+
+/**
+ * @brief Folds functions with identical bodies.
+ * @param pm The pass manager.
+ * @return Number of functions folded.
+ */
+static int pass_icf(OptlirPassManager *pm) {
+    return optlir_fold_identical(pm->module, optlir_require_callgraph(pm));
+}
+
+/**
+ * @brief Removes dead allocations.
+ * @param pm The pass manager.
+ * @return 1, since the pass does not count what it removes.
+ */
+static int pass_dce_allocs(OptlirPassManager *pm) {
+    optlir_dce_allocs(pm->module);
+    return 1;
+}
+
+#define FUNCTION_PASS(fn, impl) \
+    static int fn(OptlirPassManager *pm, AlirFunction *func) { return impl(pm->module, func); }
+
+FUNCTION_PASS(pass_unreachable, optlir_remove_unreachable_function)
+FUNCTION_PASS(pass_forward, optlir_forward_blocks_function)
+FUNCTION_PASS(pass_sccp, optlir_sccp_function)
+FUNCTION_PASS(pass_constprop, optlir_constprop_function)
+FUNCTION_PASS(pass_fold_branches, optlir_fold_branches_function)
+FUNCTION_PASS(pass_merge, optlir_merge_blocks_function)
+FUNCTION_PASS(pass_gvn, optlir_gvn_function)
+FUNCTION_PASS(pass_licm, optlir_licm_function)
+FUNCTION_PASS(pass_indvar, optlir_indvar_function)
+FUNCTION_PASS(pass_dead_stores, optlir_dead_stores_function)
+FUNCTION_PASS(pass_param_copies, optlir_param_copies_function)
+
+/**
+ * @brief Evaluates pure calls with constant arguments through the shared memo.
+ * @param pm The pass manager.
+ * @param func The function.
+ * @return Number of calls replaced by their result.
+ */
+static int pass_pure_calls(OptlirPassManager *pm, AlirFunction *func) {
+    return optlir_pure_calls_function(pm->module, func, &pm->pure);
+}
+
+static const OptlirPass optlir_passes[] = {
+    {"unused", NULL, pass_unused, 0, 0, "remove functions, structs and globals main cannot reach"},
+    {"mem2reg", NULL, pass_mem2reg, 0, 0, "promote stack slots used within one block"},
+    {"ssa", NULL, pass_ssa, 0, 0, "promote scalar stack slots to SSA values"},
+    {"strip-free-stack", NULL, pass_strip_free_stack, 0, 0, "remove stack release markers"},
+    {"inline", NULL, pass_inline, 0, 0, "inline small and annotated direct calls"},
+    {"escape", NULL, pass_escape, 0, 0, "move mallocs that do not escape onto the stack"},
+    {"dce-allocs", NULL, pass_dce_allocs, 0, 0, "remove dead allocations"},
+    {"icf", NULL, pass_icf, 0, 0, "fold functions with identical bodies"},
+    {"unreachable", pass_unreachable, NULL, OPTLIR_AN_CFG, OPTLIR_AN_CFG | OPTLIR_AN_USES,
+     "remove blocks the entry cannot reach"},
+    {"forward", pass_forward, NULL, OPTLIR_AN_CFG, OPTLIR_AN_CFG | OPTLIR_AN_USES,
+     "branch past blocks that only jump on"},
+    {"sccp", pass_sccp, NULL, OPTLIR_AN_CFG | OPTLIR_AN_USES, AN_LOCAL,
+     "sparse conditional constant propagation"},
+    {"constprop", pass_constprop, NULL, OPTLIR_AN_USES, AN_LOCAL,
+     "fold constant operations and identities"},
+    {"fold-branches", pass_fold_branches, NULL, OPTLIR_AN_CFG, OPTLIR_AN_CFG | OPTLIR_AN_USES,
+     "turn branches on constants into jumps"},
+    {"merge", pass_merge, NULL, OPTLIR_AN_CFG, OPTLIR_AN_CFG | OPTLIR_AN_USES,
+     "merge blocks into their only predecessor"},
+    {"gvn", pass_gvn, NULL, AN_LOCAL, AN_LOCAL, "dominator-based global value numbering"},
+    {"licm", pass_licm, NULL, AN_LOCAL, OPTLIR_AN_CFG | OPTLIR_AN_DOM, "hoist loop-invariant code"},
+    {"indvar", pass_indvar, NULL, AN_LOCAL, OPTLIR_AN_CFG | OPTLIR_AN_DOM,
+     "strength-reduce induction variables, find trip counts"},
+    {"dse", pass_dead_stores, NULL, OPTLIR_AN_USES, AN_LOCAL, "remove stores into slots never read"},
+    {"param-copies", pass_param_copies, NULL, OPTLIR_AN_USES, AN_LOCAL,
+     "use parameters instead of their stack copies"},
+    {"pure-calls", pass_pure_calls, NULL, 0, AN_LOCAL, "evaluate pure calls with constant arguments", 1},
+};
+
+#define PASS_COUNT ((int)(sizeof(optlir_passes) / sizeof(optlir_passes[0])))
+
+/**
+ * @brief What one registered pass did across the compilation.
+ */
+typedef struct PassStat {
+    int runs;
+    int changed_runs;           // Runs that reported a change
+    long changes;
+    long long nanos;
+} PassStat;
+
+static PassStat pass_stats[PASS_COUNT];
+static int pass_jobs = 0;       // Threads for function pass groups, 0 for one per CPU
+
+#define PIPELINE_O1 "unused,mem2reg,strip-free-stack,unreachable,forward,dce-allocs,unused"
+#define PIPELINE_O2_HEAD "unused,mem2reg,ssa,strip-free-stack,inline," \
+    "unreachable,forward,sccp,constprop,fold-branches,unreachable,merge,gvn,licm,indvar,dse,param-copies"
+#define PIPELINE_TAIL "escape,dce-allocs,icf,unused"
+
+/**
+ * @brief Returns the pipeline an optimization level runs.
+ * @param opt_level The optimization level.
+ * @return Comma-separated pass names.
+ */
+const char* optlir_default_pipeline(int opt_level) {
+    if (opt_level <= 1) return PIPELINE_O1;
+    if (opt_level == 2) return PIPELINE_O2_HEAD "," PIPELINE_TAIL;
+    return PIPELINE_O2_HEAD ",pure-calls," PIPELINE_TAIL;
+}
+
+/**
+ * @brief Reads a monotonic-enough clock.
+ * @return Nanoseconds since an arbitrary point.
+ */
+static long long pass_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Looks up a registered pass.
+ * @param name The pass name.
+ * @param len Length of the name.
+ * @return Its registry index, or -1.
+ */
+static int pass_find(const char *name, size_t len) {
+    for (int k = 0; k < PASS_COUNT; k++) {
+        if (strlen(optlir_passes[k].name) == len && strncmp(optlir_passes[k].name, name, len) == 0) return k;
+    }
+    return -1;
+}
+
+/**
+ * @brief Splits a pipeline into registry indices.
+ * @param pipeline Comma-separated pass names.
+ * @param out Receives the indices, or NULL to only count and check.
+ * @param err Stream for the diagnostic, or NULL.
+ * @return Number of passes, or -1 if a name is unknown.
+ */
+static int pass_parse(const char *pipeline, int *out, FILE *err) {
+    int n = 0;
+    const char *c = pipeline;
+    while (c && *c) {
+        while (*c == ' ' || *c == ',') c++;
+        if (!*c) break;
+        const char *end = c;
+        while (*end && *end != ',' && *end != ' ') end++;
+        int k = pass_find(c, (size_t)(end - c));
+        if (k < 0) {
+            if (err) {
+                int len = (int)(end - c) < PASS_NAME_MAX ? (int)(end - c) : PASS_NAME_MAX;
+                fprintf(err, "optlir: unknown pass '%.*s'; the passes are:\n", len, c);
+                for (int j = 0; j < PASS_COUNT; j++) {
+                    fprintf(err, "  %-18s %s\n", optlir_passes[j].name, optlir_passes[j].summary);
+                }
+            }
+            return -1;
+        }
+        if (out) out[n] = k;
+        n++;
+        c = end;
+    }
+    return n;
+}
+
+/**
+ * @brief Sets how many threads function pass groups may use.
+ * @param jobs The thread count; 0 means one per online CPU, 1 runs everything on the calling thread.
+ */
+void optlir_set_jobs(int jobs) {
+    pass_jobs = jobs;
+}
+
+/**
+ * @brief Checks that every name of a pipeline is a registered pass.
+ * @param pipeline Comma-separated pass names.
+ * @param err Stream for the diagnostic, or NULL.
+ * @return Non-zero if the pipeline is valid.
+ */
+int optlir_pipeline_valid(const char *pipeline, FILE *err) {
+    return pass_parse(pipeline, NULL, err) >= 0;
+}
+
+/**
+ * @brief Makes the pred/succ edges of a function valid.
+ * @param module The ALIR module.
+ * @param func The function.
+ */
+void optlir_require_cfg(AlirModule *module, AlirFunction *func) {
+    OptlirAnalyses *an = func->analyses;
+    if (an && (an->valid & OPTLIR_AN_CFG)) return;
+    optlir_build_edges(func, alir_arena(module));
+    if (an) an->valid |= OPTLIR_AN_CFG;
+}
+
+/**
+ * @brief Makes the def pointers and use lists of a function valid.
+ * @param module The ALIR module.
+ * @param func The function.
+ */
+void optlir_require_uses(AlirModule *module, AlirFunction *func) {
+    OptlirAnalyses *an = func->analyses;
+    if (an && (an->valid & OPTLIR_AN_USES)) return;
+    alir_build_uses(module, func);
+    if (an) an->valid |= OPTLIR_AN_USES;
+}
+
+/**
+ * @brief Returns the dominator tree of a function, building the edges first if needed.
+ * @param module The ALIR module.
+ * @param func The function.
+ * @return The dominator information, or NULL for a function without blocks.
+ */
+OptlirDomTree* optlir_require_dom(AlirModule *module, AlirFunction *func) {
+    OptlirAnalyses *an = func->analyses;
+    if (an && (an->valid & OPTLIR_AN_DOM)) return an->dom;
+    optlir_require_cfg(module, func);
+    OptlirDomTree *dom = optlir_dom_build(module, func);
+    if (an) {
+        an->dom = dom;
+        an->valid |= OPTLIR_AN_DOM;
+    }
+    return dom;
+}
+
+/**
+ * @brief Drops cached analyses of a function that a change made stale.
+ * @param func The function.
+ * @param lost OPTLIR_AN_* bits no longer valid.
+ */
+void optlir_invalidate(AlirFunction *func, unsigned lost) {
+    if (!func->analyses) return;
+    func->analyses->valid &= ~lost;
+    if (lost & OPTLIR_AN_CFG) func->analyses->valid &= ~OPTLIR_AN_DOM;
+    if (!(func->analyses->valid & OPTLIR_AN_DOM)) func->analyses->dom = NULL;
+}
+
+/**
+ * @brief Returns the module call graph, rebuilding it if a pass changed the module.
+ * @param pm The pass manager.
+ * @return The call graph.
+ */
+OptlirCallGraph* optlir_require_callgraph(OptlirPassManager *pm) {
+    if (!(pm->module_valid & OPTLIR_AN_CALLGRAPH)) {
+        if (pm->callgraph.module) optlir_callgraph_free(&pm->callgraph);
+        optlir_callgraph_build(pm->module, &pm->callgraph);
+        pm->module_valid |= OPTLIR_AN_CALLGRAPH;
+    }
+    return &pm->callgraph;
+}
+
+/**
+ * @brief Runs one pass and books its statistics.
+ * @param pm The pass manager.
+ * @param k Registry index of the pass.
+ * @param func The function for a function pass, NULL for a module pass.
+ * @param stats The statistics of the calling thread.
+ * @return Number of changes the pass reported.
+ */
+static int pass_run(OptlirPassManager *pm, int k, AlirFunction *func, PassStat *stats) {
+    const OptlirPass *pass = &optlir_passes[k];
+    if (func) {
+        if (pass->requires & OPTLIR_AN_CFG) optlir_require_cfg(pm->module, func);
+        if (pass->requires & OPTLIR_AN_USES) optlir_require_uses(pm->module, func);
+        if (pass->requires & OPTLIR_AN_DOM) optlir_require_dom(pm->module, func);
+    }
+
+    long long start = pass_now();
+    int changes = func ? pass->run_function(pm, func) : pass->run_module(pm);
+    stats[k].nanos += pass_now() - start;
+    stats[k].runs++;
+
+    if (changes > 0) {
+        stats[k].changed_runs++;
+        stats[k].changes += changes;
+        // A function group drops the module analyses itself once all its threads are done
+        if (func) optlir_invalidate(func, ~pass->preserves);
+        else pm->module_valid &= pass->preserves;
+    }
+    return changes;
+}
+
+/**
+ * @brief Runs a group of function passes on one function until nothing changes.
+ * @param pm The pass manager.
+ * @param group Registry indices of the passes.
+ * @param count Number of passes.
+ * @param func The function.
+ * @param stats The statistics of the calling thread.
+ */
+static void pass_run_function(OptlirPassManager *pm, const int *group, int count, AlirFunction *func,
+                              PassStat *stats) {
+    OptlirAnalyses analyses = {0};
+    func->analyses = &analyses;
+    int round = 0;
+    for (; round < pm->max_rounds; round++) {
+        int changes = 0;
+        for (int k = 0; k < count; k++) changes += pass_run(pm, group[k], func, stats);
+        if (!changes) break;
+    }
+    func->analyses = NULL;
+    if (round > 1) debug_optlir("pass: %s: %d rounds\n", func->name, round);
+
+    // Edges are only kept up to date while the function is being optimized
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        b->pred = NULL;
+        b->succ = NULL;
+    }
+}
+
+/**
+ * @brief Gives each function private copies of the values it shares with an earlier one.
+ *
+ * Use lists hang off the values, so two functions optimized on different
+ * threads must never reach the same value object. Pooled values have no
+ * use list and are never written, so they stay shared.
+ *
+ * @param module The ALIR module.
+ * @param funcs The functions about to be optimized.
+ * @param count Number of functions.
+ * @return Number of values copied.
+ */
+static int pass_unshare_values(AlirModule *module, AlirFunction **funcs, int count) {
+    Arena *arena = alir_arena(module);
+    HashMap owner;              // "%p" of a value -> index + 1 of the first function reaching it
+    hashmap_init(&owner, arena, 1024);
+    int copied = 0;
+    char key[32];
+
+    for (int f = 0; f < count; f++) {
+        HashMap copies;         // "%p" of a value of an earlier function -> its copy here
+        int has_copies = 0;
+        for (AlirBlock *b = funcs[f]->blocks; b; b = b->next) {
+            for (AlirInst *i = b->head; i; i = i->next) {
+                for (int k = -3; k < i->arg_count; k++) {
+                    AlirValue **slot = k == -3 ? &i->dest : k == -2 ? &i->op1 : k == -1 ? &i->op2 : &i->args[k];
+                    if (!*slot || (*slot)->pooled) continue;
+                    snprintf(key, sizeof(key), "%p", (void*)*slot);
+                    int first = (int)(uintptr_t)hashmap_get(&owner, key);
+                    if (!first) {
+                        hashmap_put(&owner, key, (void*)(uintptr_t)(f + 1));
+                        continue;
+                    }
+                    if (first == f + 1) continue;
+
+                    if (!has_copies) {
+                        hashmap_init(&copies, arena, 16);
+                        has_copies = 1;
+                    }
+                    AlirValue *copy = hashmap_get(&copies, key);
+                    if (!copy) {
+                        copy = alir_alloc(module, sizeof(AlirValue));
+                        *copy = **slot;
+                        copy->def = NULL;
+                        copy->uses = NULL;
+                        hashmap_put(&copies, key, copy);
+                        copied++;
+                    }
+                    *slot = copy;
+                }
+            }
+        }
+        if (has_copies && !arena) hashmap_free(&copies);
+    }
+    if (!arena) hashmap_free(&owner);
+    return copied;
+}
+
+/**
+ * @brief One worker of a parallel function group.
+ */
+typedef struct PassWorker {
+    Arena arena;                // Everything the worker allocates, adopted by the module afterwards
+    PassStat stats[PASS_COUNT];
+    OptlirStats opt_stats;      // The worker thread's optlir_stats when it finished
+} PassWorker;
+
+/**
+ * @brief A function group being run on several threads.
+ */
+typedef struct PassGroupRun {
+    OptlirPassManager *pm;
+    const int *group;
+    int count;
+    AlirFunction **funcs;
+    PassWorker *workers;        // Index 0 is the calling thread, which uses the module arena
+} PassGroupRun;
+
+/**
+ * @brief Points the allocations of a worker thread at its own arena.
+ * @param ctx The PassGroupRun.
+ * @param worker The worker index.
+ */
+static void pass_worker_begin(void *ctx, int worker) {
+    PassGroupRun *run = ctx;
+    if (worker) alir_set_thread_arena(&run->workers[worker].arena);
+}
+
+/**
+ * @brief Optimizes one function of a parallel group.
+ * @param ctx The PassGroupRun.
+ * @param worker The worker index.
+ * @param task Index of the function.
+ */
+static void pass_worker_run(void *ctx, int worker, int task) {
+    PassGroupRun *run = ctx;
+    PassStat *stats = worker ? run->workers[worker].stats : pass_stats;
+    pass_run_function(run->pm, run->group, run->count, run->funcs[task], stats);
+}
+
+/**
+ * @brief Saves the optimizer statistics of a worker thread before it exits.
+ * @param ctx The PassGroupRun.
+ * @param worker The worker index.
+ */
+static void pass_worker_end(void *ctx, int worker) {
+    PassGroupRun *run = ctx;
+    if (!worker) return;
+    run->workers[worker].opt_stats = optlir_stats;
+    alir_set_thread_arena(NULL);
+}
+
+/**
+ * @brief Adds the optimizer statistics of a worker to those of the calling thread.
+ * @param from The worker's statistics.
+ */
+static void pass_add_stats(const OptlirStats *from) {
+    optlir_stats.sccp_folded += from->sccp_folded;
+    optlir_stats.sccp_blocks_removed += from->sccp_blocks_removed;
+    optlir_stats.inlined_calls += from->inlined_calls;
+    optlir_stats.gvn_eliminated += from->gvn_eliminated;
+    optlir_stats.licm_hoisted += from->licm_hoisted;
+    optlir_stats.indvar_reduced += from->indvar_reduced;
+    optlir_stats.indvar_trip_counts += from->indvar_trip_counts;
+    optlir_stats.pure_folded += from->pure_folded;
+    optlir_stats.pure_memo_hits += from->pure_memo_hits;
+    optlir_stats.pure_over_budget += from->pure_over_budget;
+    optlir_stats.pure_nanos += from->pure_nanos;
+    optlir_stats.escape_moved += from->escape_moved;
+    optlir_stats.escape_frees_removed += from->escape_frees_removed;
+    optlir_stats.icf_folded += from->icf_folded;
+    optlir_stats.icf_bytes_saved += from->icf_bytes_saved;
+}
+
+/**
+ * @brief Runs a group of function passes on every function until nothing changes.
+ *
+ * A group of parallel passes on a large enough module is spread over
+ * pm->jobs threads; the functions it creates and the order it visits them
+ * in do not depend on the thread count, so neither does the result.
+ *
+ * @param pm The pass manager.
+ * @param group Registry indices of the passes.
+ * @param count Number of passes.
+ */
+static void pass_run_group(OptlirPassManager *pm, const int *group, int count) {
+    AlirModule *module = pm->module;
+    int total = 0, blocks = 0;
+    for (AlirFunction *func = module->functions; func; func = func->next) {
+        if (func->is_extern || !func->blocks) continue;
+        total++;
+        blocks += func->block_count;
+    }
+    if (!total) return;
+
+    AlirFunction **funcs = alir_alloc(module, sizeof(AlirFunction*) * total);
+    int n = 0;
+    for (AlirFunction *func = module->functions; func; func = func->next) {
+        if (!func->is_extern && func->blocks) funcs[n++] = func;
+    }
+
+    Arena *arena = alir_arena(module);
+    int parallel = arena && total > 1 && blocks >= PASS_PARALLEL_BLOCKS && !optlir_passes[group[0]].sequential;
+    if (!parallel) {
+        for (int f = 0; f < total; f++) pass_run_function(pm, group, count, funcs[f], pass_stats);
+        return;
+    }
+
+    // Done whatever the thread count, so one thread and many see the same IR
+    int copied = pass_unshare_values(module, funcs, total);
+    if (copied) debug_optlir("pass: %d values shared between functions copied\n", copied);
+
+    int jobs = pm->jobs < total ? pm->jobs : total;
+    PassWorker *workers = calloc((size_t)jobs, sizeof(PassWorker));
+    for (int w = 1; w < jobs; w++) arena_init(&workers[w].arena);
+
+    PassGroupRun run = {pm, group, count, funcs, workers};
+    OptlirParallelLoop loop = {total, &run, pass_worker_begin, pass_worker_run, pass_worker_end};
+    optlir_parallel_for(&loop, jobs);
+
+    for (int w = 1; w < jobs; w++) {
+        arena_adopt(arena, &workers[w].arena);
+        pass_add_stats(&workers[w].opt_stats);
+        for (int k = 0; k < PASS_COUNT; k++) {
+            pass_stats[k].runs += workers[w].stats[k].runs;
+            pass_stats[k].changed_runs += workers[w].stats[k].changed_runs;
+            pass_stats[k].changes += workers[w].stats[k].changes;
+            pass_stats[k].nanos += workers[w].stats[k].nanos;
+        }
+    }
+    free(workers);
+}
+
+/**
+ * @brief Runs a pipeline of passes on the module.
+ * @param module The ALIR module.
+ * @param opt_level The optimization level, for thresholds and rounds.
+ * @param pipeline Comma-separated pass names.
+ * @return 0 on success, -1 if the pipeline names an unknown pass.
+ */
+int optlir_run_pipeline(AlirModule *module, int opt_level, const char *pipeline) {
+    int count = pass_parse(pipeline, NULL, stderr);
+    if (count < 0) return -1;
+    if (!module || !count) return 0;
+    int *order = alir_alloc(module, sizeof(int) * count);
+    pass_parse(pipeline, order, NULL);
+
+    OptlirPassManager pm = {0};
+    pm.module = module;
+    pm.opt_level = opt_level;
+    pm.max_rounds = opt_level >= 3 ? PASS_ROUNDS_O3 : PASS_ROUNDS;
+    pm.jobs = optlir_parallel_jobs(pass_jobs);
+    optlir_pure_init(&pm.pure, module);
+
+    for (int k = 0; k < count; ) {
+        if (optlir_passes[order[k]].run_module) {
+            pass_run(&pm, order[k], NULL, pass_stats);
+            k++;
+            continue;
+        }
+        // Sequential passes form groups of their own, as barriers between the parallel ones
+        int end = k;
+        int sequential = optlir_passes[order[k]].sequential;
+        while (end < count && optlir_passes[order[end]].run_function &&
+               optlir_passes[order[end]].sequential == sequential) end++;
+        pass_run_group(&pm, order + k, end - k);
+        // Function passes can drop calls, so the call graph does not survive them
+        pm.module_valid &= ~OPTLIR_AN_CALLGRAPH;
+        k = end;
+    }
+
+    if (pm.callgraph.module) optlir_callgraph_free(&pm.callgraph);
+    optlir_pure_free(&pm.pure);
+    return 0;
+}
+
+/**
+ * @brief Runs all optimization passes on the module.
+ * @param module The ALIR module.
+ * @param opt_level The optimization level.
+ */
+void optlir_optimize(AlirModule *module, int opt_level) {
+    if (!module || opt_level <= 0) return;
+    optlir_run_pipeline(module, opt_level, optlir_default_pipeline(opt_level));
+}
+
+/**
+ * @brief Prints how often each pass ran, what it changed and how long it took.
+ * @param out The stream to print to.
+ */
+void optlir_print_pass_stats(FILE *out) {
+    long long total = 0;
+    for (int k = 0; k < PASS_COUNT; k++) {
+        PassStat *st = &pass_stats[k];
+        if (!st->runs) continue;
+        total += st->nanos;
+        fprintf(out, "optlir: pass %-16s %7d runs %7d changed %8ld changes %10.3f ms\n",
+                optlir_passes[k].name, st->runs, st->changed_runs, st->changes, st->nanos / 1e6);
+    }
+    fprintf(out, "optlir: passes took %.3f ms\n", total / 1e6);
+}
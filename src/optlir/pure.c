@@ -1,116 +1,652 @@
 /**
  * @file pure.c
- * @brief Pure-function evaluation and constant folding for ALIR.
+ * @brief Compile-time evaluation of pure ALIR functions with constant arguments.
+ *
+ * The evaluator interprets the ALIR of the callee on constants: scalar
+ * arithmetic, branches, phis, scalar stack slots and calls of other pure
+ * functions. Results are remembered by callee and argument bits, so a
+ * recursive function evaluates each distinct call once. Anything it does not
+ * model gives up on the call site, which then keeps its run-time call.
  */
 #include "optlir.h"
-#include <string.h>
+#include "optlir/pure.h"
+#include "optlir/local.h"
+#include "common/debug.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PURE_FRAME_BYTES 256    // What a frame costs the memory budget besides its values
+#define PURE_MAX_DEPTH   4096   // Nested calls, whatever the memory budget
+#define PURE_MAX_ARGS    16     // Calls with more arguments are not evaluated
+#define PURE_KEY_MAX     (24 + PURE_MAX_ARGS * 17)
+
+static long pure_max_steps = OPTLIR_PURE_STEPS;
+static long pure_max_memory = OPTLIR_PURE_MEMORY;
+
+/**
+ * @brief How an evaluation ended.
+ */
+typedef enum PureStatus {
+    PURE_OK,
+    PURE_FAIL,                  // Reached something the evaluator does not model
+    PURE_BUDGET                 // Ran out of steps or memory
+} PureStatus;
+
+/**
+ * @brief What the evaluator needs to know about a function, computed once.
+ */
+typedef struct PureFunc {
+    int temps;                  // Highest temp id + 1
+    HashMap labels;             // Block label -> AlirBlock*
+} PureFunc;
+
+/**
+ * @brief A remembered call.
+ */
+typedef struct PureMemo {
+    ConstVal result;            // is_const 0: the call cannot be evaluated
+} PureMemo;
+
+/**
+ * @brief The state of one function being evaluated.
+ */
+typedef struct PureFrame {
+    AlirFunction *func;
+    PureFunc *info;
+    const ConstVal *args;
+    ConstVal *vals;             // By temp id; is_const marks the ones set
+    int *slot_of;               // By temp id: stack slot index + 1, or 0
+    ConstVal *slots;
+    int slot_count;
+    int slot_cap;
+    long charged;               // Bytes taken from the memory budget
+} PureFrame;
+
+/**
+ * @brief Returns a monotonic-enough wall clock reading.
+ * @return Nanoseconds.
+ */
+static long long pure_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Sets the budgets of every evaluator created afterwards.
+ * @param steps Instructions one call site may execute; 0 or less keeps the current value.
+ * @param memory Bytes one call site may hold; 0 or less keeps the current value.
+ */
+void optlir_pure_set_budget(long steps, long memory) {
+    if (steps > 0) pure_max_steps = steps;
+    if (memory > 0) pure_max_memory = memory;
+}
+
+/**
+ * @brief Prepares an evaluator with the budgets set by optlir_pure_set_budget.
+ * @param ev The evaluator.
+ * @param module The ALIR module.
+ */
+void optlir_pure_init(OptlirPureEval *ev, AlirModule *module) {
+    memset(ev, 0, sizeof(*ev));
+    ev->module = module;
+    ev->max_steps = pure_max_steps;
+    ev->max_memory = pure_max_memory;
+    hashmap_init(&ev->funcs, alir_arena(module), 64);
+    hashmap_init(&ev->memo, alir_arena(module), 256);
+}
 
-typedef struct {
-    long long int_val;
-    double double_val;
-    int is_const;
-    int is_float;
-} EvalVal;
-
-/**
- * @brief Extract a constant value from an ALIR value for pure-function evaluation.
- * @param v The ALIR value.
- * @return The evaluation value wrapper.
- */
-static EvalVal get_val(AlirValue *v) {
-    EvalVal res = {0};
-    if (!v) return res;
-    if (v->kind == ALIR_VAL_CONST) {
-        res.is_const = 1;
-        res.is_float = (v->type.base == TYPE_SINGLE || v->type.base == TYPE_DOUBLE);
-        if (res.is_float) {
-            if (v->type.base == TYPE_SINGLE) res.double_val = v->val.single_val;
-            else res.double_val = v->val.double_val;
-        } else {
-            res.int_val = v->val.long_long_val;
+/**
+ * @brief Releases an evaluator.
+ *
+ * Everything it keeps lives in the module arena; without one it never
+ * evaluates anything and holds nothing but its two maps.
+ *
+ * @param ev The evaluator.
+ */
+void optlir_pure_free(OptlirPureEval *ev) {
+    if (alir_arena(ev->module)) return;
+    hashmap_free(&ev->funcs);
+    hashmap_free(&ev->memo);
+}
+
+/**
+ * @brief Whether the evaluator models values of a type.
+ * @param t The type.
+ * @return Non-zero for integers, enums, bools and floating point.
+ */
+static int pure_scalar(VarType t) {
+    if (t.ptr_depth > 0 || t.array_depth > 0 || t.is_func_ptr) return 0;
+    switch (t.base) {
+        case TYPE_INT: case TYPE_UNSIGNED_INT: case TYPE_SHORT:
+        case TYPE_LONG: case TYPE_LONG_LONG: case TYPE_UNSIGNED_LONG: case TYPE_UNSIGNED_LONG_LONG:
+        case TYPE_CHAR: case TYPE_UNSIGNED_CHAR: case TYPE_BOOL:
+        case TYPE_SINGLE: case TYPE_DOUBLE: case TYPE_ENUM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Whether a scalar type is an unsigned 64-bit integer.
+ * @param t The type.
+ * @return Non-zero for unsigned long and unsigned long long.
+ */
+static int pure_unsigned64(VarType t) {
+    return t.base == TYPE_UNSIGNED_LONG || t.base == TYPE_UNSIGNED_LONG_LONG;
+}
+
+/**
+ * @brief Cuts a computed value down to what its type holds.
+ * @param v The value, with 64 bits of integer precision.
+ * @param t Its scalar type.
+ * @param out Receives the value as the type holds it.
+ * @return Non-zero on success, 0 for a bool that is neither 0 nor 1.
+ */
+static int pure_wrap(ConstVal v, VarType t, ConstVal *out) {
+    ConstVal r = optlir_eval_cast(v, t);
+    switch (t.base) {
+        case TYPE_INT:
+        case TYPE_ENUM: r.int_val = (int)r.int_val; break;
+        case TYPE_UNSIGNED_INT: r.int_val = (unsigned int)r.int_val; break;
+        case TYPE_SHORT: r.int_val = (short)r.int_val; break;
+        case TYPE_CHAR: r.int_val = (char)r.int_val; break;
+        case TYPE_UNSIGNED_CHAR: r.int_val = (unsigned char)r.int_val; break;
+        case TYPE_BOOL:
+            if (r.int_val != 0 && r.int_val != 1) return 0;
+            break;
+        default: break;
+    }
+    *out = r;
+    return 1;
+}
+
+/**
+ * @brief Takes what a frame or stack slot costs from the memory budget.
+ * @param ev The evaluator.
+ * @param bytes The bytes to take.
+ * @return Non-zero if the budget still had them.
+ */
+static int pure_charge(OptlirPureEval *ev, long bytes) {
+    if (ev->memory_left < bytes) return 0;
+    ev->memory_left -= bytes;
+    return 1;
+}
+
+/**
+ * @brief Looks up or computes what the evaluator keeps about a function.
+ * @param ev The evaluator.
+ * @param func The function.
+ * @return Its PureFunc.
+ */
+static PureFunc* pure_func(OptlirPureEval *ev, AlirFunction *func) {
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)func);
+    PureFunc *pf = hashmap_get(&ev->funcs, key);
+    if (pf) return pf;
+
+    pf = alir_alloc(ev->module, sizeof(PureFunc));
+    hashmap_init(&pf->labels, alir_arena(ev->module), func->block_count > 16 ? func->block_count * 2 : 32);
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        if (b->label && !hashmap_get(&pf->labels, b->label)) hashmap_put(&pf->labels, b->label, b);
+        for (AlirInst *i = b->head; i; i = i->next) {
+            if (i->dest && i->dest->kind == ALIR_VAL_TEMP && i->dest->temp_id >= pf->temps) {
+                pf->temps = i->dest->temp_id + 1;
+            }
         }
     }
-    return res;
+    hashmap_put(&ev->funcs, key, pf);
+    return pf;
 }
 
 /**
- * @brief Evaluate a pure function at compile time with constant arguments.
- * @param module The ALIR module.
- * @param func The pure function to evaluate.
- * @param args Constant argument values.
- * @param arg_count Number of arguments.
- * @param ret_type Expected return type.
- * @return The evaluation result.
+ * @brief Returns the block a label value names.
+ * @param fr The frame.
+ * @param label The label value.
+ * @return The block, or NULL.
  */
-static EvalVal eval_pure_function_impl(AlirModule *module, AlirFunction *func, AlirValue **args, int arg_count, VarType ret_type) {
-    (void)module;
-    EvalVal res = {0};
+static AlirBlock* pure_target(PureFrame *fr, AlirValue *label) {
+    if (!label || label->kind != ALIR_VAL_LABEL) return NULL;
+    if (label->block) return label->block;
+    return label->val.str_val ? hashmap_get(&fr->info->labels, label->val.str_val) : NULL;
+}
 
-    if (arg_count != func->param_count) return res;
+/**
+ * @brief Reads an operand of an instruction being evaluated.
+ * @param fr The frame.
+ * @param v The operand.
+ * @param out Receives its value.
+ * @return Non-zero if the operand is a known scalar.
+ */
+static int pure_read(PureFrame *fr, AlirValue *v, ConstVal *out) {
+    if (!v || !pure_scalar(v->type)) return 0;
+    switch (v->kind) {
+        case ALIR_VAL_CONST:
+            *out = optlir_const_of(v);
+            return 1;
+        case ALIR_VAL_TEMP:
+            if (v->temp_id < 0 || v->temp_id >= fr->info->temps || !fr->vals[v->temp_id].is_const) return 0;
+            *out = fr->vals[v->temp_id];
+            return 1;
+        case ALIR_VAL_VAR: {
+            const char *name = v->val.str_val;
+            if (!name || name[0] != 'p') return 0;
+            char *end = NULL;
+            long p = strtol(name + 1, &end, 10);
+            if (end == name + 1 || *end || p < 0 || p >= fr->func->param_count) return 0;
+            *out = fr->args[p];
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Writes the result of an instruction.
+ * @param fr The frame.
+ * @param dest The destination temp.
+ * @param v The value, cut down to the destination type.
+ * @return Non-zero on success.
+ */
+static int pure_write(PureFrame *fr, AlirValue *dest, ConstVal v) {
+    if (!dest || dest->kind != ALIR_VAL_TEMP || dest->temp_id < 0 || dest->temp_id >= fr->info->temps) return 0;
+    if (!pure_scalar(dest->type) || !pure_wrap(v, dest->type, &v)) return 0;
+    fr->vals[dest->temp_id] = v;
+    return 1;
+}
+
+/**
+ * @brief Returns the stack slot a pointer operand refers to.
+ * @param fr The frame.
+ * @param ptr The pointer operand.
+ * @return The slot, or NULL if it is not a stack slot of this frame.
+ */
+static ConstVal* pure_slot(PureFrame *fr, AlirValue *ptr) {
+    if (!ptr || ptr->kind != ALIR_VAL_TEMP || ptr->temp_id < 0 || ptr->temp_id >= fr->info->temps) return NULL;
+    int s = fr->slot_of[ptr->temp_id];
+    return s ? &fr->slots[s - 1] : NULL;
+}
 
-    AlirParam *p = func->params;
-    EvalVal arg_vals[16];
-    for (int i = 0; i < arg_count && i < 16; i++) {
-        arg_vals[i] = get_val(args[i]);
-        if (!arg_vals[i].is_const) return res;
-        p = p ? p->next : NULL;
+/**
+ * @brief Evaluates a binary operation the way the generated code computes it.
+ *
+ * Operations whose result the generated code leaves undefined or traps on,
+ * and unsigned 64-bit operands the signed folder would misread, give up.
+ *
+ * @param i The instruction.
+ * @param l Left operand.
+ * @param r Right operand.
+ * @param out Receives the result.
+ * @return Non-zero on success.
+ */
+static int pure_binary(AlirInst *i, ConstVal l, ConstVal r, ConstVal *out) {
+    int op = i->op;
+    int compare = op >= ALIR_OP_LT && op <= ALIR_OP_NEQ;
+
+    if (l.is_float || r.is_float) {
+        double d1 = l.is_float ? l.double_val : (double)l.int_val;
+        double d2 = r.is_float ? r.double_val : (double)r.int_val;
+        if (compare) {
+            ConstVal res = {0};
+            res.is_const = 1;
+            switch (op) {
+                case ALIR_OP_LT: res.int_val = d1 < d2; break;
+                case ALIR_OP_GT: res.int_val = d1 > d2; break;
+                case ALIR_OP_LTE: res.int_val = d1 <= d2; break;
+                case ALIR_OP_GTE: res.int_val = d1 >= d2; break;
+                case ALIR_OP_EQ: res.int_val = d1 == d2; break;
+                default: res.int_val = d1 != d2; break;
+            }
+            *out = res;
+            return 1;
+        }
+        if ((op == ALIR_OP_DIV || op == ALIR_OP_FDIV) && d2 == 0) return 0;
+    } else {
+        int wide_unsigned = pure_unsigned64(i->op1->type) || pure_unsigned64(i->op2->type);
+        if (wide_unsigned && (l.int_val < 0 || r.int_val < 0) &&
+            (compare || op == ALIR_OP_DIV || op == ALIR_OP_MOD || op == ALIR_OP_SHR)) return 0;
+        if ((op == ALIR_OP_DIV || op == ALIR_OP_MOD) &&
+            (r.int_val == 0 || (r.int_val == -1 && l.int_val == (long long)(1ULL << 63)))) return 0;
+        if (op == ALIR_OP_SHL || op == ALIR_OP_SHR) {
+            int bits = 64;
+            switch (i->dest->type.base) {
+                case TYPE_INT: case TYPE_UNSIGNED_INT: case TYPE_ENUM: bits = 32; break;
+                case TYPE_SHORT: bits = 16; break;
+                case TYPE_CHAR: case TYPE_UNSIGNED_CHAR: case TYPE_BOOL: bits = 8; break;
+                default: break;
+            }
+            if (r.int_val < 0 || r.int_val >= bits) return 0;
+        }
+        if ((op == ALIR_OP_ROTL || op == ALIR_OP_ROTR) &&
+            i->dest->type.base != TYPE_LONG && i->dest->type.base != TYPE_LONG_LONG &&
+            !pure_unsigned64(i->dest->type)) return 0;
+    }
+
+    *out = optlir_eval_binary(op, l, r, i->dest->type);
+    return out->is_const;
+}
+
+static PureStatus pure_call(OptlirPureEval *ev, AlirFunction *func, const ConstVal *args, ConstVal *out);
+
+/**
+ * @brief Evaluates a call made by the function being evaluated.
+ * @param ev The evaluator.
+ * @param fr The calling frame.
+ * @param i The call instruction.
+ * @return How the call ended.
+ */
+static PureStatus pure_eval_inner_call(OptlirPureEval *ev, PureFrame *fr, AlirInst *i) {
+    AlirValue *f = i->op1;
+    if (!f || (f->kind != ALIR_VAL_VAR && f->kind != ALIR_VAL_GLOBAL) || !f->val.str_val) return PURE_FAIL;
+    AlirFunction *callee = hashmap_get(&ev->module->func_map, f->val.str_val);
+    if (!callee || !callee->is_pure || callee->is_extern || !callee->blocks) return PURE_FAIL;
+    if (callee->is_varargs || callee->is_flux || i->arg_count != callee->param_count) return PURE_FAIL;
+    if (i->arg_count > PURE_MAX_ARGS) return PURE_FAIL;
+
+    ConstVal args[PURE_MAX_ARGS];
+    AlirParam *p = callee->params;
+    for (int k = 0; k < i->arg_count; k++, p = p ? p->next : NULL) {
+        if (!p || !pure_scalar(p->type) || !pure_read(fr, i->args[k], &args[k])) return PURE_FAIL;
+        if (!pure_wrap(args[k], p->type, &args[k])) return PURE_FAIL;
     }
 
-    if (streq_lit(func->name, "abs") && arg_count == 1) {
-        res = arg_vals[0];
-        if (res.is_float) {
-            if (res.double_val < 0) res.double_val = -res.double_val;
-        } else {
-            if (res.int_val < 0) res.int_val = -res.int_val;
+    ConstVal res = {0};
+    PureStatus st = pure_call(ev, callee, args, &res);
+    if (st != PURE_OK) return st;
+    if (i->dest && !pure_write(fr, i->dest, res)) return PURE_FAIL;
+    return PURE_OK;
+}
+
+/**
+ * @brief Sets the phis at the head of a block for the edge it was entered on.
+ *
+ * All phis read their incoming values before any of them is written, since
+ * they take effect together on the edge.
+ *
+ * @param fr The frame.
+ * @param b The block.
+ * @param from The block it was entered from.
+ * @param st Receives PURE_FAIL if a phi cannot be evaluated.
+ * @return The first instruction after the phis.
+ */
+static AlirInst* pure_enter_block(PureFrame *fr, AlirBlock *b, AlirBlock *from, PureStatus *st) {
+    int count = 0;
+    AlirInst *i = b->head;
+    for (; i && i->op == ALIR_OP_PHI; i = i->next) count++;
+    *st = PURE_OK;
+    if (!count) return b->head;
+
+    ConstVal small[16];
+    ConstVal *in = count <= 16 ? small : malloc(sizeof(ConstVal) * count);
+    int k = 0;
+    for (AlirInst *phi = b->head; phi != i; phi = phi->next, k++) {
+        int found = 0;
+        for (int a = 0; a + 1 < phi->arg_count; a += 2) {
+            if (pure_target(fr, phi->args[a]) != from) continue;
+            found = pure_read(fr, phi->args[a + 1], &in[k]);
+            break;
         }
-        res.is_const = 1;
-        return res;
+        if (!found) {
+            *st = PURE_FAIL;
+            break;
+        }
+    }
+    k = 0;
+    for (AlirInst *phi = b->head; *st == PURE_OK && phi != i; phi = phi->next, k++) {
+        if (!pure_write(fr, phi->dest, in[k])) *st = PURE_FAIL;
     }
+    if (in != small) free(in);
+    return i;
+}
+
+/**
+ * @brief Runs the body of a function on its frame.
+ * @param ev The evaluator.
+ * @param fr The frame.
+ * @param out Receives the returned value.
+ * @return How the evaluation ended.
+ */
+static PureStatus pure_run(OptlirPureEval *ev, PureFrame *fr, ConstVal *out) {
+    AlirBlock *from = NULL;
+    AlirBlock *b = fr->func->blocks;
+
+    while (b) {
+        PureStatus st = PURE_OK;
+        AlirInst *i = pure_enter_block(fr, b, from, &st);
+        if (st != PURE_OK) return st;
+        AlirBlock *next = NULL;
+
+        for (; i && !next; i = i->next) {
+            if (--ev->steps_left < 0) return PURE_BUDGET;
+            ConstVal l, r, res;
+
+            switch (i->op) {
+                case ALIR_OP_ADD: case ALIR_OP_SUB: case ALIR_OP_MUL: case ALIR_OP_DIV: case ALIR_OP_MOD:
+                case ALIR_OP_FADD: case ALIR_OP_FSUB: case ALIR_OP_FMUL: case ALIR_OP_FDIV:
+                case ALIR_OP_AND: case ALIR_OP_OR: case ALIR_OP_XOR:
+                case ALIR_OP_SHL: case ALIR_OP_SHR: case ALIR_OP_ROTR: case ALIR_OP_ROTL:
+                case ALIR_OP_LT: case ALIR_OP_GT: case ALIR_OP_LTE: case ALIR_OP_GTE:
+                case ALIR_OP_EQ: case ALIR_OP_NEQ:
+                    if (!i->dest || !pure_read(fr, i->op1, &l) || !pure_read(fr, i->op2, &r)) return PURE_FAIL;
+                    if (!pure_binary(i, l, r, &res) || !pure_write(fr, i->dest, res)) return PURE_FAIL;
+                    break;
+
+                case ALIR_OP_NOT:
+                    if (!i->dest || !pure_read(fr, i->op1, &l) || l.is_float) return PURE_FAIL;
+                    res = optlir_eval_unary(ALIR_OP_NOT, l, i->dest->type);
+                    if (!res.is_const || !pure_write(fr, i->dest, res)) return PURE_FAIL;
+                    break;
+
+                case ALIR_OP_CAST:
+                    if (!i->dest || !pure_read(fr, i->op1, &l)) return PURE_FAIL;
+                    // Out of range float to integer conversions are undefined
+                    if (l.is_float && i->dest->type.base != TYPE_SINGLE && i->dest->type.base != TYPE_DOUBLE &&
+                        !(l.double_val > -9.2e18 && l.double_val < 9.2e18)) return PURE_FAIL;
+                    if (!pure_write(fr, i->dest, l)) return PURE_FAIL;
+                    break;
+
+                case ALIR_OP_ALLOCA: {
+                    if (i->op1 || !i->dest || i->dest->kind != ALIR_VAL_TEMP) return PURE_FAIL;
+                    int id = i->dest->temp_id;
+                    if (id < 0 || id >= fr->info->temps) return PURE_FAIL;
+                    if (!fr->slot_of[id]) {
+                        if (!pure_charge(ev, sizeof(ConstVal))) return PURE_BUDGET;
+                        fr->charged += sizeof(ConstVal);
+                        if (fr->slot_count == fr->slot_cap) {
+                            fr->slot_cap = fr->slot_cap ? fr->slot_cap * 2 : 8;
+                            fr->slots = realloc(fr->slots, sizeof(ConstVal) * fr->slot_cap);
+                        }
+                        fr->slot_of[id] = ++fr->slot_count;
+                    }
+                    memset(&fr->slots[fr->slot_of[id] - 1], 0, sizeof(ConstVal));
+                    break;
+                }
+
+                case ALIR_OP_STORE: {
+                    ConstVal *slot = pure_slot(fr, i->op2);
+                    if (!slot || !pure_read(fr, i->op1, &l) || !pure_wrap(l, i->op1->type, slot)) return PURE_FAIL;
+                    break;
+                }
+
+                case ALIR_OP_LOAD: {
+                    ConstVal *slot = pure_slot(fr, i->op1);
+                    if (!slot || !slot->is_const || !pure_write(fr, i->dest, *slot)) return PURE_FAIL;
+                    break;
+                }
+
+                case ALIR_OP_FREE_STACK:
+                    break;
+
+                case ALIR_OP_CALL: {
+                    PureStatus call = pure_eval_inner_call(ev, fr, i);
+                    if (call != PURE_OK) return call;
+                    break;
+                }
+
+                case ALIR_OP_JUMP:
+                    next = pure_target(fr, i->op1);
+                    if (!next) return PURE_FAIL;
+                    break;
+
+                case ALIR_OP_CONDI:
+                    if (!pure_read(fr, i->op1, &l) || l.is_float || i->arg_count < 1) return PURE_FAIL;
+                    next = pure_target(fr, l.int_val ? i->op2 : i->args[0]);
+                    if (!next) return PURE_FAIL;
+                    break;
+
+                case ALIR_OP_SWITCH:
+                    if (!pure_read(fr, i->op1, &l) || l.is_float) return PURE_FAIL;
+                    next = pure_target(fr, i->op2);
+                    for (int k = 0; k + 1 < i->arg_count; k += 2) {
+                        if (!pure_read(fr, i->args[k], &r)) return PURE_FAIL;
+                        if (r.int_val == l.int_val) {
+                            next = pure_target(fr, i->args[k + 1]);
+                            break;
+                        }
+                    }
+                    if (!next) return PURE_FAIL;
+                    break;
 
-    AlirBlock *entry = func->blocks;
-    if (!entry) return res;
-
-    AlirInst *i = entry->head;
-    while (i) {
-        if (i->op == ALIR_OP_RET && i->op1) {
-            EvalVal v = get_val(i->op1);
-            if (v.is_const) {
-                res = v;
-                if (ret_type.base == TYPE_SINGLE && res.is_float) {
-                    res.double_val = (float)res.double_val;
-                } else if (ret_type.base == TYPE_DOUBLE && !res.is_float) {
-                    res.double_val = (double)res.int_val;
-                    res.is_float = 1;
-                } else if (ret_type.base != TYPE_SINGLE && ret_type.base != TYPE_DOUBLE && res.is_float) {
-                    res.int_val = (long long)res.double_val;
-                    res.is_float = 0;
+                case ALIR_OP_RET: {
+                    VarType rt = fr->func->ret_type;
+                    if (rt.base == TYPE_VOID && rt.ptr_depth == 0) {
+                        memset(out, 0, sizeof(*out));
+                        out->is_const = 1;
+                        return PURE_OK;
+                    }
+                    if (!pure_scalar(rt) || !pure_read(fr, i->op1, &l) || !pure_wrap(l, rt, out)) return PURE_FAIL;
+                    return PURE_OK;
                 }
-                res.is_const = 1;
-                return res;
+
+                default:
+                    return PURE_FAIL;
             }
         }
-        i = i->next;
+        if (!next) return PURE_FAIL;
+        from = b;
+        b = next;
     }
+    return PURE_FAIL;
+}
 
-    return res;
+/**
+ * @brief Builds the memo key of a call.
+ * @param key Receives the key; PURE_KEY_MAX bytes.
+ * @param func The callee.
+ * @param args The arguments.
+ */
+static void pure_memo_key(char *key, AlirFunction *func, const ConstVal *args) {
+    int n = snprintf(key, PURE_KEY_MAX, "%p", (void*)func);
+    for (int k = 0; k < func->param_count; k++) {
+        unsigned long long bits = (unsigned long long)args[k].int_val;
+        if (args[k].is_float) memcpy(&bits, &args[k].double_val, sizeof(bits));
+        n += snprintf(key + n, PURE_KEY_MAX - n, ":%llx", bits);
+    }
 }
 
 /**
- * @brief Evaluate a pure function at compile time and return a ConstVal.
- * @param module The ALIR module.
- * @param func The pure function to evaluate.
- * @param args Constant argument values.
+ * @brief Remembers the outcome of a call.
+ * @param ev The evaluator.
+ * @param key The memo key.
+ * @param result The result; is_const 0 for a call that cannot be evaluated.
+ */
+static void pure_remember(OptlirPureEval *ev, const char *key, ConstVal result) {
+    PureMemo *m = alir_alloc(ev->module, sizeof(PureMemo));
+    m->result = result;
+    hashmap_put(&ev->memo, key, m);
+}
+
+/**
+ * @brief Evaluates a function on constant arguments, or returns what it did before.
+ *
+ * Only successful results of nested calls are remembered: a nested call may
+ * fail for want of what its caller left of the budget.
+ *
+ * @param ev The evaluator.
+ * @param func The function.
+ * @param args Its arguments, cut down to the parameter types.
+ * @param out Receives the returned value.
+ * @return How the evaluation ended.
+ */
+static PureStatus pure_call(OptlirPureEval *ev, AlirFunction *func, const ConstVal *args, ConstVal *out) {
+    char key[PURE_KEY_MAX];
+    pure_memo_key(key, func, args);
+    PureMemo *m = hashmap_get(&ev->memo, key);
+    if (m) {
+        optlir_stats.pure_memo_hits++;
+        *out = m->result;
+        return m->result.is_const ? PURE_OK : PURE_FAIL;
+    }
+    if (ev->depth >= PURE_MAX_DEPTH) return PURE_BUDGET;
+
+    PureFrame fr = {0};
+    fr.func = func;
+    fr.info = pure_func(ev, func);
+    fr.args = args;
+    fr.charged = PURE_FRAME_BYTES + (long)fr.info->temps * (long)(sizeof(ConstVal) + sizeof(int));
+    if (!pure_charge(ev, fr.charged)) return PURE_BUDGET;
+    fr.vals = calloc(fr.info->temps ? fr.info->temps : 1, sizeof(ConstVal));
+    fr.slot_of = calloc(fr.info->temps ? fr.info->temps : 1, sizeof(int));
+
+    ev->depth++;
+    PureStatus st = pure_run(ev, &fr, out);
+    ev->depth--;
+
+    ev->memory_left += fr.charged;
+    free(fr.vals);
+    free(fr.slot_of);
+    free(fr.slots);
+
+    if (st == PURE_OK) pure_remember(ev, key, *out);
+    return st;
+}
+
+/**
+ * @brief Evaluates one call of a pure function with constant arguments.
+ *
+ * The time spent and the outcome are added to optlir_stats.
+ *
+ * @param ev The evaluator.
+ * @param callee The called function.
+ * @param args The constant arguments.
  * @param arg_count Number of arguments.
- * @param ret_type Expected return type.
- * @return The constant result wrapper.
+ * @param out Receives the returned value.
+ * @return Non-zero if the call was evaluated within the budgets.
  */
-ConstVal eval_pure_function(AlirModule *module, AlirFunction *func, AlirValue **args, int arg_count, VarType ret_type) {
-    EvalVal ev = eval_pure_function_impl(module, func, args, arg_count, ret_type);
-    ConstVal res = {0};
-    res.is_const = ev.is_const;
-    res.is_float = ev.is_float;
-    res.int_val = ev.int_val;
-    res.double_val = ev.double_val;
-    return res;
+int optlir_pure_eval_call(OptlirPureEval *ev, AlirFunction *callee, AlirValue **args, int arg_count,
+                          ConstVal *out) {
+    // The memo and the function table need keys that outlive the call
+    if (!alir_arena(ev->module)) return 0;
+    if (!callee->is_pure || callee->is_extern || !callee->blocks || callee->is_varargs || callee->is_flux) return 0;
+    if (arg_count != callee->param_count || arg_count > PURE_MAX_ARGS) return 0;
+
+    ConstVal vals[PURE_MAX_ARGS];
+    AlirParam *p = callee->params;
+    for (int k = 0; k < arg_count; k++, p = p ? p->next : NULL) {
+        if (!p || !pure_scalar(p->type) || !args[k] || args[k]->kind != ALIR_VAL_CONST) return 0;
+        if (!pure_scalar(args[k]->type) || !pure_wrap(optlir_const_of(args[k]), p->type, &vals[k])) return 0;
+    }
+
+    long long start = pure_now();
+    ev->steps_left = ev->max_steps;
+    ev->memory_left = ev->max_memory;
+    ev->depth = 0;
+
+    char key[PURE_KEY_MAX];
+    pure_memo_key(key, callee, vals);
+    PureStatus st = pure_call(ev, callee, vals, out);
+    // The whole budget was available, so the same call would fail the same way again
+    if (st != PURE_OK && !hashmap_get(&ev->memo, key)) pure_remember(ev, key, (ConstVal){0});
+
+    optlir_stats.pure_nanos += pure_now() - start;
+    if (st == PURE_BUDGET) {
+        optlir_stats.pure_over_budget++;
+        debug_optlir("pure: %s: over budget after %ld steps, left to run time\n",
+                     callee->name, ev->max_steps - ev->steps_left);
+    }
+    return st == PURE_OK;
 }
@@ -0,0 +1,428 @@
+/**
+ * @file sccp.c
+ * @brief Sparse conditional constant propagation over ALIR functions.
+ *
+ * Wegman-Zadeck SCCP: every value starts unknown and only moves down the
+ * lattice unknown -> constant -> overdefined. A block is evaluated once one
+ * of its incoming edges is executable, and a branch on a constant marks only
+ * the edge it takes, so a phi meets only the values of edges that can run.
+ */
+#include "optlir.h"
+#include "optlir/local.h"
+#include "optlir/sccp.h"
+#include "common/arena.h"
+#include "common/debug.h"
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    SCCP_UNKNOWN,
+    SCCP_CONST,
+    SCCP_OVER
+} SccpState;
+
+/**
+ * @brief The lattice value of one SSA value.
+ */
+typedef struct SccpCell {
+    AlirValue *value;
+    AlirInst *def;
+    SccpState state;
+    ConstVal c;
+} SccpCell;
+
+/**
+ * @brief State of one SCCP run.
+ */
+typedef struct SccpCtx {
+    SccpCell *cells;
+    int cell_count;
+    HashMap cell_index;     // "%p" of a value -> cell + 1
+    HashMap inst_block;     // "%p" of an instruction -> its block
+    HashMap executable;     // "%p" of a block -> block, once reached
+    HashMap edges;          // "%p>%p" of an executable edge -> its target
+    AlirBlock **flow;       // Pending edges, as (from, to) pairs
+    int flow_top;
+    int *ssa;               // Pending cells whose state went down
+    int ssa_top;
+} SccpCtx;
+
+/**
+ * @brief Whether constants of a type are tracked.
+ *
+ * Only plain integers and floats are; pointers, strings and aggregates stay
+ * overdefined.
+ *
+ * @param type The type.
+ * @return Non-zero if the type is a scalar number.
+ */
+static int sccp_scalar(VarType type) {
+    if (type.ptr_depth > 0 || type.array_depth > 0 || type.is_func_ptr) return 0;
+    switch (type.base) {
+        case TYPE_INT: case TYPE_UNSIGNED_INT: case TYPE_SHORT: case TYPE_LONG:
+        case TYPE_LONG_LONG: case TYPE_UNSIGNED_LONG: case TYPE_UNSIGNED_LONG_LONG:
+        case TYPE_CHAR: case TYPE_UNSIGNED_CHAR: case TYPE_BOOL:
+        case TYPE_SINGLE: case TYPE_DOUBLE: case TYPE_ENUM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Key an object by its address.
+ * @param p The object.
+ * @param key Buffer of at least 32 bytes receiving the key.
+ */
+static void sccp_key(void *p, char *key) {
+    snprintf(key, 32, "%p", p);
+}
+
+/**
+ * @brief Returns the cell of a value.
+ * @param ctx The SCCP state.
+ * @param v The value.
+ * @return Its cell index, or -1 if the value is not defined in the function.
+ */
+static int sccp_cell(SccpCtx *ctx, AlirValue *v) {
+    char key[32];
+    sccp_key(v, key);
+    return (int)(uintptr_t)hashmap_get(&ctx->cell_index, key) - 1;
+}
+
+/**
+ * @brief Returns the lattice value of an operand.
+ * @param ctx The SCCP state.
+ * @param v The operand.
+ * @param out Receives the constant when the result is SCCP_CONST.
+ * @return The lattice state of the operand.
+ */
+static SccpState sccp_operand(SccpCtx *ctx, AlirValue *v, ConstVal *out) {
+    if (!v) return SCCP_OVER;
+    if (v->kind == ALIR_VAL_CONST) {
+        if (!sccp_scalar(v->type)) return SCCP_OVER;
+        *out = optlir_const_of(v);
+        return SCCP_CONST;
+    }
+    int c = sccp_cell(ctx, v);
+    if (c < 0) return SCCP_OVER;
+    *out = ctx->cells[c].c;
+    return ctx->cells[c].state;
+}
+
+/**
+ * @brief Whether two constants are the same.
+ * @param a The first constant.
+ * @param b The second constant.
+ * @return Non-zero if they are equal.
+ */
+static int sccp_same(ConstVal a, ConstVal b) {
+    if (a.is_float != b.is_float) return 0;
+    return a.is_float ? a.double_val == b.double_val : a.int_val == b.int_val;
+}
+
+/**
+ * @brief Moves a cell down to a new state and queues its users.
+ *
+ * A constant that changes becomes overdefined, which keeps the lattice
+ * monotone.
+ *
+ * @param ctx The SCCP state.
+ * @param c The cell index.
+ * @param state The state computed for the value.
+ * @param val The constant computed when state is SCCP_CONST.
+ */
+static void sccp_lower(SccpCtx *ctx, int c, SccpState state, ConstVal val) {
+    SccpCell *cell = &ctx->cells[c];
+    if (state == SCCP_UNKNOWN || cell->state == SCCP_OVER) return;
+    if (cell->state == SCCP_CONST) {
+        if (state == SCCP_CONST && sccp_same(cell->c, val)) return;
+        state = SCCP_OVER;
+    }
+    cell->state = state;
+    cell->c = val;
+    ctx->ssa[ctx->ssa_top++] = c;
+}
+
+/**
+ * @brief Marks a CFG edge executable and queues it if it was not yet.
+ * @param ctx The SCCP state.
+ * @param from The branching block.
+ * @param to The target block.
+ */
+static void sccp_mark_edge(SccpCtx *ctx, AlirBlock *from, AlirBlock *to) {
+    char key[64];
+    snprintf(key, sizeof(key), "%p>%p", (void*)from, (void*)to);
+    if (hashmap_get(&ctx->edges, key)) return;
+    hashmap_put(&ctx->edges, key, to);
+    ctx->flow[ctx->flow_top++] = from;
+    ctx->flow[ctx->flow_top++] = to;
+}
+
+/**
+ * @brief Whether a CFG edge has been marked executable.
+ * @param ctx The SCCP state.
+ * @param from The branching block.
+ * @param to The target block.
+ * @return Non-zero if the edge can run.
+ */
+static int sccp_edge_live(SccpCtx *ctx, AlirBlock *from, AlirBlock *to) {
+    char key[64];
+    snprintf(key, sizeof(key), "%p>%p", (void*)from, (void*)to);
+    return hashmap_get(&ctx->edges, key) != NULL;
+}
+
+/**
+ * @brief Evaluates a branch, marking the edges it can take.
+ *
+ * A condition not known yet counts as overdefined: the blocks it would rule
+ * out stay in the CFG, so their phi entries must not be ignored.
+ *
+ * @param ctx The SCCP state.
+ * @param block The block ending in the branch.
+ * @param inst The branch.
+ */
+static void sccp_visit_branch(SccpCtx *ctx, AlirBlock *block, AlirInst *inst) {
+    ConstVal cond = {0};
+    SccpState state = SCCP_OVER;
+    if (inst->op == ALIR_OP_CONDI || inst->op == ALIR_OP_SWITCH) {
+        state = sccp_operand(ctx, inst->op1, &cond);
+    }
+    if (state == SCCP_CONST && !cond.is_float) {
+        AlirBlock *to = NULL;
+        if (inst->op == ALIR_OP_SWITCH) {
+            to = alir_switch_target(inst, cond.int_val);
+        } else {
+            AlirValue **taken = alir_branch_slot(inst, cond.int_val != 0 ? 0 : 1);
+            if (taken) to = (*taken)->block;
+        }
+        if (to) {
+            sccp_mark_edge(ctx, block, to);
+            return;
+        }
+    }
+    int n = alir_branch_count(inst);
+    for (int k = 0; k < n; k++) {
+        AlirValue **slot = alir_branch_slot(inst, k);
+        if (slot && (*slot)->block) sccp_mark_edge(ctx, block, (*slot)->block);
+    }
+}
+
+/**
+ * @brief Evaluates a phi over the incoming edges that can run.
+ * @param ctx The SCCP state.
+ * @param block The block of the phi.
+ * @param phi The phi.
+ * @param c The cell of the phi's value.
+ */
+static void sccp_visit_phi(SccpCtx *ctx, AlirBlock *block, AlirInst *phi, int c) {
+    SccpState state = SCCP_UNKNOWN;
+    ConstVal val = {0};
+    for (int k = 0; k + 1 < phi->arg_count && state != SCCP_OVER; k += 2) {
+        if (!phi->args[k] || !sccp_edge_live(ctx, phi->args[k]->block, block)) continue;
+        ConstVal in = {0};
+        SccpState s = sccp_operand(ctx, phi->args[k + 1], &in);
+        if (s == SCCP_UNKNOWN) continue;
+        if (s == SCCP_OVER || (state == SCCP_CONST && !sccp_same(val, in))) {
+            state = SCCP_OVER;
+        } else {
+            state = SCCP_CONST;
+            val = in;
+        }
+    }
+    sccp_lower(ctx, c, state, val);
+}
+
+/**
+ * @brief Evaluates one instruction of an executable block.
+ * @param ctx The SCCP state.
+ * @param block The block of the instruction.
+ * @param inst The instruction.
+ */
+static void sccp_visit(SccpCtx *ctx, AlirBlock *block, AlirInst *inst) {
+    if (alir_branch_count(inst) > 0) {
+        sccp_visit_branch(ctx, block, inst);
+        return;
+    }
+    if (!inst->dest) return;
+    int c = sccp_cell(ctx, inst->dest);
+    if (c < 0) return;
+    if (ctx->cells[c].def != inst || !sccp_scalar(inst->dest->type)) {
+        sccp_lower(ctx, c, SCCP_OVER, (ConstVal){0});
+        return;
+    }
+    if (inst->op == ALIR_OP_PHI) {
+        sccp_visit_phi(ctx, block, inst, c);
+        return;
+    }
+
+    ConstVal l = {0}, r = {0}, res = {0};
+    SccpState state = SCCP_OVER;
+    if (inst->op == ALIR_OP_NOT || inst->op == ALIR_OP_CAST) {
+        state = sccp_operand(ctx, inst->op1, &l);
+        if (state == SCCP_CONST) {
+            res = inst->op == ALIR_OP_NOT ? optlir_eval_unary(ALIR_OP_NOT, l, inst->dest->type)
+                                          : optlir_eval_cast(l, inst->dest->type);
+        }
+    } else if (inst->op >= ALIR_OP_ADD && inst->op <= ALIR_OP_NEQ) {
+        SccpState sl = sccp_operand(ctx, inst->op1, &l);
+        SccpState sr = sccp_operand(ctx, inst->op2, &r);
+        if (sl == SCCP_OVER || sr == SCCP_OVER) state = SCCP_OVER;
+        else if (sl == SCCP_UNKNOWN || sr == SCCP_UNKNOWN) state = SCCP_UNKNOWN;
+        else {
+            state = SCCP_CONST;
+            res = optlir_eval_binary(inst->op, l, r, inst->dest->type);
+        }
+    }
+    if (state == SCCP_CONST && !res.is_const) state = SCCP_OVER;
+    sccp_lower(ctx, c, state, res);
+}
+
+/**
+ * @brief Numbers the values defined in a function and records instruction blocks.
+ * @param module The ALIR module.
+ * @param ctx The SCCP state receiving the cells and maps.
+ * @param func The function.
+ * @param arena Arena for the maps, or NULL.
+ * @return Number of CFG edges of the function.
+ */
+static int sccp_init(AlirModule *module, SccpCtx *ctx, AlirFunction *func, Arena *arena) {
+    int defs = 0, insts = 0, edges = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            insts++;
+            if (i->dest) defs++;
+        }
+        for (BlockEdge *e = b->succ; e; e = e->next) edges++;
+    }
+    int blocks = func->block_count > 0 ? func->block_count : 1;
+
+    ctx->cells = alir_alloc(module, sizeof(SccpCell) * (defs ? defs : 1));
+    ctx->ssa = alir_alloc(module, sizeof(int) * (defs * 2 + 1));
+    ctx->flow = alir_alloc(module, sizeof(AlirBlock*) * (edges + 1) * 2);
+    hashmap_init(&ctx->cell_index, arena, defs > 16 ? defs * 2 : 32);
+    hashmap_init(&ctx->inst_block, arena, insts > 16 ? insts * 2 : 32);
+    hashmap_init(&ctx->executable, arena, blocks > 16 ? blocks * 2 : 32);
+    hashmap_init(&ctx->edges, arena, edges > 16 ? edges * 2 : 32);
+
+    char key[32];
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        for (AlirInst *i = b->head; i; i = i->next) {
+            sccp_key(i, key);
+            hashmap_put(&ctx->inst_block, key, b);
+            if (!i->dest) continue;
+
+            int c = sccp_cell(ctx, i->dest);
+            if (c >= 0) {
+                // Written twice: not SSA, never a constant
+                ctx->cells[c].state = SCCP_OVER;
+                continue;
+            }
+            c = ctx->cell_count++;
+            ctx->cells[c].value = i->dest;
+            ctx->cells[c].def = i;
+            sccp_key(i->dest, key);
+            hashmap_put(&ctx->cell_index, key, (void*)(uintptr_t)(c + 1));
+        }
+    }
+    return edges;
+}
+
+/**
+ * @brief Runs the SCCP worklists to a fixed point.
+ * @param ctx The SCCP state.
+ * @param entry The entry block.
+ */
+static void sccp_solve(SccpCtx *ctx, AlirBlock *entry) {
+    char key[32];
+    ctx->flow[ctx->flow_top++] = NULL;
+    ctx->flow[ctx->flow_top++] = entry;
+
+    while (ctx->flow_top > 0 || ctx->ssa_top > 0) {
+        while (ctx->flow_top > 0) {
+            AlirBlock *to = ctx->flow[--ctx->flow_top];
+            ctx->flow_top--;
+            sccp_key(to, key);
+            if (hashmap_get(&ctx->executable, key)) {
+                // A new edge into a block already evaluated only changes its phis
+                for (AlirInst *i = to->head; i && i->op == ALIR_OP_PHI; i = i->next) {
+                    sccp_visit(ctx, to, i);
+                }
+                continue;
+            }
+            hashmap_put(&ctx->executable, key, to);
+            for (AlirInst *i = to->head; i; i = i->next) sccp_visit(ctx, to, i);
+        }
+
+        while (ctx->ssa_top > 0) {
+            SccpCell *cell = &ctx->cells[ctx->ssa[--ctx->ssa_top]];
+            for (AlirUse *u = cell->value->uses; u; u = u->next) {
+                sccp_key(u->user, key);
+                AlirBlock *b = hashmap_get(&ctx->inst_block, key);
+                if (!b) continue;
+                sccp_key(b, key);
+                if (hashmap_get(&ctx->executable, key)) sccp_visit(ctx, b, u->user);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Propagates constants along the executable edges of a function.
+ *
+ * Every value proven constant becomes that constant in place and loses its
+ * defining instruction, so the branches reading it fold afterwards and the
+ * blocks never reached become unreachable.
+ *
+ * @param module The ALIR module.
+ * @param func The function (SSA form, valid edges and def-use chains).
+ * @return Number of values folded to constants.
+ */
+int optlir_sccp_function(AlirModule *module, AlirFunction *func) {
+    if (!func || !func->blocks) return 0;
+    Arena *arena = alir_arena(module);
+
+    SccpCtx ctx = {0};
+    sccp_init(module, &ctx, func, arena);
+    sccp_solve(&ctx, func->blocks);
+
+    char key[32];
+    int folded = 0, dead = 0;
+    for (AlirBlock *b = func->blocks; b; b = b->next) {
+        sccp_key(b, key);
+        if (!hashmap_get(&ctx.executable, key)) {
+            dead++;
+            continue;
+        }
+        AlirInst *prev = NULL;
+        for (AlirInst *i = b->head; i; ) {
+            AlirInst *next = i->next;
+            int c = i->dest ? sccp_cell(&ctx, i->dest) : -1;
+            if (c >= 0 && ctx.cells[c].state == SCCP_CONST && ctx.cells[c].def == i) {
+                optlir_make_const(i->dest, ctx.cells[c].c);
+                alir_drop_uses(i);
+                if (prev) prev->next = next;
+                else b->head = next;
+                if (b->tail == i) b->tail = prev;
+                folded++;
+            } else {
+                prev = i;
+            }
+            i = next;
+        }
+    }
+
+    optlir_stats.sccp_folded += folded;
+    optlir_stats.sccp_blocks_removed += dead;
+    if (folded || dead) {
+        debug_optlir("sccp: %s: %d values folded, %d blocks unreachable\n", func->name, folded, dead);
+    }
+
+    if (!arena) {
+        hashmap_free(&ctx.cell_index);
+        hashmap_free(&ctx.inst_block);
+        hashmap_free(&ctx.executable);
+        hashmap_free(&ctx.edges);
+    }
+    return folded;
+}
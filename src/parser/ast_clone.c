@@ -96,7 +96,73 @@ VarType clone_var_type(CompilerContext *ctx, VarType t, char **type_params, VarT
 }
 
 /**
- * @brief Deep-clone an AST subtree with optional generic substitution and renaming.
+ * @brief Collect the left spine of a binary operator chain, outermost first.
+ *
+ * A left operand that is itself a binary operator (and not part of a list)
+ * continues the spine. Long spines spill from the caller's buffer into the arena.
+ *
+ * @param ctx The compiler context.
+ * @param top The outermost binary operator.
+ * @param local Caller-provided buffer.
+ * @param local_cap Capacity of local.
+ * @param out_count Receives the number of spine nodes.
+ * @return The spine; local or an arena array.
+ */
+static BinaryOpNode** ast_binary_spine(CompilerContext *ctx, BinaryOpNode *top, BinaryOpNode **local, int local_cap, int *out_count) {
+    BinaryOpNode **spine = local;
+    int count = 0, capacity = local_cap;
+
+    BinaryOpNode *curr = top;
+    while (1) {
+        if (count == capacity) {
+            BinaryOpNode **grown = arena_alloc(ctx->arena, sizeof(BinaryOpNode*) * capacity * 2);
+            memcpy(grown, spine, sizeof(BinaryOpNode*) * count);
+            spine = grown;
+            capacity *= 2;
+        }
+        spine[count++] = curr;
+        ASTNode *left = curr->left;
+        if (!left || left->type != NODE_BINARY_OP || left->next) break;
+        curr = (BinaryOpNode*)left;
+    }
+    *out_count = count;
+    return spine;
+}
+
+/**
+ * @brief Clone a left-deep chain of binary operators such as `a + b + c + ...`.
+ *
+ * The left spine is collected into an explicit stack and rebuilt bottom-up,
+ * so the depth of the chain does not turn into C stack depth.
+ *
+ * @param ctx The compiler context.
+ * @param top The outermost binary operator.
+ * @param type_params Generic type parameter names.
+ * @param replace_with Replacement types for generic parameters.
+ * @param num_params Number of generic parameters.
+ * @param rename_from Names to rename.
+ * @param rename_to New names.
+ * @param num_renames Number of renames.
+ * @return The cloned operator; its next pointer is left to the caller.
+ */
+static ASTNode* ast_clone_binary_chain(CompilerContext *ctx, BinaryOpNode *top, char **type_params, VarType *replace_with, int num_params, char **rename_from, char **rename_to, int num_renames) {
+    BinaryOpNode *local[64];
+    int count = 0;
+    BinaryOpNode **spine = ast_binary_spine(ctx, top, local, 64, &count);
+
+    ASTNode *result = ast_clone(ctx, spine[count - 1]->left, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
+    for (int i = count - 1; i >= 0; i--) {
+        BinaryOpNode *n = arena_alloc(ctx->arena, sizeof(BinaryOpNode));
+        *n = *spine[i];
+        n->left = result;
+        n->right = ast_clone(ctx, spine[i]->right, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
+        result = (ASTNode*)n;
+    }
+    return result;
+}
+
+/**
+ * @brief Clone a single AST node and its children, but not the nodes after it.
  * @param ctx The compiler context.
  * @param node The AST node to clone.
  * @param type_params Generic type parameter names.
@@ -105,11 +171,10 @@ VarType clone_var_type(CompilerContext *ctx, VarType t, char **type_params, VarT
  * @param rename_from Names to rename.
  * @param rename_to New names.
  * @param num_renames Number of renames.
+ * @param list_done Set when the statement list must end after this node.
  * @return The cloned AST node.
  */
-ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarType *replace_with, int num_params, char **rename_from, char **rename_to, int num_renames) {
-    if (!ctx || !node) return NULL;
-
+static ASTNode* ast_clone_one(CompilerContext *ctx, ASTNode *node, char **type_params, VarType *replace_with, int num_params, char **rename_from, char **rename_to, int num_renames, int *list_done) {
     ASTNode *clone = NULL;
 
     switch (node->type) {
@@ -269,15 +334,9 @@ ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarT
             clone = (ASTNode*)n;
             break;
         }
-        case NODE_BINARY_OP: {
-            BinaryOpNode *orig = (BinaryOpNode*)node;
-            BinaryOpNode *n = arena_alloc(ctx->arena, sizeof(BinaryOpNode));
-            *n = *orig;
-            n->left = ast_clone(ctx, orig->left, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
-            n->right = ast_clone(ctx, orig->right, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
-            clone = (ASTNode*)n;
+        case NODE_BINARY_OP:
+            clone = ast_clone_binary_chain(ctx, (BinaryOpNode*)node, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
             break;
-        }
         case NODE_UNARY_OP: {
             UnaryOpNode *orig = (UnaryOpNode*)node;
             UnaryOpNode *n = arena_alloc(ctx->arena, sizeof(UnaryOpNode));
@@ -362,13 +421,26 @@ ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarT
             break;
         }
         case NODE_IF: {
+            // else-if links are cloned in a loop, each hanging off the previous else slot
             IfNode *orig = (IfNode*)node;
-            IfNode *n = arena_alloc(ctx->arena, sizeof(IfNode));
-            *n = *orig;
-            n->condition = ast_clone(ctx, orig->condition, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
-            n->then_body = ast_clone(ctx, orig->then_body, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
-            n->else_body = ast_clone(ctx, orig->else_body, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
-            clone = (ASTNode*)n;
+            ASTNode **slot = &clone;
+            while (1) {
+                IfNode *n = arena_alloc(ctx->arena, sizeof(IfNode));
+                *n = *orig;
+                n->condition = ast_clone(ctx, orig->condition, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
+                n->then_body = ast_clone(ctx, orig->then_body, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
+                n->else_body = NULL;
+                *slot = (ASTNode*)n;
+
+                ASTNode *else_body = orig->else_body;
+                if (else_body && else_body->type == NODE_IF && !else_body->next) {
+                    slot = &n->else_body;
+                    orig = (IfNode*)else_body;
+                    continue;
+                }
+                n->else_body = ast_clone(ctx, else_body, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
+                break;
+            }
             break;
         }
         case NODE_WHILE: {
@@ -431,6 +503,7 @@ ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarT
             n->err_var_name = orig->err_var_name ? arena_strdup(ctx->arena, orig->err_var_name) : NULL;
             n->body = ast_clone(ctx, orig->body, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
             n->residue_body = ast_clone(ctx, orig->residue_body, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
+            *list_done = 1;
             return (ASTNode*)n;
         }
         case NODE_UNTAINT: {
@@ -443,10 +516,12 @@ ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarT
             n->var_name = orig->var_name ? arena_strdup(ctx->arena, orig->var_name) : NULL;
             n->err_var_name = orig->err_var_name ? arena_strdup(ctx->arena, orig->err_var_name) : NULL;
             n->residue_body = ast_clone(ctx, orig->residue_body, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
+            *list_done = 1;
             return (ASTNode*)n;
         }
         case NODE_ERRNUM:
             // Top level constructs are typically not cloned in template instantiation
+            *list_done = 1;
             return NULL;
         // random node, try to fix this
         default:
@@ -455,27 +530,130 @@ ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarT
             break;
     }
 
-    if (node->next) {
-        clone->next = ast_clone(ctx, node->next, type_params, replace_with, num_params, rename_from, rename_to, num_renames);
-    } else {
+    return clone;
+}
+
+/**
+ * @brief Deep-clone an AST subtree with optional generic substitution and renaming.
+ *
+ * The statement list starting at node is cloned in a loop, so long blocks do
+ * not recurse once per statement.
+ *
+ * @param ctx The compiler context.
+ * @param node The AST node to clone.
+ * @param type_params Generic type parameter names.
+ * @param replace_with Replacement types for generic parameters.
+ * @param num_params Number of generic parameters.
+ * @param rename_from Names to rename.
+ * @param rename_to New names.
+ * @param num_renames Number of renames.
+ * @return The cloned AST node.
+ */
+ASTNode* ast_clone(CompilerContext *ctx, ASTNode *node, char **type_params, VarType *replace_with, int num_params, char **rename_from, char **rename_to, int num_renames) {
+    if (!ctx || !node) return NULL;
+
+    ASTNode *head = NULL;
+    ASTNode **tail = &head;
+    for (ASTNode *curr = node; curr; curr = curr->next) {
+        int list_done = 0;
+        ASTNode *clone = ast_clone_one(ctx, curr, type_params, replace_with, num_params, rename_from, rename_to, num_renames, &list_done);
+        *tail = clone;
+        if (list_done || !clone) break;
         clone->next = NULL;
+        tail = &clone->next;
     }
+    return head;
+}
 
-    return clone;
+/**
+ * @brief Record a substituted macro argument in the rewrite trace.
+ * @param ctx The compiler context.
+ * @param trace The trace to append to, or NULL.
+ * @param slot The cloned placeholder node inserted into the body.
+ * @param origin The call-site argument the placeholder was cloned from.
+ */
+static void macro_trace_record(CompilerContext *ctx, MacroArgTrace *trace, ASTNode *slot, ASTNode *origin) {
+    if (!trace) return;
+    if (trace->count == trace->capacity) {
+        int new_cap = trace->capacity ? trace->capacity * 2 : 8;
+        ASTNode **new_slots = arena_alloc(ctx->arena, sizeof(ASTNode*) * new_cap);
+        ASTNode **new_origins = arena_alloc(ctx->arena, sizeof(ASTNode*) * new_cap);
+        if (trace->count) {
+            memcpy(new_slots, trace->slots, sizeof(ASTNode*) * trace->count);
+            memcpy(new_origins, trace->origins, sizeof(ASTNode*) * trace->count);
+        }
+        trace->slots = new_slots;
+        trace->origins = new_origins;
+        trace->capacity = new_cap;
+    }
+    trace->slots[trace->count] = slot;
+    trace->origins[trace->count] = origin;
+    trace->count++;
 }
 
 /**
- * @brief Rewrite a macro call by substituting parameters with cloned argument subtrees.
+ * @brief Size of the concrete node struct that ast_clone allocates for a node type.
+ * @param type The node type.
+ * @return The struct size in bytes.
+ */
+static size_t ast_clone_node_size(NodeType type) {
+    switch (type) {
+        case NODE_LITERAL: return sizeof(LiteralNode);
+        case NODE_VAR_REF: return sizeof(VarRefNode);
+        case NODE_ARRAY_LIT: return sizeof(ArrayLitNode);
+        case NODE_FUNC_DEF: return sizeof(FuncDefNode);
+        case NODE_VAR_DECL: return sizeof(VarDeclNode);
+        case NODE_CALL: return sizeof(CallNode);
+        case NODE_CLASS: return sizeof(ClassNode);
+        case NODE_BINARY_OP: return sizeof(BinaryOpNode);
+        case NODE_UNARY_OP: return sizeof(UnaryOpNode);
+        case NODE_RETURN: return sizeof(ReturnNode);
+        case NODE_PURGE: return sizeof(PurgeNode);
+        case NODE_CAST: return sizeof(CastNode);
+        case NODE_MEMBER_ACCESS: return sizeof(MemberAccessNode);
+        case NODE_METHOD_CALL: return sizeof(MethodCallNode);
+        case NODE_INC_DEC: return sizeof(IncDecNode);
+        case NODE_FOR_IN: return sizeof(ForInNode);
+        case NODE_INDEX_ACCESS: return sizeof(IndexAccessNode);
+        case NODE_IF: return sizeof(IfNode);
+        case NODE_WHILE: return sizeof(WhileNode);
+        case NODE_ASSIGN: return sizeof(AssignNode);
+        case NODE_TEMPLATE_INSTANTIATION: return sizeof(TemplateInstNode);
+        case NODE_TYPEOF:
+        case NODE_SIZEOF:
+        case NODE_ALIGNOF: return sizeof(SizeOfNode);
+        case NODE_CLEAN: return sizeof(CleanNode);
+        case NODE_UNTAINT: return sizeof(UntaintNode);
+        default: return sizeof(ASTNode);
+    }
+}
+
+/**
+ * @brief Point a macro placeholder at a new call-site argument of the same node type.
+ * @param slot The placeholder node produced by ast_rewrite_macro.
+ * @param arg The argument to substitute; its children are shared, not cloned.
+ */
+void ast_refresh_macro_arg(ASTNode *slot, ASTNode *arg) {
+    if (!slot || !arg || slot == arg || slot->type != arg->type) return;
+    ASTNode *next = slot->next;
+    memcpy(slot, arg, ast_clone_node_size(arg->type));
+    slot->next = next;
+    slot->is_macro_arg = 1;
+}
+
+/**
+ * @brief Rewrite one node of a macro body, but not the nodes after it.
  * @param ctx The compiler context.
  * @param node The AST node to rewrite.
  * @param varargs_head Head of the varargs list.
  * @param param_names Macro parameter names.
  * @param param_args Macro argument nodes.
  * @param num_params Number of macro parameters.
- * @return The rewritten AST node.
+ * @param trace Optional trace receiving every placeholder and the argument it came from.
+ * @param out_tail Receives the last node of the replacement, or NULL if it is empty.
+ * @return The first node of the replacement, which may be several nodes long.
  */
-ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs_head, char **param_names, ASTNode **param_args, int num_params) {
-    if (!node) return NULL;
+static ASTNode* ast_rewrite_macro_one(CompilerContext *ctx, ASTNode *node, ASTNode *varargs_head, char **param_names, ASTNode **param_args, int num_params, MacroArgTrace *trace, ASTNode **out_tail) {
 
     // Check for parameter replacement
     if (node->type == NODE_VAR_REF) {
@@ -488,7 +666,8 @@ ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs
                 ASTNode *cloned_arg = ast_clone(ctx, param_args[i], NULL, NULL, 0, NULL, NULL, 0);
                 cloned_arg->is_macro_arg = 1;
                 param_args[i]->next = old_next;
-                cloned_arg->next = ast_rewrite_macro(ctx, node->next, varargs_head, param_names, param_args, num_params);
+                macro_trace_record(ctx, trace, cloned_arg, param_args[i]);
+                *out_tail = cloned_arg;
                 return cloned_arg;
             }
         }
@@ -515,7 +694,8 @@ ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs
                         ASTNode *cloned_arg = ast_clone(ctx, curr, NULL, NULL, 0, NULL, NULL, 0);
                         cloned_arg->is_macro_arg = 1;
                         curr->next = old_next;
-                        cloned_arg->next = ast_rewrite_macro(ctx, node->next, varargs_head, param_names, param_args, num_params);
+                        macro_trace_record(ctx, trace, cloned_arg, curr);
+                        *out_tail = cloned_arg;
                         return cloned_arg;
                     }
                 }
@@ -528,46 +708,51 @@ ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs
     switch (node->type) {
         case NODE_FUNC_DEF: {
             FuncDefNode *fn = (FuncDefNode*)node;
-            fn->body = ast_rewrite_macro(ctx, fn->body, varargs_head, param_names, param_args, num_params);
+            fn->body = ast_rewrite_macro(ctx, fn->body, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_VAR_DECL: {
             VarDeclNode *vn = (VarDeclNode*)node;
-            vn->initializer = ast_rewrite_macro(ctx, vn->initializer, varargs_head, param_names, param_args, num_params);
+            vn->initializer = ast_rewrite_macro(ctx, vn->initializer, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_ASSIGN: {
             AssignNode *an = (AssignNode*)node;
-            an->target = ast_rewrite_macro(ctx, an->target, varargs_head, param_names, param_args, num_params);
-            an->value = ast_rewrite_macro(ctx, an->value, varargs_head, param_names, param_args, num_params);
+            an->target = ast_rewrite_macro(ctx, an->target, varargs_head, param_names, param_args, num_params, trace);
+            an->value = ast_rewrite_macro(ctx, an->value, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_BINARY_OP: {
-            BinaryOpNode *bn = (BinaryOpNode*)node;
-            bn->left = ast_rewrite_macro(ctx, bn->left, varargs_head, param_names, param_args, num_params);
-            bn->right = ast_rewrite_macro(ctx, bn->right, varargs_head, param_names, param_args, num_params);
+            // Walk the left spine of `a + b + c + ...` bottom-up instead of recursing into it
+            BinaryOpNode *local[64];
+            int count = 0;
+            BinaryOpNode **spine = ast_binary_spine(ctx, (BinaryOpNode*)node, local, 64, &count);
+            spine[count - 1]->left = ast_rewrite_macro(ctx, spine[count - 1]->left, varargs_head, param_names, param_args, num_params, trace);
+            for (int i = count - 1; i >= 0; i--) {
+                spine[i]->right = ast_rewrite_macro(ctx, spine[i]->right, varargs_head, param_names, param_args, num_params, trace);
+            }
             break;
         }
         case NODE_ARRAY_LIT: {
             ArrayLitNode *an = (ArrayLitNode*)node;
-            an->elements = ast_rewrite_macro(ctx, an->elements, varargs_head, param_names, param_args, num_params);
+            an->elements = ast_rewrite_macro(ctx, an->elements, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_CALL: {
             CallNode *cn = (CallNode*)node;
-            cn->target = ast_rewrite_macro(ctx, cn->target, varargs_head, param_names, param_args, num_params);
-            cn->args = ast_rewrite_macro(ctx, cn->args, varargs_head, param_names, param_args, num_params);
+            cn->target = ast_rewrite_macro(ctx, cn->target, varargs_head, param_names, param_args, num_params, trace);
+            cn->args = ast_rewrite_macro(ctx, cn->args, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_MEMBER_ACCESS: {
             MemberAccessNode *mn = (MemberAccessNode*)node;
-            mn->object = ast_rewrite_macro(ctx, mn->object, varargs_head, param_names, param_args, num_params);
+            mn->object = ast_rewrite_macro(ctx, mn->object, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_METHOD_CALL: {
             MethodCallNode *mcn = (MethodCallNode*)node;
-            mcn->object = ast_rewrite_macro(ctx, mcn->object, varargs_head, param_names, param_args, num_params);
-            mcn->args = ast_rewrite_macro(ctx, mcn->args, varargs_head, param_names, param_args, num_params);
+            mcn->object = ast_rewrite_macro(ctx, mcn->object, varargs_head, param_names, param_args, num_params, trace);
+            mcn->args = ast_rewrite_macro(ctx, mcn->args, varargs_head, param_names, param_args, num_params, trace);
 
             if (mcn->object && mcn->object->type == NODE_VAR_REF && ((VarRefNode*)mcn->object)->name && streq_lit(((VarRefNode*)mcn->object)->name, "metas")) {
                 debug_parser("found metas.method_name = %s\n", mcn->method_name);
@@ -582,6 +767,7 @@ ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs
                             const char *delim = delim_node->val.str_val;
 
                             debug_parser("metas.split intercepted! str=%s, delim=%s\n", str, delim);
+                            if (trace) trace->value_dependent = 1;
 
                             ArrayLitNode *arr = arena_alloc(ctx->arena, sizeof(ArrayLitNode));
                             memset(arr, 0, sizeof(ArrayLitNode));
@@ -611,7 +797,7 @@ ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs
                                 pt = match + delim_len;
                             }
 
-                            arr->base.next = ast_rewrite_macro(ctx, node->next, varargs_head, param_names, param_args, num_params);
+                            *out_tail = (ASTNode*)arr;
                             return (ASTNode*)arr;
                         }
                     }
@@ -621,25 +807,33 @@ ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs
         }
         case NODE_RETURN: {
             ReturnNode *rn = (ReturnNode*)node;
-            rn->value = ast_rewrite_macro(ctx, rn->value, varargs_head, param_names, param_args, num_params);
+            rn->value = ast_rewrite_macro(ctx, rn->value, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_PURGE: {
             PurgeNode *pn = (PurgeNode*)node;
-            pn->msg = ast_rewrite_macro(ctx, pn->msg, varargs_head, param_names, param_args, num_params);
-            pn->target = ast_rewrite_macro(ctx, pn->target, varargs_head, param_names, param_args, num_params);
+            pn->msg = ast_rewrite_macro(ctx, pn->msg, varargs_head, param_names, param_args, num_params, trace);
+            pn->target = ast_rewrite_macro(ctx, pn->target, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_CAST: {
             CastNode *cn = (CastNode*)node;
-            cn->operand = ast_rewrite_macro(ctx, cn->operand, varargs_head, param_names, param_args, num_params);
+            cn->operand = ast_rewrite_macro(ctx, cn->operand, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_IF: {
             IfNode *in = (IfNode*)node;
-            in->condition = ast_rewrite_macro(ctx, in->condition, varargs_head, param_names, param_args, num_params);
-            in->then_body = ast_rewrite_macro(ctx, in->then_body, varargs_head, param_names, param_args, num_params);
-            in->else_body = ast_rewrite_macro(ctx, in->else_body, varargs_head, param_names, param_args, num_params);
+            while (1) {
+                in->condition = ast_rewrite_macro(ctx, in->condition, varargs_head, param_names, param_args, num_params, trace);
+                in->then_body = ast_rewrite_macro(ctx, in->then_body, varargs_head, param_names, param_args, num_params, trace);
+                ASTNode *else_body = in->else_body;
+                if (else_body && else_body->type == NODE_IF && !else_body->next) {
+                    in = (IfNode*)else_body;
+                    continue;
+                }
+                in->else_body = ast_rewrite_macro(ctx, else_body, varargs_head, param_names, param_args, num_params, trace);
+                break;
+            }
             break;
         }
         case NODE_FOR_IN: {
@@ -660,7 +854,7 @@ ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs
                     new_args[num_params] = curr_arg;
 
                     ASTNode *cloned_body = ast_clone(ctx, fn->body, NULL, NULL, 0, NULL, NULL, 0);
-                    cloned_body = ast_rewrite_macro(ctx, cloned_body, varargs_head, new_names, new_args, num_params + 1);
+                    cloned_body = ast_rewrite_macro(ctx, cloned_body, varargs_head, new_names, new_args, num_params + 1, trace);
 
                     if (!expanded_head) expanded_head = cloned_body;
                     else expanded_tail->next = cloned_body;
@@ -672,38 +866,66 @@ ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs
                     curr_arg = curr_arg->next;
                 }
 
-                if (expanded_tail) expanded_tail->next = ast_rewrite_macro(ctx, fn->base.next, varargs_head, param_names, param_args, num_params);
-                else expanded_head = ast_rewrite_macro(ctx, fn->base.next, varargs_head, param_names, param_args, num_params);
-
+                *out_tail = expanded_tail;
                 return expanded_head;
             }
-            fn->collection = ast_rewrite_macro(ctx, fn->collection, varargs_head, param_names, param_args, num_params);
-            fn->body = ast_rewrite_macro(ctx, fn->body, varargs_head, param_names, param_args, num_params);
+            fn->collection = ast_rewrite_macro(ctx, fn->collection, varargs_head, param_names, param_args, num_params, trace);
+            fn->body = ast_rewrite_macro(ctx, fn->body, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_INDEX_ACCESS: {
             IndexAccessNode *an = (IndexAccessNode*)node;
-            an->target = ast_rewrite_macro(ctx, an->target, varargs_head, param_names, param_args, num_params);
-            an->index = ast_rewrite_macro(ctx, an->index, varargs_head, param_names, param_args, num_params);
+            an->target = ast_rewrite_macro(ctx, an->target, varargs_head, param_names, param_args, num_params, trace);
+            an->index = ast_rewrite_macro(ctx, an->index, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_UNARY_OP: {
             UnaryOpNode *un = (UnaryOpNode*)node;
-            un->operand = ast_rewrite_macro(ctx, un->operand, varargs_head, param_names, param_args, num_params);
+            un->operand = ast_rewrite_macro(ctx, un->operand, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         case NODE_TYPEOF:
         case NODE_SIZEOF: {
             SizeOfNode *sn = (SizeOfNode*)node;
-            sn->operand = ast_rewrite_macro(ctx, sn->operand, varargs_head, param_names, param_args, num_params);
+            sn->operand = ast_rewrite_macro(ctx, sn->operand, varargs_head, param_names, param_args, num_params, trace);
             break;
         }
         default:
             break;
     }
 
-    // Also rewrite next nodes in the list!
-    node->next = ast_rewrite_macro(ctx, node->next, varargs_head, param_names, param_args, num_params);
-
+    *out_tail = node;
     return node;
 }
+
+/**
+ * @brief Rewrite a macro call by substituting parameters with cloned argument subtrees.
+ *
+ * The statement list starting at node is rewritten in a loop; a node may be
+ * replaced by several nodes (a vararg for-in expansion) or by none.
+ *
+ * @param ctx The compiler context.
+ * @param node The AST node to rewrite.
+ * @param varargs_head Head of the varargs list.
+ * @param param_names Macro parameter names.
+ * @param param_args Macro argument nodes.
+ * @param num_params Number of macro parameters.
+ * @param trace Optional trace receiving every placeholder and the argument it came from.
+ * @return The rewritten AST node.
+ */
+ASTNode* ast_rewrite_macro(CompilerContext *ctx, ASTNode *node, ASTNode *varargs_head, char **param_names, ASTNode **param_args, int num_params, MacroArgTrace *trace) {
+    ASTNode *head = NULL;
+    ASTNode **link = &head;
+    while (node) {
+        ASTNode *next = node->next;
+        ASTNode *tail = NULL;
+        ASTNode *first = ast_rewrite_macro_one(ctx, node, varargs_head, param_names, param_args, num_params, trace, &tail);
+        if (first) {
+            *link = first;
+            link = &tail->next;
+        }
+        node = next;
+    }
+    *link = NULL;
+    return head;
+}
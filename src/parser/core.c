@@ -32,6 +32,7 @@ void parser_init(Parser *p, Lexer *l, ParserSettings *settings) {
     p->in_space_separated_call = 0;
     p->disable_space_call = 0;
     p->pending_cconv = NULL;
+    p->pending_inline = 0;
 
     if (p->ctx && p->ctx->arena) {
         hashmap_init(&p->types_map, p->ctx->arena, 64);
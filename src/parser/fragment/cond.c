@@ -10,38 +10,52 @@
 static ASTNode* parse_case_body_stmts(Parser *p);
 /**
  * @brief Parses an if/else statement.
+ *
+ * An `else if` chain is parsed in a loop, each link hanging off the previous
+ * link's else slot, so long chains do not recurse once per link.
+ *
  * @param p Parser context.
  * @return AST node for the if statement, or NULL on error.
  */
 ASTNode* parse_if(Parser *p) {
-  int line = p->current_token.line, col = p->current_token.col;
-  eat(p, TOKEN_IF);
-  ASTNode *cond = NULL;
-  if (p->settings.require_parens_for_conditions) {
-      eat(p, TOKEN_LPAREN);
-      cond = parse_expression(p);
-      eat(p, TOKEN_RPAREN);
-  } else {
-      cond = parse_expression(p);
-  }
-  
-  if (p->current_token.type == TOKEN_THEN) {
-      eat(p, TOKEN_THEN);
-  }
-  
-  ASTNode *then_body = parse_single_statement_or_block(p);
-  ASTNode *else_body = NULL;
-  if (p->current_token.type == TOKEN_ELSE) {
+  ASTNode *head = NULL;
+  ASTNode **slot = &head;
+
+  while (1) {
+    int line = p->current_token.line, col = p->current_token.col;
+    eat(p, TOKEN_IF);
+    ASTNode *cond = NULL;
+    if (p->settings.require_parens_for_conditions) {
+        eat(p, TOKEN_LPAREN);
+        cond = parse_expression(p);
+        eat(p, TOKEN_RPAREN);
+    } else {
+        cond = parse_expression(p);
+    }
+    
+    if (p->current_token.type == TOKEN_THEN) {
+        eat(p, TOKEN_THEN);
+    }
+    
+    ASTNode *then_body = parse_single_statement_or_block(p);
+    IfNode *node = parser_alloc(p, sizeof(IfNode));
+    node->base.type = NODE_IF;
+    node->condition = cond;
+    node->then_body = then_body;
+    node->else_body = NULL;
+    set_loc((ASTNode*)node, line, col);
+    *slot = (ASTNode*)node;
+
+    if (p->current_token.type != TOKEN_ELSE) break;
     eat(p, TOKEN_ELSE);
-    else_body = parse_single_statement_or_block(p);
+    if (p->current_token.type == TOKEN_IF && !p->has_error) {
+      slot = &node->else_body;
+      continue;
+    }
+    node->else_body = parse_single_statement_or_block(p);
+    break;
   }
-  IfNode *node = parser_alloc(p, sizeof(IfNode));
-  node->base.type = NODE_IF;
-  node->condition = cond;
-  node->then_body = then_body;
-  node->else_body = else_body;
-  set_loc((ASTNode*)node, line, col);
-  return (ASTNode*)node;
+  return head;
 }
 
 /**
@@ -131,6 +131,8 @@ static ASTNode* parse_single_extern(Parser *p, int modifiers) {
   node->extern_name = extern_name;
   node->cconv = p->pending_cconv ? p->pending_cconv : p->ctx->settings.default_cconv;
   p->pending_cconv = NULL;
+  node->inline_hint = p->pending_inline;
+  p->pending_inline = 0;
   apply_func_modifiers(node, modifiers);
   return (ASTNode*)node;
 }
@@ -788,11 +790,11 @@ ASTNode* parse_top_level_internal(Parser *p) {
               char *reason_str = NULL;
               if (p->current_token.type == TOKEN_REASON) {
                   eat(p, TOKEN_REASON);
-                  if (p->current_token.type != TOKEN_STRING) {
+                  if (p->current_token.type != TOKEN_STRING && p->current_token.type != TOKEN_C_STRING) {
                       parser_fail(p, "Expected string literal after reason");
                   }
                   reason_str = parser_strdup(p, p->current_token.text);
-                  eat(p, TOKEN_STRING);
+                  eat(p, p->current_token.type);
               }
 
               int line = p->current_token.line;
@@ -802,7 +804,8 @@ ASTNode* parse_top_level_internal(Parser *p) {
                   eat(p, TOKEN_IDENTIFIER);
                   if (p->current_token.type == TOKEN_ASSIGN) {
                       eat(p, TOKEN_ASSIGN);
-                      if (p->current_token.type == TOKEN_STRING || p->current_token.type == TOKEN_IDENTIFIER) {
+                      if (p->current_token.type == TOKEN_STRING || p->current_token.type == TOKEN_C_STRING ||
+                          p->current_token.type == TOKEN_IDENTIFIER) {
                           if (!reason_str) {
                               p->current_token.line = line;
                               p->current_token.col = col;
@@ -810,6 +813,10 @@ ASTNode* parse_top_level_internal(Parser *p) {
                           }
                           if (streq_lit(key, "cconv")) {
                               p->pending_cconv = parser_strdup(p, p->current_token.text);
+                          } else if (streq_lit(key, "inline")) {
+                              if (streq_lit(p->current_token.text, "always")) p->pending_inline = 1;
+                              else if (streq_lit(p->current_token.text, "never")) p->pending_inline = -1;
+                              else parser_fail(p, "Expected 'always' or 'never' for inline");
                           }
                           eat(p, p->current_token.type);
                       }
@@ -1071,6 +1078,8 @@ ASTNode* parse_func_def_after_type(Parser *p, int modifiers, VarType vtype, int
     node->base.line = line; node->base.col = col;
     node->cconv = p->pending_cconv ? p->pending_cconv : p->ctx->settings.default_cconv;
     p->pending_cconv = NULL; // Consume it
+    node->inline_hint = p->pending_inline;
+    p->pending_inline = 0;
 
     apply_func_modifiers(node, modifiers);
     return (ASTNode*)node;
@@ -99,6 +99,12 @@ void sem_scan_top_level(SemanticCtx *ctx, ASTNode *node) {
 
     // TODO change this into switch instead of if-else
     while (node) {
+        if (sem_decl_is_reused(ctx, node)) {
+            node = node->next;
+            continue;
+        }
+        SemDecl *decl = sem_decl_for(ctx, node);
+        if (decl) ctx->current_decl = decl;
         if (node->filename) ctx->current_filename = node->filename;
         ctx->current_node = node;
         if (node->type == NODE_FUNC_DEF) {
@@ -338,12 +344,11 @@ void sem_inject_default_class_args(SemanticCtx *ctx, CallNode *node, SemSymbol *
 }
 
 /**
- * @brief Type-check a binary operator expression node.
+ * @brief Type-check a binary operator whose left operand is already checked.
  * @param ctx Semantic context.
  * @param node Binary operator AST node.
  */
-void sem_check_binary_op(SemanticCtx *ctx, BinaryOpNode *node) {
-    sem_check_expr(ctx, node->left);
+static void sem_check_binary_op_rest(SemanticCtx *ctx, BinaryOpNode *node) {
     sem_check_expr(ctx, node->right);
 
     VarType l = sem_get_node_type(ctx, node->left);
@@ -477,6 +482,42 @@ void sem_check_binary_op(SemanticCtx *ctx, BinaryOpNode *node) {
     }
 }
 
+/**
+ * @brief Type-check a binary operator expression node.
+ *
+ * The left spine of a left-deep chain such as `a + b + c + ...` is collected
+ * first and checked bottom-up, so long chains do not recurse per operator.
+ *
+ * @param ctx Semantic context.
+ * @param node Binary operator AST node.
+ */
+void sem_check_binary_op(SemanticCtx *ctx, BinaryOpNode *node) {
+    BinaryOpNode *local[64];
+    BinaryOpNode **spine = local;
+    int count = 0, capacity = 64;
+
+    BinaryOpNode *curr = node;
+    while (1) {
+        if (count == capacity) {
+            BinaryOpNode **grown = arena_alloc(ctx->compiler_ctx->arena, sizeof(BinaryOpNode*) * capacity * 2);
+            memcpy(grown, spine, sizeof(BinaryOpNode*) * count);
+            spine = grown;
+            capacity *= 2;
+        }
+        spine[count++] = curr;
+        ASTNode *left = curr->left;
+        if (!left || left->type != NODE_BINARY_OP || left->is_macro_arg) break;
+        if (left->filename) ctx->current_filename = left->filename;
+        ctx->current_node = left;
+        curr = (BinaryOpNode*)left;
+    }
+
+    sem_check_expr(ctx, curr->left);
+    for (int i = count - 1; i >= 0; i--) {
+        sem_check_binary_op_rest(ctx, spine[i]);
+    }
+}
+
 // TODO break this into a modularized form!
 // because this is too big!
 /**
@@ -254,7 +254,10 @@ int sem_check_program(SemanticCtx *ctx, ASTNode *root) {
     }
 
     sem_register_builtins(ctx);
+    ctx->decl_scanning = 1;
     sem_scan_top_level(ctx, root);
+    ctx->decl_scanning = 0;
+    ctx->current_decl = NULL;
 
     // Pass 1.5: Structural validations (Inheritance, Traits)
     ASTNode *curr_val = root;
@@ -285,14 +288,28 @@ int sem_check_program(SemanticCtx *ctx, ASTNode *root) {
 
     ASTNode *curr = root;
     while (curr) {
+        if (sem_decl_is_reused(ctx, curr)) {
+            curr = curr->next;
+            continue;
+        }
+        ctx->current_decl = sem_decl_for(ctx, curr);
+        ASTNode **tail_before = ctx->ast_tail;
         if (curr->type == NODE_VAR_DECL) {
             // Check global var initializers (don't register, already scanned)
             sem_check_var_decl(ctx, (VarDeclNode*)curr, 0);
         } else {
             sem_check_node(ctx, curr);
         }
+        if (ctx->current_decl && tail_before && tail_before != ctx->ast_tail) {
+            sem_decl_note_extras(ctx, ctx->current_decl, *tail_before);
+        }
         curr = curr->next;
     }
+    ctx->current_decl = NULL;
+
+    // Settle pure/total summaries now that every body has been seen.
+    // Must run before the class cycle check, which reuses the must_* bits.
+    sem_infer_effects(ctx);
 
     // Cycle Detection for Class Sizes
     if (ctx->global_scope) {
@@ -325,6 +342,7 @@ int sem_check_program(SemanticCtx *ctx, ASTNode *root) {
         }
     }
 
-    if (ctx->compiler_ctx) return ctx->compiler_ctx->error_count;
-    return 0;
+    int errors = ctx->compiler_ctx ? ctx->compiler_ctx->error_count : 0;
+    sem_incremental_finish(ctx, errors);
+    return errors;
 }
@@ -4,6 +4,34 @@
  */
 #include "semantic.h"
 
+/**
+ * @brief Statically evaluates a `typeof(a) == typeof(b)` style condition.
+ * @param ctx Semantic context.
+ * @param cond The checked condition expression.
+ * @return 1 or 0 when the condition is known at compile time, -1 otherwise.
+ */
+static int sem_static_condition(SemanticCtx *ctx, ASTNode *cond) {
+    if (!cond || cond->type != NODE_BINARY_OP) return -1;
+    BinaryOpNode *bin = (BinaryOpNode*)cond;
+    if (bin->op != TOKEN_EQ && bin->op != TOKEN_NEQ) return -1;
+
+    ASTNode *l = bin->left;
+    ASTNode *r = bin->right;
+    if (l && l->type == NODE_CAST) l = ((CastNode*)l)->operand;
+    if (l && l->type == NODE_BEING) l = ((BeingNode*)l)->operand;
+    if (r && r->type == NODE_CAST) r = ((CastNode*)r)->operand;
+    if (r && r->type == NODE_BEING) r = ((BeingNode*)r)->operand;
+    if (!l || !r || l->type != NODE_TYPEOF || r->type != NODE_TYPEOF) return -1;
+
+    SizeOfNode *sl = (SizeOfNode*)l;
+    SizeOfNode *sr = (SizeOfNode*)r;
+    VarType tl = sl->target_type.base != TYPE_UNKNOWN ? sl->target_type : sem_get_node_type(ctx, sl->operand);
+    VarType tr = sr->target_type.base != TYPE_UNKNOWN ? sr->target_type : sem_get_node_type(ctx, sr->operand);
+    int cond_val = (sem_types_are_equal(tl, tr) || sem_types_are_compatible(ctx, tl, tr)) ? 1 : 0;
+    if (bin->op == TOKEN_NEQ) cond_val = 1 - cond_val;
+    return cond_val;
+}
+
 /**
  * @brief Type-check a single statement node.
  * @param ctx Semantic context.
@@ -59,8 +87,11 @@ void sem_check_stmt(SemanticCtx *ctx, ASTNode *node) {
                 sem_check_expr(ctx, rn->value);
                 VarType val = sem_get_node_type(ctx, rn->value);
 
-                if (ctx->current_func_sym && ctx->current_func_sym->must_pristine && sem_get_node_tainted(ctx, rn->value)) {
-                    sem_error(ctx, node, "Pristine function '%s' cannot return a tainted value", ctx->current_func_sym->name);
+                if (ctx->current_func_sym && sem_get_node_tainted(ctx, rn->value)) {
+                    if (ctx->current_func_sym->must_pristine) {
+                        sem_error(ctx, node, "Pristine function '%s' cannot return a tainted value", ctx->current_func_sym->name);
+                    }
+                    ctx->current_func_sym->returns_tainted = 1;
                 }
 
                 if (ctx->current_scope->is_function_scope) {
@@ -156,48 +187,34 @@ void sem_check_stmt(SemanticCtx *ctx, ASTNode *node) {
         case NODE_ERRNUM:
             break;
         case NODE_IF: {
+            // An else-if chain is walked link by link; every branch gets its
+            // own scope, so the links do not nest scopes or recurse
             IfNode *ifn = (IfNode*)node;
-            sem_check_expr(ctx, ifn->condition);
-            if (sem_get_node_type(ctx, ifn->condition).is_tainted) {
-                sem_error(ctx, ifn->condition, "Condition is tainted");
-                sem_emit_fallback_hint(ctx, ifn->condition);
-            }
-
-            int cond_val = -1;
-            if (ifn->condition->type == NODE_BINARY_OP) {
-                BinaryOpNode *bin = (BinaryOpNode*)ifn->condition;
-                if (bin->op == TOKEN_EQ || bin->op == TOKEN_NEQ) {
-                    ASTNode *l = bin->left;
-                    ASTNode *r = bin->right;
-                    if (l && l->type == NODE_CAST) l = ((CastNode*)l)->operand;
-                    if (l && l->type == NODE_BEING) l = ((BeingNode*)l)->operand;
-                    if (r && r->type == NODE_CAST) r = ((CastNode*)r)->operand;
-                    if (r && r->type == NODE_BEING) r = ((BeingNode*)r)->operand;
-
-                    if (l && r && l->type == NODE_TYPEOF && r->type == NODE_TYPEOF) {
-                        SizeOfNode *sl = (SizeOfNode*)l;
-                        SizeOfNode *sr = (SizeOfNode*)r;
-                        VarType tl = sl->target_type.base != TYPE_UNKNOWN ? sl->target_type : sem_get_node_type(ctx, sl->operand);
-                        VarType tr = sr->target_type.base != TYPE_UNKNOWN ? sr->target_type : sem_get_node_type(ctx, sr->operand);
-                        cond_val = (sem_types_are_equal(tl, tr) || sem_types_are_compatible(ctx, tl, tr)) ? 1 : 0;
-                        if (bin->op == TOKEN_NEQ) cond_val = 1 - cond_val;
-                    }
+            while (ifn) {
+                ctx->current_node = (ASTNode*)ifn;
+                if (ifn->base.filename) ctx->current_filename = ifn->base.filename;
+                sem_check_expr(ctx, ifn->condition);
+                if (sem_get_node_type(ctx, ifn->condition).is_tainted) {
+                    sem_error(ctx, ifn->condition, "Condition is tainted");
+                    sem_emit_fallback_hint(ctx, ifn->condition);
                 }
-            }
 
-            if (cond_val == -1 || cond_val == 1) {
-                sem_scope_enter(ctx, 0, (VarType){0});
-                sem_check_block(ctx, ifn->then_body);
-                sem_scope_exit(ctx);
-            }
+                int cond_val = sem_static_condition(ctx, ifn->condition);
+                if (cond_val == -1 || cond_val == 1) {
+                    sem_scope_enter(ctx, 0, (VarType){0});
+                    sem_check_block(ctx, ifn->then_body);
+                    sem_scope_exit(ctx);
+                }
 
-            if (ifn->else_body && (cond_val == -1 || cond_val == 0)) {
-                sem_scope_enter(ctx, 0, (VarType){0});
-                if (ifn->else_body->type == NODE_IF) {
-                    sem_check_node(ctx, ifn->else_body);
-                } else {
-                    sem_check_block(ctx, ifn->else_body);
+                ASTNode *else_body = ifn->else_body;
+                ifn = NULL;
+                if (!else_body || cond_val == 1) break;
+                if (else_body->type == NODE_IF && !else_body->next && !else_body->is_macro_arg) {
+                    ifn = (IfNode*)else_body;
+                    continue;
                 }
+                sem_scope_enter(ctx, 0, (VarType){0});
+                sem_check_block(ctx, else_body);
                 sem_scope_exit(ctx);
             }
             break;
@@ -0,0 +1,552 @@
+/**
+ * @file incremental.c
+ * @brief Declaration dependency tracking for in-process recompilation.
+ *
+ * Hosts that keep one SemanticCtx alive across compilations (ethyl's REPL,
+ * metalir module loading) would otherwise re-scan and re-check every
+ * top-level declaration, including each re-imported std module, on every
+ * round. Instead, each top-level declaration gets a record holding a source
+ * fingerprint, the names it declared and the names it looked up while being
+ * scanned and checked (symbols, class layouts and templates are all resolved
+ * by name). Every name is stamped with the recompilation that last
+ * re-declared it. A declaration is reused when its fingerprint is unchanged
+ * and none of the names it used was stamped after it was checked; anything it
+ * depends on transitively is covered because a re-checked declaration stamps
+ * the names it provides in turn.
+ *
+ * Reuse is done by splicing the previously checked node back into the new
+ * program, so its symbols, type table entries and effect summaries from the
+ * last round stay valid for ALIR generation.
+ */
+#include "semantic.h"
+#include <stdint.h>
+
+/**
+ * @brief Remembers where the last line lookup stopped in a source buffer.
+ */
+typedef struct DeclCursor {
+    const char *src;
+    const char *pos;
+    int line;
+} DeclCursor;
+
+/**
+ * @brief Appends a pointer to an arena-backed growable array.
+ * @param arena The arena.
+ * @param items The array; reallocated when full.
+ * @param count Number of items; updated.
+ * @param cap Capacity; updated.
+ * @param item The item to append.
+ */
+static void decl_push(Arena *arena, void ***items, int *count, int *cap, void *item) {
+    if (*count == *cap) {
+        int new_cap = *cap ? *cap * 2 : 8;
+        void **grown = arena_alloc(arena, sizeof(void*) * new_cap);
+        if (*count) memcpy(grown, *items, sizeof(void*) * (*count));
+        *items = grown;
+        *cap = new_cap;
+    }
+    (*items)[(*count)++] = item;
+}
+
+/**
+ * @brief Folds bytes into an FNV-1a hash.
+ * @param h The running hash.
+ * @param p The bytes.
+ * @param n Number of bytes.
+ * @return The updated hash.
+ */
+static unsigned long long decl_hash_bytes(unsigned long long h, const char *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Returns the start of a source line, scanning forward from the cursor.
+ * @param cur The cursor; moved to the returned line.
+ * @param src The source buffer.
+ * @param line The 1-based line.
+ * @return Pointer to the first character of the line (or the buffer end).
+ */
+static const char* decl_line_start(DeclCursor *cur, const char *src, int line) {
+    if (cur->src != src || line < cur->line) {
+        cur->src = src;
+        cur->pos = src;
+        cur->line = 1;
+    }
+    while (cur->line < line && *cur->pos) {
+        if (*cur->pos == '\n') cur->line++;
+        cur->pos++;
+    }
+    return cur->pos;
+}
+
+/**
+ * @brief Returns the source position of a node, clamped to the end of its line.
+ * @param cur The line cursor.
+ * @param node The node.
+ * @return Pointer into the node's source.
+ */
+static const char* decl_node_start(DeclCursor *cur, ASTNode *node) {
+    const char *p = decl_line_start(cur, node->source, node->line);
+    for (int col = 1; col < node->col && *p && *p != '\n'; col++) p++;
+    return p;
+}
+
+/**
+ * @brief Fingerprints a top-level declaration.
+ *
+ * The emitted AST covers modifiers and structure, but skips node types the
+ * emitter does not know; the source text up to the next declaration of the
+ * same file covers those.
+ *
+ * @param node The declaration.
+ * @param cur Line cursor over the declaration's source.
+ * @return The fingerprint.
+ */
+static unsigned long long decl_fingerprint(ASTNode *node, DeclCursor *cur) {
+    unsigned long long h = 1469598103934665603ULL;
+
+    StringBuilder sb;
+    sb_init(&sb, NULL);
+    parser_emit_ast_node(&sb, node, 0);
+    if (sb.data) h = decl_hash_bytes(h, sb.data, sb.len);
+    sb_free(&sb);
+
+    // Columns keep declarations sharing a line (as REPL input does) apart
+    if (node->source && node->line > 0) {
+        const char *start = decl_node_start(cur, node);
+        const char *end = NULL;
+        ASTNode *next = node->next;
+        if (next && next->source == node->source && next->line > 0) {
+            end = decl_node_start(cur, next);
+            if (end <= start) end = strchr(start, '\n');
+        }
+        if (!end) end = start + strlen(start);
+        h = decl_hash_bytes(h, start, end - start);
+    }
+    return h;
+}
+
+/**
+ * @brief Returns the name a top-level node declares.
+ * @param node The node.
+ * @return The name, or NULL.
+ */
+static const char* decl_name(ASTNode *node) {
+    switch (node->type) {
+        case NODE_FUNC_DEF: return ((FuncDefNode*)node)->name;
+        case NODE_CLASS: return ((ClassNode*)node)->name;
+        case NODE_VAR_DECL: return ((VarDeclNode*)node)->name;
+        case NODE_NAMESPACE: return ((NamespaceNode*)node)->name;
+        case NODE_ENUM: return ((EnumNode*)node)->name;
+        default: return NULL;
+    }
+}
+
+/**
+ * @brief Whether a top-level node can be reused across recompilations.
+ *
+ * Statements and imports without a namespace are re-checked every round.
+ *
+ * @param node The node.
+ * @return Non-zero if the node gets a declaration record.
+ */
+static int decl_is_tracked(ASTNode *node) {
+    switch (node->type) {
+        case NODE_FUNC_DEF:
+        case NODE_CLASS:
+        case NODE_VAR_DECL:
+        case NODE_NAMESPACE:
+        case NODE_ENUM:
+        case NODE_COMPOUND:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Stamps the names a fresh declaration will declare as changed.
+ * @param stamps Name -> generation map.
+ * @param node The declaration.
+ * @param generation The current recompilation.
+ */
+static void decl_mark_dirty(HashMap *stamps, ASTNode *node, int generation) {
+    const char *name = decl_name(node);
+    if (name) hashmap_put(stamps, name, (void*)(intptr_t)generation);
+
+    ASTNode *body = NULL;
+    if (node->type == NODE_NAMESPACE) body = ((NamespaceNode*)node)->body;
+    else if (node->type == NODE_COMPOUND) body = ((CompoundNode*)node)->body;
+    for (; body; body = body->next) decl_mark_dirty(stamps, body, generation);
+}
+
+/**
+ * @brief Stamps the names a previous declaration record declared as changed.
+ * @param stamps Name -> generation map.
+ * @param d The record.
+ * @param generation The current recompilation.
+ */
+static void decl_mark_provides_dirty(HashMap *stamps, SemDecl *d, int generation) {
+    for (int i = 0; i < d->provide_count; i++) {
+        hashmap_put(stamps, d->provides[i], (void*)(intptr_t)generation);
+    }
+}
+
+/**
+ * @brief Whether a declaration looked up a name re-declared since it was checked.
+ * @param d The record.
+ * @param stamps Name -> generation map.
+ * @return Non-zero if it must be re-checked.
+ */
+static int decl_uses_dirty(SemDecl *d, HashMap *stamps) {
+    for (int i = 0; i < d->use_count; i++) {
+        if ((intptr_t)hashmap_get(stamps, d->uses[i]) > d->generation) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reports what happens to a declaration record this round.
+ *
+ * Printed when incremental_trace is set (also in release builds), otherwise
+ * a semantic debug line.
+ *
+ * @param ctx The semantic context.
+ * @param what "reusing", "checking" or "dropping".
+ * @param key The record key.
+ */
+static void decl_trace(SemanticCtx *ctx, const char *what, const char *key) {
+    if (ctx->settings.incremental_trace) {
+        fprintf(stderr, "incremental: %s '%s'\n", what, key);
+    } else {
+        debug_semantic("incremental: %s '%s'\n", what, key);
+    }
+}
+
+/**
+ * @brief Returns the file a declaration record came from.
+ * @param d The record.
+ * @return The file name, or "".
+ */
+static const char* decl_file(SemDecl *d) {
+    return d->node && d->node->filename ? d->node->filename : "";
+}
+
+/**
+ * @brief Removes the global symbols a deleted declaration added.
+ * @param ctx The semantic context.
+ * @param d The record.
+ */
+static void decl_forget_symbols(SemanticCtx *ctx, SemDecl *d) {
+    SemScope *scope = ctx->global_scope;
+    if (!scope) return;
+    for (int k = 0; k < d->symbol_count; k++) {
+        SemSymbol *sym = d->symbols[k];
+        for (SemSymbol **link = &scope->symbols; *link; link = &(*link)->next) {
+            if (*link != sym) continue;
+            *link = sym->next;
+            if (ctx->symbol_index_head == sym) ctx->symbol_index_head = sym->next;
+            break;
+        }
+        if (!scope->symbol_map) continue;
+
+        // Overloads hang off the first symbol of a name
+        HashMap *map = (HashMap*)scope->symbol_map;
+        SemSymbol *head = hashmap_get(map, sym->name);
+        if (head == sym) {
+            hashmap_put(map, sym->name, sym->overload_next);
+        } else {
+            for (SemSymbol *o = head; o; o = o->overload_next) {
+                if (o->overload_next != sym) continue;
+                o->overload_next = sym->overload_next;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Drops the records of declarations deleted since the last recompilation.
+ *
+ * A record is deleted when the program resubmits other declarations that
+ * came with it (same file, last seen in the same recompilation) but not the
+ * record itself. A REPL line that only adds declarations keeps the earlier
+ * ones. Names the deleted declaration provided are stamped so its
+ * dependents are checked again, and its global symbols are removed so they
+ * fail to resolve.
+ *
+ * @param ctx The semantic context.
+ * @param prev Records of this program's declarations (NULL for new ones).
+ * @param n Number of entries in prev.
+ * @param scratch Arena for temporary keys.
+ * @param generation The current recompilation.
+ */
+static void decl_drop_deleted(SemanticCtx *ctx, SemDecl **prev, int n, Arena *scratch, int generation) {
+    HashMap units;
+    hashmap_init(&units, scratch, 16);
+    char unit[512];
+    for (int i = 0; i < n; i++) {
+        if (!prev[i]) continue;
+        snprintf(unit, sizeof(unit), "%s|%d", decl_file(prev[i]), prev[i]->seen);
+        hashmap_put(&units, unit, (void*)1);
+    }
+    for (int i = 0; i < n; i++) {
+        if (prev[i]) prev[i]->seen = generation;
+    }
+
+    HashMap *map = (HashMap*)ctx->decl_map;
+    SemDecl **link = &ctx->decl_all;
+    while (*link) {
+        SemDecl *d = *link;
+        // Records replaced by a re-checked declaration leave the list here
+        if (hashmap_get(map, d->key) != d) {
+            *link = d->all_next;
+            continue;
+        }
+        snprintf(unit, sizeof(unit), "%s|%d", decl_file(d), d->seen);
+        if (d->seen != generation && hashmap_has(&units, unit)) {
+            decl_trace(ctx, "dropping", d->key);
+            decl_mark_provides_dirty((HashMap*)ctx->decl_stamps, d, generation);
+            decl_forget_symbols(ctx, d);
+            hashmap_put(map, d->key, NULL);
+            *link = d->all_next;
+            continue;
+        }
+        link = &d->all_next;
+    }
+}
+
+/**
+ * @brief Splices previously checked declarations back into a new program.
+ * @param ctx The semantic context.
+ * @param root The program; its head may be replaced.
+ */
+void sem_incremental_prepare(SemanticCtx *ctx, ASTNode **root) {
+    if (!ctx->incremental || !root || !*root) return;
+    if (!ctx->compiler_ctx || !ctx->compiler_ctx->arena) return;
+    Arena *arena = ctx->compiler_ctx->arena;
+
+    if (!ctx->decl_map) {
+        ctx->decl_map = arena_alloc_type(arena, HashMap);
+        hashmap_init((HashMap*)ctx->decl_map, arena, 64);
+        ctx->decl_stamps = arena_alloc_type(arena, HashMap);
+        hashmap_init((HashMap*)ctx->decl_stamps, arena, 64);
+    }
+    int generation = ++ctx->decl_generation;
+    HashMap *stamps = (HashMap*)ctx->decl_stamps;
+    ctx->decl_nodes = arena_alloc_type(arena, HashMap);
+    hashmap_init((HashMap*)ctx->decl_nodes, arena, 64);
+    ctx->decl_reused = arena_alloc_type(arena, HashMap);
+    hashmap_init((HashMap*)ctx->decl_reused, arena, 64);
+    ctx->decl_round = NULL;
+
+    Arena scratch;
+    arena_init(&scratch);
+
+    int n = 0;
+    for (ASTNode *node = *root; node; node = node->next) n++;
+    char **keys = arena_alloc(&scratch, sizeof(char*) * n);
+    unsigned long long *hashes = arena_alloc(&scratch, sizeof(unsigned long long) * n);
+    SemDecl **prev = arena_alloc(&scratch, sizeof(SemDecl*) * n);
+    int *changed = arena_alloc(&scratch, sizeof(int) * n);
+
+    HashMap ordinals;
+    hashmap_init(&ordinals, &scratch, 64);
+    DeclCursor cur = {0};
+
+    // Fingerprint every declaration and compare with the last round
+    int i = 0;
+    for (ASTNode *node = *root; node; node = node->next, i++) {
+        keys[i] = NULL;
+        prev[i] = NULL;
+        changed[i] = 1;
+        if (!decl_is_tracked(node)) continue;
+
+        const char *name = decl_name(node);
+        char key[512];
+        snprintf(key, sizeof(key), "%d|%s|%s", node->type, name ? name : "", node->filename ? node->filename : "");
+        int ordinal = hashmap_inc(&ordinals, key);
+        size_t len = strlen(key);
+        snprintf(key + len, sizeof(key) - len, "|%d", ordinal);
+
+        keys[i] = arena_strdup(&scratch, key);
+        hashes[i] = decl_fingerprint(node, &cur);
+        prev[i] = hashmap_get((HashMap*)ctx->decl_map, key);
+        changed[i] = !prev[i] || prev[i]->had_errors || prev[i]->hash != hashes[i];
+        if (changed[i]) {
+            decl_mark_dirty(stamps, node, generation);
+            if (prev[i]) decl_mark_provides_dirty(stamps, prev[i], generation);
+        }
+    }
+
+    decl_drop_deleted(ctx, prev, n, &scratch, generation);
+
+    // Anything that used a re-declared name is re-checked, and re-declares its own names
+    int progress = 1;
+    while (progress) {
+        progress = 0;
+        for (i = 0; i < n; i++) {
+            if (changed[i] || !decl_uses_dirty(prev[i], stamps)) continue;
+            changed[i] = 1;
+            decl_mark_provides_dirty(stamps, prev[i], generation);
+            progress = 1;
+        }
+    }
+
+    ASTNode **link = root;
+    for (i = 0; i < n; i++) {
+        ASTNode *node = *link;
+        char ptr_key[32];
+        if (keys[i] && !changed[i]) {
+            SemDecl *d = prev[i];
+            d->node->next = node->next;
+            *link = d->node;
+            snprintf(ptr_key, sizeof(ptr_key), "%p", (void*)d->node);
+            hashmap_put((HashMap*)ctx->decl_reused, ptr_key, d->node);
+            decl_trace(ctx, "reusing", keys[i]);
+        } else if (keys[i]) {
+            SemDecl *d = arena_alloc_type(arena, SemDecl);
+            memset(d, 0, sizeof(SemDecl));
+            d->key = arena_strdup(arena, keys[i]);
+            d->hash = hashes[i];
+            d->node = node;
+            d->generation = generation;
+            d->seen = generation;
+            d->use_set = arena_alloc_type(arena, HashMap);
+            hashmap_init((HashMap*)d->use_set, arena, 16);
+            d->round_next = ctx->decl_round;
+            ctx->decl_round = d;
+            d->all_next = ctx->decl_all;
+            ctx->decl_all = d;
+            hashmap_put((HashMap*)ctx->decl_map, d->key, d);
+            snprintf(ptr_key, sizeof(ptr_key), "%p", (void*)node);
+            hashmap_put((HashMap*)ctx->decl_nodes, ptr_key, d);
+            decl_trace(ctx, "checking", keys[i]);
+        }
+        link = &(*link)->next;
+    }
+
+    // Template instantiations made by reused declarations are not made again
+    for (i = 0; i < n; i++) {
+        if (!keys[i] || changed[i]) continue;
+        SemDecl *d = prev[i];
+        for (int k = 0; k < d->extra_count; k++) {
+            ASTNode *extra = d->extras[k];
+            char ptr_key[32];
+            snprintf(ptr_key, sizeof(ptr_key), "%p", (void*)extra);
+            if (hashmap_has((HashMap*)ctx->decl_reused, ptr_key)) continue;
+            hashmap_put((HashMap*)ctx->decl_reused, ptr_key, extra);
+            extra->next = NULL;
+            *link = extra;
+            link = &extra->next;
+        }
+    }
+
+    arena_free(&scratch);
+}
+
+/**
+ * @brief Records the errors of the finished recompilation.
+ * @param ctx The semantic context.
+ * @param error_count Errors reported by this recompilation.
+ */
+void sem_incremental_finish(SemanticCtx *ctx, int error_count) {
+    ctx->current_decl = NULL;
+    ctx->decl_scanning = 0;
+    if (!ctx->incremental) return;
+
+    // Errors are not attributed to declarations, so none of them is trusted
+    if (error_count > 0) {
+        for (SemDecl *d = ctx->decl_round; d; d = d->round_next) d->had_errors = 1;
+    }
+    ctx->decl_round = NULL;
+}
+
+/**
+ * @brief Returns the declaration record created for a top-level node.
+ * @param ctx The semantic context.
+ * @param node The top-level node.
+ * @return The record, or NULL.
+ */
+SemDecl* sem_decl_for(SemanticCtx *ctx, ASTNode *node) {
+    if (!ctx->incremental || !ctx->decl_nodes || !node) return NULL;
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)node);
+    return hashmap_get((HashMap*)ctx->decl_nodes, key);
+}
+
+/**
+ * @brief Whether a top-level node was reused from the last recompilation.
+ * @param ctx The semantic context.
+ * @param node The top-level node.
+ * @return Non-zero if reused.
+ */
+int sem_decl_is_reused(SemanticCtx *ctx, ASTNode *node) {
+    if (!ctx->incremental || !ctx->decl_reused || !node) return 0;
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)node);
+    return hashmap_has((HashMap*)ctx->decl_reused, key);
+}
+
+/**
+ * @brief Records that the current declaration looked up a name.
+ * @param ctx The semantic context.
+ * @param name The (possibly dotted) name; only the outermost part is kept.
+ */
+void sem_decl_note_use(SemanticCtx *ctx, const char *name) {
+    SemDecl *d = ctx->current_decl;
+    if (!d || !name) return;
+
+    char base[256];
+    const char *dot = strchr(name, '.');
+    size_t len = dot ? (size_t)(dot - name) : strlen(name);
+    if (len >= sizeof(base)) len = sizeof(base) - 1;
+    memcpy(base, name, len);
+    base[len] = '\0';
+
+    if (hashmap_has((HashMap*)d->use_set, base)) return;
+    hashmap_put((HashMap*)d->use_set, base, (void*)1);
+    decl_push(ctx->compiler_ctx->arena, (void***)&d->uses, &d->use_count, &d->use_cap,
+              arena_strdup(ctx->compiler_ctx->arena, base));
+}
+
+/**
+ * @brief Records that the current declaration declared a name.
+ * @param ctx The semantic context.
+ * @param name The declared name.
+ */
+void sem_decl_note_provide(SemanticCtx *ctx, const char *name) {
+    SemDecl *d = ctx->current_decl;
+    if (!d || !ctx->decl_scanning || !name) return;
+    decl_push(ctx->compiler_ctx->arena, (void***)&d->provides, &d->provide_count, &d->provide_cap,
+              arena_strdup(ctx->compiler_ctx->arena, name));
+}
+
+/**
+ * @brief Records a global symbol the current declaration added.
+ * @param ctx The semantic context.
+ * @param sym The symbol.
+ */
+void sem_decl_note_symbol(SemanticCtx *ctx, SemSymbol *sym) {
+    SemDecl *d = ctx->current_decl;
+    if (!d || !ctx->decl_scanning || !sym) return;
+    decl_push(ctx->compiler_ctx->arena, (void***)&d->symbols, &d->symbol_count, &d->symbol_cap, sym);
+}
+
+/**
+ * @brief Records the nodes appended to the program while checking a declaration.
+ * @param ctx The semantic context.
+ * @param decl The declaration being checked.
+ * @param first The first appended node, or NULL.
+ */
+void sem_decl_note_extras(SemanticCtx *ctx, SemDecl *decl, ASTNode *first) {
+    if (!decl) return;
+    for (ASTNode *node = first; node; node = node->next) {
+        decl_push(ctx->compiler_ctx->arena, (void***)&decl->extras, &decl->extra_count, &decl->extra_cap, node);
+    }
+}
@@ -57,6 +57,7 @@ int sem_lookup_class_call(SemanticCtx *ctx, MethodCallNode *node) {
         if (current_class->inner_scope && current_class->inner_scope->symbol_map) {
             SemSymbol *member = hashmap_get((HashMap*)current_class->inner_scope->symbol_map, node->method_name);
             if (member) {
+                    sem_record_call(ctx, member, (ASTNode*)node);
                     if (ctx->current_func_sym && ctx->current_func_sym->is_pure) {
                         if (member->kind == SYM_FUNC && !member->is_pure) {
                             if (ctx->current_func_sym->must_pure) sem_error(ctx, (ASTNode*)node, "Pure function '%s' cannot call impure method '%s'", ctx->current_func_sym->name, member->name);
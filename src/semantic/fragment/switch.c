@@ -218,6 +218,8 @@ void sem_check_var_ref(SemanticCtx *ctx, ASTNode *node) {
     }
 
     sem_error(ctx, node, "Undefined variable '%s'", ref->name);
+    const char *suggestion = sem_suggest_symbol(ctx, ref->name);
+    if (suggestion) sem_hint(ctx, node, "Did you mean '%s'?", suggestion);
     sem_set_node_type(ctx, node, (VarType){TYPE_UNKNOWN, 0, NULL, 0, 0, NULL, NULL, 0, 0, 0, 0});
 }
 
@@ -0,0 +1,229 @@
+/**
+ * @file effect.c
+ * @brief Effect summary inference over the call graph.
+ *
+ * While checking, each function body downgrades its own symbol when it does
+ * something impure or partial, and every call is recorded as an edge. A call
+ * to a function whose body has not been checked yet cannot see the callee's
+ * final summary, so the summaries are settled afterwards: the call graph is
+ * split into strongly connected components, which are solved callee-first with
+ * a small fixed point inside each component.
+ */
+#include "effect.h"
+#include <stdint.h>
+
+/**
+ * @brief Records a call from the function being checked to a callee.
+ * @param ctx The semantic context.
+ * @param callee The called symbol.
+ * @param site The call node.
+ */
+void sem_record_call(SemanticCtx *ctx, SemSymbol *callee, ASTNode *site) {
+    if (!ctx->current_func_sym || !callee || callee->kind != SYM_FUNC) return;
+    if (!ctx->compiler_ctx || !ctx->compiler_ctx->arena) return;
+
+    SemCallEdge *e = arena_alloc_type(ctx->compiler_ctx->arena, SemCallEdge);
+    e->caller = ctx->current_func_sym;
+    e->callee = callee;
+    e->site = site;
+    e->next = ctx->call_edges;
+    ctx->call_edges = e;
+}
+
+/**
+ * @brief Associates a checked function definition with its symbol.
+ * @param ctx The semantic context.
+ * @param fd The function definition.
+ * @param sym The function symbol.
+ */
+void sem_effect_register(SemanticCtx *ctx, FuncDefNode *fd, SemSymbol *sym) {
+    if (!fd || !sym || !ctx->compiler_ctx || !ctx->compiler_ctx->arena) return;
+    if (!ctx->effect_map) {
+        ctx->effect_map = arena_alloc_type(ctx->compiler_ctx->arena, HashMap);
+        hashmap_init((HashMap*)ctx->effect_map, ctx->compiler_ctx->arena, 64);
+    }
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)fd);
+    hashmap_put((HashMap*)ctx->effect_map, key, sym);
+}
+
+/**
+ * @brief Returns the symbol holding the effect summary of a function definition.
+ * @param ctx The semantic context.
+ * @param fd The function definition.
+ * @return The symbol, or NULL.
+ */
+SemSymbol* sem_effect_lookup(SemanticCtx *ctx, FuncDefNode *fd) {
+    if (!ctx || !fd || !ctx->effect_map) return NULL;
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)fd);
+    return hashmap_get((HashMap*)ctx->effect_map, key);
+}
+
+/**
+ * @brief Returns the graph index of a symbol, adding it if needed.
+ * @param index_map Symbol pointer -> (index + 1).
+ * @param nodes Node array with room for every possible symbol.
+ * @param count Number of nodes so far; updated.
+ * @param sym The symbol.
+ * @return The node index.
+ */
+static int effect_node_index(HashMap *index_map, SemSymbol **nodes, int *count, SemSymbol *sym) {
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)sym);
+    intptr_t idx = (intptr_t)hashmap_get(index_map, key);
+    if (idx) return (int)idx - 1;
+    nodes[*count] = sym;
+    hashmap_put(index_map, key, (void*)(intptr_t)(*count + 1));
+    return (*count)++;
+}
+
+/**
+ * @brief Whether calling a symbol keeps the caller pure.
+ *
+ * Macro bodies are only checked once expanded during ALIR generation, after
+ * the summaries are final, so a macro counts as pure only when declared so.
+ *
+ * @param callee The called symbol.
+ * @return Non-zero if the call is pure.
+ */
+static int effect_call_is_pure(SemSymbol *callee) {
+    if (callee->is_macro) return callee->must_pure;
+    return callee->is_pure;
+}
+
+/**
+ * @brief Propagates callee effects into the members of one component until stable.
+ * @param ctx The semantic context.
+ * @param members Node indices of the component.
+ * @param member_count Number of members.
+ * @param nodes Node symbols.
+ * @param out_start CSR offsets into out_edges.
+ * @param out_edges Outgoing edges grouped by caller.
+ */
+static void effect_solve_component(SemanticCtx *ctx, int *members, int member_count, SemSymbol **nodes, int *out_start, SemCallEdge **out_edges) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int m = 0; m < member_count; m++) {
+            int f = members[m];
+            SemSymbol *caller = nodes[f];
+            for (int k = out_start[f]; k < out_start[f + 1]; k++) {
+                SemCallEdge *e = out_edges[k];
+                SemSymbol *callee = e->callee;
+                if (caller->is_pure && !effect_call_is_pure(callee)) {
+                    if (caller->must_pure) {
+                        sem_error(ctx, e->site, "Pure function '%s' cannot call impure function '%s'", caller->name, callee->name);
+                    }
+                    debug_semantic("effects: '%s' is impure through '%s'\n", caller->name, callee->name);
+                    caller->is_pure = false;
+                    changed = 1;
+                }
+                if (caller->is_total && !callee->is_total) {
+                    if (caller->must_total) {
+                        sem_error(ctx, e->site, "Total function '%s' cannot call partial function '%s'", caller->name, callee->name);
+                    }
+                    debug_semantic("effects: '%s' is partial through '%s'\n", caller->name, callee->name);
+                    caller->is_total = false;
+                    changed = 1;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Finalizes pure/total summaries over the recorded call graph.
+ * @param ctx The semantic context.
+ */
+void sem_infer_effects(SemanticCtx *ctx) {
+    if (!ctx->call_edges || !ctx->compiler_ctx || !ctx->compiler_ctx->arena) return;
+    Arena *arena = ctx->compiler_ctx->arena;
+
+    int edge_count = 0;
+    for (SemCallEdge *e = ctx->call_edges; e; e = e->next) edge_count++;
+
+    // Number the functions and lay the edges out grouped by caller
+    HashMap index_map;
+    hashmap_init(&index_map, arena, 64);
+    SemSymbol **nodes = arena_alloc(arena, sizeof(SemSymbol*) * edge_count * 2);
+    int *edge_from = arena_alloc(arena, sizeof(int) * edge_count);
+    int *edge_to = arena_alloc(arena, sizeof(int) * edge_count);
+    int n = 0;
+    int i = 0;
+    for (SemCallEdge *e = ctx->call_edges; e; e = e->next, i++) {
+        edge_from[i] = effect_node_index(&index_map, nodes, &n, e->caller);
+        edge_to[i] = effect_node_index(&index_map, nodes, &n, e->callee);
+    }
+
+    int *out_start = arena_alloc(arena, sizeof(int) * (n + 1));
+    int *fill = arena_alloc(arena, sizeof(int) * (n + 1));
+    int *out_to = arena_alloc(arena, sizeof(int) * edge_count);
+    SemCallEdge **out_edges = arena_alloc(arena, sizeof(SemCallEdge*) * edge_count);
+    memset(out_start, 0, sizeof(int) * (n + 1));
+    for (i = 0; i < edge_count; i++) out_start[edge_from[i] + 1]++;
+    for (i = 0; i < n; i++) out_start[i + 1] += out_start[i];
+    memcpy(fill, out_start, sizeof(int) * (n + 1));
+    i = 0;
+    for (SemCallEdge *e = ctx->call_edges; e; e = e->next, i++) {
+        int slot = fill[edge_from[i]]++;
+        out_edges[slot] = e;
+        out_to[slot] = edge_to[i];
+    }
+
+    // Iterative Tarjan: components come out callee-first
+    int *order = arena_alloc(arena, sizeof(int) * n);
+    int *low = arena_alloc(arena, sizeof(int) * n);
+    int *on_stack = arena_alloc(arena, sizeof(int) * n);
+    int *scc_stack = arena_alloc(arena, sizeof(int) * n);
+    int *call_stack = arena_alloc(arena, sizeof(int) * n);
+    int *next_edge = arena_alloc(arena, sizeof(int) * n);
+    memset(order, 0, sizeof(int) * n);
+    memset(on_stack, 0, sizeof(int) * n);
+    int counter = 0, scc_top = 0;
+
+    for (int root = 0; root < n; root++) {
+        if (order[root]) continue;
+        int call_top = 0;
+        call_stack[call_top++] = root;
+        order[root] = low[root] = ++counter;
+        next_edge[root] = out_start[root];
+        scc_stack[scc_top++] = root;
+        on_stack[root] = 1;
+
+        while (call_top > 0) {
+            int v = call_stack[call_top - 1];
+            if (next_edge[v] < out_start[v + 1]) {
+                int w = out_to[next_edge[v]++];
+                if (!order[w]) {
+                    order[w] = low[w] = ++counter;
+                    next_edge[w] = out_start[w];
+                    scc_stack[scc_top++] = w;
+                    on_stack[w] = 1;
+                    call_stack[call_top++] = w;
+                } else if (on_stack[w] && order[w] < low[v]) {
+                    low[v] = order[w];
+                }
+                continue;
+            }
+
+            call_top--;
+            if (call_top > 0) {
+                int parent = call_stack[call_top - 1];
+                if (low[v] < low[parent]) low[parent] = low[v];
+            }
+            if (low[v] == order[v]) {
+                int start = scc_top;
+                do {
+                    start--;
+                    on_stack[scc_stack[start]] = 0;
+                } while (scc_stack[start] != v);
+                effect_solve_component(ctx, scc_stack + start, scc_top - start, nodes, out_start, out_edges);
+                scc_top = start;
+            }
+        }
+    }
+
+    // Every recorded call has been folded into the summaries
+    ctx->call_edges = NULL;
+}
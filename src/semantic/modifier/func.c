@@ -54,6 +54,7 @@ void sem_check_method_call(SemanticCtx *ctx, MethodCallNode *node) {
                 }
             }
             if (member) {
+                    sem_record_call(ctx, member, (ASTNode*)node);
                     if (ctx->current_func_sym && ctx->current_func_sym->is_pure) {
                         if (member->kind == SYM_FUNC && !member->is_pure) {
                             if (ctx->current_func_sym->must_pure) {
@@ -241,6 +242,7 @@ void sem_check_func_def(SemanticCtx *ctx, FuncDefNode *node) {
 
     SemSymbol *old_func = ctx->current_func_sym;
     ctx->current_func_sym = sem_symbol_lookup(ctx, node->name, NULL);
+    sem_effect_register(ctx, node, ctx->current_func_sym);
 
     if (node->class_name) {
         VarType this_type = {TYPE_CLASS, 1, arena_strdup(ctx->compiler_ctx->arena, node->class_name), 0, 0, NULL, NULL, 0, 0, 0, 0};
@@ -377,6 +379,8 @@ void sem_check_call(SemanticCtx *ctx, CallNode *node) {
     if (!sym) {
         if (node->name) {
             sem_error(ctx, (ASTNode*)node, "Undefined function or class '%s'", node->name);
+            const char *suggestion = sem_suggest_symbol(ctx, node->name);
+            if (suggestion) sem_hint(ctx, (ASTNode*)node, "Did you mean '%s'?", suggestion);
         } else {
             debug_semantic("Cannot call non-function type at line %d col %d, node type %d, target type %d\n", node->base.line, node->base.col, node->base.type, node->target ? (int)node->target->type : -1); sem_error(ctx, (ASTNode*)node, "Cannot call non-function type");
         }
@@ -384,6 +388,7 @@ void sem_check_call(SemanticCtx *ctx, CallNode *node) {
         return;
     }
 
+    sem_record_call(ctx, sym, (ASTNode*)node);
     if (ctx->current_func_sym && ctx->current_func_sym->is_pure) {
         if (!sym->is_pure) {
             if (ctx->current_func_sym->must_pure) {
@@ -10,13 +10,66 @@
 #include <stdint.h>
 
 /**
- * @brief Compute a hash bucket index for an AST node pointer.
+ * @brief Compute a hash for an AST node pointer.
  * @param node AST node pointer to hash.
- * @return Unsigned bucket index.
+ * @return Unsigned hash; callers mask it down to their bucket count.
  */
 unsigned int hash_ptr(ASTNode *node) {
     uintptr_t ptr_val = (uintptr_t)node;
-    return (unsigned int)((ptr_val >> 3) % TYPE_TABLE_SIZE);
+    return (unsigned int)((ptr_val >> 3) ^ (ptr_val >> 17));
+}
+
+/**
+ * @brief Find the type table entry recorded for an AST node.
+ * @param ctx Semantic context.
+ * @param node AST node to look up.
+ * @return The entry, or NULL if the node has none.
+ */
+static TypeEntry* type_entry_find(SemanticCtx *ctx, ASTNode *node) {
+    if (!ctx->type_buckets) return NULL;
+    TypeEntry *curr = ctx->type_buckets[hash_ptr(node) & (ctx->type_bucket_count - 1)];
+    while (curr) {
+        if (curr->node == node) return curr;
+        curr = curr->next;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Make room for one more type table entry.
+ *
+ * The table starts at TYPE_TABLE_SIZE buckets and doubles whenever it holds
+ * twice as many entries as buckets, so lookups stay constant time no matter
+ * how many expressions a program has.
+ *
+ * @param ctx Semantic context; must have an arena.
+ */
+static void type_table_reserve(SemanticCtx *ctx) {
+    Arena *arena = ctx->compiler_ctx->arena;
+    if (!ctx->type_buckets) {
+        ctx->type_bucket_count = TYPE_TABLE_SIZE;
+        ctx->type_entry_count = 0;
+        ctx->type_buckets = arena_alloc(arena, sizeof(TypeEntry*) * ctx->type_bucket_count);
+        memset(ctx->type_buckets, 0, sizeof(TypeEntry*) * ctx->type_bucket_count);
+        return;
+    }
+    if (ctx->type_entry_count < ctx->type_bucket_count * 2) return;
+
+    unsigned int new_count = ctx->type_bucket_count * 2;
+    TypeEntry **new_buckets = arena_alloc(arena, sizeof(TypeEntry*) * new_count);
+    memset(new_buckets, 0, sizeof(TypeEntry*) * new_count);
+    for (unsigned int i = 0; i < ctx->type_bucket_count; i++) {
+        TypeEntry *curr = ctx->type_buckets[i];
+        while (curr) {
+            TypeEntry *next = curr->next;
+            unsigned int idx = hash_ptr(curr->node) & (new_count - 1);
+            curr->next = new_buckets[idx];
+            new_buckets[idx] = curr;
+            curr = next;
+        }
+    }
+    ctx->type_buckets = new_buckets;
+    ctx->type_bucket_count = new_count;
 }
 
 /**
@@ -28,21 +81,19 @@ unsigned int hash_ptr(ASTNode *node) {
 void sem_set_node_type(SemanticCtx *ctx, ASTNode *node, VarType type) {
     if (!node) return;
     node->sem_type = type;
-    unsigned int idx = hash_ptr(node);
 
-    TypeEntry *curr = ctx->type_buckets[idx];
-    while (curr) {
-        if (curr->node == node) {
-            if (type.base != TYPE_UNKNOWN) {
-                curr->type = type;
-            }
-            return;
+    TypeEntry *found = type_entry_find(ctx, node);
+    if (found) {
+        if (type.base != TYPE_UNKNOWN) {
+            found->type = type;
         }
-        curr = curr->next;
+        return;
     }
 
     if (!ctx->compiler_ctx || !ctx->compiler_ctx->arena) return;
 
+    type_table_reserve(ctx);
+    unsigned int idx = hash_ptr(node) & (ctx->type_bucket_count - 1);
     TypeEntry *entry = arena_alloc_type(ctx->compiler_ctx->arena, TypeEntry);
     entry->node = node;
     entry->type = type;
@@ -50,6 +101,7 @@ void sem_set_node_type(SemanticCtx *ctx, ASTNode *node, VarType type) {
     entry->is_impure = 0;
     entry->next = ctx->type_buckets[idx];
     ctx->type_buckets[idx] = entry;
+    ctx->type_entry_count++;
 }
 
 /**
@@ -62,21 +114,16 @@ VarType sem_get_node_type(SemanticCtx *ctx, ASTNode *node) {
     if (!node) return (VarType){TYPE_UNKNOWN, 0, NULL, 0, 0, NULL, NULL, 0, 0, 0, 0};
 
     VarType res = {TYPE_UNKNOWN, 0, NULL, 0, 0, NULL, NULL, 0, 0, 0, 0};
-    unsigned int idx = hash_ptr(node);
-    TypeEntry *curr = ctx->type_buckets[idx];
-    while (curr) {
-        if (curr->node == node && curr->type.base != TYPE_UNKNOWN) {
-            res = curr->type;
-            break;
-        }
-        curr = curr->next;
+    TypeEntry *found = type_entry_find(ctx, node);
+    if (found && found->type.base != TYPE_UNKNOWN) {
+        res = found->type;
     }
 
     if (res.base == TYPE_UNKNOWN && node->sem_type.base != TYPE_UNKNOWN) {
         res = node->sem_type;
     }
 
-    res.is_tainted = sem_get_node_tainted(ctx, node) || res.is_tainted;
+    res.is_tainted = (found && found->is_tainted) || res.is_tainted;
 
     return res;
 }
@@ -89,18 +136,12 @@ VarType sem_get_node_type(SemanticCtx *ctx, ASTNode *node) {
  */
 void sem_set_node_tainted(SemanticCtx *ctx, ASTNode *node, int is_tainted) {
     if (!node) return;
-    unsigned int idx = hash_ptr(node);
-    TypeEntry *curr = ctx->type_buckets[idx];
-    while (curr) {
-        if (curr->node == node) {
-            curr->is_tainted = is_tainted;
-            return;
-        }
-        curr = curr->next;
+    TypeEntry *found = type_entry_find(ctx, node);
+    if (!found) {
+        sem_set_node_type(ctx, node, (VarType){TYPE_UNKNOWN, 0, NULL, 0, 0, NULL, NULL, 0, 0, 0, 0});
+        found = type_entry_find(ctx, node);
     }
-
-    sem_set_node_type(ctx, node, (VarType){TYPE_UNKNOWN, 0, NULL, 0, 0, NULL, NULL, 0, 0, 0, 0});
-    ctx->type_buckets[idx]->is_tainted = is_tainted;
+    if (found) found->is_tainted = is_tainted;
 }
 
 /**
@@ -111,13 +152,8 @@ void sem_set_node_tainted(SemanticCtx *ctx, ASTNode *node, int is_tainted) {
  */
 int sem_get_node_tainted(SemanticCtx *ctx, ASTNode *node) {
     if (!node) return 0;
-    unsigned int idx = hash_ptr(node);
-    TypeEntry *curr = ctx->type_buckets[idx];
-    while (curr) {
-        if (curr->node == node) return curr->is_tainted;
-        curr = curr->next;
-    }
-    return 0;
+    TypeEntry *found = type_entry_find(ctx, node);
+    return found ? found->is_tainted : 0;
 }
 
 /**
@@ -128,18 +164,12 @@ int sem_get_node_tainted(SemanticCtx *ctx, ASTNode *node) {
  */
 void sem_set_node_impure(SemanticCtx *ctx, ASTNode *node, int is_impure) {
     if (!node) return;
-    unsigned int idx = hash_ptr(node);
-    TypeEntry *curr = ctx->type_buckets[idx];
-    while (curr) {
-        if (curr->node == node) {
-            curr->is_impure = is_impure;
-            return;
-        }
-        curr = curr->next;
+    TypeEntry *found = type_entry_find(ctx, node);
+    if (!found) {
+        sem_set_node_type(ctx, node, (VarType){TYPE_UNKNOWN, 0, NULL, 0, 0, NULL, NULL, 0, 0, 0, 0});
+        found = type_entry_find(ctx, node);
     }
-
-    sem_set_node_type(ctx, node, (VarType){TYPE_UNKNOWN, 0, NULL, 0, 0, NULL, NULL, 0, 0, 0, 0});
-    ctx->type_buckets[idx]->is_impure = is_impure;
+    if (found) found->is_impure = is_impure;
 }
 
 /**
@@ -150,13 +180,8 @@ void sem_set_node_impure(SemanticCtx *ctx, ASTNode *node, int is_impure) {
  */
 int sem_get_node_impure(SemanticCtx *ctx, ASTNode *node) {
     if (!node) return 0;
-    unsigned int idx = hash_ptr(node);
-    TypeEntry *curr = ctx->type_buckets[idx];
-    while (curr) {
-        if (curr->node == node) return curr->is_impure;
-        curr = curr->next;
-    }
-    return 0;
+    TypeEntry *found = type_entry_find(ctx, node);
+    return found ? found->is_impure : 0;
 }
 
 /**
@@ -219,10 +244,24 @@ void sem_init(SemanticCtx *ctx, CompilerContext *compiler_ctx, SemanticSettings
     ctx->in_switch = 0;
     ctx->current_source = NULL;
     ctx->current_filename = NULL;
-
-    for (int i = 0; i < TYPE_TABLE_SIZE; i++) {
-        ctx->type_buckets[i] = NULL;
-    }
+    ctx->call_edges = NULL;
+    ctx->effect_map = NULL;
+    ctx->symbol_index = NULL;
+    ctx->symbol_index_head = NULL;
+    ctx->incremental = 0;
+    ctx->decl_scanning = 0;
+    ctx->current_decl = NULL;
+    ctx->decl_round = NULL;
+    ctx->decl_all = NULL;
+    ctx->decl_generation = 0;
+    ctx->decl_stamps = NULL;
+    ctx->decl_map = NULL;
+    ctx->decl_nodes = NULL;
+    ctx->decl_reused = NULL;
+
+    ctx->type_buckets = NULL;
+    ctx->type_bucket_count = 0;
+    ctx->type_entry_count = 0;
 }
 
 /**
@@ -233,9 +272,21 @@ void sem_cleanup(SemanticCtx *ctx) {
     ctx->current_scope = NULL;
     ctx->global_scope = NULL;
     ctx->current_func_sym = NULL;
-    for (int i = 0; i < TYPE_TABLE_SIZE; i++) {
-        ctx->type_buckets[i] = NULL;
-    }
+    ctx->call_edges = NULL;
+    ctx->effect_map = NULL;
+    ctx->symbol_index = NULL;
+    ctx->symbol_index_head = NULL;
+    ctx->current_decl = NULL;
+    ctx->decl_round = NULL;
+    ctx->decl_all = NULL;
+    ctx->decl_generation = 0;
+    ctx->decl_stamps = NULL;
+    ctx->decl_map = NULL;
+    ctx->decl_nodes = NULL;
+    ctx->decl_reused = NULL;
+    ctx->type_buckets = NULL;
+    ctx->type_bucket_count = 0;
+    ctx->type_entry_count = 0;
 }
 
 /**
@@ -308,6 +359,11 @@ SemSymbol* sem_symbol_add(SemanticCtx *ctx, const char *name, SymbolKind kind, V
     sym->must_pristine = false;
     sym->inner_scope = NULL;
 
+    if (ctx->current_decl) sem_decl_note_provide(ctx, name);
+    if (ctx->current_decl && (!ctx->current_scope || ctx->current_scope == ctx->global_scope)) {
+        sem_decl_note_symbol(ctx, sym);
+    }
+
     if (ctx->current_scope) {
         sym->next = ctx->current_scope->symbols;
         ctx->current_scope->symbols = sym;
@@ -365,6 +421,7 @@ SemSymbol* sem_symbol_add(SemanticCtx *ctx, const char *name, SymbolKind kind, V
  */
 SemSymbol* sem_symbol_lookup_type(SemanticCtx *ctx, const char *name) {
     if (!name) return NULL;
+    if (ctx->current_decl) sem_decl_note_use(ctx, name);
     const char *dot = strchr(name, '.');
     if (dot) {
         char base_name[256];
@@ -434,6 +491,57 @@ SemSymbol* sem_symbol_lookup_type(SemanticCtx *ctx, const char *name) {
     return NULL;
 }
 
+/**
+ * @brief Suggest a visible symbol whose name is within a small edit distance of an unknown one.
+ *
+ * Local scopes are scanned directly. The global scope can hold thousands of
+ * symbols from imported C headers, so it is indexed in a BK-tree that is
+ * topped up with the symbols added since the previous suggestion.
+ *
+ * @param ctx Semantic context.
+ * @param name The unknown name.
+ * @return The suggested name, or NULL if nothing is close enough.
+ */
+const char* sem_suggest_symbol(SemanticCtx *ctx, const char *name) {
+    if (!name || !ctx->compiler_ctx || !ctx->compiler_ctx->arena) return NULL;
+    int max_dist = strlen(name) <= 3 ? 1 : 2;
+    const char *best = NULL;
+    int best_dist = max_dist + 1;
+
+    SemScope *scope = ctx->current_scope;
+    while (scope && scope != ctx->global_scope) {
+        SemSymbol *sym = scope->symbols;
+        while (sym) {
+            int d = levenshtein_bounded(name, sym->name, best_dist - 1);
+            if (d > 0 && d < best_dist) {
+                best = sym->name;
+                best_dist = d;
+            }
+            sym = sym->next;
+        }
+        scope = scope->parent;
+    }
+
+    if (ctx->global_scope && best_dist > 1) {
+        Arena *arena = ctx->compiler_ctx->arena;
+        if (!ctx->symbol_index) {
+            ctx->symbol_index = arena_alloc_type(arena, BKTree);
+            memset(ctx->symbol_index, 0, sizeof(BKTree));
+        }
+        BKTree *tree = (BKTree*)ctx->symbol_index;
+        SemSymbol *head = ctx->global_scope->symbols;
+        for (SemSymbol *sym = head; sym && sym != ctx->symbol_index_head; sym = sym->next) {
+            bk_tree_insert(tree, arena, sym->name);
+        }
+        ctx->symbol_index_head = head;
+
+        int d = 0;
+        const char *found = bk_tree_closest(tree, name, best_dist - 1, &d);
+        if (found && d > 0 && d < best_dist) best = found;
+    }
+    return best;
+}
+
 /**
  * @brief Look up any symbol by name, searching scopes and parent/inherited scopes.
  * @param ctx Semantic context.
@@ -443,6 +551,7 @@ SemSymbol* sem_symbol_lookup_type(SemanticCtx *ctx, const char *name) {
  */
 SemSymbol* sem_symbol_lookup(SemanticCtx *ctx, const char *name, SemScope **out_scope) {
     if (!name) return NULL;
+    if (ctx->current_decl) sem_decl_note_use(ctx, name);
     const char *dot = strchr(name, '.');
     if (dot && strchr(name, '/') == NULL && strchr(name, '\\') == NULL) {
         char base_name[256];
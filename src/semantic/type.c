@@ -318,6 +318,8 @@ void sem_check_assign(SemanticCtx *ctx, AssignNode *node) {
                 lhs_type = rhs_type;
             } else {
                 sem_error(ctx, (ASTNode*)node, "Undefined variable '%s'", node->name);
+                const char *suggestion = sem_suggest_symbol(ctx, node->name);
+                if (suggestion) sem_hint(ctx, (ASTNode*)node, "Did you mean '%s'?", suggestion);
                 lhs_type = (VarType){TYPE_UNKNOWN, 0, NULL, 0, 0, NULL, NULL, 0, 0, 0, 0};
             }
         } else {